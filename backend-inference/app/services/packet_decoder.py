@@ -0,0 +1,162 @@
+import struct
+import zlib
+from typing import Iterator, NamedTuple, Optional
+
+import numpy as np
+
+# Packet layout sent by esp32-client (little-endian), AudioPacketHeader in
+# esp32-client/lib/pipeline/include/packet_format.h:
+#   uint16 magic | uint8 version | uint8 header_size | uint32 sequence |
+#   uint64 timestamp_us | uint32 sample_rate | uint16 sample_count |
+#   uint16 payload_bytes | uint8 codec | uint8 flags | uint8 channels |
+#   uint8 reserved | uint32 crc32 | [version 2: int64 wall_clock_us] | payload
+# A message may hold several packets back to back. wall_clock_us is the
+# capture time as Unix microseconds on the receiver's clock (0 until the node
+# has synced) and is not covered by the CRC.
+HEADER_FORMAT = "<HBBIQIHHBBBxI"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+CRC_OFFSET = HEADER_SIZE - 4
+PACKET_MAGIC = 0x4E43
+PACKET_VERSION = 1
+WALL_CLOCK_VERSION = 2
+WALL_CLOCK_FORMAT = "<q"
+WALL_CLOCK_SIZE = struct.calcsize(WALL_CLOCK_FORMAT)
+
+FLAG_TRIGGER_START = 0x01
+FLAG_TRIGGER_END = 0x02
+FLAG_PREROLL = 0x04
+FLAG_OVERRUN = 0x08
+FLAG_SPOOLED = 0x10  # Held on the node while offline, delivered late
+
+# AudioCodecId in esp32-client/lib/pipeline/include/audio_codec.h
+CODEC_PCM16 = 0
+CODEC_PCM24 = 1
+CODEC_IMA_ADPCM = 2
+CODEC_LOG_MEL = 3  # Not audio: log-mel frames (MelPayloadHeader in mel_features.h)
+
+# MelPayloadHeader: bands, reserved, fft_size, hop, low_hz, high_hz, db_floor,
+# db_step_q4; then sample_count frames of `bands` bytes, dB = floor + code * step / 16
+MEL_HEADER_FORMAT = "<BxHHHHbB"
+MEL_HEADER_SIZE = struct.calcsize(MEL_HEADER_FORMAT)
+
+_IMA_INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8]
+_IMA_STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767,
+]
+
+
+def decode_ima_adpcm(data: bytes) -> np.ndarray:
+    """Decodes one self-contained IMA-ADPCM payload (4-byte state header)."""
+    if len(data) < 4:
+        return np.zeros(0, dtype=np.int16)
+    predictor, index = struct.unpack_from("<hB", data, 0)
+    index = min(max(index, 0), 88)
+    out = np.empty((len(data) - 4) * 2, dtype=np.int16)
+    n = 0
+    for byte in data[4:]:
+        for nibble in (byte & 0x0F, byte >> 4):
+            step = _IMA_STEP_TABLE[index]
+            delta = step >> 3
+            if nibble & 4:
+                delta += step
+            if nibble & 2:
+                delta += step >> 1
+            if nibble & 1:
+                delta += step >> 2
+            predictor = predictor - delta if nibble & 8 else predictor + delta
+            predictor = min(max(predictor, -32768), 32767)
+            index = min(max(index + _IMA_INDEX_TABLE[nibble], 0), 88)
+            out[n] = predictor
+            n += 1
+    return out
+
+
+def decode_samples(codec: int, payload: bytes) -> np.ndarray:
+    """Returns the payload as int16 samples."""
+    if codec == CODEC_PCM16:
+        return np.frombuffer(payload[: len(payload) & ~1], dtype=np.int16)
+    if codec == CODEC_PCM24:
+        raw = np.frombuffer(payload[: len(payload) - len(payload) % 3], dtype=np.uint8)
+        raw = raw.reshape(-1, 3).astype(np.uint16)
+        return (raw[:, 1] | (raw[:, 2] << 8)).view(np.int16)
+    if codec == CODEC_IMA_ADPCM:
+        return decode_ima_adpcm(payload)
+    raise ValueError(f"Unknown codec id {codec}")
+
+
+def decode_channels(codec: int, payload: bytes, sample_count: int, channels: int) -> np.ndarray:
+    """Returns the payload as interleaved int16 samples, sample_count per channel.
+
+    PCM payloads are interleaved on the wire. A multi-channel IMA-ADPCM payload
+    carries one self-contained block per channel, back to back in channel order."""
+    if codec != CODEC_IMA_ADPCM or channels <= 1:
+        return decode_samples(codec, payload)[:sample_count * max(channels, 1)]
+    block = 4 + (sample_count + 1) // 2
+    planes = [decode_ima_adpcm(payload[c * block:(c + 1) * block])[:sample_count] for c in range(channels)]
+    if any(len(plane) < sample_count for plane in planes):
+        raise ValueError(f"IMA-ADPCM payload too short for {channels} x {sample_count} samples")
+    return np.stack(planes, axis=1).reshape(-1)
+
+
+def decode_log_mel(payload: bytes, frame_count: int) -> np.ndarray:
+    """Returns a log-mel payload as a (frames, bands) float32 array in dB."""
+    if len(payload) < MEL_HEADER_SIZE:
+        raise ValueError("Truncated log-mel header")
+    bands, _, _, _, _, db_floor, db_step_q4 = struct.unpack_from(MEL_HEADER_FORMAT, payload, 0)
+    codes = np.frombuffer(payload, dtype=np.uint8, offset=MEL_HEADER_SIZE)
+    if bands == 0 or len(codes) < frame_count * bands:
+        raise ValueError(f"Log-mel payload too short for {frame_count} x {bands} frames")
+    codes = codes[:frame_count * bands].reshape(frame_count, bands)
+    return db_floor + codes.astype(np.float32) * (db_step_q4 / 16.0)
+
+
+class AudioPacket(NamedTuple):
+    sequence: int
+    timestamp_us: int
+    sample_rate: int
+    codec: int
+    flags: int
+    channels: int
+    samples: np.ndarray
+    wall_clock_us: int = 0
+    features: Optional[np.ndarray] = None  # CODEC_LOG_MEL: (frames, bands) dB; samples is then empty
+
+
+def iter_packets(message: bytes) -> Iterator[AudioPacket]:
+    """Decodes every packet in a node message, validating magic, version and CRC."""
+    view = memoryview(message)
+    offset = 0
+    while offset < len(view):
+        if len(view) - offset < HEADER_SIZE:
+            raise ValueError(f"Truncated header at offset {offset}")
+        (magic, version, header_size, sequence, timestamp_us, sample_rate, sample_count,
+         payload_bytes, codec, flags, channels, crc) = struct.unpack_from(HEADER_FORMAT, view, offset)
+        if magic != PACKET_MAGIC:
+            raise ValueError(f"Bad magic 0x{magic:04x} at offset {offset}")
+        # Newer versions may append header fields, but must keep this prefix
+        if version < PACKET_VERSION or header_size < HEADER_SIZE:
+            raise ValueError(f"Unsupported header version {version} (size {header_size})")
+        end = offset + header_size + payload_bytes
+        if end > len(view):
+            raise ValueError(f"Packet {sequence} runs past end of message")
+        payload = bytes(view[offset + header_size:end])
+        expected = zlib.crc32(payload, zlib.crc32(view[offset:offset + CRC_OFFSET])) & 0xFFFFFFFF
+        if crc != expected:
+            raise ValueError(f"CRC mismatch on packet {sequence}")
+        wall_clock_us = 0
+        if version >= WALL_CLOCK_VERSION and header_size >= HEADER_SIZE + WALL_CLOCK_SIZE:
+            (wall_clock_us,) = struct.unpack_from(WALL_CLOCK_FORMAT, view, offset + HEADER_SIZE)
+        if codec == CODEC_LOG_MEL:
+            features = decode_log_mel(payload, sample_count)
+            yield AudioPacket(sequence, timestamp_us, sample_rate, codec, flags, channels,
+                              np.zeros(0, dtype=np.int16), wall_clock_us, features)
+        else:
+            samples = decode_channels(codec, payload, sample_count, channels)
+            yield AudioPacket(sequence, timestamp_us, sample_rate, codec, flags, channels, samples, wall_clock_us)
+        offset = end
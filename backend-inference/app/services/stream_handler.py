@@ -1,12 +1,14 @@
 import asyncio
 import websockets
-import numpy as np
+
+from app.services.packet_decoder import iter_packets
 
 class AudioStreamHandler:
     def __init__(self, uri: str):
         self.uri = uri
         self.connected = False
         self.audio_queue = asyncio.Queue()
+        self.feature_queue = asyncio.Queue(maxsize=256)  # Log-mel packets (node output_mode features)
         self.stop_signal = False
 
     async def connect(self):
@@ -26,8 +28,17 @@ class AudioStreamHandler:
         try:
             async for message in websocket:
                 if isinstance(message, bytes):
-                    samples = np.frombuffer(message, dtype=np.int16)
-                    await self.audio_queue.put(samples)
+                    try:
+                        packets = list(iter_packets(message))
+                    except ValueError as e:
+                        print(f"[AudioStreamHandler] Dropping message: {e}")
+                        continue
+                    for packet in packets:
+                        if packet.features is not None:
+                            if not self.feature_queue.full():
+                                self.feature_queue.put_nowait(packet)
+                            continue
+                        await self.audio_queue.put(packet.samples)
         except websockets.ConnectionClosed:
             print("[AudioStreamHandler] Connection closed.")
         except Exception as e:
@@ -38,5 +49,8 @@ class AudioStreamHandler:
     async def get_audio_chunk(self):
         return await self.audio_queue.get()
 
+    async def get_feature_packet(self):
+        return await self.feature_queue.get()
+
     def shutdown(self):
         self.stop_signal = True
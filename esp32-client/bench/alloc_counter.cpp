@@ -0,0 +1,70 @@
+// bench/alloc_counter.cpp
+//
+// Heap hooks behind benchmark::AllocationCount(). On glibc the C allocator
+// itself is wrapped, which also catches operator new (it calls malloc);
+// elsewhere only operator new is counted.
+
+#include <errno.h>
+
+#include "benchmark.h"
+
+#if defined(__GLIBC__)
+
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+    void *__libc_memalign(size_t alignment, size_t size);
+
+    void *malloc(size_t size)
+    {
+        benchmark::allocationCounter().fetch_add(1, std::memory_order_relaxed);
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        benchmark::allocationCounter().fetch_add(1, std::memory_order_relaxed);
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *ptr, size_t size)
+    {
+        benchmark::allocationCounter().fetch_add(1, std::memory_order_relaxed);
+        return __libc_realloc(ptr, size);
+    }
+
+    void *aligned_alloc(size_t alignment, size_t size)
+    {
+        benchmark::allocationCounter().fetch_add(1, std::memory_order_relaxed);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void **ptr, size_t alignment, size_t size)
+    {
+        benchmark::allocationCounter().fetch_add(1, std::memory_order_relaxed);
+        *ptr = __libc_memalign(alignment, size);
+        return *ptr ? 0 : ENOMEM;
+    }
+}
+
+#else
+
+void *operator new(size_t size)
+{
+    benchmark::allocationCounter().fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+#endif
@@ -0,0 +1,458 @@
+#ifndef BENCH_BENCHMARK_H
+#define BENCH_BENCHMARK_H
+
+// bench/benchmark.h
+//
+// The part of the Google Benchmark API the pipeline suite uses, in one
+// header so the `native` environment needs nothing beyond a host compiler:
+// BENCHMARK(fn)->Arg()/Args()/ArgNames(), `for (auto _ : state)`,
+// state.range(), SetItemsProcessed(), SetBytesProcessed(), SetLabel(),
+// counters with kIsRate / kAvgIterations, DoNotOptimize() and
+// BENCHMARK_MAIN(). The --benchmark_filter, --benchmark_min_time and
+// --benchmark_format=console|csv flags behave like upstream's, so scripts
+// that drive or parse a Google Benchmark binary work unchanged.
+//
+// Two additions report what the firmware cares about: every timed run also
+// measures CPU cycles per iteration (TSC on x86, '-' elsewhere), and
+// benchmark::AllocationCount() counts heap allocations made through
+// operator new and, on glibc, malloc/calloc/realloc.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <new>
+#include <regex>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace benchmark
+{
+
+// === ALLOCATION COUNTING ===
+inline std::atomic<uint64_t> &allocationCounter()
+{
+    static std::atomic<uint64_t> count{0};
+    return count;
+}
+
+// Heap allocations since the program started
+inline uint64_t AllocationCount() { return allocationCounter().load(std::memory_order_relaxed); }
+
+// === CYCLES ===
+// Time stamp counter ticks: core cycles at the nominal frequency, so compare
+// runs on the same machine only. 0 where there is no such counter.
+inline uint64_t CycleCount()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// === OPTIMISER BARRIERS ===
+template <typename T>
+inline void DoNotOptimize(T const &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void ClobberMemory() { asm volatile("" : : : "memory"); }
+
+// === COUNTERS ===
+class Counter
+{
+public:
+    enum Flags
+    {
+        kDefaults = 0,
+        kIsRate = 1,         // Divided by the elapsed seconds
+        kAvgIterations = 2,  // Divided by the iteration count
+    };
+
+    Counter(double v = 0.0, Flags f = kDefaults) : value(v), flags(f) {}
+
+    double value;
+    Flags flags;
+};
+
+// === STATE ===
+class State
+{
+public:
+    // What `for (auto _ : state)` binds; marked unused like upstream's so the
+    // loop variable does not warn
+    struct __attribute__((unused)) Value
+    {
+    };
+
+    class StateIterator
+    {
+    public:
+        StateIterator(State *owner, uint64_t count) : parent(owner), remaining(count) {}
+        Value operator*() const { return Value(); }
+        StateIterator &operator++()
+        {
+            --remaining;
+            return *this;
+        }
+        bool operator!=(const StateIterator &) const
+        {
+            if (remaining > 0)
+            {
+                return true;
+            }
+            parent->finishKeepRunning();
+            return false;
+        }
+
+    private:
+        State *parent;
+        uint64_t remaining;
+    };
+
+    State(const std::vector<int64_t> &arguments, uint64_t iterations) : args(arguments), max_iterations(iterations) {}
+
+    StateIterator begin()
+    {
+        start_cycles = CycleCount();
+        start_time = std::chrono::steady_clock::now();
+        return StateIterator(this, max_iterations);
+    }
+    StateIterator end() { return StateIterator(this, 0); }
+
+    int64_t range(size_t index = 0) const { return index < args.size() ? args[index] : 0; }
+    uint64_t iterations() const { return max_iterations; }
+
+    void SetItemsProcessed(int64_t items) { items_processed = items; }
+    void SetBytesProcessed(int64_t bytes) { bytes_processed = bytes; }
+    void SetLabel(const std::string &text) { label = text; }
+    void SkipWithError(const char *message) { error = message; }
+
+    std::map<std::string, Counter> counters;
+
+    // Filled in by the runner
+    double elapsed_seconds = 0.0;
+    uint64_t elapsed_cycles = 0;
+    int64_t items_processed = 0;
+    int64_t bytes_processed = 0;
+    std::string label;
+    std::string error;
+
+private:
+    void finishKeepRunning()
+    {
+        const auto stop_time = std::chrono::steady_clock::now();
+        elapsed_cycles = CycleCount() - start_cycles;
+        elapsed_seconds = std::chrono::duration<double>(stop_time - start_time).count();
+    }
+
+    std::vector<int64_t> args;
+    uint64_t max_iterations;
+    uint64_t start_cycles = 0;
+    std::chrono::steady_clock::time_point start_time;
+};
+
+// === REGISTRATION ===
+typedef void (*Function)(State &);
+
+class Benchmark
+{
+public:
+    Benchmark(const char *benchmark_name, Function benchmark_fn) : name(benchmark_name), fn(benchmark_fn) {}
+
+    Benchmark *Arg(int64_t value)
+    {
+        arg_sets.push_back({value});
+        return this;
+    }
+    Benchmark *Args(const std::vector<int64_t> &values)
+    {
+        arg_sets.push_back(values);
+        return this;
+    }
+    Benchmark *ArgName(const std::string &arg_name)
+    {
+        arg_names = {arg_name};
+        return this;
+    }
+    Benchmark *ArgNames(const std::vector<std::string> &names)
+    {
+        arg_names = names;
+        return this;
+    }
+
+    std::string runName(const std::vector<int64_t> &values) const
+    {
+        std::string full = name;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            full += "/";
+            if (i < arg_names.size() && !arg_names[i].empty())
+            {
+                full += arg_names[i] + ":";
+            }
+            full += std::to_string(values[i]);
+        }
+        return full;
+    }
+
+    std::string name;
+    Function fn;
+    std::vector<std::vector<int64_t>> arg_sets;
+    std::vector<std::string> arg_names;
+};
+
+inline std::vector<Benchmark *> &registry()
+{
+    static std::vector<Benchmark *> benchmarks;
+    return benchmarks;
+}
+
+inline Benchmark *RegisterBenchmark(const char *name, Function fn)
+{
+    registry().push_back(new Benchmark(name, fn));
+    return registry().back();
+}
+
+// === RUNNER ===
+struct RunReport
+{
+    std::string name;
+    uint64_t iterations;
+    State state;
+};
+
+inline std::string formatRate(double per_second, const char *unit)
+{
+    static const char *const prefixes[] = {"", "k", "M", "G", "T"};
+    size_t prefix = 0;
+    while (per_second >= 1000.0 && prefix < 4)
+    {
+        per_second /= 1000.0;
+        ++prefix;
+    }
+    char text[32];
+    snprintf(text, sizeof(text), "%.4g%s%s/s", per_second, prefixes[prefix], unit);
+    return text;
+}
+
+inline double counterValue(const Counter &counter, const State &state)
+{
+    double value = counter.value;
+    if (counter.flags & Counter::kAvgIterations)
+    {
+        value /= (double)state.iterations();
+    }
+    if ((counter.flags & Counter::kIsRate) && state.elapsed_seconds > 0.0)
+    {
+        value /= state.elapsed_seconds;
+    }
+    return value;
+}
+
+// Grows the iteration count the way upstream does until a run lasts min_time
+inline State runOne(const Benchmark &bench, const std::vector<int64_t> &args, double min_time)
+{
+    uint64_t iterations = 1;
+    for (;;)
+    {
+        State state(args, iterations);
+        bench.fn(state);
+        if (!state.error.empty() || state.elapsed_seconds >= min_time || iterations >= 1000000000ull)
+        {
+            return state;
+        }
+        double multiplier = state.elapsed_seconds > 0.0 ? min_time * 1.4 / state.elapsed_seconds : 10.0;
+        if (state.elapsed_seconds < min_time / 10.0)
+        {
+            multiplier = multiplier < 10.0 ? multiplier : 10.0;
+        }
+        multiplier = multiplier > 1.0 ? multiplier : 2.0;
+        iterations = (uint64_t)(iterations * multiplier) + 1;
+    }
+}
+
+inline void printConsole(const RunReport &report)
+{
+    const State &state = report.state;
+    if (!state.error.empty())
+    {
+        printf("%-44s ERROR: %s\n", report.name.c_str(), state.error.c_str());
+        return;
+    }
+    const double seconds = state.elapsed_seconds;
+    const double ns_per_iter = seconds * 1e9 / report.iterations;
+    char cycles[24] = "-";
+    if (state.elapsed_cycles > 0)
+    {
+        snprintf(cycles, sizeof(cycles), "%.0f", (double)state.elapsed_cycles / report.iterations);
+    }
+    printf("%-44s %12.1f ns %12s %12llu", report.name.c_str(), ns_per_iter, cycles, (unsigned long long)report.iterations);
+    if (state.items_processed > 0 && seconds > 0.0)
+    {
+        printf(" items_per_second=%s", formatRate(state.items_processed / seconds, "").c_str());
+    }
+    if (state.bytes_processed > 0 && seconds > 0.0)
+    {
+        printf(" bytes_per_second=%s", formatRate(state.bytes_processed / seconds, "B").c_str());
+    }
+    for (const auto &entry : state.counters)
+    {
+        printf(" %s=%.4g", entry.first.c_str(), counterValue(entry.second, state));
+    }
+    if (!state.label.empty())
+    {
+        printf(" %s", state.label.c_str());
+    }
+    printf("\n");
+}
+
+// Counter columns are the union over all runs, as upstream's CSV reporter does
+inline void printCsv(const std::vector<RunReport> &reports)
+{
+    std::vector<std::string> counter_names;
+    for (const RunReport &report : reports)
+    {
+        for (const auto &entry : report.state.counters)
+        {
+            bool known = false;
+            for (const std::string &name : counter_names)
+            {
+                known = known || name == entry.first;
+            }
+            if (!known)
+            {
+                counter_names.push_back(entry.first);
+            }
+        }
+    }
+    printf("name,iterations,real_time,cpu_cycles,time_unit,bytes_per_second,items_per_second,label,error_occurred,error_message");
+    for (const std::string &name : counter_names)
+    {
+        printf(",\"%s\"", name.c_str());
+    }
+    printf("\n");
+    for (const RunReport &report : reports)
+    {
+        const State &state = report.state;
+        const double seconds = state.elapsed_seconds;
+        printf("\"%s\",%llu,%.3f,%.1f,ns,", report.name.c_str(), (unsigned long long)report.iterations,
+               seconds * 1e9 / report.iterations, (double)state.elapsed_cycles / report.iterations);
+        if (state.bytes_processed > 0 && seconds > 0.0)
+        {
+            printf("%.6g", state.bytes_processed / seconds);
+        }
+        printf(",");
+        if (state.items_processed > 0 && seconds > 0.0)
+        {
+            printf("%.6g", state.items_processed / seconds);
+        }
+        printf(",\"%s\",%s,\"%s\"", state.label.c_str(), state.error.empty() ? "false" : "true", state.error.c_str());
+        for (const std::string &name : counter_names)
+        {
+            const auto found = state.counters.find(name);
+            printf(",");
+            if (found != state.counters.end())
+            {
+                printf("%.6g", counterValue(found->second, state));
+            }
+        }
+        printf("\n");
+    }
+}
+
+inline int RunSpecifiedBenchmarks(int argc, char **argv)
+{
+    std::string filter = ".";
+    std::string format = "console";
+    double min_time = 0.5;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--benchmark_filter=", 19) == 0)
+        {
+            filter = arg + 19;
+        }
+        else if (strncmp(arg, "--benchmark_min_time=", 21) == 0)
+        {
+            min_time = atof(arg + 21); // Accepts "0.5" and "0.5s"
+        }
+        else if (strncmp(arg, "--benchmark_format=", 19) == 0)
+        {
+            format = arg + 19;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--benchmark_filter=<regex>] [--benchmark_min_time=<seconds>] "
+                            "[--benchmark_format=console|csv]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (format != "console" && format != "csv")
+    {
+        fprintf(stderr, "unknown --benchmark_format=%s\n", format.c_str());
+        return 1;
+    }
+    const std::regex pattern(filter);
+
+    if (format == "console")
+    {
+        printf("%-44s %15s %12s %12s\n", "Benchmark", "Time", "Cycles", "Iterations");
+        printf("%s\n", std::string(86, '-').c_str());
+    }
+    std::vector<RunReport> reports;
+    for (const Benchmark *bench : registry())
+    {
+        std::vector<std::vector<int64_t>> arg_sets = bench->arg_sets;
+        if (arg_sets.empty())
+        {
+            arg_sets.push_back({});
+        }
+        for (const std::vector<int64_t> &args : arg_sets)
+        {
+            const std::string name = bench->runName(args);
+            if (!std::regex_search(name, pattern))
+            {
+                continue;
+            }
+            State state = runOne(*bench, args, min_time);
+            reports.push_back({name, state.iterations(), state});
+            if (format == "console")
+            {
+                printConsole(reports.back());
+                fflush(stdout);
+            }
+        }
+    }
+    if (format == "csv")
+    {
+        printCsv(reports);
+    }
+    return 0;
+}
+
+} // namespace benchmark
+
+#define BENCHMARK_CONCAT_INNER(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_INNER(a, b)
+#define BENCHMARK(fn)                                                                    \
+    static ::benchmark::Benchmark *BENCHMARK_CONCAT(benchmark_registration_, __LINE__) \
+        __attribute__((unused)) = ::benchmark::RegisterBenchmark(#fn, fn)
+
+#define BENCHMARK_MAIN()                                         \
+    int main(int argc, char **argv)                              \
+    {                                                            \
+        return ::benchmark::RunSpecifiedBenchmarks(argc, argv); \
+    }
+
+#endif // BENCH_BENCHMARK_H
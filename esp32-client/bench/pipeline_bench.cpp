@@ -0,0 +1,282 @@
+// bench/pipeline_bench.cpp
+//
+// Host benchmarks for the capture -> process -> packetize pipeline in
+// lib/pipeline. One iteration is one capture frame (MAX_SAMPLES_PER_READ
+// samples at 48 kHz), so the Cycles column is cycles per frame and
+// items_per_second is samples per second. Build and run with
+//   pio run -e native -t exec
+// or pass Google Benchmark flags to .pio/build/native/program, e.g.
+//   --benchmark_filter=Packetize --benchmark_format=csv
+
+#include <math.h>
+#include <string.h>
+
+#include "benchmark.h"
+#include "audio_codec.h"
+#include "audio_dsp.h"
+#include "frame_encoder.h"
+#include "mel_features.h"
+#include "packet_format.h"
+#include "spectral_detector.h"
+
+#define BENCH_SAMPLE_RATE 48000
+
+// === Input ===
+// Mic-like frame: a 4 kHz tone at -12 dBFS over low-level noise, 24-bit
+// samples left-justified in 32-bit words as the I2S driver delivers them
+struct BenchFrame
+{
+    BenchFrame()
+    {
+        uint32_t lcg = 12345;
+        for (size_t i = 0; i < MAX_SAMPLES_PER_READ; ++i)
+        {
+            lcg = lcg * 1664525u + 1013904223u;
+            const double tone = 0.25 * sin(2.0 * M_PI * 4000.0 * i / BENCH_SAMPLE_RATE);
+            const double noise = ((int32_t)lcg >> 8) / 8388608.0 * 0.01;
+            samples[i] = (int32_t)((tone + noise) * 8388607.0) * 256;
+        }
+    }
+
+    alignas(AUDIO_DSP_ALIGN) int32_t samples[MAX_SAMPLES_PER_READ];
+};
+
+static const BenchFrame bench_frame;
+
+static void setSamplesProcessed(benchmark::State &state, size_t per_iteration)
+{
+    state.SetItemsProcessed((int64_t)(state.iterations() * per_iteration));
+}
+
+// === Conversion ===
+// range(0): output_bits, 0 = statistics only
+static void BM_ConvertFrame(benchmark::State &state)
+{
+    const uint8_t bits = (uint8_t)state.range(0);
+    alignas(AUDIO_DSP_ALIGN) static uint8_t out[MAX_PACKET_PAYLOAD_BYTES];
+    FrameStats stats;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(convertFrame(bench_frame.samples, MAX_SAMPLES_PER_READ, bits ? bits : 16,
+                                              bits ? out : nullptr, stats));
+        benchmark::ClobberMemory();
+    }
+    setSamplesProcessed(state, MAX_SAMPLES_PER_READ);
+}
+BENCHMARK(BM_ConvertFrame)->ArgName("bits")->Arg(0)->Arg(16)->Arg(24);
+
+static void BM_ConvertFrameScalar(benchmark::State &state)
+{
+    const uint8_t bits = (uint8_t)state.range(0);
+    alignas(AUDIO_DSP_ALIGN) static uint8_t out[MAX_PACKET_PAYLOAD_BYTES];
+    FrameStats stats;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(convertFrameScalar(bench_frame.samples, MAX_SAMPLES_PER_READ, bits ? bits : 16,
+                                                    bits ? out : nullptr, stats));
+        benchmark::ClobberMemory();
+    }
+    setSamplesProcessed(state, MAX_SAMPLES_PER_READ);
+}
+BENCHMARK(BM_ConvertFrameScalar)->ArgName("bits")->Arg(0)->Arg(16)->Arg(24);
+
+// Gain + DC blocker + 100 Hz high-pass fused into the conversion. Runs in
+// place on a copy of the frame; the values drift but the cost does not.
+static void BM_ProcessConvertFrame(benchmark::State &state)
+{
+    const uint8_t bits = (uint8_t)state.range(0);
+    alignas(AUDIO_DSP_ALIGN) static int32_t raw[MAX_SAMPLES_PER_READ];
+    alignas(AUDIO_DSP_ALIGN) static uint8_t out[MAX_PACKET_PAYLOAD_BYTES];
+    memcpy(raw, bench_frame.samples, sizeof(raw));
+    SamplePreprocessor preprocessor;
+    preprocessor.configure(4.0f, true, 100.0f, BENCH_SAMPLE_RATE);
+    FrameStats stats;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(processConvertFrame(raw, MAX_SAMPLES_PER_READ, bits ? bits : 16,
+                                                     bits ? out : nullptr, stats, preprocessor));
+        benchmark::ClobberMemory();
+    }
+    setSamplesProcessed(state, MAX_SAMPLES_PER_READ);
+}
+BENCHMARK(BM_ProcessConvertFrame)->ArgName("bits")->Arg(0)->Arg(16)->Arg(24);
+
+// === Codec ===
+static void BM_ImaAdpcmEncode(benchmark::State &state)
+{
+    static int16_t pcm[MAX_SAMPLES_PER_READ];
+    static uint8_t out[IMA_ADPCM_BLOCK_HEADER + MAX_SAMPLES_PER_READ / 2];
+    for (size_t i = 0; i < MAX_SAMPLES_PER_READ; ++i)
+    {
+        pcm[i] = rawToSample16(bench_frame.samples[i]);
+    }
+    ImaAdpcmState adpcm;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(imaAdpcmEncode(pcm, MAX_SAMPLES_PER_READ, out, adpcm));
+        benchmark::ClobberMemory();
+    }
+    setSamplesProcessed(state, MAX_SAMPLES_PER_READ);
+}
+BENCHMARK(BM_ImaAdpcmEncode);
+
+// === Decimation ===
+// range(0): factor; samples counted at the input rate
+static void BM_Decimate(benchmark::State &state)
+{
+    static PolyphaseDecimator decimator;
+    alignas(AUDIO_DSP_ALIGN) static int32_t decimated[MAX_SAMPLES_PER_READ / 2 + 1];
+    if (!decimator.configure((uint8_t)state.range(0)))
+    {
+        state.SkipWithError("unsupported factor");
+        return;
+    }
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(decimator.process(bench_frame.samples, MAX_SAMPLES_PER_READ, decimated));
+        benchmark::ClobberMemory();
+    }
+    setSamplesProcessed(state, MAX_SAMPLES_PER_READ);
+    state.SetLabel(std::to_string(decimator.taps()) + " taps");
+}
+BENCHMARK(BM_Decimate)->ArgName("factor")->Arg(2)->Arg(3)->Arg(4);
+
+// === Channels ===
+// range(0): channels; the frame is split into planes and put back
+static void BM_Deinterleave(benchmark::State &state)
+{
+    const uint8_t channels = (uint8_t)state.range(0);
+    const size_t frames = MAX_SAMPLES_PER_READ / channels;
+    const size_t stride = planeStride(frames);
+    alignas(AUDIO_DSP_ALIGN) static int32_t planes[MAX_SAMPLES_PER_READ + AUDIO_MAX_CHANNELS * AUDIO_DSP_SIMD_BLOCK];
+    alignas(AUDIO_DSP_ALIGN) static int32_t interleaved[MAX_SAMPLES_PER_READ];
+    for (auto _ : state)
+    {
+        deinterleaveFrame(bench_frame.samples, frames, channels, planes, stride);
+        benchmark::ClobberMemory();
+        interleaveFrame(planes, stride, frames, channels, interleaved);
+        benchmark::ClobberMemory();
+    }
+    setSamplesProcessed(state, frames * channels);
+}
+BENCHMARK(BM_Deinterleave)->ArgName("channels")->Arg(2)->Arg(4);
+
+// === Spectral Trigger ===
+// One frame is one hop: window + FFT + band split every iteration
+static void BM_SpectralDetector(benchmark::State &state)
+{
+    static SpectralDetector detector; // ~16 KB
+    detector.begin(BENCH_SAMPLE_RATE, 1000.0f, 10000.0f);
+    for (size_t filled = 0; filled < SPECTRAL_FFT_SIZE; filled += MAX_SAMPLES_PER_READ)
+    {
+        detector.process(bench_frame.samples, MAX_SAMPLES_PER_READ); // Fill the window
+    }
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(detector.process(bench_frame.samples, MAX_SAMPLES_PER_READ));
+        benchmark::ClobberMemory();
+    }
+    setSamplesProcessed(state, MAX_SAMPLES_PER_READ);
+    state.SetLabel(SpectralDetector::usingEspDsp() ? "esp-dsp" : "portable");
+}
+BENCHMARK(BM_SpectralDetector);
+
+// Log-mel frame from the detector's last analysis: the extra cost of
+// features mode on top of the spectral trigger
+static void BM_MelFeatures(benchmark::State &state)
+{
+    static SpectralDetector detector;
+    static MelFeatureExtractor extractor;
+    detector.begin(BENCH_SAMPLE_RATE, 1000.0f, 10000.0f);
+    extractor.begin(BENCH_SAMPLE_RATE);
+    for (size_t filled = 0; filled <= SPECTRAL_FFT_SIZE; filled += MAX_SAMPLES_PER_READ)
+    {
+        detector.process(bench_frame.samples, MAX_SAMPLES_PER_READ);
+    }
+    uint8_t frame[MEL_BANDS];
+    for (auto _ : state)
+    {
+        extractor.compute(detector, frame);
+        benchmark::DoNotOptimize(frame);
+        benchmark::ClobberMemory();
+    }
+    setSamplesProcessed(state, SPECTRAL_HOP);
+}
+BENCHMARK(BM_MelFeatures);
+
+// === Packetization ===
+// What the network task does for every transmitted frame: condition,
+// decimate, encode into a packet buffer and stamp the header and CRC.
+// range(0): AudioCodecId on the wire
+// range(1): decimation factor
+// range(2): interleaved channels in the frame
+static void BM_Packetize(benchmark::State &state)
+{
+    const AudioCodecId codec = (AudioCodecId)state.range(0);
+    const bool adpcm = codec == AUDIO_CODEC_IMA_ADPCM;
+    const uint8_t bits = codec == AUDIO_CODEC_PCM24 ? 24 : 16;
+    alignas(AUDIO_DSP_ALIGN) static uint8_t storage[PACKET_PAYLOAD_OFFSET + MAX_PACKET_PAYLOAD_BYTES];
+    alignas(AUDIO_DSP_ALIGN) static int32_t raw[MAX_SAMPLES_PER_READ];
+    static FrameEncoder encoder;
+    PacketBuffer packet = {storage, 0};
+
+    // Firmware defaults: unity gain with the DC blocker on
+    encoder.setFormat(BENCH_SAMPLE_RATE, bits, adpcm ? CODEC_SETTING_IMA_ADPCM : CODEC_SETTING_PCM, (uint8_t)state.range(2));
+    encoder.configurePreprocessor(1.0f, true, 0.0f);
+    if (!encoder.setDecimation((uint8_t)state.range(1)))
+    {
+        state.SkipWithError("unsupported factor");
+        return;
+    }
+    memcpy(raw, bench_frame.samples, sizeof(raw));
+
+    uint32_t sequence = 0;
+    size_t packet_bytes = 0;
+    const uint64_t allocations_before = benchmark::AllocationCount();
+    for (auto _ : state)
+    {
+        FrameStats stats;
+        EncodedPayload encoded;
+        encoder.conditionAndEncode(raw, MAX_SAMPLES_PER_READ, packet.payload(), stats, encoded);
+        finalizePacket(&packet, sequence++, 0, 0, encoded.sample_rate, encoded.samples, encoded.channels, encoded.codec, 0,
+                       encoded.bytes);
+        packet_bytes += packet.length;
+        benchmark::DoNotOptimize(packet.header()->crc32);
+    }
+    const uint64_t allocations = benchmark::AllocationCount() - allocations_before;
+
+    setSamplesProcessed(state, MAX_SAMPLES_PER_READ);
+    state.SetBytesProcessed((int64_t)packet_bytes);
+    state.counters["allocs/packet"] = benchmark::Counter((double)allocations, benchmark::Counter::kAvgIterations);
+    state.counters["bytes/packet"] = benchmark::Counter((double)packet_bytes, benchmark::Counter::kAvgIterations);
+    state.SetLabel(codecName(codec));
+}
+BENCHMARK(BM_Packetize)
+    ->ArgNames({"codec", "decimate", "channels"})
+    ->Args({AUDIO_CODEC_PCM16, 1, 1})
+    ->Args({AUDIO_CODEC_PCM24, 1, 1})
+    ->Args({AUDIO_CODEC_IMA_ADPCM, 1, 1})
+    ->Args({AUDIO_CODEC_PCM16, 2, 1})
+    ->Args({AUDIO_CODEC_PCM24, 2, 1})
+    ->Args({AUDIO_CODEC_IMA_ADPCM, 2, 1})
+    ->Args({AUDIO_CODEC_PCM16, 4, 1})
+    ->Args({AUDIO_CODEC_PCM16, 1, 2})
+    ->Args({AUDIO_CODEC_IMA_ADPCM, 1, 2})
+    ->Args({AUDIO_CODEC_PCM16, 2, 2})
+    ->Args({AUDIO_CODEC_PCM16, 1, 4})
+    ->Args({AUDIO_CODEC_IMA_ADPCM, 2, 4});
+
+// Header + payload CRC for the largest packet (24-bit PCM)
+static void BM_Crc32(benchmark::State &state)
+{
+    static uint8_t payload[MAX_PACKET_PAYLOAD_BYTES];
+    memcpy(payload, bench_frame.samples, sizeof(payload));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(crc32Update(0, payload, sizeof(payload)));
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * sizeof(payload)));
+}
+BENCHMARK(BM_Crc32);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,112 @@
+#ifndef AUDIO_CAPTURE_H
+#define AUDIO_CAPTURE_H
+
+#include <Arduino.h>
+#include "packet_format.h" // I2S_READ_BUFFER_SIZE / MAX_SAMPLES_PER_READ
+#include "spsc_ring.h"
+
+// === CAPTURE CONSTANTS ===
+#define CAPTURE_RING_FRAMES 32                          // Frames buffered between capture and network (power of two)
+#define CAPTURE_TASK_CORE 1                             // APP CPU; WiFi/lwIP live on core 0
+#define CAPTURE_TASK_PRIORITY 18
+#define CAPTURE_TASK_STACK 4096
+
+// Limits of the legacy I2S driver for AudioSettings::dma_buf_count / dma_buf_len
+#define I2S_DMA_BUF_COUNT_MIN 2
+#define I2S_DMA_BUF_COUNT_MAX 128
+#define I2S_DMA_BUF_LEN_MIN 8     // Frames per DMA buffer
+#define I2S_DMA_BUF_LEN_MAX 1024
+#define CAPTURE_SAMPLE_RATE_MIN 8000
+#define CAPTURE_SAMPLE_RATE_MAX 96000
+#define I2S_EVENT_QUEUE_LEN 32    // Drained after every read; RX_DONE arrives once per DMA buffer
+#define CAPTURE_RATE_PUBLISH_US 1000000
+
+// AudioSettings::channels. Both stereo mics share I2S_SD (one strapped
+// left, one right); four channels need a TDM mic array and a chip whose I2S
+// supports TDM, and fall back to stereo elsewhere.
+#define CAPTURE_CHANNELS_MONO 1
+#define CAPTURE_CHANNELS_STEREO 2
+#define CAPTURE_CHANNELS_TDM 4
+
+// Everything about a CaptureFrame but its samples, split out so a copy of
+// one frame's metadata is a single assignment
+struct CaptureFrameInfo
+{
+    uint64_t timestamp;     // Capture time of the first sample (microseconds from esp_timer)
+    uint32_t sample_count;  // Valid entries in samples[], all channels together
+    uint8_t channels;       // Interleaved channels, 1..AUDIO_MAX_CHANNELS
+    bool after_overrun;     // Frames were dropped between this one and the last
+    uint32_t sample_rate;   // Rate the driver was running at when this frame was read
+    uint16_t generation;    // captureGeneration() at the time of the read
+};
+
+// One i2s_read worth of raw 32-bit I2S words, stamped with the capture time
+// of its first sample: the read's completion less the audio it returned.
+// samples[] is 16-byte aligned so the SIMD conversion kernel can load it directly.
+// With more than one channel the words are interleaved, slot 0 first, so a
+// frame holds sample_count / channels samples of each channel.
+struct alignas(16) CaptureFrame : CaptureFrameInfo
+{
+    alignas(16) int32_t samples[MAX_SAMPLES_PER_READ];
+};
+
+// Audio a frame holds, in microseconds at the rate it was read at
+static inline uint64_t captureFrameDurationUs(const CaptureFrameInfo &frame)
+{
+    return (uint64_t)(frame.sample_count / frame.channels) * 1000000ULL / frame.sample_rate;
+}
+
+struct AudioSettings;
+
+// What the I2S driver is installed with, taken from AudioSettings with the
+// DMA geometry clamped to the driver's range and APLL dropped where the chip
+// has none
+struct CaptureConfig
+{
+    uint32_t sample_rate;
+    uint16_t dma_buf_count;
+    uint16_t dma_buf_len;
+    bool use_apll;
+    bool simulate;    // Synthetic source instead of the driver (synthetic_source.h)
+    uint8_t channels; // CAPTURE_CHANNELS_*, TDM only where the chip has it
+
+    bool operator==(const CaptureConfig &other) const
+    {
+        return sample_rate == other.sample_rate && dma_buf_count == other.dma_buf_count &&
+               dma_buf_len == other.dma_buf_len && use_apll == other.use_apll && simulate == other.simulate &&
+               channels == other.channels;
+    }
+    bool operator!=(const CaptureConfig &other) const { return !(*this == other); }
+};
+
+CaptureConfig captureConfigFor(const AudioSettings &settings);
+
+// Filled by the capture task, drained by the network task.
+extern SpscRing<CaptureFrame> capture_ring;
+
+// Installs the I2S driver from the sample_rate / dma_buf_count /
+// dma_buf_len / use_apll / channels settings (or, with simulate_mic, starts the
+// synthetic source instead) and starts a fresh sample rate measurement.
+void setupI2S();
+
+// === LIVE RECONFIGURATION ===
+// The capture task owns the driver once it runs, so a new configuration is
+// handed to it and installed between two reads: it uninstalls the driver,
+// installs it with the new configuration (or switches to or from the
+// synthetic source) and carries on reading. If the new
+// configuration cannot be installed the previous one is restored. Frames
+// read afterwards carry the next generation.
+//
+// Called from the network task only. requestCaptureReconfigure() returns
+// false while an earlier request is still pending; activeCaptureConfig() and
+// captureGeneration() are only meaningful once it has completed.
+bool requestCaptureReconfigure(const CaptureConfig &config);
+bool captureReconfigurePending();
+CaptureConfig activeCaptureConfig();
+uint16_t captureGeneration();
+
+// Allocates the capture ring and starts the capture task pinned to
+// CAPTURE_TASK_CORE. `consumer` is notified every time a frame is committed.
+bool startCaptureTask(TaskHandle_t consumer);
+
+#endif // AUDIO_CAPTURE_H
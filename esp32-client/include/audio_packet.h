@@ -0,0 +1,89 @@
+#ifndef AUDIO_PACKET_H
+#define AUDIO_PACKET_H
+
+#include <Arduino.h>
+#include "packet_format.h"
+#include "memory_policy.h"
+
+// === PACKET POOL ===
+#define PACKET_POOL_SIZE 4                              // Buffers available to the send path
+#define PACKET_BATCH_MAX_BYTES 8192                     // Upper bound for the batch_max_bytes setting
+
+// Where the pool lives. Define PACKET_POOL_USE_PSRAM in build_flags to move it
+// to external RAM; the default keeps it in internal RAM next to the WiFi buffers.
+#ifdef PACKET_POOL_USE_PSRAM
+#define PACKET_POOL_MEMORY MEMORY_BULK
+#else
+#define PACKET_POOL_MEMORY MEMORY_HOT
+#endif
+
+// Fixed set of packet buffers allocated once at boot. acquire()/release()
+// never touch the heap, so the send path cannot fragment it.
+class PacketPool
+{
+public:
+    bool begin(size_t count, size_t payload_capacity, MemoryClass placement);
+
+    PacketBuffer *acquire(); // nullptr when every buffer is in flight
+    void release(PacketBuffer *buffer);
+
+    size_t available() const { return free_count; }
+    size_t capacity() const { return count; }
+    size_t payloadCapacity() const { return payload_capacity; }
+    uint32_t exhaustedCount() const { return exhausted; }
+
+private:
+    PacketBuffer *buffers = nullptr;
+    PacketBuffer **free_list = nullptr;
+    size_t count = 0;
+    size_t payload_capacity = 0;
+    volatile size_t free_count = 0;
+    volatile uint32_t exhausted = 0; // acquire() calls that found the pool empty
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+};
+
+extern PacketPool packet_pool;
+
+// Coalesces finished packets into one WebSocket message. Packets are copied in
+// back to back (receivers split them via header_size + payload_bytes) behind
+// the same PACKET_HEADROOM, so the whole batch still goes out with a single
+// sendBIN(..., true) and no allocation.
+class PacketBatch
+{
+public:
+    bool begin(size_t capacity, MemoryClass placement);
+
+    // True if `bytes` more would still fit under `limit` (and the buffer)
+    bool fits(size_t bytes, size_t limit) const { return used + bytes <= min(limit, capacity_bytes); }
+    // Copies the packet in; returns false if it does not fit the buffer
+    bool append(PacketBuffer *packet, uint32_t now_ms);
+    // True once the oldest queued packet has waited `max_delay_ms`
+    bool due(uint32_t now_ms, uint32_t max_delay_ms) const { return packet_count > 0 && now_ms - first_ms >= max_delay_ms; }
+
+    uint8_t *wsFrame() { return storage; } // What sendBIN(..., true) expects
+    size_t length() const { return used; }
+    size_t packets() const { return packet_count; }
+    size_t capacity() const { return capacity_bytes; }
+    bool empty() const { return packet_count == 0; }
+
+    void markSent(); // Records the batch in the counters below and empties it
+    void clear();    // Drops whatever is queued (e.g. on disconnect)
+
+    uint32_t batchesSent() const { return batches_sent; }
+    float averagePackets() const { return batches_sent ? (float)packets_sent / batches_sent : 0.0f; }
+    float averageBytes() const { return batches_sent ? (float)bytes_sent / batches_sent : 0.0f; }
+
+private:
+    uint8_t *storage = nullptr; // [PACKET_HEADROOM][packets ...]
+    size_t capacity_bytes = 0;
+    size_t used = 0;
+    size_t packet_count = 0;
+    uint32_t first_ms = 0;
+    uint32_t batches_sent = 0;
+    uint64_t packets_sent = 0;
+    uint64_t bytes_sent = 0;
+};
+
+extern PacketBatch packet_batch;
+
+#endif // AUDIO_PACKET_H
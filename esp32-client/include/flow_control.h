@@ -0,0 +1,92 @@
+#ifndef FLOW_CONTROL_H
+#define FLOW_CONTROL_H
+
+#include <Arduino.h>
+
+// === FLOW CONTROL ===
+// Limits on what the node sends, on top of the settings: requested by the
+// receiver when its ingest is over budget, or taken by the node itself when
+// its own send path backs up. Limits only ever reduce the load: the
+// effective value is the most conservative of the setting, the receiver's
+// request and the automatic level.
+//
+// Receiver requests are {"type":"flow",...} text messages on the WebSocket.
+// Every field is optional and a message only changes the fields it carries:
+//   "pause": true|false         Live audio goes to the spool instead (drained after resume)
+//   "codec": "ima_adpcm"|null   Force the 4:1 codec, or go back to the codec setting
+//   "decimate": 1..4|null       Minimum output decimation factor
+//   "batch_max_bytes": n|null   Minimum WS batch size (fewer, larger messages)
+//   "batch_max_delay_ms": n|null
+//   "ttl_ms": n                 Requests lapse after this long unless repeated (default FLOW_REQUEST_TTL_MS)
+//   "clear": true               Drops every receiver request
+// so a receiver that crashes mid-throttle never leaves the fleet throttled.
+//
+// With AudioSettings::flow_auto the node also steps through FLOW_AUTO_LEVELS
+// on its own send-queue depth, i.e. frames waiting in the capture ring while
+// the network task is stuck in sendBIN(): one level per FLOW_AUTO_RAISE_MS
+// above FLOW_AUTO_HIGH_PCT of the ring, back one per FLOW_AUTO_RECOVER_MS
+// with the ring drained.
+//   level 1: batches of FLOW_AUTO_BATCH_BYTES
+//   level 2: + IMA-ADPCM
+//   level 3: + decimation by 2
+//
+// After every change the node reports what it now applies as
+// {"type":"flow_state",...}, so the receiver can see the fleet's state.
+#define FLOW_REQUEST_TTL_MS 60000
+#define FLOW_REQUEST_TTL_MAX_MS 3600000
+#define FLOW_AUTO_LEVELS 3
+#define FLOW_AUTO_HIGH_PCT 50
+#define FLOW_AUTO_RAISE_MS 500
+#define FLOW_AUTO_RECOVER_MS 10000
+#define FLOW_AUTO_BATCH_BYTES 8192     // PACKET_BATCH_MAX_BYTES
+#define FLOW_AUTO_BATCH_DELAY_MS 200
+#define FLOW_STATE_BYTES 192
+
+// Snapshot for /status.json and /metrics
+struct FlowStats
+{
+    bool paused;              // Receiver asked for a pause
+    bool server_limits;       // Any receiver request in force
+    uint8_t auto_level;       // 0..FLOW_AUTO_LEVELS
+    uint32_t requests;        // flow messages accepted since boot
+    uint32_t auto_changes;    // Automatic level changes since boot
+    uint32_t paused_ms;       // Total time paused since boot, current pause included
+};
+
+// Everything below is called from the network task only
+
+// A {"type":"flow"} message, already parsed. Fields absent from it are not
+// touched; `has_*` says which ones were present.
+struct FlowRequest
+{
+    bool clear;
+    bool has_pause, pause;
+    bool has_codec, adpcm;
+    bool has_decimate;
+    uint8_t decimate;
+    bool has_batch_bytes;
+    uint16_t batch_bytes;
+    bool has_batch_delay;
+    uint16_t batch_delay_ms;
+    uint32_t ttl_ms;
+};
+void flowRequest(const FlowRequest &request);
+
+// WebSocket closed: receiver requests go with the connection (the receiver
+// repeats them on reconnect if they still apply)
+void flowDisconnected();
+
+// Once per loop pass with the capture ring fill. Returns true with a
+// flow_state message in `message` when one should go out now.
+bool flowService(uint32_t now_ms, size_t ring_fill, size_t ring_capacity, bool ws_up, char *message, size_t size);
+
+// Effective values, given the configured ones
+bool flowPaused();
+uint8_t flowCodec(uint8_t codec_setting);                // CODEC_SETTING_*
+uint8_t flowDecimation(uint8_t factor, uint32_t sample_rate); // Whole divisor of sample_rate
+uint16_t flowBatchBytes(uint16_t batch_max_bytes);
+uint16_t flowBatchDelay(uint16_t batch_max_delay_ms);
+
+void flowFillStats(FlowStats &stats);
+
+#endif // FLOW_CONTROL_H
@@ -2,16 +2,146 @@
 #define GLOBALS_H
 
 #include <stdint.h> // Include for standard types like int16_t
+#include "seqlock.h"
+#include "power_manager.h"
+#include "packet_spool.h"
+#include "udp_transport.h"
+#include "metrics.h"
+#include "time_sync.h"
+#include "flow_control.h"
+#include "audio_dsp.h"
 
 // Runtime state variables shared between main.cpp and potentially settings_api.cpp
 // These are DEFINED in main.cpp and DECLARED here for other modules to use.
 
+// The network task owns the live values below and is the only one allowed to
+// touch them. Every other task (web server, /status.json) reads the copy it
+// publishes once per frame into status_snapshot.
 extern float current_rms;      // Calculated Root Mean Square of recent audio samples
 extern int16_t current_peak;   // Peak absolute value of recent audio samples
 extern bool transmitting;      // Are we actively transmitting audio data? (Set based on triggers/logic)
 
-extern int16_t *latest_samples;      // Pointer to rolling diagnostics buffer used by the status API
-extern size_t latest_sample_index;   // Write index inside the diagnostics buffer
-extern size_t latest_sample_capacity; // Number of samples allocated for diagnostics
+// Connection manager state (main.cpp), also shown on the status LED
+enum SystemState
+{
+    STATE_BOOTING,
+    STATE_WIFI_CONNECTING, // WiFi attempt running, or waiting out its backoff
+    STATE_WIFI_CONNECTED,  // WiFi connected, WS disconnected (waiting out its backoff)
+    STATE_WS_CONNECTING,   // Attempting WS connection
+    STATE_WS_CONNECTED     // WS connected
+};
+
+inline const char *systemStateName(uint8_t state)
+{
+    static const char *const names[] = {"booting", "wifi_connecting", "wifi_connected", "ws_connecting", "ws_connected"};
+    return state <= STATE_WS_CONNECTED ? names[state] : "unknown";
+}
+
+// Connection manager telemetry for /status.json
+struct LinkStats
+{
+    uint8_t state;          // SystemState
+    uint32_t wifi_attempts; // WiFi.begin() calls since boot
+    uint32_t ws_attempts;   // WebSocket connection attempts since boot
+    uint32_t retry_in_ms;   // Backoff left before the next attempt; 0 while connected or attempting
+};
+
+// Live reconfiguration telemetry for /status.json, kept by the network task.
+// Downtime is the audio lost between the last frame processed with the old
+// configuration and the first one captured with the new one: the driver
+// reinstall plus any stale frames dropped from the capture ring.
+struct ReconfigStats
+{
+    uint32_t count;            // Completed I2S reconfigurations since boot
+    uint32_t failures;         // Rejected by the driver and reverted
+    uint32_t last_downtime_us;
+    uint32_t max_downtime_us;
+    uint32_t stale_frames;     // Captured at the old sample rate and dropped, since boot
+};
+
+// Upper bound for AudioSettings::status_sample_count
+#define STATUS_SAMPLES_MAX 1024
+
+// Log-mel output; written by the network task, read elsewhere through StatusSnapshot::features
+struct FeatureStats
+{
+    uint32_t frames = 0;           // Log-mel frames computed
+    uint32_t packets = 0;          // Feature packets handed to the transport or spool
+    uint64_t bytes = 0;            // Their wire size, headers included
+    uint32_t dropped = 0;          // Frames lost to a full packet pool or no link
+    float compute_us = 0.0f;       // Moving average per frame (includes the FFT with the RMS trigger)
+    uint32_t compute_us_max = 0;   // Worst time seen
+};
+extern FeatureStats feature_stats;
+
+// Spectral trigger cost; written by the network task once per frame, read elsewhere through StatusSnapshot::detector
+struct DetectorStats
+{
+    uint32_t analyses = 0;         // FFT analyses run
+    float analyse_us = 0.0f;       // Moving average time per frame
+    uint32_t analyse_us_max = 0;   // Worst time seen
+};
+extern DetectorStats detector_stats;
+
+// I2S driver telemetry; written by setupI2S() and the capture task, copied
+// into StatusSnapshot::capture by the network task for everyone else
+struct CaptureStats
+{
+    volatile uint32_t dma_overflows = 0;    // I2S_EVENT_RX_Q_OVF: every DMA buffer filled before a read
+    volatile uint32_t dma_errors = 0;       // I2S_EVENT_DMA_ERROR
+    volatile float measured_rate_hz = 0.0f; // Samples delivered per second since setupI2S()
+    float clock_hz = 0.0f;                  // Rate the driver's clock dividers actually produce
+    bool apll = false;                      // APLL requested and supported by this chip
+    volatile uint32_t reinstall_us = 0;     // Last live reconfiguration: driver uninstall + install
+    volatile uint32_t frames = 0;           // Frames read from the driver (or the synthetic source), overruns included
+};
+extern CaptureStats capture_stats;
+
+// Encoder telemetry; written by the network task once per encoded frame, read elsewhere through StatusSnapshot::codec
+struct CodecStats
+{
+    uint32_t frames = 0;         // Frames encoded with a compressing codec
+    float ratio = 0.0f;          // Moving average of PCM16 bytes / encoded bytes
+    float encode_us = 0.0f;      // Moving average encode time per frame
+    uint32_t encode_us_max = 0;  // Worst encode time seen
+};
+extern CodecStats codec_stats;
+
+// Per-frame view of the network task's state for other tasks
+struct StatusSnapshot
+{
+    uint32_t frames;                     // Frames processed since boot
+    uint64_t timestamp;                  // Capture time of the last frame (us)
+    float rms;                           // current_rms
+    int16_t peak;                        // current_peak
+    uint8_t channels;                    // Capture channels of the last frame
+    float channel_rms[AUDIO_MAX_CHANNELS];   // Per channel, same scale as rms
+    int16_t channel_peak[AUDIO_MAX_CHANNELS];
+    uint8_t trigger_channels;            // Bit c: channel c was above the trigger on the last frame
+    bool triggered;                      // transmitting
+    uint8_t trigger_state;               // TriggerState
+    uint16_t preroll_frames;             // Frames currently buffered
+    uint16_t preroll_depth;              // Frames the pre-roll is set to hold
+    uint16_t preroll_capacity;           // Frames allocated, which changes with rate and channel count
+    float band_db;                       // Spectral trigger band energy (dBFS)
+    float floor_db;                      // Spectral trigger noise floor (dBFS)
+    PowerStats power;                    // Time in state, clock and radio
+    SpoolStats spool;                    // Store-and-forward fill and drops
+    LinkStats link;                      // WiFi / WebSocket connection manager
+    UdpStats udp;                        // Datagram transport, both ends
+    ReconfigStats reconfig;              // Live I2S reconfiguration
+    SendStats ws_send;                   // WebSocket audio sends
+    TimeSyncStats time_sync;             // Wall-clock source and offset
+    FlowStats flow;                      // Receiver / automatic send limits
+    CaptureStats capture;                // I2S driver and capture task
+    CodecStats codec;                    // Compressing encoder cost
+    DetectorStats detector;              // Spectral trigger cost
+    FeatureStats features;               // Log-mel output
+    uint16_t sample_count;               // Valid entries in samples[]
+    int16_t samples[STATUS_SAMPLES_MAX]; // Most recent status samples, oldest first
+};
+extern Seqlock<StatusSnapshot> status_snapshot;
+
+extern volatile uint32_t capture_overruns; // Frames dropped because the network task fell behind (audio_capture.cpp)
 
 #endif // GLOBALS_H
\ No newline at end of file
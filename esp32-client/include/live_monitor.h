@@ -0,0 +1,52 @@
+#ifndef LIVE_MONITOR_H
+#define LIVE_MONITOR_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "audio_dsp.h"
+
+// === LIVE MONITOR ===
+// Browsers connect to ws://<node>/live and receive binary snapshots at
+// AudioSettings::live_rate_hz. Each snapshot is a min/max envelope of the
+// audio since the previous one, so the page sees every transient no matter
+// how far it is decimated. Nothing is computed while no client is connected.
+#define LIVE_MONITOR_PATH "/live"
+#define LIVE_BUCKETS 128       // min/max pairs per snapshot
+#define LIVE_MAX_RATE_HZ 30    // Upper bound for AudioSettings::live_rate_hz
+#define LIVE_SNAPSHOT_MAGIC 0x564C // "LV" on the wire
+#define LIVE_SNAPSHOT_VERSION 1
+
+// LiveSnapshotHeader::flags
+#define LIVE_FLAG_TRIGGERED 0x01
+
+// Little-endian, followed by `buckets` x {int16 min, int16 max}
+struct LiveSnapshotHeader
+{
+    uint16_t magic;              // LIVE_SNAPSHOT_MAGIC
+    uint8_t version;             // LIVE_SNAPSHOT_VERSION
+    uint8_t flags;               // LIVE_FLAG_*
+    uint32_t sequence;           // Snapshot counter (gaps = snapshots not sent)
+    uint32_t sample_rate;        // Hz
+    uint16_t samples_per_bucket; // Decimation factor
+    uint16_t buckets;            // Envelope pairs that follow
+    float rms;                   // Over the snapshot window, 0.0 .. 1.0
+    int16_t peak;                // Over the snapshot window
+    uint16_t reserved;
+} __attribute__((packed));
+
+static_assert(sizeof(LiveSnapshotHeader) == 24, "Live snapshot header layout changed");
+
+// Registers the /live WebSocket handler on `server`
+void setupLiveMonitor(AsyncWebServer &server);
+
+// Network task: folds one converted frame into the pending snapshot.
+// `stats` are the frame's RMS/peak statistics from convertFrame().
+void liveMonitorFeed(const int32_t *raw, size_t count, const FrameStats &stats, bool triggered);
+
+// Network task: sends a completed snapshot and reaps closed clients
+void liveMonitorService();
+
+size_t liveMonitorClients();
+uint32_t liveMonitorDropped(); // Snapshots skipped because a client was still busy
+
+#endif // LIVE_MONITOR_H
@@ -0,0 +1,20 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <Arduino.h>
+
+// === LOGGING MACROS ===
+#define LOG_INFO(format, ...) Serial.printf("[INFO] " format "\n", ##__VA_ARGS__)
+#define LOG_WARN(format, ...) Serial.printf("[WARN] " format "\n", ##__VA_ARGS__)
+#define LOG_ERROR(format, ...) Serial.printf("[ERROR] " format "\n", ##__VA_ARGS__)
+#ifdef CORE_DEBUG_LEVEL
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(format, ...) Serial.printf("[DEBUG] " format "\n", ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...)
+#endif
+#else
+#define LOG_DEBUG(format, ...)
+#endif
+
+#endif // LOGGING_H
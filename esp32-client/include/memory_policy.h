@@ -0,0 +1,85 @@
+#ifndef MEMORY_POLICY_H
+#define MEMORY_POLICY_H
+
+#include <Arduino.h>
+
+// === MEMORY PLACEMENT ===
+// Every large buffer is allocated once at boot (or on a settings change)
+// through memoryAlloc(), which picks the heap from the buffer's class rather
+// than leaving it to malloc(): with PSRAM enabled, Arduino's malloc() sends
+// anything above a few KB to external RAM, which is what the bulk buffers
+// want and what the hot ones must not get.
+//
+//   MEMORY_HOT        Internal, DMA-capable RAM. Buffers the capture or
+//                     network task touches every frame (capture ring,
+//                     detectors, packet pool): PSRAM sits behind the cache
+//                     and stalls both cores on a miss. No fallback.
+//   MEMORY_BULK       PSRAM, or internal RAM on boards without it. Large,
+//                     sequentially used buffers: spool, pre-roll, status and
+//                     metrics text, clip data.
+//   MEMORY_PSRAM_ONLY PSRAM or nothing, for bulk buffers whose owner picks a
+//                     smaller size for internal RAM itself (spool, pre-roll).
+//
+// The allocations are kept in a small registry so /status.json can list
+// where each one went next to the per-capability heap figures.
+enum MemoryClass : uint8_t
+{
+    MEMORY_HOT,
+    MEMORY_BULK,
+    MEMORY_PSRAM_ONLY,
+    MEMORY_CLASS_COUNT
+};
+
+#define MEMORY_HOT_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA | MALLOC_CAP_8BIT)
+#define MEMORY_INTERNAL_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#define MEMORY_PSRAM_CAPS (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#define MEMORY_MAX_BLOCKS 24 // Registry slots; blocks past this still allocate, unlisted
+#define MEMORY_DEFAULT_ALIGN 16
+
+const char *memoryClassName(uint8_t cls);
+
+// `bytes` aligned to `align` (a power of two) from the heap `cls` allows.
+// `what` must outlive the block (a string literal). nullptr when no allowed
+// heap has room; failures are counted and logged.
+void *memoryAlloc(MemoryClass cls, size_t bytes, const char *what, size_t align = MEMORY_DEFAULT_ALIGN);
+void memoryFree(void *block); // nullptr is fine
+bool memoryInPsram(const void *block); // Registered blocks only
+
+struct MemoryBlock
+{
+    const char *what;
+    uint32_t bytes;
+    uint8_t cls;   // MemoryClass
+    bool psram;    // Where it actually went
+};
+
+struct HeapRegionStats
+{
+    uint32_t total;
+    uint32_t free;
+    uint32_t largest;  // Largest free block: what the next allocation can get
+    uint32_t min_free; // Low-water mark since boot
+};
+
+// Snapshot for /status.json and /metrics
+struct MemoryStats
+{
+    HeapRegionStats internal;                  // MEMORY_INTERNAL_CAPS
+    HeapRegionStats dma;                       // MEMORY_HOT_CAPS, what WiFi and I2S buffers also need
+    HeapRegionStats psram;                     // MEMORY_PSRAM_CAPS; zero without PSRAM
+    uint32_t class_bytes[MEMORY_CLASS_COUNT];  // Currently allocated per class
+    uint32_t class_psram_bytes[MEMORY_CLASS_COUNT];
+    uint16_t blocks;                           // Live registered blocks
+    uint16_t fallbacks;                        // MEMORY_BULK blocks that went to internal RAM
+    uint16_t failures;                         // memoryAlloc() calls that returned nullptr
+};
+
+void memoryFillStats(MemoryStats &stats);
+
+// Copies up to `max` registered blocks, in allocation order. Returns the count.
+size_t memoryBlocks(MemoryBlock *out, size_t max);
+
+// One log line per heap plus one per block, for the boot log
+void memoryLogSummary();
+
+#endif // MEMORY_POLICY_H
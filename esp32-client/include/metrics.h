@@ -0,0 +1,89 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "seqlock.h"
+
+// === HOT-PATH METRICS ===
+// Per-stage cost histograms for /metrics (Prometheus text format). Every
+// stage is recorded by exactly one task; record() is a count-leading-zeros,
+// two increments and a compare, so it stays on for every frame.
+//
+// Compute stages are measured in CPU cycles (ESP.getCycleCount()), which
+// count work independent of power_mode's clock scaling. Stages that can
+// block (I2S, sockets) are measured in microseconds (esp_timer), because
+// the cycle counter keeps running while another task has the core.
+//
+// Buckets are log-linear: four per power of two, so a quantile is within
+// ~12% of the true value. Quantiles and max cover the last one to two
+// METRICS_WINDOW_MS windows, so a node falling behind now shows up now;
+// count and sum run since boot as Prometheus expects of a summary.
+#define METRICS_SUB_BUCKETS 4
+#define METRICS_BUCKETS (31 * METRICS_SUB_BUCKETS) // Through 2^32 - 1
+#define METRICS_WINDOW_MS 30000
+
+enum MetricStage : uint8_t
+{
+    METRIC_STAGE_I2S_WAIT,    // Capture task: blocked in i2s_read() / the paced synthetic read (us)
+    METRIC_STAGE_QUEUE_DELAY, // Capture time of a frame to the network task picking it up (us)
+    METRIC_STAGE_CONDITION,   // Preprocess + convert + RMS/peak (+ codec), one fused pass (cycles)
+    METRIC_STAGE_TRIGGER,     // RMS compare or spectral analysis (cycles)
+    METRIC_STAGE_FRAME,       // processFrame() including any send (us)
+    METRIC_STAGE_SEND,        // One WebSocket sendBIN() or UDP send (us)
+    METRIC_STAGE_WS_LOOP,     // connectionService(): WiFi/WS state machine and wsClient.loop() (us)
+    METRIC_STAGE_COUNT
+};
+
+const char *metricStageName(MetricStage stage);
+bool metricStageInCycles(MetricStage stage); // false: microseconds
+
+struct StageSummary
+{
+    uint64_t count;  // Since boot
+    uint64_t sum;    // Since boot, in the stage's unit
+    uint32_t p50;    // Window quantiles and max
+    uint32_t p99;
+    uint32_t max;
+    uint32_t window_count;
+};
+
+class StageHistogram
+{
+public:
+    void record(uint32_t value);          // Owning task only
+    void summarize(StageSummary &out) const; // Any task; quantiles may be a frame behind
+
+private:
+    struct Totals
+    {
+        uint64_t count;
+        uint64_t sum;
+    };
+    void rotate(TickType_t now);
+    uint32_t quantile(uint32_t rank) const;
+
+    uint32_t buckets[2][METRICS_BUCKETS] = {};
+    uint32_t window_count[2] = {};
+    uint32_t window_max[2] = {};
+    uint8_t active = 0;
+    TickType_t window_start = 0;
+    Seqlock<Totals> totals;
+};
+
+extern StageHistogram stage_metrics[METRIC_STAGE_COUNT];
+
+static inline void metricsRecord(MetricStage stage, uint32_t value)
+{
+    stage_metrics[stage].record(value);
+}
+
+// WebSocket sends since boot for /metrics; UDP keeps its own in UdpStats.
+// Written by the network task, published in StatusSnapshot.
+struct SendStats
+{
+    uint32_t packets;  // Audio packets handed to sendBIN(), batched and drained ones included
+    uint32_t failures; // sendBIN() calls that failed
+    uint64_t bytes;    // WebSocket payload bytes sent
+};
+
+#endif // METRICS_H
@@ -0,0 +1,127 @@
+#ifndef PACKET_SPOOL_H
+#define PACKET_SPOOL_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "audio_packet.h"
+
+// === STORE-AND-FORWARD SPOOL ===
+// Finished wire packets that could not be sent (WebSocket down) are kept
+// here, oldest first, and drained after reconnecting. Packets are stored
+// byte for byte, so the original sequence numbers and esp_timer timestamps
+// survive; the sender sets PACKET_FLAG_SPOOLED before finalising them.
+//
+// Two tiers, always in order: the oldest packets sit in LittleFS segment
+// files, the newest in a RAM ring (PSRAM when present). When the ring passes
+// SPOOL_SPILL_PERCENT its oldest records move to the newest segment; when
+// the flash budget is used up the oldest segment is deleted. Each record is
+// [uint16 length][packet], and every packet carries its own magic and CRC,
+// so a segment torn by a reset is cut at the last intact record on boot.
+#define SPOOL_RAM_BYTES (1024 * 1024)        // PSRAM tier (~10 s of 48 kHz PCM16)
+#define SPOOL_RAM_INTERNAL_BYTES (32 * 1024) // Fallback without PSRAM
+#define SPOOL_SPILL_PERCENT 75               // RAM fill that starts moving the oldest records to flash
+#define SPOOL_SPILL_CHUNK_BYTES 8192         // Flash written per service() call, bounds the stall
+#define SPOOL_SEGMENT_BYTES (64 * 1024)
+#define SPOOL_MAX_SEGMENTS 32                // 2 MB of flash
+#define SPOOL_DIR "/spool"
+#define SPOOL_MESSAGE_MAX_BYTES PACKET_BATCH_MAX_BYTES // Largest drain message
+#define SPOOL_DRAIN_MAX_KBPS 8000                      // Upper bound for AudioSettings::spool_drain_kbps (kbit/s)
+
+// Snapshot for /status.json
+struct SpoolStats
+{
+    uint32_t ram_capacity;
+    uint32_t ram_bytes;
+    uint32_t flash_capacity;  // 0 when the flash tier is unavailable
+    uint32_t flash_bytes;
+    uint32_t packets;         // Packets waiting in both tiers
+    uint32_t spooled;         // Packets accepted since boot
+    uint32_t drained;         // Packets sent after reconnecting
+    uint32_t dropped_packets; // Oldest packets discarded to make room
+    uint64_t dropped_bytes;
+};
+
+// Network task only
+class PacketSpool
+{
+public:
+    // Allocates the RAM ring (falling back to internal RAM) and, if
+    // use_flash, mounts LittleFS and picks up segments left by a previous boot.
+    bool begin(size_t ram_bytes, bool use_flash);
+
+    bool enabled() const { return ram != nullptr; }
+    bool empty() const { return ram_packets == 0 && flash_packets == 0; }
+
+    // Stores one finished packet (header + payload), dropping the oldest
+    // records if the RAM ring is full. Returns false if the spool is off.
+    bool push(const uint8_t *packet, size_t length);
+
+    // Moves the oldest RAM records to flash once the ring passes the spill mark
+    void service(bool use_flash);
+
+    // Copies whole packets, oldest first, into the drain message (up to
+    // max_bytes) without removing them; returns the message length. Send
+    // wsFrame() with sendBIN(..., true), then consume() on success.
+    size_t prepare(size_t max_bytes);
+    uint8_t *wsFrame() { return message; }
+    size_t preparedPackets() const { return prepared_packets; }
+    void consume();
+
+    void fillStats(SpoolStats &stats) const;
+
+private:
+    struct Segment
+    {
+        uint32_t id;
+        uint32_t bytes;
+        uint32_t packets;
+    };
+
+    // RAM ring
+    void ramCopyIn(size_t offset, const uint8_t *data, size_t length);
+    void ramCopyOut(size_t offset, uint8_t *data, size_t length) const;
+    uint16_t ramRecordLength(size_t offset) const;
+    void ramDropOldest();
+
+    // Flash segments
+    void scanSegments();
+    uint32_t validRecords(fs::File &file, uint32_t &valid_bytes);
+    bool flashAppend(const uint8_t *record, size_t length);
+    void dropOldestSegment();
+    void sealWriter();
+    Segment &segmentAt(size_t index) { return segments[(segment_head + index) % SPOOL_MAX_SEGMENTS]; }
+
+    uint8_t *ram = nullptr;
+    size_t ram_capacity = 0;
+    size_t ram_head = 0; // Oldest record
+    size_t ram_used = 0;
+    uint32_t ram_packets = 0;
+
+    bool flash_ready = false;
+    Segment segments[SPOOL_MAX_SEGMENTS];
+    size_t segment_head = 0;
+    size_t segment_count = 0;
+    uint32_t next_segment_id = 0;
+    bool writer_open = false; // Newest segment still accepts records
+    fs::File writer;
+    fs::File reader;
+    uint32_t reader_id = UINT32_MAX;
+    uint32_t read_offset = 0; // Bytes of the oldest segment already drained
+    uint32_t flash_bytes = 0;
+    uint32_t flash_packets = 0;
+
+    // Drain message: [PACKET_HEADROOM][packets ...]
+    uint8_t message[PACKET_HEADROOM + SPOOL_MESSAGE_MAX_BYTES];
+    size_t prepared_bytes = 0;  // Record bytes (with length prefixes) covered by the message
+    size_t prepared_packets = 0;
+    bool prepared_from_flash = false;
+
+    uint32_t spooled = 0;
+    uint32_t drained = 0;
+    uint32_t dropped_packets = 0;
+    uint64_t dropped_bytes = 0;
+};
+
+extern PacketSpool packet_spool;
+
+#endif // PACKET_SPOOL_H
@@ -0,0 +1,47 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+
+// === POWER MANAGEMENT ===
+// Between detections the node only has to run the trigger, so in
+// POWER_MODE_LOW the CPU drops to POWER_IDLE_CPU_MHZ and the radio goes into
+// modem sleep. The frame that opens a detection switches back to full speed
+// and a fully awake radio before the pre-roll burst is encoded and sent.
+//
+// Automatic light sleep is not used: the I2S driver holds a PM lock for as
+// long as it captures, so the chip would never enter it while listening.
+#define POWER_MODE_FULL 0 // Full clock and radio all the time
+#define POWER_MODE_LOW 1  // CPU scaling + modem sleep between detections
+
+#define POWER_ACTIVE_CPU_MHZ 240
+#define POWER_IDLE_CPU_MHZ 80 // Lowest clock WiFi and the I2S APB clock tolerate
+
+enum PowerState
+{
+    POWER_STATE_IDLE,   // Listening only (scaled down in POWER_MODE_LOW)
+    POWER_STATE_ACTIVE, // Detection open: full speed, radio awake
+    POWER_STATE_COUNT
+};
+
+// Time-in-state accounting for /status.json, all since boot
+struct PowerStats
+{
+    uint64_t state_us[POWER_STATE_COUNT]; // Includes the current state up to now
+    uint32_t transitions;                 // Idle -> active switches
+    uint32_t wake_us_max;                 // Slowest switch to full speed
+    uint64_t busy_us;                     // Network task time spent working, not waiting
+    uint64_t uptime_us;
+    uint16_t cpu_mhz;
+    uint8_t state;                        // PowerState
+    bool modem_sleep;                     // Radio currently allowed to doze
+};
+
+// Everything below is called from the network task only
+void powerBegin(uint8_t mode);
+void powerSetActive(bool active); // Follows the trigger gate; cheap when nothing changes
+void powerService();              // Picks up power_mode changes, re-applies the radio setting once WiFi is up
+void powerAccountBusy(uint32_t busy_us);
+void powerFillStats(PowerStats &stats);
+
+#endif // POWER_MANAGER_H
@@ -0,0 +1,38 @@
+#ifndef RECONNECT_BACKOFF_H
+#define RECONNECT_BACKOFF_H
+
+#include <Arduino.h>
+
+// Exponential backoff with "equal jitter": retry n waits a random time in
+// [d/2, d] where d = min(cap, base * 2^n). Because every node draws its own
+// delay, a fleet that lost its AP or server at the same moment comes back
+// spread out instead of in lockstep.
+class ReconnectBackoff
+{
+public:
+    ReconnectBackoff(uint32_t base_ms, uint32_t cap_ms) : base_ms(base_ms), cap_ms(cap_ms) {}
+
+    // Delay before the next attempt; each call doubles the window up to the cap
+    uint32_t next()
+    {
+        const uint64_t window = min((uint64_t)base_ms << min(failure_count, (uint32_t)24), (uint64_t)cap_ms);
+        failure_count++;
+        const uint32_t half = (uint32_t)(window / 2);
+        return half + esp_random() % (half + 1);
+    }
+
+    // Link came up: the next outage starts again from base_ms
+    void reset() { failure_count = 0; }
+
+    uint32_t failures() const { return failure_count; } // Attempts since the last reset()
+
+    // Random delay in [0, window_ms) for the first attempt after a shared event
+    static uint32_t spread(uint32_t window_ms) { return window_ms ? esp_random() % window_ms : 0; }
+
+private:
+    uint32_t base_ms;
+    uint32_t cap_ms;
+    uint32_t failure_count = 0;
+};
+
+#endif // RECONNECT_BACKOFF_H
@@ -0,0 +1,63 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+// Single-writer sequence lock around a trivially copyable value.
+//
+// The writer bumps the sequence to an odd number, updates the value in place
+// and bumps it back to even; it never waits on readers. Readers copy the
+// value out and retry if the sequence was odd or changed underneath them, so
+// a reader can never observe a half-written value and never blocks the
+// writer. With one short write per audio frame, a retry is rare and a
+// reader practically always finishes on its first attempt.
+template <typename T>
+class Seqlock
+{
+public:
+    // --- Writer side (exactly one task) ---
+    T &beginWrite()
+    {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return value;
+    }
+
+    void endWrite()
+    {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // --- Reader side (any task) ---
+    // Copies a consistent value into `out`. Gives up after `attempts` torn
+    // reads and returns false, leaving `out` unspecified.
+    bool read(T &out, int attempts = 4) const
+    {
+        while (attempts-- > 0)
+        {
+            const uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                continue; // Write in progress
+            }
+            memcpy(&out, (const void *)&value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t version() const { return sequence.load(std::memory_order_acquire) >> 1; }
+
+private:
+    std::atomic<uint32_t> sequence{0};
+    T value{};
+};
+
+#endif // SEQLOCK_H
@@ -2,78 +2,147 @@
 #define SETTINGS_MANAGER_H
 
 #include <Arduino.h>
-#include <Preferences.h>
+#include <freertos/semphr.h>
 
 struct AudioSettings {
     float trigger_rms_threshold = 0.02f;
     uint32_t trigger_timeout_ms = 3000;
-    bool simulate_mic = false;
-    float simulated_power_offset = 300.0f;
-    float simulated_power_variation = 100.0f;
+    uint8_t trigger_mode = 1;            // TRIGGER_MODE_RMS (0) or TRIGGER_MODE_SPECTRAL (1)
+    float band_low_hz = 1000.0f;         // Spectral trigger band
+    float band_high_hz = 10000.0f;
+    float spectral_threshold_db = 10.0f; // Band energy above the noise floor that counts as a trigger
+    uint16_t preroll_ms = 500;   // Audio kept from before a trigger fires
+    bool simulate_mic = false;   // Capture from the synthetic source instead of I2S (synthetic_source.h)
+    uint8_t sim_signal = 1;          // SIM_SIGNAL_TONE (0), _CHIRP (1), _NOISE (2) or _CLIP (3)
+    float sim_freq_hz = 3000.0f;     // Tone frequency, chirp start
+    float sim_freq_end_hz = 8000.0f; // Chirp end
+    float sim_level = 0.25f;         // Peak amplitude 0..1 (gain for the clip)
+    uint8_t sim_duty_pct = 20;       // Share of each period the signal plays; the rest is a -60 dBFS floor
+    uint16_t sim_period_ms = 5000;
     uint32_t sample_rate = 48000;
-    uint32_t buffer_len = 1024;
+    uint32_t output_sample_rate = 0; // Transmitted rate, sample_rate / 2..4; 0 sends at sample_rate
+    uint8_t dma_buf_count = 8;     // I2S DMA buffers; more rides out longer network-task stalls
+    uint16_t dma_buf_len = 512;    // Frames per DMA buffer; depth x length is the capture latency
+    bool use_apll = false;         // Clock I2S from the audio PLL where the chip has one (closer to sample_rate)
+    uint8_t channels = 1;          // Mics on the I2S bus: CAPTURE_CHANNELS_MONO (1), _STEREO (2) or _TDM (4)
     String wifi_ssid = "";
     String wifi_pass = "";
     String ws_server = "";
     String ws_port = "8080";
-    float gain = 10.0f;
+    String ntp_server = "pool.ntp.org"; // SNTP for packet wall-clock times; "" leaves it to the receiver's time_pong
+    float gain = 1.0f;           // Linear, applied in fixed point with saturation (max PREPROCESS_MAX_GAIN)
+    bool dc_block = true;        // One-pole DC blocker before gain
+    uint16_t highpass_hz = 0;    // 2nd-order high-pass corner; 0 = off
     uint8_t output_bits = 16;
+    uint8_t codec = 0;           // CODEC_SETTING_PCM (output_bits wide) or CODEC_SETTING_IMA_ADPCM
+    uint8_t output_mode = 0;     // OUTPUT_MODE_AUDIO (0), _FEATURES (1) or _FEATURES_ONLY (2), see mel_features.h
+    uint16_t batch_max_bytes = 4096;  // Packets coalesced per WS message; 0 sends each read on its own
+    uint16_t batch_max_delay_ms = 40; // Longest a packet waits for its batch to fill
+    uint8_t live_rate_hz = 10;        // /live snapshots per second; 0 disables the monitor
+    uint8_t power_mode = 1;           // POWER_MODE_FULL (0) or POWER_MODE_LOW (1)
+    bool spool_enabled = true;        // Keep packets while the WebSocket is down (allocated at boot)
+    bool spool_flash = true;          // Let the spool spill to LittleFS once its RAM tier fills up
+    uint16_t spool_drain_kbps = 1024; // Backlog rate after reconnecting, kbit/s
+    uint8_t transport = 0;            // Live audio: TRANSPORT_WS (0), TRANSPORT_UDP (1) or TRANSPORT_RTP (2)
+    uint16_t udp_port = 5004;         // Datagram destination port on the ws_server host
+    bool flow_auto = true;            // Step down batching / codec / rate when sends back up (flow_control.h)
     uint8_t led_brightness = 20; // New field
     uint16_t status_sample_count = 128;
 };
 
+// Every persisted field once: X(Preferences type, member, NVS key). NVS keys
+// are limited to 15 characters. A field whose meaning changes gets a new key,
+// so values stored by older firmware are not read back with the new meaning.
+#define AUDIO_SETTINGS_FIELDS(X)                         \
+    X(Float, trigger_rms_threshold, "threshold")         \
+    X(UInt, trigger_timeout_ms, "timeout")               \
+    X(UChar, trigger_mode, "trigger_mode")               \
+    X(Float, band_low_hz, "band_lo_hz")                  \
+    X(Float, band_high_hz, "band_hi_hz")                 \
+    X(Float, spectral_threshold_db, "spec_thresh_db")    \
+    X(UShort, preroll_ms, "preroll_ms")                  \
+    X(Bool, simulate_mic, "simulate_mic")                \
+    X(UChar, sim_signal, "sim_signal")                   \
+    X(Float, sim_freq_hz, "sim_freq_hz")                 \
+    X(Float, sim_freq_end_hz, "sim_freq_end")            \
+    X(Float, sim_level, "sim_level")                     \
+    X(UChar, sim_duty_pct, "sim_duty_pct")               \
+    X(UShort, sim_period_ms, "sim_period_ms")            \
+    X(UInt, sample_rate, "sample_rate")                  \
+    X(UInt, output_sample_rate, "out_rate")              \
+    X(UChar, dma_buf_count, "dma_buf_count")             \
+    X(UShort, dma_buf_len, "dma_buf_len")                \
+    X(Bool, use_apll, "use_apll")                        \
+    X(UChar, channels, "channels")                       \
+    X(String, wifi_ssid, "wifi_ssid")                    \
+    X(String, wifi_pass, "wifi_pass")                    \
+    X(String, ws_server, "ws_server")                    \
+    X(String, ws_port, "ws_port")                        \
+    X(String, ntp_server, "ntp_server")                  \
+    X(Float, gain, "gain_lin")                           \
+    X(Bool, dc_block, "dc_block")                        \
+    X(UShort, highpass_hz, "highpass_hz")                \
+    X(UChar, output_bits, "output_bits")                 \
+    X(UChar, codec, "codec")                             \
+    X(UChar, output_mode, "output_mode")                 \
+    X(UShort, batch_max_bytes, "batch_bytes")            \
+    X(UShort, batch_max_delay_ms, "batch_delay_ms")      \
+    X(UChar, live_rate_hz, "live_rate_hz")               \
+    X(UChar, power_mode, "power_mode")                   \
+    X(Bool, spool_enabled, "spool_enabled")              \
+    X(Bool, spool_flash, "spool_flash")                  \
+    X(UShort, spool_drain_kbps, "spool_kbps")            \
+    X(UChar, transport, "transport")                     \
+    X(UShort, udp_port, "udp_port")                      \
+    X(Bool, flow_auto, "flow_auto")                      \
+    X(UChar, led_brightness, "led_brightness")           \
+    X(UShort, status_sample_count, "status_samples")
+
+// === SETTINGS PUBLICATION AND PERSISTENCE ===
+// Three copies, each with one owner:
+//  - published: what /control.json last committed, behind a mutex. Any task
+//    takes a consistent copy with snapshot() and replaces it with publish().
+//  - settings: the runtime copy read by setup() and the network task with no
+//    locking. apply() refreshes it from published once per loop pass, so a
+//    POST never changes fields (or frees a String) in the middle of a frame.
+//  - persisted: what NVS holds. A low-priority writer task compares it with
+//    published and writes only the keys that differ, once the POSTs have
+//    been quiet for SETTINGS_SAVE_DEBOUNCE_MS (SETTINGS_SAVE_MAX_DELAY_MS at
+//    the latest), so dragging a slider costs one flash write, not dozens.
+#define SETTINGS_SAVE_DEBOUNCE_MS 1000
+#define SETTINGS_SAVE_MAX_DELAY_MS 5000
+#define SETTINGS_TASK_STACK 4096
+#define SETTINGS_TASK_PRIORITY 1
+
 class SettingsManager {
 public:
-    AudioSettings settings;
+    AudioSettings settings; // Runtime copy: setup() and the network task only
 
-    void load() {
-        Preferences prefs;
-        prefs.begin("audio", true);
+    void load();               // Before any task starts
+    bool startWriter();        // Starts the background NVS writer
 
-        settings.trigger_rms_threshold = prefs.getFloat("threshold", settings.trigger_rms_threshold);
-        settings.trigger_timeout_ms = prefs.getUInt("timeout", settings.trigger_timeout_ms);
-        settings.simulate_mic = prefs.getBool("simulate_mic", settings.simulate_mic);
-        settings.simulated_power_offset = prefs.getFloat("pwr_offset", settings.simulated_power_offset);
-        settings.simulated_power_variation = prefs.getFloat("pwr_var", settings.simulated_power_variation);
-        settings.sample_rate = prefs.getUInt("sample_rate", settings.sample_rate);
-        settings.buffer_len = prefs.getUInt("buffer_len", settings.buffer_len);
-        settings.wifi_ssid = prefs.getString("wifi_ssid", settings.wifi_ssid);
-        settings.wifi_pass = prefs.getString("wifi_pass", settings.wifi_pass);
-        settings.ws_server = prefs.getString("ws_server", settings.ws_server);
-        settings.ws_port = prefs.getString("ws_port", settings.ws_port);
-        settings.gain = prefs.getFloat("gain", settings.gain);
-        settings.output_bits = prefs.getUChar("output_bits", settings.output_bits);
-        settings.led_brightness = prefs.getUChar("led_brightness", settings.led_brightness);
-        settings.status_sample_count = prefs.getUShort("status_sample_count", settings.status_sample_count);
-        prefs.end();
-    }
+    AudioSettings snapshot();                // Any task
+    void publish(const AudioSettings &next); // Any task; persisted after the debounce
+    bool apply();                            // Network task; true if settings changed
+    void flush();                            // Writes pending changes now (e.g. before a restart)
+    void resetDefaults();
 
-    void save() {
-        Preferences prefs;
-        prefs.begin("audio", false);
+    uint32_t nvsWrites() const { return nvs_writes; } // Keys written since boot
+    uint32_t nvsSaves() const { return nvs_saves; }   // Coalesced saves since boot
 
-        prefs.putFloat("threshold", settings.trigger_rms_threshold);
-        prefs.putUInt("timeout", settings.trigger_timeout_ms);
-        prefs.putBool("simulate_mic", settings.simulate_mic);
-        prefs.putFloat("pwr_offset", settings.simulated_power_offset);
-        prefs.putFloat("pwr_var", settings.simulated_power_variation);
-        prefs.putUInt("sample_rate", settings.sample_rate);
-        prefs.putUInt("buffer_len", settings.buffer_len);
-        prefs.putString("wifi_ssid", settings.wifi_ssid);
-        prefs.putString("wifi_pass", settings.wifi_pass);
-        prefs.putString("ws_server", settings.ws_server);
-        prefs.putString("ws_port", settings.ws_port);
-        prefs.putFloat("gain", settings.gain);
-        prefs.putUChar("output_bits", settings.output_bits);
-        prefs.putUChar("led_brightness", settings.led_brightness);
-        prefs.putUShort("status_sample_count", settings.status_sample_count);
-        prefs.end();
-    }
+private:
+    static void writerTask(void *param);
+    void persist();
 
-    void resetDefaults() {
-        settings = AudioSettings();
-        save();
-    }
+    SemaphoreHandle_t publish_mutex = nullptr; // Guards published / published_version
+    SemaphoreHandle_t nvs_mutex = nullptr;     // Serialises persist() between the writer and flush()
+    TaskHandle_t writer = nullptr;
+    AudioSettings published;
+    AudioSettings persisted;
+    uint32_t published_version = 0;
+    uint32_t applied_version = 0;
+    volatile uint32_t nvs_writes = 0;
+    volatile uint32_t nvs_saves = 0;
 };
 
 extern SettingsManager Settings;
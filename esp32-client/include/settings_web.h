@@ -35,7 +35,7 @@ label {
     font-weight: 600;
 }
 
-input[type="text"], input[type="number"], input[type="password"], input[type="range"] {
+input[type="text"], input[type="number"], input[type="password"], input[type="range"], select {
     width: 100%;
     padding: 0.5em;
     margin-top: 0.3em;
@@ -68,6 +68,18 @@ button:hover {
     gap: 0.5em;
 }
 
+#live_canvas {
+    width: 100%;
+    height: 160px;
+    background: #111;
+    border-radius: 4px;
+}
+
+.readout {
+    font-family: ui-monospace, monospace;
+    margin-top: 0.5em;
+}
+
 #toast {
     display: none;
     position: fixed;
@@ -86,33 +98,170 @@ button:hover {
 
 <h1>ESP32 Audio Stream Settings</h1>
 
+<section>
+  <h2>Live Monitor</h2>
+  <canvas id="live_canvas" width="760" height="160"></canvas>
+  <div class="readout" id="live_readout">Connecting...</div>
+  <label>Snapshots per Second (0 = off, max 30):
+    <input id="live_rate_hz" type="number" min="0" max="30">
+  </label>
+</section>
+
 <section>
   <h2>Trigger Settings</h2>
+  <label>Trigger Mode:
+    <select id="trigger_mode">
+      <option value="0">Broadband RMS</option>
+      <option value="1">Spectral band energy</option>
+    </select>
+  </label>
   <label>RMS Threshold:
     <input id="threshold" type="number" step="0.01">
   </label>
+  <label>Band Low (Hz):
+    <input id="band_low_hz" type="number" min="0" step="100">
+  </label>
+  <label>Band High (Hz):
+    <input id="band_high_hz" type="number" min="0" step="100">
+  </label>
+  <label>Spectral Threshold (dB above noise floor):
+    <input id="spectral_threshold_db" type="number" step="0.5">
+  </label>
   <label>Trigger Timeout (ms):
     <input id="timeout" type="number">
   </label>
+  <label>Pre-roll (ms, 0–1000):
+    <input id="preroll_ms" type="number" min="0" max="1000">
+  </label>
   <label class="flex">
     <input id="simulate_mic" type="checkbox"> Simulate Microphone
   </label>
+  <label>Simulated Signal:
+    <select id="sim_signal">
+      <option value="0">Tone</option>
+      <option value="1">Chirp</option>
+      <option value="2">White noise</option>
+      <option value="3">Clip (/sim_clip.wav on flash)</option>
+    </select>
+  </label>
+  <label>Simulated Frequency (Hz; chirp start):
+    <input id="sim_freq_hz" type="number" min="0" step="100">
+  </label>
+  <label>Chirp End (Hz):
+    <input id="sim_freq_end_hz" type="number" min="0" step="100">
+  </label>
+  <label>Simulated Level (0–1):
+    <input id="sim_level" type="number" min="0" max="1" step="0.01">
+  </label>
+  <label>Burst Duty Cycle (%):
+    <input id="sim_duty_pct" type="number" min="0" max="100">
+  </label>
+  <label>Burst Period (ms):
+    <input id="sim_period_ms" type="number" min="100" max="60000" step="100">
+  </label>
 </section>
 
 <section>
   <h2>Audio Settings</h2>
-  <label>Gain:
-    <input id="gain" type="number" step="0.1">
+  <label>Gain (linear, max 256):
+    <input id="gain" type="number" step="0.1" min="0" max="256">
+  </label>
+  <label class="flex">
+    <input id="dc_block" type="checkbox"> DC Blocker
+  </label>
+  <label>High-pass Corner (Hz, 0 = off):
+    <input id="highpass_hz" type="number" min="0" step="10">
   </label>
   <label>Sample Rate (Hz):
     <input id="sample_rate" type="number">
   </label>
-  <label>Buffer Length (bytes):
-    <input id="buffer_len" type="number">
+  <label>Output Sample Rate (Hz, Sample Rate / 2, 3 or 4; 0 = same):
+    <input id="output_sample_rate" type="number" min="0">
+  </label>
+  <label>DMA Buffers (2–128):
+    <input id="dma_buf_count" type="number" min="2" max="128">
+  </label>
+  <label>DMA Buffer Length (frames, 8–1024):
+    <input id="dma_buf_len" type="number" min="8" max="1024">
+  </label>
+  <label class="flex">
+    <input id="use_apll" type="checkbox"> Audio PLL clock (where supported)
+  </label>
+  <label>Microphones:
+    <select id="channels">
+      <option value="1">Mono (left slot)</option>
+      <option value="2">Stereo (left + right)</option>
+      <option value="4">4-channel TDM (where supported)</option>
+    </select>
+  </label>
+  <div class="readout" id="channel_readout"></div>
+  <div class="readout" id="reconfig_readout"></div>
+  <label>Status Samples (0–1024):
+    <input id="status_sample_count" type="number" min="0" max="1024">
   </label>
   <label>Output Bits (16 or 24):
     <input id="output_bits" type="number" min="16" max="24">
   </label>
+  <label>Codec:
+    <select id="codec">
+      <option value="0">PCM (Output Bits)</option>
+      <option value="1">IMA-ADPCM (4:1)</option>
+    </select>
+  </label>
+  <label>Output:
+    <select id="output_mode">
+      <option value="0">Audio around triggers</option>
+      <option value="1">Log-mel features + audio around triggers</option>
+      <option value="2">Log-mel features only</option>
+    </select>
+  </label>
+  <div class="readout" id="feature_readout"></div>
+  <label>Max Batch Bytes (0 = no batching, max 8192):
+    <input id="batch_max_bytes" type="number" min="0" max="8192">
+  </label>
+  <label>Max Batch Delay (ms):
+    <input id="batch_max_delay_ms" type="number" min="0" max="1000">
+  </label>
+  <label>Audio Transport:
+    <select id="transport">
+      <option value="0">WebSocket (TCP)</option>
+      <option value="1">UDP datagrams</option>
+      <option value="2">RTP over UDP</option>
+    </select>
+  </label>
+  <label>UDP Port:
+    <input id="udp_port" type="number" min="1" max="65535">
+  </label>
+  <div class="readout" id="udp_readout"></div>
+  <label class="flex">
+    <input id="flow_auto" type="checkbox"> Reduce bitrate automatically when sends back up
+  </label>
+  <div class="readout" id="flow_readout"></div>
+</section>
+
+<section>
+  <h2>Power</h2>
+  <label>Power Mode:
+    <select id="power_mode">
+      <option value="0">Full (always full clock and radio)</option>
+      <option value="1">Low (scale down and modem sleep between detections)</option>
+    </select>
+  </label>
+  <div class="readout" id="power_readout"></div>
+</section>
+
+<section>
+  <h2>Store and Forward</h2>
+  <label class="flex">
+    <input id="spool_enabled" type="checkbox"> Spool detections while the server is unreachable
+  </label>
+  <label class="flex">
+    <input id="spool_flash" type="checkbox"> Spill to flash when the RAM spool fills up
+  </label>
+  <label>Drain Rate (kbit/s, 8–8000):
+    <input id="spool_drain_kbps" type="number" min="8" max="8000">
+  </label>
+  <div class="readout" id="spool_readout"></div>
 </section>
 
 <section>
@@ -133,6 +282,12 @@ button:hover {
   <label>WebSocket Server:
     <input id="ws_server" type="text">
   </label>
+  <label>WebSocket Port:
+    <input id="ws_port" type="number" min="1" max="65535">
+  </label>
+  <label>NTP Server (empty: receiver clock only):
+    <input id="ntp_server" type="text">
+  </label>
 </section>
 
 <div>
@@ -160,15 +315,47 @@ function clearChanges() {
 function sendSettings() {
   const payload = {
     threshold: parseFloat(document.getElementById('threshold').value),
+    trigger_mode: parseInt(document.getElementById('trigger_mode').value),
+    band_low_hz: parseFloat(document.getElementById('band_low_hz').value),
+    band_high_hz: parseFloat(document.getElementById('band_high_hz').value),
+    spectral_threshold_db: parseFloat(document.getElementById('spectral_threshold_db').value),
     timeout: parseInt(document.getElementById('timeout').value),
+    preroll_ms: parseInt(document.getElementById('preroll_ms').value),
     gain: parseFloat(document.getElementById('gain').value),
+    dc_block: document.getElementById('dc_block').checked,
+    highpass_hz: parseInt(document.getElementById('highpass_hz').value),
     sample_rate: parseInt(document.getElementById('sample_rate').value),
-    buffer_len: parseInt(document.getElementById('buffer_len').value),
+    output_sample_rate: parseInt(document.getElementById('output_sample_rate').value),
+    dma_buf_count: parseInt(document.getElementById('dma_buf_count').value),
+    dma_buf_len: parseInt(document.getElementById('dma_buf_len').value),
+    use_apll: document.getElementById('use_apll').checked,
+    channels: parseInt(document.getElementById('channels').value),
     output_bits: parseInt(document.getElementById('output_bits').value),
+    codec: parseInt(document.getElementById('codec').value),
+    output_mode: parseInt(document.getElementById('output_mode').value),
+    status_sample_count: parseInt(document.getElementById('status_sample_count').value),
+    batch_max_bytes: parseInt(document.getElementById('batch_max_bytes').value),
+    batch_max_delay_ms: parseInt(document.getElementById('batch_max_delay_ms').value),
+    transport: parseInt(document.getElementById('transport').value),
+    flow_auto: document.getElementById('flow_auto').checked,
+    udp_port: parseInt(document.getElementById('udp_port').value),
+    power_mode: parseInt(document.getElementById('power_mode').value),
+    spool_enabled: document.getElementById('spool_enabled').checked,
+    spool_flash: document.getElementById('spool_flash').checked,
+    spool_drain_kbps: parseInt(document.getElementById('spool_drain_kbps').value),
     led_brightness: parseInt(document.getElementById('led_brightness').value),
+    live_rate_hz: parseInt(document.getElementById('live_rate_hz').value),
     simulate_mic: document.getElementById('simulate_mic').checked,
+    sim_signal: parseInt(document.getElementById('sim_signal').value),
+    sim_freq_hz: parseFloat(document.getElementById('sim_freq_hz').value),
+    sim_freq_end_hz: parseFloat(document.getElementById('sim_freq_end_hz').value),
+    sim_level: parseFloat(document.getElementById('sim_level').value),
+    sim_duty_pct: parseInt(document.getElementById('sim_duty_pct').value),
+    sim_period_ms: parseInt(document.getElementById('sim_period_ms').value),
     wifi_ssid: document.getElementById('wifi_ssid').value,
-    ws_server: document.getElementById('ws_server').value
+    ws_server: document.getElementById('ws_server').value,
+    ws_port: parseInt(document.getElementById('ws_port').value),
+    ntp_server: document.getElementById('ntp_server').value
   };
   const pass = document.getElementById('wifi_pass').value;
   if (pass.length > 0) payload.wifi_pass = pass;
@@ -184,18 +371,115 @@ async function updateStatus() {
   const res = await fetch('/status.json');
   const data = await res.json();
   document.getElementById('threshold').value = data.threshold;
+  document.getElementById('trigger_mode').value = data.trigger_mode;
+  document.getElementById('band_low_hz').value = data.band_low_hz;
+  document.getElementById('band_high_hz').value = data.band_high_hz;
+  document.getElementById('spectral_threshold_db').value = data.spectral_threshold_db;
   document.getElementById('timeout').value = data.timeout;
+  document.getElementById('preroll_ms').value = data.preroll_ms;
   document.getElementById('gain').value = data.gain;
+  document.getElementById('dc_block').checked = data.dc_block;
+  document.getElementById('highpass_hz').value = data.highpass_hz;
   document.getElementById('sample_rate').value = data.sample_rate;
-  document.getElementById('buffer_len').value = data.buffer_len;
+  document.getElementById('output_sample_rate').value = data.output_sample_rate;
+  document.getElementById('dma_buf_count').value = data.dma_buf_count;
+  document.getElementById('dma_buf_len').value = data.dma_buf_len;
+  document.getElementById('use_apll').checked = data.use_apll;
+  document.getElementById('channels').value = data.channels;
+  document.getElementById('channel_readout').innerText = data.capture_channels < 2 ? '' :
+    data.channel_rms.map((rms, c) => `ch${c} RMS ${rms.toFixed(4)} peak ${data.channel_peak[c]}` +
+                                     `${data.trigger_channels & (1 << c) ? ' (above)' : ''}`).join(', ');
   document.getElementById('output_bits').value = data.output_bits;
+  document.getElementById('codec').value = data.codec;
+  document.getElementById('output_mode').value = data.output_mode;
+  document.getElementById('feature_readout').innerText = data.output_mode === 0 ? '' :
+    !data.features_available ? `No log-mel filterbank for ${data.sample_rate} Hz` :
+    `${data.feature_frames} frames in ${data.feature_packets} packets (${data.feature_dropped} dropped), ` +
+    `${data.feature_us} us per frame`;
+  document.getElementById('status_sample_count').value = data.status_sample_count;
+  document.getElementById('reconfig_readout').innerText = data.i2s_reconfigurations === 0 ? '' :
+    `${data.i2s_reconfigurations} live I2S changes (${data.i2s_reconfig_failures} rejected), ` +
+    `last lost ${data.i2s_reconfig_downtime_ms} ms of audio (worst ${data.i2s_reconfig_max_downtime_ms} ms)`;
+  document.getElementById('batch_max_bytes').value = data.batch_max_bytes;
+  document.getElementById('batch_max_delay_ms').value = data.batch_max_delay_ms;
+  document.getElementById('transport').value = data.transport;
+  document.getElementById('udp_port').value = data.udp_port;
+  document.getElementById('udp_readout').innerText = data.transport === 0 ? '' :
+    `${data.udp_ready ? 'sending' : 'not ready'}: ${data.udp_datagrams} datagrams, ${data.udp_send_errors} dropped locally; ` +
+    `receiver reports ${data.udp_loss_pct}% lost, ${data.udp_peer_reordered} reordered, ${data.udp_peer_late} late`;
+  document.getElementById('flow_auto').checked = data.flow_auto;
+  document.getElementById('flow_readout').innerText =
+    `${data.flow_paused ? 'paused by server' : 'sending'}, automatic level ${data.flow_auto_level}` +
+    `${data.flow_server_limits ? ', server limits in force' : ''}`;
+  document.getElementById('power_mode').value = data.power_mode;
+  document.getElementById('power_readout').innerText =
+    `${data.power_state} at ${data.cpu_mhz} MHz, modem sleep ${data.modem_sleep ? 'on' : 'off'}, ` +
+    `active ${data.duty_cycle_pct}% of uptime, network task busy ${data.network_busy_pct}%`;
+  document.getElementById('spool_enabled').checked = data.spool_enabled;
+  document.getElementById('spool_flash').checked = data.spool_flash;
+  document.getElementById('spool_drain_kbps').value = data.spool_drain_kbps;
+  document.getElementById('spool_readout').innerText =
+    `${data.spool_packets} packets waiting (RAM ${data.spool_ram_fill_pct}%, flash ${data.spool_flash_fill_pct}%), ` +
+    `${data.spool_drained} drained, ${data.spool_dropped} dropped`;
   document.getElementById('led_brightness').value = data.led_brightness;
+  document.getElementById('live_rate_hz').value = data.live_rate_hz;
   document.getElementById('simulate_mic').checked = data.simulate_mic;
+  document.getElementById('sim_signal').value = data.sim_signal;
+  document.getElementById('sim_freq_hz').value = data.sim_freq_hz;
+  document.getElementById('sim_freq_end_hz').value = data.sim_freq_end_hz;
+  document.getElementById('sim_level').value = data.sim_level;
+  document.getElementById('sim_duty_pct').value = data.sim_duty_pct;
+  document.getElementById('sim_period_ms').value = data.sim_period_ms;
   document.getElementById('wifi_ssid').value = data.wifi_ssid;
   document.getElementById('ws_server').value = data.ws_server;
+  document.getElementById('ws_port').value = data.ws_port;
+  document.getElementById('ntp_server').value = data.ntp_server;
+}
+
+// Binary snapshots from /live: 24-byte header, then {int16 min, int16 max} per bucket
+function drawSnapshot(buffer) {
+  const view = new DataView(buffer);
+  if (buffer.byteLength < 24 || view.getUint16(0, true) !== 0x564C) return;
+  const triggered = (view.getUint8(3) & 1) !== 0;
+  const rate = view.getUint32(8, true);
+  const perBucket = view.getUint16(12, true);
+  const buckets = view.getUint16(14, true);
+  const rms = view.getFloat32(16, true);
+  const peak = view.getInt16(20, true);
+
+  const canvas = document.getElementById('live_canvas');
+  const ctx = canvas.getContext('2d');
+  const w = canvas.width, h = canvas.height, mid = h / 2;
+  ctx.fillStyle = '#111';
+  ctx.fillRect(0, 0, w, h);
+  ctx.strokeStyle = triggered ? '#ff6b6b' : '#4fc3f7';
+  ctx.beginPath();
+  for (let i = 0; i < buckets && 24 + i * 4 + 4 <= buffer.byteLength; i++) {
+    const lo = view.getInt16(24 + i * 4, true);
+    const hi = view.getInt16(26 + i * 4, true);
+    const x = (i + 0.5) * w / buckets;
+    ctx.moveTo(x, mid - hi / 32768 * mid);
+    ctx.lineTo(x, mid - lo / 32768 * mid + 1);
+  }
+  ctx.stroke();
+
+  const windowMs = rate ? (perBucket * buckets * 1000 / rate).toFixed(0) : '?';
+  document.getElementById('live_readout').innerText =
+    `RMS ${rms.toFixed(4)}  Peak ${peak}  ${triggered ? 'TRIGGERED' : 'idle'}  (${windowMs} ms window)`;
+}
+
+function connectLive() {
+  const ws = new WebSocket(`ws://${location.host}/live`);
+  ws.binaryType = 'arraybuffer';
+  ws.onmessage = (event) => drawSnapshot(event.data);
+  ws.onclose = () => {
+    document.getElementById('live_readout').innerText = 'Disconnected, retrying...';
+    setTimeout(connectLive, 2000);
+  };
 }
 
 updateStatus();
+connectLive();
 </script>
 
 </body>
@@ -0,0 +1,84 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <atomic>
+
+// Lock-free single-producer / single-consumer ring of fixed-size slots.
+//
+// The producer and consumer each own one index; neither side ever writes the
+// other's, so no lock is required as long as exactly one task produces and
+// exactly one task consumes. Slots are handed out in place (writeSlot/readSlot)
+// so frames can be filled and drained without an extra copy.
+//
+// Storage is supplied by the caller so large rings can live wherever the
+// caller allocates them. Capacity must be a power of two.
+template <typename T>
+class SpscRing
+{
+public:
+    bool begin(T *storage, size_t capacity)
+    {
+        if (storage == nullptr || capacity == 0 || (capacity & (capacity - 1)) != 0)
+        {
+            return false;
+        }
+        slots = storage;
+        mask = capacity - 1;
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    // --- Producer side ---
+    // Returns the next free slot, or nullptr if the ring is full.
+    T *writeSlot()
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask)
+        {
+            return nullptr;
+        }
+        return &slots[h & mask];
+    }
+
+    // Publishes the slot returned by writeSlot() to the consumer.
+    void commitWrite()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // --- Consumer side ---
+    // Returns the oldest published slot, or nullptr if the ring is empty.
+    T *readSlot()
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+        return &slots[t & mask];
+    }
+
+    // Hands the slot returned by readSlot() back to the producer.
+    void releaseRead()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // --- Either side (approximate while the other side is running) ---
+    size_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return slots ? mask + 1 : 0; }
+
+private:
+    T *slots = nullptr;
+    size_t mask = 0;
+    alignas(32) std::atomic<size_t> head{0}; // Written only by the producer
+    alignas(32) std::atomic<size_t> tail{0}; // Written only by the consumer
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,105 @@
+#ifndef SYNTHETIC_SOURCE_H
+#define SYNTHETIC_SOURCE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "seqlock.h"
+
+// === SYNTHETIC SOURCE ===
+// With AudioSettings::simulate_mic set, the capture task reads from this
+// generator instead of i2s_read() and the I2S driver is not installed. It
+// produces the same raw words the mic would (24-bit left-justified in 32),
+// paced to the sample rate: every block is released when its last sample
+// is due and stamped with exactly that time, so measured_rate_hz matches
+// sample_rate and receivers see perfectly spaced timestamps.
+//
+// Output is a repeating burst: the signal plays for sim_duty_pct of every
+// sim_period_ms, and a -60 dBFS noise floor fills the rest, so the trigger
+// fires once per period with a known length. Everything restarts from the
+// same state (phase, noise seed, clip position) whenever the source is
+// (re)installed, so two runs with the same settings produce the same
+// samples. With more than one capture channel every channel carries the
+// same signal, so the trigger and the receiver see identical mics.
+//
+// The clip is a 16-bit PCM WAV (first channel used) at SIM_CLIP_PATH on
+// LittleFS, e.g. uploaded with `pio run -t uploadfs` from data/. It is
+// loaded into PSRAM the first time it is selected and played at its own
+// rate, one copy from the start per burst. Reading a long clip takes
+// seconds, so it happens in a short-lived low-priority task.
+#define SIM_SIGNAL_TONE 0  // Sine at sim_freq_hz
+#define SIM_SIGNAL_CHIRP 1 // Linear sweep sim_freq_hz -> sim_freq_end_hz over each burst
+#define SIM_SIGNAL_NOISE 2 // White noise
+#define SIM_SIGNAL_CLIP 3  // Recording from flash
+#define SIM_SIGNAL_COUNT 4
+
+#define SIM_CLIP_PATH "/sim_clip.wav"
+#define SIM_CLIP_MAX_BYTES (2 * 1024 * 1024)
+#define SIM_FLOOR_LEVEL 0.001f   // Between bursts (-60 dBFS)
+#define SIM_MAX_LAG_US 100000    // Further behind than this, pacing restarts instead of catching up
+#define SIM_PERIOD_MIN_MS 100
+#define SIM_NOISE_SEED 0x2545F491u
+#define SIM_CLIP_TASK_STACK 4096
+#define SIM_CLIP_TASK_PRIORITY 1
+
+struct AudioSettings;
+
+// What the generator plays; taken from AudioSettings::sim_*
+struct SyntheticConfig
+{
+    uint8_t signal;      // SIM_SIGNAL_*
+    float freq_hz;
+    float freq_end_hz;   // Chirp only
+    float level;         // Peak amplitude 0..1; gain for the clip (1 = as recorded)
+    uint8_t duty_pct;    // 0 = floor only, 100 = continuous
+    uint16_t period_ms;
+};
+
+SyntheticConfig syntheticConfigFor(const AudioSettings &settings);
+
+class SyntheticSource
+{
+public:
+    // --- Network task ---
+    void configure(const SyntheticConfig &next); // Picked up at the capture task's next block
+    void requestClip();                          // Loads SIM_CLIP_PATH in the background, once
+    bool clipLoaded() const { return clip_samples.load(std::memory_order_acquire) != nullptr; }
+
+    // --- Capture task ---
+    void restart(uint32_t sample_rate);
+    // Fills `out` with up to `words` raw words, whole frames of `channels`
+    // interleaved words, waiting until the last one is due. Returns the
+    // words written and the time the block completed.
+    size_t read(int32_t *out, size_t words, uint8_t channels, uint64_t &timestamp_us);
+
+private:
+    static void clipLoaderTask(void *param);
+    bool loadClip(const char *path);
+    void applyConfig(const SyntheticConfig &next);
+    float noise();
+
+    Seqlock<SyntheticConfig> pending;
+    uint32_t applied_version = UINT32_MAX;
+
+    // Capture task state
+    SyntheticConfig config = {};
+    uint32_t rate = 48000;
+    uint64_t start_us = 0;
+    uint64_t produced = 0;      // Samples since start_us
+    uint32_t cycle_samples = 1; // Burst period
+    uint32_t on_samples = 0;    // Burst length
+    uint32_t cycle_pos = 0;
+    float phase = 0.0f;         // Cycles, 0..1
+    uint32_t noise_state = SIM_NOISE_SEED;
+    uint64_t clip_pos = 0;      // Q16 index into the clip
+    uint32_t clip_step = 0;     // Q16 clip samples per output sample
+
+    // Published once by loadClip()
+    std::atomic<bool> clip_requested{false};
+    std::atomic<const int16_t *> clip_samples{nullptr};
+    uint32_t clip_count = 0;
+    uint32_t clip_rate = 0;
+};
+
+extern SyntheticSource synthetic_source;
+
+#endif // SYNTHETIC_SOURCE_H
@@ -0,0 +1,79 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <Arduino.h>
+
+// === CLOCK SYNC ===
+// Maps esp_timer (microseconds since boot, what AudioPacketHeader::timestamp
+// carries) onto the receiver's wall clock, so every packet can also carry
+// its capture time as Unix microseconds (AudioPacketHeader::wall_clock_us)
+// and the receiver can measure capture-to-arrival latency and line up
+// detections from different nodes.
+//
+// Two sources, best one wins:
+//  - SNTP against AudioSettings::ntp_server, started once WiFi is up. Good
+//    to a few ms and enough on its own when the receiver is NTP-synced too.
+//  - Ping/pong with the receiver over the WebSocket text channel:
+//      node:   {"type":"time_ping","seq":N,"t0":<esp_timer us>}
+//      server: {"type":"time_pong","seq":N,"t0":..,"t1":<rx us>,"t2":<tx us>}
+//    with t1/t2 on the receiver's Unix clock. Each exchange gives the NTP
+//    estimate offset = ((t1 - t0) + (t2 - t3)) / 2 with error below rtt / 2;
+//    the offset in use is that of the lowest-RTT exchange among the last
+//    TIME_SYNC_SAMPLES, which throws out samples queued behind audio.
+// The receiver's clock takes over from SNTP at the first pong, and SNTP
+// takes over again if the receiver stops answering for TIME_SYNC_STALE_MS.
+#define TIME_SYNC_INTERVAL_MS 10000      // Ping period once settled
+#define TIME_SYNC_BURST_INTERVAL_MS 1000 // Ping period right after the WebSocket connects
+#define TIME_SYNC_BURST_PINGS 8          // Pings sent at the burst rate
+#define TIME_SYNC_SAMPLES 8              // Exchanges the lowest-RTT filter picks from
+#define TIME_SYNC_MAX_RTT_US 500000      // Slower exchanges are discarded outright
+#define TIME_SYNC_STALE_MS 120000        // Receiver silent this long: fall back to SNTP
+#define TIME_SYNC_SNTP_CHECK_MS 1000     // How often the system clock is re-read
+#define TIME_SYNC_MIN_EPOCH 1700000000   // System clock earlier than this (s) is not set yet
+#define TIME_SYNC_PING_BYTES 80
+
+enum TimeSource : uint8_t
+{
+    TIME_SOURCE_NONE,   // wall_clock_us is 0 on the wire
+    TIME_SOURCE_SNTP,   // System clock set by SNTP
+    TIME_SOURCE_SERVER, // Receiver's clock via time_ping / time_pong
+};
+
+const char *timeSourceName(uint8_t value);
+
+// Snapshot for /status.json and /metrics
+struct TimeSyncStats
+{
+    uint8_t source;        // TimeSource
+    int64_t offset_us;     // Unix us = esp_timer us + offset_us
+    uint32_t rtt_us;       // Round trip of the exchange the offset comes from
+    int32_t last_step_us;  // Change the last offset update made
+    uint32_t age_ms;       // Since the offset was last refreshed
+    uint32_t pings;        // Sent since boot
+    uint32_t pongs;        // Accepted since boot
+    uint32_t rejected;     // Pongs dropped: stale, unknown or above TIME_SYNC_MAX_RTT_US
+};
+
+// Everything below is called from the network task only
+
+// Starts, retargets or (with "") stops SNTP. Call once WiFi is up; repeated
+// calls with the same server do nothing.
+void timeSyncSetNtpServer(const String &server);
+
+// WebSocket (re)connected: the filter starts over with a fresh burst, since
+// the receiver or the path to it may have changed.
+void timeSyncConnected();
+
+// Every network loop pass. Follows the SNTP clock and returns true with a
+// time_ping message in `message` when one should go out now.
+bool timeSyncService(uint32_t now_ms, bool ws_up, char *message, size_t size);
+
+// A time_pong from the receiver; t3 is taken on arrival
+void timeSyncPong(uint32_t seq, int64_t t0, int64_t t1, int64_t t2);
+
+// Receiver-clock Unix microseconds for an esp_timer timestamp; 0 until synced
+int64_t timeSyncWallClock(uint64_t timer_us);
+
+void timeSyncFillStats(TimeSyncStats &stats);
+
+#endif // TIME_SYNC_H
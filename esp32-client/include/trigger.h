@@ -0,0 +1,71 @@
+#ifndef TRIGGER_H
+#define TRIGGER_H
+
+#include <Arduino.h>
+#include "audio_capture.h"
+
+// === PRE-ROLL ===
+#define PREROLL_MAX_MS 1000             // Upper bound for AudioSettings::preroll_ms
+#define PREROLL_INTERNAL_MAX_FRAMES 8   // Fallback depth when no PSRAM is available
+
+// Frames needed to hold `ms` of audio at `sample_rate`, each frame carrying
+// MAX_SAMPLES_PER_READ words of `channels` interleaved channels
+size_t prerollFramesFor(uint32_t ms, uint32_t sample_rate, uint8_t channels);
+
+// Ring of the most recent untransmitted frames. Single-task use (network
+// task): push() overwrites the oldest frame once `depth` frames are held.
+class PreRollBuffer
+{
+public:
+    bool begin(CaptureFrame *storage, size_t frames);
+
+    void setDepth(size_t frames); // Clamped to capacity(); 0 disables pre-roll
+    void push(const CaptureFrame &frame);
+    const CaptureFrame *pop();    // Oldest first, nullptr when empty
+    void clear() { count = 0; }
+
+    size_t size() const { return count; }
+    size_t depth() const { return active_depth; }
+    size_t capacity() const { return frames_allocated; }
+
+private:
+    CaptureFrame *slots = nullptr;
+    size_t frames_allocated = 0;
+    size_t active_depth = 0;
+    size_t first = 0; // Index of the oldest frame
+    size_t count = 0;
+};
+
+// === TRIGGER GATE ===
+enum TriggerState
+{
+    TRIGGER_IDLE,     // Below threshold, filling pre-roll
+    TRIGGER_ACTIVE,   // Above threshold, streaming
+    TRIGGER_HANGOVER  // Fell below threshold, still streaming until the timeout expires
+};
+
+enum TriggerEvent
+{
+    TRIGGER_EVENT_NONE,
+    TRIGGER_EVENT_START, // IDLE -> ACTIVE: flush pre-roll before this frame
+    TRIGGER_EVENT_END    // HANGOVER -> IDLE: this frame closes the detection
+};
+
+// Keeps a detection open for `hangover_ms` after the level last exceeded the
+// threshold, so a call with short pauses streams as one burst.
+class TriggerGate
+{
+public:
+    TriggerEvent update(bool above_threshold, uint32_t now_ms, uint32_t hangover_ms);
+
+    bool active() const { return state != TRIGGER_IDLE; }
+    TriggerState current() const { return state; }
+
+private:
+    TriggerState state = TRIGGER_IDLE;
+    uint32_t last_above_ms = 0;
+};
+
+const char *triggerStateName(TriggerState state);
+
+#endif // TRIGGER_H
@@ -0,0 +1,63 @@
+#ifndef UDP_TRANSPORT_H
+#define UDP_TRANSPORT_H
+
+#include <Arduino.h>
+#include "audio_packet.h"
+
+// === UDP / RTP AUDIO TRANSPORT ===
+// With AudioSettings::transport set to UDP or RTP, live audio packets leave
+// as one datagram each, sent to ws_server:udp_port. A lost datagram is just
+// a gap, so a lossy link no longer stalls the sender behind TCP
+// retransmits. The WebSocket stays up for control messages and for draining
+// the spool, which needs reliable delivery.
+//
+// UDP datagrams carry the wire packet unchanged. RTP datagrams (RFC 3550)
+// put a 12-byte header in front of it, written into the packet's headroom:
+// sequence = low 16 bits of packet_sequence, timestamp = the esp_timer
+// capture time in sample_rate ticks, marker = PACKET_FLAG_TRIGGER_START.
+// Receivers can tell the two apart from the first byte: RTP version 2 has
+// its top bits set to 10, the wire magic's first byte (0x43) does not.
+//
+// The sender only sees its own drops (lwIP out of buffers). Loss and
+// reordering on the path are counted by the receiver and reported back as
+// a {"type":"udp_stats",...} text message on the WebSocket.
+#define TRANSPORT_WS 0
+#define TRANSPORT_UDP 1
+#define TRANSPORT_RTP 2
+
+#define UDP_DEFAULT_PORT 5004
+#define UDP_RESOLVE_RETRY_MS 5000
+#define RTP_HEADER_BYTES 12
+#define RTP_VERSION 2
+#define RTP_PAYLOAD_TYPE 96 // Dynamic range; the payload is a self-describing wire packet
+
+static_assert(RTP_HEADER_BYTES <= PACKET_HEADROOM, "RTP header must fit the packet headroom");
+
+// Snapshot for /status.json
+struct UdpStats
+{
+    uint32_t datagrams;     // Sent since boot
+    uint32_t send_errors;   // Not accepted by lwIP (dropped, never retried)
+    uint64_t bytes;
+    uint32_t peer_received; // Last receiver report
+    uint32_t peer_lost;
+    uint32_t peer_reordered;
+    uint32_t peer_late;     // Arrived after the receiver's jitter buffer gave up on them
+    bool ready;             // Socket open and destination resolved
+};
+
+// Everything below is called from the network task only
+
+// Opens, re-targets or closes the socket to follow the transport / ws_server /
+// udp_port settings. Returns udpTransportReady().
+bool udpTransportService(bool wifi_up);
+bool udpTransportReady();
+
+// Sends one finished packet as a datagram. Never blocks; false means dropped.
+bool udpTransportSend(PacketBuffer *packet);
+
+// Counters from the receiver's udp_stats report
+void udpTransportPeerReport(uint32_t received, uint32_t lost, uint32_t reordered, uint32_t late);
+void udpTransportFillStats(UdpStats &stats);
+
+#endif // UDP_TRANSPORT_H
@@ -0,0 +1,52 @@
+#ifndef AUDIO_CODEC_H
+#define AUDIO_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// === CODEC SETTING ===
+// AudioSettings::codec. PCM width still comes from AudioSettings::output_bits.
+#define CODEC_SETTING_PCM 0
+#define CODEC_SETTING_IMA_ADPCM 1
+
+// === WIRE CODEC IDS ===
+// Carried in AudioPacketHeader::codec so receivers can decode each packet
+// without out-of-band configuration.
+enum AudioCodecId : uint8_t
+{
+    AUDIO_CODEC_PCM16 = 0,     // int16 little-endian
+    AUDIO_CODEC_PCM24 = 1,     // packed 24-bit little-endian
+    AUDIO_CODEC_IMA_ADPCM = 2, // 4-byte block header + 4-bit IMA-ADPCM, low nibble first
+    AUDIO_CODEC_LOG_MEL = 3    // Not audio: quantised log-mel frames (MelPayloadHeader in mel_features.h)
+};
+
+// === IMA-ADPCM ===
+// Every payload starts with the encoder state it was produced from:
+//   int16 predictor | uint8 step index | uint8 reserved (0)
+// so each packet decodes on its own even when earlier packets were lost.
+// A payload with more than one channel carries one such block per channel,
+// back to back in channel order, each imaAdpcmEncodedSize(sample_count)
+// bytes and each from that channel's own encoder state.
+#define IMA_ADPCM_BLOCK_HEADER 4
+
+struct ImaAdpcmState
+{
+    int16_t predictor = 0;
+    uint8_t step_index = 0;
+};
+
+static inline size_t imaAdpcmEncodedSize(size_t samples)
+{
+    return IMA_ADPCM_BLOCK_HEADER + (samples + 1) / 2;
+}
+
+// Encodes `count` 16-bit samples into `out` (imaAdpcmEncodedSize(count)
+// bytes) and advances `state`. Returns the number of bytes written.
+size_t imaAdpcmEncode(const int16_t *in, size_t count, uint8_t *out, ImaAdpcmState &state);
+
+// Decodes one payload produced by imaAdpcmEncode(). Returns samples written.
+size_t imaAdpcmDecode(const uint8_t *in, size_t bytes, int16_t *out, size_t max_samples);
+
+const char *codecName(AudioCodecId codec);
+
+#endif // AUDIO_CODEC_H
@@ -0,0 +1,131 @@
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Hardware-independent sample kernels for the capture path. Nothing in here
+// touches Arduino or ESP-IDF APIs, so the same code runs on the host.
+
+// Buffers handed to convertFrame() that start on this boundary (and frames
+// whose length is a multiple of AUDIO_DSP_SIMD_BLOCK) take the vector path.
+#define AUDIO_DSP_ALIGN 16
+#define AUDIO_DSP_SIMD_BLOCK 8
+
+struct FrameStats
+{
+    uint32_t count;  // Samples folded into peak/sum_sq
+    int16_t peak;    // Largest absolute 16-bit sample
+    uint64_t sum_sq; // Sum of squared 16-bit samples (exact, no float)
+
+    float rms() const; // Normalised to approx 0.0 .. 1.0
+};
+
+// Converts raw 32-bit I2S words to the output format and gathers peak and
+// sum-of-squares in the same pass. output_bits selects 16-bit or packed
+// 24-bit little-endian PCM; pass out = nullptr to only gather statistics.
+// Returns the number of payload bytes written to `out`.
+size_t convertFrame(const int32_t *raw, size_t count, uint8_t output_bits, uint8_t *out, FrameStats &stats);
+
+// Portable reference implementation of convertFrame(). Always available.
+size_t convertFrameScalar(const int32_t *raw, size_t count, uint8_t output_bits, uint8_t *out, FrameStats &stats);
+
+// Checks the SIMD path against the scalar reference once at boot and disables
+// it on mismatch. Returns true when the SIMD path is active.
+bool audioDspInit();
+bool audioDspUsingSimd();
+
+// === PREPROCESSING ===
+// Fixed-point conditioning applied before conversion: one-pole DC blocker,
+// optional 2nd-order Butterworth high-pass, then gain with saturation.
+// Filters run on the 24-bit mic samples with Q30 coefficients and 64-bit
+// accumulators, so gain can lift quiet calls into the 16-bit output without
+// amplifying the mic's DC offset or using float per sample.
+#define PREPROCESS_MAX_GAIN 256.0f
+#define PREPROCESS_DC_POLE 0.995f // ~38 Hz corner at 48 kHz
+
+struct SamplePreprocessor
+{
+    // gain is linear; highpass_hz = 0 disables the biquad
+    void configure(float gain, bool dc_block, float highpass_hz, uint32_t sample_rate);
+    void reset(); // Clears filter history, keeps the configuration
+    bool identity() const { return gain_q16 == (1 << 16) && !dc_block && !highpass; }
+
+    int32_t gain_q16 = 1 << 16;
+    bool dc_block = false;
+    bool highpass = false;
+    int32_t dc_pole_q30 = 0;
+    int32_t b0 = 0, b1 = 0, b2 = 0, a1 = 0, a2 = 0; // Q30, a0 normalised to 1
+
+    int32_t dc_x1 = 0, dc_y1 = 0;
+    int32_t hp_x1 = 0, hp_x2 = 0, hp_y1 = 0, hp_y2 = 0;
+};
+
+// convertFrame() with `pre` applied in the same pass. The conditioned
+// samples are also written back into raw[] (same left-justified format), so
+// a frame that is converted again later (pre-roll) must use convertFrame()
+// and is not filtered twice. Falls through to convertFrame() when `pre` is
+// the identity, keeping the SIMD path.
+size_t processConvertFrame(int32_t *raw, size_t count, uint8_t output_bits, uint8_t *out, FrameStats &stats, SamplePreprocessor &pre);
+
+// === DECIMATION ===
+// Linear-phase low-pass FIR that keeps every factor-th output, for sending a
+// lower rate than the mic is clocked at. Only the retained outputs are
+// computed, which is what the polyphase split buys: taps / factor MACs per
+// input sample. Coefficients are Q15, one block per factor, padded to a
+// multiple of AUDIO_DSP_SIMD_BLOCK and 16-byte aligned so a vector MAC can
+// walk them and the contiguous sample window in lockstep.
+#define DECIMATOR_MAX_FACTOR 4
+#define DECIMATOR_TAPS_PER_PHASE 24 // ~70 dB stopband; the -6 dB point sits at the output Nyquist
+#define DECIMATOR_MAX_TAPS (DECIMATOR_MAX_FACTOR * DECIMATOR_TAPS_PER_PHASE)
+
+static_assert(DECIMATOR_TAPS_PER_PHASE * 2 % AUDIO_DSP_SIMD_BLOCK == 0, "Decimator taps must fill whole vectors");
+
+// Factor that turns input_rate into output_rate: 1 when output_rate is 0 or
+// not lower, 0 when the ratio is not a whole 2..DECIMATOR_MAX_FACTOR.
+uint8_t decimationFactorFor(uint32_t input_rate, uint32_t output_rate);
+
+struct PolyphaseDecimator
+{
+    bool configure(uint8_t factor); // 1 bypasses; false (and bypass) for unsupported factors
+    void reset();                   // Clears history and phase, keeps the filter
+
+    // Filters raw I2S words and writes the kept samples to `out` in the same
+    // left-justified format, ready for convertFrame(). The phase carries over
+    // between calls, so frames need not be a multiple of the factor. Returns
+    // the number of samples written (at most count / factor + 1).
+    size_t process(const int32_t *raw, size_t count, int32_t *out);
+
+    uint8_t factor() const { return decimation; }
+    size_t taps() const { return tap_count; }
+
+    alignas(AUDIO_DSP_ALIGN) int16_t coeffs[DECIMATOR_MAX_TAPS] = {};
+    alignas(AUDIO_DSP_ALIGN) int32_t history[DECIMATOR_MAX_TAPS] = {};           // Last taps-1 raw words
+    alignas(AUDIO_DSP_ALIGN) int32_t window[2 * DECIMATOR_MAX_TAPS] = {};        // History joined to a frame's head
+    uint8_t decimation = 1;
+    size_t tap_count = 0;
+    size_t skip = 0; // Input samples to consume before the next kept output
+};
+
+// === CHANNELS ===
+// Stereo and TDM reads arrive interleaved one word per slot. The filters,
+// the decimator and the detectors carry state per channel, so they run on
+// planar copies: plane c starts at c * stride. A stride that is a multiple
+// of AUDIO_DSP_SIMD_BLOCK keeps every plane 16-byte aligned for the vector
+// conversion path.
+#define AUDIO_MAX_CHANNELS 4
+
+static inline size_t planeStride(size_t frames)
+{
+    return (frames + AUDIO_DSP_SIMD_BLOCK - 1) & ~(size_t)(AUDIO_DSP_SIMD_BLOCK - 1);
+}
+
+// `frames` frames of `channels` (1..AUDIO_MAX_CHANNELS) words each into
+// planes `stride` words apart, and back. Unsupported counts copy nothing.
+void deinterleaveFrame(const int32_t *interleaved, size_t frames, uint8_t channels, int32_t *planar, size_t stride);
+void interleaveFrame(const int32_t *planar, size_t stride, size_t frames, uint8_t channels, int32_t *interleaved);
+
+// Same 16-bit view of a raw I2S word that every kernel uses
+static inline int16_t rawToSample16(int32_t raw) { return (int16_t)(raw >> 16); }
+
+#endif // AUDIO_DSP_H
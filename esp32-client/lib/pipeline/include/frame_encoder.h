@@ -0,0 +1,101 @@
+#ifndef FRAME_ENCODER_H
+#define FRAME_ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "audio_codec.h"
+#include "audio_dsp.h"
+#include "packet_format.h"
+
+// === FRAME ENCODER ===
+// The process -> packetize half of the pipeline for one capture frame:
+// preprocessing (gain / DC blocker / high-pass), decimation to the output
+// rate and the codec, with RMS/peak gathered in the same pass. Owns the
+// filter and encoder state that carries over from frame to frame, so one
+// instance serves one stream from one task. Hardware-independent like
+// audio_dsp.h: the firmware drives it from the network task and bench/ runs
+// the same code on the host.
+//
+// Stereo and TDM frames come in interleaved and go out interleaved; in
+// between, each channel is split into its own plane and has its own filter,
+// decimator and ADPCM state, and its own statistics for the trigger. Mono
+// frames never leave the single-channel path.
+
+// What one frame turned into on the wire
+struct EncodedPayload
+{
+    size_t bytes = 0;         // 0 if the configuration is unsupported
+    uint16_t samples = 0;     // Per channel, after decimation
+    uint32_t sample_rate = 0; // Rate of the payload, not of the mic
+    AudioCodecId codec = AUDIO_CODEC_PCM16;
+    uint8_t channels = 1;
+    uint32_t encode_us = 0;   // Time spent in a compressing codec (needs setClock())
+};
+
+class FrameEncoder
+{
+public:
+    // Output format: PCM width (16 or 24) and CODEC_SETTING_*, plus the
+    // interleaved channel count of the frames that follow. Cheap, so it can
+    // follow the settings every frame; a new channel count starts every
+    // filter, decimator and codec state over.
+    void setFormat(uint32_t sample_rate, uint8_t output_bits, uint8_t codec_setting, uint8_t frame_channels = 1);
+    void configurePreprocessor(float gain, bool dc_block, float highpass_hz);
+    // 1 bypasses; false (and bypass) for factors PolyphaseDecimator rejects
+    bool setDecimation(uint8_t factor);
+    void resetDecimator(); // A new detection starts with a clean filter
+    uint8_t decimation() const { return decimators[0].factor(); }
+    size_t decimatorTaps() const { return decimators[0].taps(); }
+
+    // Microsecond clock for EncodedPayload::encode_us; none by default
+    void setClock(int64_t (*now_us)()) { clock_us = now_us; }
+
+    // A fresh frame: the preprocessor runs in the conversion pass and the
+    // conditioned samples replace raw[] for everything downstream.
+    // With payload == nullptr only the statistics are computed. `count` is
+    // in words, all channels together; `stats` covers every channel.
+    // Returns the payload size (0 if the configuration is unsupported).
+    size_t conditionAndEncode(int32_t *raw, size_t count, uint8_t *payload, FrameStats &stats, EncodedPayload &encoded);
+    // A frame that already went through conditionAndEncode() (pre-roll,
+    // re-sends). Like a decimated mono frame, a multi-channel one leaves
+    // `stats` untouched.
+    size_t encode(const int32_t *raw, size_t count, uint8_t *payload, FrameStats &stats, EncodedPayload &encoded);
+
+    // The last conditionAndEncode() frame, one channel at a time: its
+    // statistics and its conditioned samples at the mic rate, frames() long.
+    // Valid until the next call.
+    uint8_t channels() const { return channel_count; }
+    size_t frames() const { return plane_frames; }
+    const FrameStats &channelStats(uint8_t channel) const { return channel_stats[channel]; }
+    const int32_t *plane(uint8_t channel) const;
+
+private:
+    template <typename Convert>
+    size_t encodeWith(Convert convert, size_t count, uint8_t *payload, FrameStats &stats, EncodedPayload &encoded);
+    size_t encodeDecimated(const int32_t *raw, size_t count, uint8_t *payload, EncodedPayload &encoded);
+    size_t conditionChannels(int32_t *raw, size_t frames, uint8_t *payload, FrameStats &stats, EncodedPayload &encoded);
+    size_t encodeChannels(const int32_t *raw, size_t frames, bool planes_ready, uint8_t *payload, EncodedPayload &encoded);
+
+    SamplePreprocessor preprocessors[AUDIO_MAX_CHANNELS];
+    PolyphaseDecimator decimators[AUDIO_MAX_CHANNELS];
+    ImaAdpcmState adpcm_states[AUDIO_MAX_CHANNELS]; // Carried from packet to packet
+    FrameStats channel_stats[AUDIO_MAX_CHANNELS] = {};
+    uint32_t sample_rate = 48000;
+    uint8_t output_bits = 16;
+    uint8_t codec_setting = CODEC_SETTING_PCM;
+    uint8_t channel_count = 1;
+    float gain = 1.0f;
+    bool dc_block = false;
+    float highpass_hz = 0.0f;
+    int64_t (*clock_us)() = nullptr;
+    const int32_t *mono_plane = nullptr; // Mono frames are their own plane
+    size_t plane_frames = 0;
+
+    // Rounding every plane up to whole vectors costs at most one block per channel
+    alignas(AUDIO_DSP_ALIGN) int16_t pcm16[MAX_SAMPLES_PER_READ + AUDIO_MAX_CHANNELS * AUDIO_DSP_SIMD_BLOCK];  // ADPCM input
+    alignas(AUDIO_DSP_ALIGN) int32_t decimated[MAX_SAMPLES_PER_READ / 2 + AUDIO_MAX_CHANNELS];              // Decimator output
+    alignas(AUDIO_DSP_ALIGN) int32_t planes[MAX_SAMPLES_PER_READ + AUDIO_MAX_CHANNELS * AUDIO_DSP_SIMD_BLOCK]; // Mic-rate planes
+    alignas(AUDIO_DSP_ALIGN) int32_t decimated_planes[MAX_SAMPLES_PER_READ / 2 + AUDIO_MAX_CHANNELS * AUDIO_DSP_SIMD_BLOCK];
+};
+
+#endif // FRAME_ENCODER_H
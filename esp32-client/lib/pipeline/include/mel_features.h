@@ -0,0 +1,95 @@
+#ifndef MEL_FEATURES_H
+#define MEL_FEATURES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "spectral_detector.h"
+
+// Hardware-independent like audio_dsp.h. Turns the spectral detector's FFT
+// into quantised log-mel frames, the input the backend classifier needs, so
+// an always-on node can send those instead of raw audio.
+
+// === OUTPUT MODE ===
+// AudioSettings::output_mode
+#define OUTPUT_MODE_AUDIO 0         // Audio around triggers, as before
+#define OUTPUT_MODE_FEATURES 1      // Log-mel frames all the time, plus audio around triggers
+#define OUTPUT_MODE_FEATURES_ONLY 2 // Log-mel frames only; trigger edges ride on their flags
+
+// === LOG-MEL FRAMES ===
+// One frame per spectral analysis (SPECTRAL_HOP samples, 50% overlap):
+// MEL_BANDS triangular filters with a peak of 1 (HTK style), spaced evenly
+// on the mel scale from MEL_LOW_HZ to MEL_HIGH_HZ or Nyquist if lower. Each
+// band's power is scaled like SpectralDetector::bandDb() and stored as one
+// byte, MEL_DB_FLOOR + code * MEL_DB_STEP_Q4 / 16 dB (code 0 also means
+// "at or below").
+#define MEL_BANDS 40
+#define MEL_LOW_HZ 150
+#define MEL_HIGH_HZ 15000
+#define MEL_DB_FLOOR -120
+#define MEL_DB_STEP_Q4 8 // 0.5 dB per code: -120 .. +7.5 dB
+#define MEL_FRAMES_PER_PACKET 16 // ~170 ms at 48 kHz
+#define MEL_MAX_WEIGHTS SPECTRAL_FFT_SIZE // A bin lies in at most two triangles
+
+// Payload of an AUDIO_CODEC_LOG_MEL packet. The wire header's sample_count
+// is the number of frames, sample_rate the mic rate and timestamp the start
+// of the first frame's FFT window. Frames follow the header oldest first,
+// MEL_BANDS bytes each, low band first.
+struct MelPayloadHeader
+{
+    uint8_t bands;       // MEL_BANDS
+    uint8_t reserved;    // 0
+    uint16_t fft_size;   // SPECTRAL_FFT_SIZE, periodic Hann window
+    uint16_t hop;        // Mic samples between frames
+    uint16_t low_hz;     // Lower edge of the first band
+    uint16_t high_hz;    // Upper edge of the last band
+    int8_t db_floor;     // MEL_DB_FLOOR
+    uint8_t db_step_q4;  // MEL_DB_STEP_Q4
+} __attribute__((packed));
+
+static_assert(sizeof(MelPayloadHeader) == 12, "Mel payload header layout changed");
+
+// === FILTERBANK ===
+// Sparse: each band lists only the bins under its triangle, so a frame costs
+// about two multiply-adds per bin. The tables are built at compile time for
+// the rates in MEL_TABLE_RATES; other rates have no feature mode.
+#define MEL_TABLE_RATES(X) X(16000) X(22050) X(24000) X(32000) X(44100) X(48000) X(96000)
+
+struct MelBand
+{
+    uint16_t first_bin;
+    uint16_t bins;          // Weights for first_bin .. first_bin + bins - 1
+    uint16_t weight_offset; // Into MelFilterbank::weights
+};
+
+struct MelFilterbank
+{
+    uint32_t sample_rate;
+    uint16_t low_hz, high_hz;
+    uint16_t first_bin, last_bin; // Every bin any band reads
+    MelBand bands[MEL_BANDS];
+    uint16_t weights[MEL_MAX_WEIGHTS]; // Q16, 65535 = 1.0; the bands' runs back to back
+};
+
+// Compile-time table for `sample_rate`, or nullptr if it has none
+const MelFilterbank *melFilterbankFor(uint32_t sample_rate);
+
+class MelFeatureExtractor
+{
+public:
+    // False (and no frames) when `sample_rate` has no filterbank
+    bool begin(uint32_t sample_rate);
+    bool ready() const { return bank != nullptr; }
+    const MelFilterbank *filterbank() const { return bank; }
+
+    // One frame from the detector's last analysis into out[MEL_BANDS]
+    void compute(const SpectralDetector &detector, uint8_t *out);
+
+    // The payload header for frames from this filterbank
+    void fillHeader(MelPayloadHeader &header) const;
+
+private:
+    const MelFilterbank *bank = nullptr;
+    alignas(16) float spectrum[SPECTRAL_FFT_SIZE / 2];
+};
+
+#endif // MEL_FEATURES_H
@@ -0,0 +1,90 @@
+#ifndef PACKET_FORMAT_H
+#define PACKET_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "audio_codec.h"
+
+// Wire format shared by every transport, the spool and the host benchmarks.
+// Hardware-independent like audio_dsp.h; the heap-backed pool and batch that
+// carry these buffers on the device live in audio_packet.h.
+
+// === FRAME SIZE ===
+#define I2S_READ_BUFFER_SIZE 2048                       // Size of the buffer for i2s_read in bytes
+#define MAX_SAMPLES_PER_READ (I2S_READ_BUFFER_SIZE / 4) // Max samples based on 32-bit I2S read
+
+// === PACKET LAYOUT ===
+// Each pooled buffer is laid out as
+//   [pad][PACKET_HEADROOM][AudioPacketHeader][payload ...]
+//                                            ^ PACKET_PAYLOAD_OFFSET
+// The headroom lets WebSocketsClient::sendBIN(..., headerToPayload = true)
+// write its frame header (and mask the payload) in place instead of
+// allocating and copying a send buffer of its own. The pad keeps the payload
+// on a 16-byte boundary so the SIMD conversion kernel can store into it.
+#define PACKET_HEADROOM 14                              // Must equal WEBSOCKETS_MAX_HEADER_SIZE
+#define PACKET_PAYLOAD_OFFSET 64                        // Headroom + header, rounded up to 16 bytes
+#define MAX_PACKET_PAYLOAD_BYTES (MAX_SAMPLES_PER_READ * 3) // Largest payload: 24-bit PCM
+
+// === WIRE HEADER ===
+// Every packet is self-describing so receivers need no per-node config and
+// can walk a stream of back-to-back packets using header_size + payload_bytes.
+// All fields little-endian. Receivers must skip header_size bytes rather than
+// sizeof(AudioPacketHeader) so later versions can append fields.
+//
+// Version 2 appends wall_clock_us after the CRC field. Version 1 receivers
+// skip it unread and still validate the packet, because the CRC keeps
+// covering only the version 1 header prefix and the payload.
+#define AUDIO_PACKET_MAGIC 0x4E43 // "CN" on the wire
+#define AUDIO_PACKET_VERSION 2
+
+// AudioPacketHeader::flags
+#define PACKET_FLAG_TRIGGER_START 0x01 // First live frame of a detection
+#define PACKET_FLAG_TRIGGER_END 0x02   // Last frame of a detection (hangover expired)
+#define PACKET_FLAG_PREROLL 0x04       // Captured before the trigger fired
+#define PACKET_FLAG_OVERRUN 0x08       // Capture dropped frames right before this one
+#define PACKET_FLAG_SPOOLED 0x10       // Held in the spool while the link was down, sent late
+
+struct AudioPacketHeader
+{
+    uint16_t magic;         // AUDIO_PACKET_MAGIC
+    uint8_t version;        // AUDIO_PACKET_VERSION
+    uint8_t header_size;    // sizeof(AudioPacketHeader) for this version
+    uint32_t sequence;      // Packet sequence number
+    uint64_t timestamp;     // Capture timestamp of the first sample (microseconds from esp_timer)
+    uint32_t sample_rate;   // Hz
+    uint16_t sample_count;  // Samples per channel in the payload (AUDIO_CODEC_LOG_MEL: feature frames)
+    uint16_t payload_bytes; // Bytes following the header
+    uint8_t codec;          // AudioCodecId of the payload
+    uint8_t flags;          // PACKET_FLAG_*
+    uint8_t channels;       // Interleaved channel count (IMA-ADPCM: one block per channel)
+    uint8_t reserved;       // 0
+    uint32_t crc32;         // CRC-32 (IEEE, as zlib.crc32) of the header up to this field, then the payload
+    int64_t wall_clock_us;  // Version 2: timestamp as Unix microseconds on the receiver's clock, 0 until synced
+} __attribute__((packed)); // Prevent compiler padding
+
+static_assert(sizeof(AudioPacketHeader) == 40, "Wire header layout changed");
+
+static_assert(PACKET_PAYLOAD_OFFSET >= PACKET_HEADROOM + sizeof(AudioPacketHeader), "Packet header does not fit");
+static_assert(PACKET_PAYLOAD_OFFSET % 16 == 0, "Packet payload must stay 16-byte aligned");
+
+struct PacketBuffer
+{
+    uint8_t *storage;   // 16-byte aligned; PACKET_PAYLOAD_OFFSET + payload capacity
+    size_t length;      // Packet bytes in use (header + payload)
+
+    uint8_t *payload() { return storage + PACKET_PAYLOAD_OFFSET; }
+    uint8_t *packet() { return payload() - sizeof(AudioPacketHeader); }
+    AudioPacketHeader *header() { return reinterpret_cast<AudioPacketHeader *>(packet()); }
+    uint8_t *wsFrame() { return packet() - PACKET_HEADROOM; } // What sendBIN(..., true) expects
+};
+
+// Writes the wire header for a filled payload, computes the CRC over header
+// and payload and sets packet->length.
+void finalizePacket(PacketBuffer *packet, uint32_t sequence, uint64_t timestamp, int64_t wall_clock_us,
+                    uint32_t sample_rate, uint16_t sample_count, uint8_t channels, AudioCodecId codec, uint8_t flags,
+                    size_t payload_bytes);
+
+// Standard reflected CRC-32 (polynomial 0xEDB88320); pass 0 to start.
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t length);
+
+#endif // PACKET_FORMAT_H
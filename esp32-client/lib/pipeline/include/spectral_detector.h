@@ -0,0 +1,73 @@
+#ifndef SPECTRAL_DETECTOR_H
+#define SPECTRAL_DETECTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Hardware-independent like audio_dsp.h: the FFT runs on esp-dsp when the
+// library is available and on a portable radix-2 implementation otherwise.
+
+// === SPECTRAL DETECTOR ===
+// Hann-windowed real FFT of SPECTRAL_FFT_SIZE samples, advanced every
+// SPECTRAL_HOP samples (50% overlap, one analysis per capture frame). The
+// energy between two configurable frequencies is compared with a noise floor
+// that follows the band energy down quickly and up slowly, so steady wind,
+// traffic or HVAC noise raises the floor instead of holding the trigger open.
+#define SPECTRAL_FFT_SIZE 1024
+#define SPECTRAL_HOP (SPECTRAL_FFT_SIZE / 2)
+#define SPECTRAL_MIN_DB -120.0f
+
+// AudioSettings::trigger_mode
+#define TRIGGER_MODE_RMS 0      // Broadband RMS vs. trigger_rms_threshold
+#define TRIGGER_MODE_SPECTRAL 1 // Band energy vs. noise floor + spectral_threshold_db
+
+class SpectralDetector
+{
+public:
+    bool begin(uint32_t sample_rate, float band_low_hz, float band_high_hz);
+    void setBand(float band_low_hz, float band_high_hz); // Clamped to the FFT range
+
+    // Appends raw I2S words; runs one analysis for every SPECTRAL_HOP
+    // samples collected. Returns the number of analyses performed.
+    size_t process(const int32_t *raw, size_t count);
+
+    // Result of the last analysis
+    bool above(float threshold_db) const { return primed && band_db - floor_db > threshold_db; }
+    float bandDb() const { return band_db; }   // dBFS of the band (full-scale sine = -3)
+    float floorDb() const { return floor_db; } // Adaptive noise floor, same scale
+    uint32_t sampleRate() const { return rate; }
+    float bandLowHz() const;
+    float bandHighHz() const;
+    uint32_t analysisCount() const { return analyses_run; } // Changes whenever the spectrum below does
+
+    // Power of bins [first_bin, last_bin] of the last analysis into out[],
+    // scaled like bandDb() so that the bins of a band sum to its mean square.
+    // Bin 0 (DC) reads 0. Valid until the next analysis.
+    void powerSpectrum(float *out, size_t first_bin, size_t last_bin) const;
+
+    // Exposed for the benchmark and host checks
+    void analyse();
+
+    static bool usingEspDsp();
+
+private:
+    void updateFloor(bool louder);
+    float binEnergy(size_t k) const;
+
+    alignas(16) float history[SPECTRAL_FFT_SIZE];     // Newest sample last
+    alignas(16) float window[SPECTRAL_FFT_SIZE];
+    alignas(16) float work[SPECTRAL_FFT_SIZE];        // SPECTRAL_FFT_SIZE / 2 complex points
+    alignas(16) float split_twiddle[SPECTRAL_FFT_SIZE]; // cos/sin of 2*pi*k/N, k < N/2
+    float window_power = 1.0f;                        // Sum of window^2
+    uint32_t analyses_run = 0;
+    size_t pending = 0;                               // Samples since the last analysis
+    size_t bin_low = 1;
+    size_t bin_high = 1;
+    uint32_t rate = 0;
+    float band_db = SPECTRAL_MIN_DB;
+    float floor_db = SPECTRAL_MIN_DB;
+    bool primed = false; // history[] filled and a floor established
+    size_t filled = 0;
+};
+
+#endif // SPECTRAL_DETECTOR_H
@@ -0,0 +1,144 @@
+// lib/pipeline/src/audio_codec.cpp
+
+#include "audio_codec.h"
+
+static const int8_t ima_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8};
+
+static const int16_t ima_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+static inline int32_t clampSample(int32_t value)
+{
+    return value > 32767 ? 32767 : (value < -32768 ? -32768 : value);
+}
+
+static inline int32_t clampIndex(int32_t index)
+{
+    return index < 0 ? 0 : (index > 88 ? 88 : index);
+}
+
+// Applies one nibble to (predictor, index); shared by encoder and decoder so
+// both sides reconstruct exactly the same signal.
+static inline void imaStep(uint8_t nibble, int32_t &predictor, int32_t &index)
+{
+    const int32_t step = ima_step_table[index];
+    int32_t delta = step >> 3;
+    if (nibble & 4)
+    {
+        delta += step;
+    }
+    if (nibble & 2)
+    {
+        delta += step >> 1;
+    }
+    if (nibble & 1)
+    {
+        delta += step >> 2;
+    }
+    predictor = clampSample((nibble & 8) ? predictor - delta : predictor + delta);
+    index = clampIndex(index + ima_index_table[nibble]);
+}
+
+size_t imaAdpcmEncode(const int16_t *in, size_t count, uint8_t *out, ImaAdpcmState &state)
+{
+    int32_t predictor = state.predictor;
+    int32_t index = clampIndex(state.step_index);
+
+    out[0] = (uint8_t)(predictor & 0xFF);
+    out[1] = (uint8_t)((predictor >> 8) & 0xFF);
+    out[2] = (uint8_t)index;
+    out[3] = 0;
+    uint8_t *dest = out + IMA_ADPCM_BLOCK_HEADER;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        int32_t diff = in[i] - predictor;
+        uint8_t nibble = 0;
+        if (diff < 0)
+        {
+            nibble = 8;
+            diff = -diff;
+        }
+        int32_t step = ima_step_table[index];
+        if (diff >= step)
+        {
+            nibble |= 4;
+            diff -= step;
+        }
+        step >>= 1;
+        if (diff >= step)
+        {
+            nibble |= 2;
+            diff -= step;
+        }
+        step >>= 1;
+        if (diff >= step)
+        {
+            nibble |= 1;
+        }
+
+        imaStep(nibble, predictor, index);
+
+        if ((i & 1) == 0)
+        {
+            dest[i / 2] = nibble;
+        }
+        else
+        {
+            dest[i / 2] |= (uint8_t)(nibble << 4);
+        }
+    }
+
+    state.predictor = (int16_t)predictor;
+    state.step_index = (uint8_t)index;
+    return imaAdpcmEncodedSize(count);
+}
+
+size_t imaAdpcmDecode(const uint8_t *in, size_t bytes, int16_t *out, size_t max_samples)
+{
+    if (bytes < IMA_ADPCM_BLOCK_HEADER)
+    {
+        return 0;
+    }
+    int32_t predictor = (int16_t)(in[0] | (in[1] << 8));
+    int32_t index = clampIndex(in[2]);
+
+    size_t produced = 0;
+    for (size_t i = IMA_ADPCM_BLOCK_HEADER; i < bytes && produced < max_samples; ++i)
+    {
+        imaStep(in[i] & 0x0F, predictor, index);
+        out[produced++] = (int16_t)predictor;
+        if (produced < max_samples)
+        {
+            imaStep(in[i] >> 4, predictor, index);
+            out[produced++] = (int16_t)predictor;
+        }
+    }
+    return produced;
+}
+
+const char *codecName(AudioCodecId codec)
+{
+    switch (codec)
+    {
+    case AUDIO_CODEC_PCM16:
+        return "pcm16";
+    case AUDIO_CODEC_PCM24:
+        return "pcm24";
+    case AUDIO_CODEC_IMA_ADPCM:
+        return "ima_adpcm";
+    case AUDIO_CODEC_LOG_MEL:
+        return "log_mel";
+    }
+    return "unknown";
+}
@@ -0,0 +1,576 @@
+// lib/pipeline/src/audio_dsp.cpp
+
+#include <math.h>
+#include <string.h>
+
+#include "audio_dsp.h"
+
+#if __has_include("sdkconfig.h")
+#include "sdkconfig.h"
+#endif
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && !defined(AUDIO_DSP_FORCE_SCALAR)
+#define AUDIO_DSP_HAVE_PIE 1
+// audio_dsp_aes3.S: 8 samples per iteration using the S3 PIE vector unit.
+//   extrema receives 8 lanes of max followed by 8 lanes of min,
+//   acc receives the 40-bit ACCX accumulator as {low 32 bits, high 8 bits}.
+extern "C" void audio_convert16_aes3(const int32_t *raw, int16_t *out, int blocks, int16_t *extrema, uint32_t *acc);
+#else
+#define AUDIO_DSP_HAVE_PIE 0
+#endif
+
+// ACCX is 40 bits wide; 256 full-scale squares (2^38) can never overflow it
+#define PIE_MAX_BLOCKS_PER_CALL (256 / AUDIO_DSP_SIMD_BLOCK)
+
+static bool simd_enabled = false;
+
+float FrameStats::rms() const
+{
+    if (count == 0)
+    {
+        return 0.0f;
+    }
+    return sqrtf((float)sum_sq / (float)count) / 32768.0f;
+}
+
+static inline int16_t clampPeak(int32_t value)
+{
+    return value > 32767 ? 32767 : (int16_t)value;
+}
+
+// One loop per output format so the per-sample body carries no mode branch
+template <uint8_t Bits>
+static void convertScalarLoop(const int32_t *raw, size_t count, uint8_t *out, int32_t &peak, uint64_t &sum_sq)
+{
+    int16_t *out16 = reinterpret_cast<int16_t *>(out);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int32_t sample_24 = raw[i] >> 8; // Apply initial shift based on mic data format
+        const int16_t sample_16 = (int16_t)(sample_24 >> 8);
+
+        if (Bits == 16)
+        {
+            out16[i] = sample_16;
+        }
+        else if (Bits == 24)
+        {
+            out[i * 3 + 0] = (uint8_t)(sample_24 & 0xFF);
+            out[i * 3 + 1] = (uint8_t)((sample_24 >> 8) & 0xFF);
+            out[i * 3 + 2] = (uint8_t)((sample_24 >> 16) & 0xFF);
+        }
+
+        const int32_t abs_sample = sample_16 < 0 ? -(int32_t)sample_16 : sample_16;
+        if (abs_sample > peak)
+        {
+            peak = abs_sample;
+        }
+        sum_sq += (uint32_t)((int32_t)sample_16 * sample_16);
+    }
+}
+
+static size_t payloadBytes(size_t count, uint8_t output_bits, const uint8_t *out)
+{
+    if (!out)
+    {
+        return 0;
+    }
+    if (output_bits == 16)
+    {
+        return count * 2;
+    }
+    if (output_bits == 24)
+    {
+        return count * 3;
+    }
+    return 0;
+}
+
+size_t convertFrameScalar(const int32_t *raw, size_t count, uint8_t output_bits, uint8_t *out, FrameStats &stats)
+{
+    int32_t peak = 0;
+    uint64_t sum_sq = 0;
+
+    if (out && output_bits == 16)
+    {
+        convertScalarLoop<16>(raw, count, out, peak, sum_sq);
+    }
+    else if (out && output_bits == 24)
+    {
+        convertScalarLoop<24>(raw, count, out, peak, sum_sq);
+    }
+    else
+    {
+        convertScalarLoop<0>(raw, count, nullptr, peak, sum_sq);
+    }
+
+    stats.count = count;
+    stats.peak = clampPeak(peak);
+    stats.sum_sq = sum_sq;
+    return payloadBytes(count, output_bits, out);
+}
+
+// === Preprocessing ===
+#define Q30_ONE (1 << 30)
+#define SAMPLE_24_MAX ((1 << 23) - 1)
+#define SAMPLE_24_MIN (-(1 << 23))
+
+static int32_t toQ30(double value)
+{
+    return (int32_t)lrint(value * Q30_ONE);
+}
+
+void SamplePreprocessor::configure(float gain, bool enable_dc_block, float highpass_hz, uint32_t sample_rate)
+{
+    gain = gain < 0.0f ? 0.0f : (gain > PREPROCESS_MAX_GAIN ? PREPROCESS_MAX_GAIN : gain);
+    gain_q16 = (int32_t)lrintf(gain * 65536.0f);
+
+    dc_block = enable_dc_block;
+    dc_pole_q30 = toQ30(PREPROCESS_DC_POLE);
+
+    // RBJ cookbook high-pass, Q = 1/sqrt(2)
+    highpass = highpass_hz > 0.0f && sample_rate > 0 && highpass_hz < sample_rate * 0.45f;
+    if (highpass)
+    {
+        const double w0 = 2.0 * M_PI * highpass_hz / sample_rate;
+        const double alpha = sin(w0) / (2.0 * M_SQRT1_2);
+        const double cw = cos(w0);
+        const double a0 = 1.0 + alpha;
+        b0 = toQ30((1.0 + cw) / 2.0 / a0);
+        b1 = toQ30(-(1.0 + cw) / a0);
+        b2 = b0;
+        a1 = toQ30(-2.0 * cw / a0);
+        a2 = toQ30((1.0 - alpha) / a0);
+    }
+}
+
+void SamplePreprocessor::reset()
+{
+    dc_x1 = dc_y1 = 0;
+    hp_x1 = hp_x2 = hp_y1 = hp_y2 = 0;
+}
+
+static inline int32_t saturate24(int64_t value)
+{
+    return value > SAMPLE_24_MAX ? SAMPLE_24_MAX : (value < SAMPLE_24_MIN ? SAMPLE_24_MIN : (int32_t)value);
+}
+
+template <uint8_t Bits, bool DcBlock, bool HighPass>
+static void processScalarLoop(int32_t *raw, size_t count, uint8_t *out, SamplePreprocessor &pre, int32_t &peak, uint64_t &sum_sq)
+{
+    int16_t *out16 = reinterpret_cast<int16_t *>(out);
+    // Filter state lives in registers for the frame
+    int32_t dc_x1 = pre.dc_x1, dc_y1 = pre.dc_y1;
+    int32_t hp_x1 = pre.hp_x1, hp_x2 = pre.hp_x2, hp_y1 = pre.hp_y1, hp_y2 = pre.hp_y2;
+    const int32_t gain_q16 = pre.gain_q16;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        int32_t x = raw[i] >> 8;
+        if (DcBlock)
+        {
+            // y = x - x[-1] + p * y[-1]
+            const int32_t y = saturate24((int64_t)x - dc_x1 + (((int64_t)dc_y1 * pre.dc_pole_q30) >> 30));
+            dc_x1 = x;
+            dc_y1 = y;
+            x = y;
+        }
+        if (HighPass)
+        {
+            const int64_t acc = (int64_t)pre.b0 * x + (int64_t)pre.b1 * hp_x1 + (int64_t)pre.b2 * hp_x2
+                                - (int64_t)pre.a1 * hp_y1 - (int64_t)pre.a2 * hp_y2;
+            const int32_t y = saturate24(acc >> 30);
+            hp_x2 = hp_x1;
+            hp_x1 = x;
+            hp_y2 = hp_y1;
+            hp_y1 = y;
+            x = y;
+        }
+        const int32_t sample_24 = saturate24(((int64_t)x * gain_q16) >> 16);
+        raw[i] = sample_24 << 8; // Back to the I2S word layout for later passes
+        const int16_t sample_16 = (int16_t)(sample_24 >> 8);
+
+        if (Bits == 16)
+        {
+            out16[i] = sample_16;
+        }
+        else if (Bits == 24)
+        {
+            out[i * 3 + 0] = (uint8_t)(sample_24 & 0xFF);
+            out[i * 3 + 1] = (uint8_t)((sample_24 >> 8) & 0xFF);
+            out[i * 3 + 2] = (uint8_t)((sample_24 >> 16) & 0xFF);
+        }
+
+        const int32_t abs_sample = sample_16 < 0 ? -(int32_t)sample_16 : sample_16;
+        if (abs_sample > peak)
+        {
+            peak = abs_sample;
+        }
+        sum_sq += (uint32_t)((int32_t)sample_16 * sample_16);
+    }
+
+    pre.dc_x1 = dc_x1;
+    pre.dc_y1 = dc_y1;
+    pre.hp_x1 = hp_x1;
+    pre.hp_x2 = hp_x2;
+    pre.hp_y1 = hp_y1;
+    pre.hp_y2 = hp_y2;
+}
+
+template <uint8_t Bits>
+static void processScalarDispatch(int32_t *raw, size_t count, uint8_t *out, SamplePreprocessor &pre, int32_t &peak, uint64_t &sum_sq)
+{
+    if (pre.dc_block && pre.highpass)
+    {
+        processScalarLoop<Bits, true, true>(raw, count, out, pre, peak, sum_sq);
+    }
+    else if (pre.dc_block)
+    {
+        processScalarLoop<Bits, true, false>(raw, count, out, pre, peak, sum_sq);
+    }
+    else if (pre.highpass)
+    {
+        processScalarLoop<Bits, false, true>(raw, count, out, pre, peak, sum_sq);
+    }
+    else
+    {
+        processScalarLoop<Bits, false, false>(raw, count, out, pre, peak, sum_sq);
+    }
+}
+
+size_t processConvertFrame(int32_t *raw, size_t count, uint8_t output_bits, uint8_t *out, FrameStats &stats, SamplePreprocessor &pre)
+{
+    if (pre.identity())
+    {
+        return convertFrame(raw, count, output_bits, out, stats);
+    }
+
+    int32_t peak = 0;
+    uint64_t sum_sq = 0;
+    if (out && output_bits == 16)
+    {
+        processScalarDispatch<16>(raw, count, out, pre, peak, sum_sq);
+    }
+    else if (out && output_bits == 24)
+    {
+        processScalarDispatch<24>(raw, count, out, pre, peak, sum_sq);
+    }
+    else
+    {
+        processScalarDispatch<0>(raw, count, nullptr, pre, peak, sum_sq);
+    }
+
+    stats.count = count;
+    stats.peak = clampPeak(peak);
+    stats.sum_sq = sum_sq;
+    return payloadBytes(count, output_bits, out);
+}
+
+// === Decimation ===
+uint8_t decimationFactorFor(uint32_t input_rate, uint32_t output_rate)
+{
+    if (output_rate == 0 || output_rate >= input_rate)
+    {
+        return 1;
+    }
+    if (input_rate % output_rate != 0)
+    {
+        return 0;
+    }
+    const uint32_t factor = input_rate / output_rate;
+    return factor <= DECIMATOR_MAX_FACTOR ? (uint8_t)factor : 0;
+}
+
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k)
+    {
+        const double half = x / (2.0 * k);
+        term *= half * half;
+        sum += term;
+    }
+    return sum;
+}
+
+bool PolyphaseDecimator::configure(uint8_t factor)
+{
+    const bool supported = factor >= 1 && factor <= DECIMATOR_MAX_FACTOR;
+    decimation = supported ? factor : 1;
+    tap_count = decimation > 1 ? decimation * DECIMATOR_TAPS_PER_PHASE : 0;
+    memset(coeffs, 0, sizeof(coeffs));
+    reset();
+    if (tap_count == 0)
+    {
+        return supported;
+    }
+
+    // Kaiser-windowed sinc, cutoff at the output Nyquist. Aliases from the
+    // transition band only fold back above the passband.
+    const double beta = 7.0;
+    const double cutoff = 0.5 / decimation; // Cycles per input sample
+    const double centre = (tap_count - 1) / 2.0;
+    double taps[DECIMATOR_MAX_TAPS];
+    double sum = 0.0;
+    for (size_t n = 0; n < tap_count; ++n)
+    {
+        const double t = n - centre;
+        const double sinc = sin(2.0 * M_PI * cutoff * t) / (M_PI * t); // t is never 0 for an even length
+        const double r = t / centre;
+        taps[n] = sinc * besselI0(beta * sqrt(1.0 - r * r)) / besselI0(beta);
+        sum += taps[n];
+    }
+
+    // Unity DC gain exactly: the rounding residue goes to a centre tap
+    int32_t total = 0;
+    for (size_t n = 0; n < tap_count; ++n)
+    {
+        coeffs[n] = (int16_t)lrint(taps[n] / sum * 32768.0);
+        total += coeffs[n];
+    }
+    coeffs[tap_count / 2] += (int16_t)(32768 - total);
+    return true;
+}
+
+void PolyphaseDecimator::reset()
+{
+    memset(history, 0, sizeof(history));
+    skip = 0;
+}
+
+// One output: Q15 taps over left-justified words, back to a 24-bit sample
+static inline int32_t firOutput(const int32_t *x, const int16_t *h, size_t taps)
+{
+    int64_t acc = 0;
+    for (size_t k = 0; k < taps; k += AUDIO_DSP_SIMD_BLOCK)
+    {
+        for (size_t lane = 0; lane < AUDIO_DSP_SIMD_BLOCK; ++lane)
+        {
+            acc += (int64_t)x[k + lane] * h[k + lane];
+        }
+    }
+    return saturate24((acc + (1 << 22)) >> 23) << 8;
+}
+
+size_t PolyphaseDecimator::process(const int32_t *raw, size_t count, int32_t *out)
+{
+    if (decimation <= 1)
+    {
+        memcpy(out, raw, count * sizeof(int32_t));
+        return count;
+    }
+
+    // Outputs whose window reaches back into the previous frame read from a
+    // short stitched copy; everything after that reads raw[] in place.
+    const size_t keep = tap_count - 1;
+    const size_t head = count < keep ? count : keep;
+    memcpy(window, history, keep * sizeof(int32_t));
+    memcpy(window + keep, raw, head * sizeof(int32_t));
+
+    size_t written = 0;
+    size_t newest = skip; // Index in raw[] of the newest sample under the window
+    for (; newest < count; newest += decimation)
+    {
+        const int32_t *x = newest < keep ? window + newest : raw + newest - keep;
+        out[written++] = firOutput(x, coeffs, tap_count);
+    }
+    skip = newest - count;
+
+    if (count >= keep)
+    {
+        memcpy(history, raw + count - keep, keep * sizeof(int32_t));
+    }
+    else
+    {
+        memcpy(history, window + count, keep * sizeof(int32_t)); // Short frame: history shifts by count
+    }
+    return written;
+}
+
+// === Channels ===
+// The channel count is a template argument so each slot is a fixed-offset
+// load or store; a block of AUDIO_DSP_SIMD_BLOCK frames per iteration leaves
+// only the tail to the generic loop.
+template <uint8_t Channels>
+static void deinterleaveLoop(const int32_t *in, size_t frames, int32_t *planar, size_t stride)
+{
+    size_t i = 0;
+    for (; i + AUDIO_DSP_SIMD_BLOCK <= frames; i += AUDIO_DSP_SIMD_BLOCK)
+    {
+        const int32_t *block = in + i * Channels;
+        for (uint8_t c = 0; c < Channels; ++c)
+        {
+            int32_t *plane = planar + c * stride + i;
+            for (size_t lane = 0; lane < AUDIO_DSP_SIMD_BLOCK; ++lane)
+            {
+                plane[lane] = block[lane * Channels + c];
+            }
+        }
+    }
+    for (; i < frames; ++i)
+    {
+        for (uint8_t c = 0; c < Channels; ++c)
+        {
+            planar[c * stride + i] = in[i * Channels + c];
+        }
+    }
+}
+
+template <uint8_t Channels>
+static void interleaveLoop(const int32_t *planar, size_t stride, size_t frames, int32_t *out)
+{
+    size_t i = 0;
+    for (; i + AUDIO_DSP_SIMD_BLOCK <= frames; i += AUDIO_DSP_SIMD_BLOCK)
+    {
+        int32_t *block = out + i * Channels;
+        for (uint8_t c = 0; c < Channels; ++c)
+        {
+            const int32_t *plane = planar + c * stride + i;
+            for (size_t lane = 0; lane < AUDIO_DSP_SIMD_BLOCK; ++lane)
+            {
+                block[lane * Channels + c] = plane[lane];
+            }
+        }
+    }
+    for (; i < frames; ++i)
+    {
+        for (uint8_t c = 0; c < Channels; ++c)
+        {
+            out[i * Channels + c] = planar[c * stride + i];
+        }
+    }
+}
+
+void deinterleaveFrame(const int32_t *interleaved, size_t frames, uint8_t channels, int32_t *planar, size_t stride)
+{
+    switch (channels)
+    {
+    case 1:
+        memcpy(planar, interleaved, frames * sizeof(int32_t));
+        break;
+    case 2:
+        deinterleaveLoop<2>(interleaved, frames, planar, stride);
+        break;
+    case 3:
+        deinterleaveLoop<3>(interleaved, frames, planar, stride);
+        break;
+    case 4:
+        deinterleaveLoop<4>(interleaved, frames, planar, stride);
+        break;
+    default:
+        break;
+    }
+}
+
+void interleaveFrame(const int32_t *planar, size_t stride, size_t frames, uint8_t channels, int32_t *interleaved)
+{
+    switch (channels)
+    {
+    case 1:
+        memcpy(interleaved, planar, frames * sizeof(int32_t));
+        break;
+    case 2:
+        interleaveLoop<2>(planar, stride, frames, interleaved);
+        break;
+    case 3:
+        interleaveLoop<3>(planar, stride, frames, interleaved);
+        break;
+    case 4:
+        interleaveLoop<4>(planar, stride, frames, interleaved);
+        break;
+    default:
+        break;
+    }
+}
+
+#if AUDIO_DSP_HAVE_PIE
+static bool isAligned(const void *ptr)
+{
+    return ((uintptr_t)ptr & (AUDIO_DSP_ALIGN - 1)) == 0;
+}
+
+// 16-bit output or stats only; 24-bit packing is byte-granular and stays scalar
+static size_t convertFramePie(const int32_t *raw, size_t count, uint8_t *out, FrameStats &stats)
+{
+    alignas(AUDIO_DSP_ALIGN) int16_t extrema[2 * AUDIO_DSP_SIMD_BLOCK];
+    int16_t *out16 = reinterpret_cast<int16_t *>(out);
+    int32_t peak = 0;
+    uint64_t sum_sq = 0;
+
+    size_t blocks = count / AUDIO_DSP_SIMD_BLOCK;
+    size_t done = 0;
+    while (blocks > 0)
+    {
+        const size_t chunk = blocks < PIE_MAX_BLOCKS_PER_CALL ? blocks : PIE_MAX_BLOCKS_PER_CALL;
+        uint32_t acc[2];
+        audio_convert16_aes3(raw + done, out16 ? out16 + done : nullptr, (int)chunk, extrema, acc);
+
+        sum_sq += ((uint64_t)(acc[1] & 0xFF) << 32) | acc[0];
+        for (size_t lane = 0; lane < AUDIO_DSP_SIMD_BLOCK; ++lane)
+        {
+            const int32_t hi = extrema[lane];
+            const int32_t lo = -(int32_t)extrema[AUDIO_DSP_SIMD_BLOCK + lane];
+            peak = hi > peak ? hi : peak;
+            peak = lo > peak ? lo : peak;
+        }
+        blocks -= chunk;
+        done += chunk * AUDIO_DSP_SIMD_BLOCK;
+    }
+
+    if (done < count)
+    {
+        // Tail shorter than one vector
+        FrameStats tail;
+        convertFrameScalar(raw + done, count - done, 16, out ? out + done * 2 : nullptr, tail);
+        peak = tail.peak > peak ? tail.peak : peak;
+        sum_sq += tail.sum_sq;
+    }
+
+    stats.count = count;
+    stats.peak = clampPeak(peak);
+    stats.sum_sq = sum_sq;
+    return out ? count * 2 : 0;
+}
+#endif
+
+size_t convertFrame(const int32_t *raw, size_t count, uint8_t output_bits, uint8_t *out, FrameStats &stats)
+{
+#if AUDIO_DSP_HAVE_PIE
+    if (simd_enabled && isAligned(raw) && (out == nullptr || (output_bits == 16 && isAligned(out))))
+    {
+        return convertFramePie(raw, count, out, stats);
+    }
+#endif
+    return convertFrameScalar(raw, count, output_bits, out, stats);
+}
+
+bool audioDspInit()
+{
+#if AUDIO_DSP_HAVE_PIE
+    // Deterministic test vector covering both signs and full scale
+    alignas(AUDIO_DSP_ALIGN) int32_t raw[64];
+    alignas(AUDIO_DSP_ALIGN) int16_t vec_out[64];
+    int16_t ref_out[64];
+    uint32_t lcg = 0x1234567u;
+    for (size_t i = 0; i < 64; ++i)
+    {
+        lcg = lcg * 1664525u + 1013904223u;
+        raw[i] = (int32_t)lcg;
+    }
+    raw[5] = INT32_MIN;
+    raw[9] = INT32_MAX;
+
+    FrameStats ref, vec;
+    convertFrameScalar(raw, 61, 16, reinterpret_cast<uint8_t *>(ref_out), ref);
+    convertFramePie(raw, 61, reinterpret_cast<uint8_t *>(vec_out), vec);
+
+    simd_enabled = ref.peak == vec.peak && ref.sum_sq == vec.sum_sq &&
+                   memcmp(ref_out, vec_out, 61 * sizeof(int16_t)) == 0;
+#endif
+    return simd_enabled;
+}
+
+bool audioDspUsingSimd()
+{
+    return simd_enabled;
+}
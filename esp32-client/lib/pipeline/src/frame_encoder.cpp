@@ -0,0 +1,245 @@
+// lib/pipeline/src/frame_encoder.cpp
+
+#include "frame_encoder.h"
+
+void FrameEncoder::setFormat(uint32_t rate, uint8_t bits, uint8_t codec, uint8_t frame_channels)
+{
+    sample_rate = rate;
+    output_bits = bits;
+    codec_setting = codec;
+    const uint8_t channels = frame_channels < 1 ? 1 : (frame_channels > AUDIO_MAX_CHANNELS ? AUDIO_MAX_CHANNELS : frame_channels);
+    if (channels == channel_count)
+    {
+        return;
+    }
+    channel_count = channels;
+    for (uint8_t c = 0; c < AUDIO_MAX_CHANNELS; ++c)
+    {
+        preprocessors[c].reset();
+        decimators[c].reset();
+        adpcm_states[c] = ImaAdpcmState();
+        channel_stats[c] = FrameStats();
+    }
+    plane_frames = 0;
+}
+
+void FrameEncoder::configurePreprocessor(float new_gain, bool new_dc_block, float new_highpass_hz)
+{
+    gain = new_gain;
+    dc_block = new_dc_block;
+    highpass_hz = new_highpass_hz;
+    for (SamplePreprocessor &preprocessor : preprocessors)
+    {
+        preprocessor.configure(gain, dc_block, highpass_hz, sample_rate);
+    }
+}
+
+bool FrameEncoder::setDecimation(uint8_t factor)
+{
+    bool supported = true;
+    for (PolyphaseDecimator &decimator : decimators)
+    {
+        supported = decimator.configure(factor) && supported;
+    }
+    return supported;
+}
+
+void FrameEncoder::resetDecimator()
+{
+    for (PolyphaseDecimator &decimator : decimators)
+    {
+        decimator.reset();
+    }
+}
+
+const int32_t *FrameEncoder::plane(uint8_t channel) const
+{
+    if (channel_count == 1)
+    {
+        return mono_plane;
+    }
+    return planes + channel * planeStride(plane_frames);
+}
+
+// `convert(output_bits, out, stats)` is the conversion kernel to use: plain
+// convertFrame() for frames already conditioned, or the preprocessing pass.
+template <typename Convert>
+size_t FrameEncoder::encodeWith(Convert convert, size_t count, uint8_t *payload, FrameStats &stats, EncodedPayload &encoded)
+{
+    encoded.samples = (uint16_t)count;
+    encoded.channels = 1;
+    encoded.sample_rate = sample_rate / decimators[0].factor();
+    encoded.encode_us = 0;
+    if (codec_setting != CODEC_SETTING_IMA_ADPCM)
+    {
+        encoded.codec = output_bits == 24 ? AUDIO_CODEC_PCM24 : AUDIO_CODEC_PCM16;
+        encoded.bytes = convert(output_bits, payload, stats);
+        return encoded.bytes;
+    }
+
+    encoded.codec = AUDIO_CODEC_IMA_ADPCM;
+    if (!payload)
+    {
+        encoded.bytes = convert(16, nullptr, stats);
+        return encoded.bytes;
+    }
+
+    // ADPCM is sequential, so convert to 16-bit first and encode from there
+    convert(16, reinterpret_cast<uint8_t *>(pcm16), stats);
+
+    const int64_t start_us = clock_us ? clock_us() : 0;
+    encoded.bytes = imaAdpcmEncode(pcm16, count, payload, adpcm_states[0]);
+    if (clock_us)
+    {
+        encoded.encode_us = (uint32_t)(clock_us() - start_us);
+    }
+    return encoded.bytes;
+}
+
+// Conditioned samples through the decimator, then the codec. Only frames
+// that are actually sent pass through here, in order, so the filter history
+// is always the previous transmitted frame.
+size_t FrameEncoder::encodeDecimated(const int32_t *raw, size_t count, uint8_t *payload, EncodedPayload &encoded)
+{
+    const size_t kept = decimators[0].process(raw, count < MAX_SAMPLES_PER_READ ? count : MAX_SAMPLES_PER_READ, decimated);
+    FrameStats decimated_stats; // Trigger and status keep the full-rate statistics
+    return encodeWith([&](uint8_t bits, uint8_t *out, FrameStats &frame_stats)
+                      { return convertFrame(decimated, kept, bits, out, frame_stats); },
+                      kept, payload, decimated_stats, encoded);
+}
+
+// Conditions every plane with its own filter state and gathers the
+// per-channel statistics. The conditioned planes are written back
+// interleaved only when a filter actually changed them.
+size_t FrameEncoder::conditionChannels(int32_t *raw, size_t frames, uint8_t *payload, FrameStats &stats, EncodedPayload &encoded)
+{
+    const size_t stride = planeStride(frames);
+    deinterleaveFrame(raw, frames, channel_count, planes, stride);
+    plane_frames = frames;
+
+    bool conditioned = false;
+    stats = FrameStats();
+    for (uint8_t c = 0; c < channel_count; ++c)
+    {
+        FrameStats &channel = channel_stats[c];
+        processConvertFrame(planes + c * stride, frames, 16, nullptr, channel, preprocessors[c]);
+        conditioned = conditioned || !preprocessors[c].identity();
+        stats.count += channel.count;
+        stats.peak = channel.peak > stats.peak ? channel.peak : stats.peak;
+        stats.sum_sq += channel.sum_sq;
+    }
+    if (conditioned)
+    {
+        interleaveFrame(planes, stride, frames, channel_count, raw);
+    }
+    return encodeChannels(raw, frames, true, payload, encoded);
+}
+
+// Interleaved conditioned frames to the payload. Undecimated PCM converts
+// straight from the interleaved words; the decimator and ADPCM need the
+// planes, which conditionChannels() may already have split.
+size_t FrameEncoder::encodeChannels(const int32_t *raw, size_t frames, bool planes_ready, uint8_t *payload, EncodedPayload &encoded)
+{
+    const uint8_t factor = decimators[0].factor();
+    const bool adpcm = codec_setting == CODEC_SETTING_IMA_ADPCM;
+    encoded.channels = channel_count;
+    encoded.sample_rate = sample_rate / factor;
+    encoded.codec = adpcm ? AUDIO_CODEC_IMA_ADPCM : (output_bits == 24 ? AUDIO_CODEC_PCM24 : AUDIO_CODEC_PCM16);
+    encoded.samples = (uint16_t)frames;
+    encoded.encode_us = 0;
+    encoded.bytes = 0;
+    if (!payload)
+    {
+        return 0;
+    }
+
+    FrameStats payload_stats; // Trigger and status keep the mic-rate statistics
+    if (factor == 1 && !adpcm)
+    {
+        encoded.bytes = convertFrame(raw, frames * channel_count, output_bits, payload, payload_stats);
+        return encoded.bytes;
+    }
+
+    size_t stride = planeStride(frames);
+    if (!planes_ready)
+    {
+        deinterleaveFrame(raw, frames, channel_count, planes, stride);
+    }
+    const int32_t *source = planes;
+    size_t source_frames = frames;
+    if (factor > 1)
+    {
+        // Every decimator has seen the same frames, so they all keep the same count
+        const size_t decimated_stride = planeStride(frames / factor + 1);
+        for (uint8_t c = 0; c < channel_count; ++c)
+        {
+            source_frames = decimators[c].process(planes + c * stride, frames, decimated_planes + c * decimated_stride);
+        }
+        source = decimated_planes;
+        stride = decimated_stride;
+        encoded.samples = (uint16_t)source_frames;
+        if (!adpcm)
+        {
+            interleaveFrame(decimated_planes, stride, source_frames, channel_count, decimated);
+            encoded.bytes = convertFrame(decimated, source_frames * channel_count, output_bits, payload, payload_stats);
+            return encoded.bytes;
+        }
+    }
+
+    // One ADPCM block per channel, each from its own 16-bit plane
+    for (uint8_t c = 0; c < channel_count; ++c)
+    {
+        convertFrame(source + c * stride, source_frames, 16, reinterpret_cast<uint8_t *>(pcm16 + c * stride), payload_stats);
+    }
+    const int64_t start_us = clock_us ? clock_us() : 0;
+    for (uint8_t c = 0; c < channel_count; ++c)
+    {
+        encoded.bytes += imaAdpcmEncode(pcm16 + c * stride, source_frames, payload + encoded.bytes, adpcm_states[c]);
+    }
+    if (clock_us)
+    {
+        encoded.encode_us = (uint32_t)(clock_us() - start_us);
+    }
+    return encoded.bytes;
+}
+
+size_t FrameEncoder::encode(const int32_t *raw, size_t count, uint8_t *payload, FrameStats &stats, EncodedPayload &encoded)
+{
+    if (channel_count > 1)
+    {
+        return encodeChannels(raw, count / channel_count, false, payload, encoded);
+    }
+    if (payload && decimators[0].factor() > 1)
+    {
+        return encodeDecimated(raw, count, payload, encoded);
+    }
+    return encodeWith([&](uint8_t bits, uint8_t *out, FrameStats &frame_stats)
+                      { return convertFrame(raw, count, bits, out, frame_stats); },
+                      count, payload, stats, encoded);
+}
+
+size_t FrameEncoder::conditionAndEncode(int32_t *raw, size_t count, uint8_t *payload, FrameStats &stats, EncodedPayload &encoded)
+{
+    if (channel_count > 1)
+    {
+        // A trailing partial frame would shift every channel after it
+        return conditionChannels(raw, count / channel_count, payload, stats, encoded);
+    }
+    mono_plane = raw;
+    plane_frames = count;
+    size_t bytes;
+    if (payload && decimators[0].factor() > 1)
+    {
+        // Statistics at the mic rate, payload at the output rate
+        processConvertFrame(raw, count, 16, nullptr, stats, preprocessors[0]);
+        bytes = encodeDecimated(raw, count, payload, encoded);
+    }
+    else
+    {
+        bytes = encodeWith([&](uint8_t bits, uint8_t *out, FrameStats &frame_stats)
+                           { return processConvertFrame(raw, count, bits, out, frame_stats, preprocessors[0]); },
+                           count, payload, stats, encoded);
+    }
+    channel_stats[0] = stats;
+    return bytes;
+}
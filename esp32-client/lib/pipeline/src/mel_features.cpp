@@ -0,0 +1,174 @@
+// lib/pipeline/src/mel_features.cpp
+
+#include <math.h>
+#include <string.h>
+
+#include "mel_features.h"
+
+// === Compile-time Filterbank ===
+// <cmath> is not constexpr, so the mel warp uses its own log/exp. Both are
+// only evaluated by the compiler, and their error is far below a bin.
+static constexpr double LN2 = 0.69314718055994530942;
+
+static constexpr double constLn(double x)
+{
+    int k = 0;
+    while (x >= 2.0)
+    {
+        x /= 2.0;
+        ++k;
+    }
+    while (x < 1.0)
+    {
+        x *= 2.0;
+        --k;
+    }
+    // ln(x) = 2 atanh((x - 1) / (x + 1)), |t| <= 1/3
+    const double t = (x - 1.0) / (x + 1.0);
+    double term = t, sum = 0.0;
+    for (int n = 1; n < 40; n += 2)
+    {
+        sum += term / n;
+        term *= t * t;
+    }
+    return 2.0 * sum + k * LN2;
+}
+
+static constexpr double constExp(double x)
+{
+    int halvings = 0;
+    while (x > 0.5 || x < -0.5)
+    {
+        x /= 2.0;
+        ++halvings;
+    }
+    double term = 1.0, sum = 1.0;
+    for (int n = 1; n < 20; ++n)
+    {
+        term *= x / n;
+        sum += term;
+    }
+    while (halvings-- > 0)
+    {
+        sum *= sum;
+    }
+    return sum;
+}
+
+static constexpr double hzToMel(double hz) { return 1127.0 * constLn(1.0 + hz / 700.0); }
+static constexpr double melToHz(double mel) { return 700.0 * (constExp(mel / 1127.0) - 1.0); }
+
+static constexpr MelFilterbank buildFilterbank(uint32_t sample_rate)
+{
+    MelFilterbank bank{};
+    const double nyquist = sample_rate / 2.0;
+    const double high_hz = MEL_HIGH_HZ < nyquist ? MEL_HIGH_HZ : nyquist;
+    const double mel_low = hzToMel(MEL_LOW_HZ);
+    const double mel_step = (hzToMel(high_hz) - mel_low) / (MEL_BANDS + 1);
+    const double bin_per_hz = (double)SPECTRAL_FFT_SIZE / sample_rate;
+    const int max_bin = SPECTRAL_FFT_SIZE / 2 - 1; // Bin N/2 is not produced by the split
+
+    bank.sample_rate = sample_rate;
+    bank.low_hz = MEL_LOW_HZ;
+    bank.high_hz = (uint16_t)high_hz;
+    bank.first_bin = (uint16_t)max_bin;
+    size_t used = 0;
+    for (int band = 0; band < MEL_BANDS; ++band)
+    {
+        const double lower = melToHz(mel_low + band * mel_step) * bin_per_hz;
+        const double center = melToHz(mel_low + (band + 1) * mel_step) * bin_per_hz;
+        const double upper = melToHz(mel_low + (band + 2) * mel_step) * bin_per_hz;
+        int first = (int)lower + 1;
+        int last = (int)upper == upper ? (int)upper - 1 : (int)upper;
+        first = first < 1 ? 1 : first;
+        last = last > max_bin ? max_bin : last;
+
+        MelBand &out = bank.bands[band];
+        out.weight_offset = (uint16_t)used;
+        if (first > last)
+        {
+            // Narrower than a bin (low rates, low bands): take the nearest one
+            const int nearest = (int)(center + 0.5);
+            first = last = nearest < 1 ? 1 : nearest > max_bin ? max_bin : nearest;
+            bank.weights[used++] = 65535;
+        }
+        else
+        {
+            for (int k = first; k <= last; ++k)
+            {
+                const double w = k <= center ? (k - lower) / (center - lower) : (upper - k) / (upper - center);
+                bank.weights[used++] = (uint16_t)(w * 65535.0 + 0.5);
+            }
+        }
+        out.first_bin = (uint16_t)first;
+        out.bins = (uint16_t)(last - first + 1);
+        bank.first_bin = out.first_bin < bank.first_bin ? out.first_bin : bank.first_bin;
+        bank.last_bin = (uint16_t)last > bank.last_bin ? (uint16_t)last : bank.last_bin;
+    }
+    return bank;
+}
+
+#define MEL_TABLE(rate) buildFilterbank(rate),
+static constexpr MelFilterbank mel_tables[] = {MEL_TABLE_RATES(MEL_TABLE)};
+#undef MEL_TABLE
+
+const MelFilterbank *melFilterbankFor(uint32_t sample_rate)
+{
+    for (const MelFilterbank &bank : mel_tables)
+    {
+        if (bank.sample_rate == sample_rate)
+        {
+            return &bank;
+        }
+    }
+    return nullptr;
+}
+
+// === Extraction ===
+bool MelFeatureExtractor::begin(uint32_t sample_rate)
+{
+    bank = melFilterbankFor(sample_rate);
+    return bank != nullptr;
+}
+
+void MelFeatureExtractor::compute(const SpectralDetector &detector, uint8_t *out)
+{
+    static const float weight_scale = 1.0f / 65535.0f;
+    static const float codes_per_db = 16.0f / MEL_DB_STEP_Q4;
+    static const float max_code = 255.0f;
+    if (!bank)
+    {
+        memset(out, 0, MEL_BANDS);
+        return;
+    }
+    detector.powerSpectrum(spectrum, bank->first_bin, bank->last_bin);
+
+    for (size_t band = 0; band < MEL_BANDS; ++band)
+    {
+        const MelBand &filter = bank->bands[band];
+        const float *bins = spectrum + (filter.first_bin - bank->first_bin);
+        const uint16_t *weights = bank->weights + filter.weight_offset;
+        float power = 0.0f;
+        for (size_t i = 0; i < filter.bins; ++i)
+        {
+            power += bins[i] * (float)weights[i];
+        }
+        power *= weight_scale;
+
+        const float db = power > 1e-12f ? 10.0f * log10f(power) : SPECTRAL_MIN_DB;
+        const float code = (db - MEL_DB_FLOOR) * codes_per_db + 0.5f;
+        out[band] = code <= 0.0f ? 0 : code >= max_code ? 255 : (uint8_t)code;
+    }
+}
+
+void MelFeatureExtractor::fillHeader(MelPayloadHeader &header) const
+{
+    header.bands = MEL_BANDS;
+    header.reserved = 0;
+    header.fft_size = SPECTRAL_FFT_SIZE;
+    header.hop = SPECTRAL_HOP;
+    header.low_hz = bank ? bank->low_hz : 0;
+    header.high_hz = bank ? bank->high_hz : 0;
+    header.db_floor = MEL_DB_FLOOR;
+    header.db_step_q4 = MEL_DB_STEP_Q4;
+}
@@ -0,0 +1,59 @@
+// lib/pipeline/src/packet_format.cpp
+
+#include "packet_format.h"
+
+// === CRC-32 ===
+static uint32_t crc_table[256];
+
+static void buildCrcTable()
+{
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t c = i;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+        }
+        crc_table[i] = c;
+    }
+}
+
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t length)
+{
+    if (crc_table[1] == 0)
+    {
+        buildCrcTable();
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i)
+    {
+        crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// === Wire Header ===
+void finalizePacket(PacketBuffer *packet, uint32_t sequence, uint64_t timestamp, int64_t wall_clock_us,
+                    uint32_t sample_rate, uint16_t sample_count, uint8_t channels, AudioCodecId codec, uint8_t flags,
+                    size_t payload_bytes)
+{
+    AudioPacketHeader *header = packet->header();
+    header->magic = AUDIO_PACKET_MAGIC;
+    header->version = AUDIO_PACKET_VERSION;
+    header->header_size = sizeof(AudioPacketHeader);
+    header->sequence = sequence;
+    header->timestamp = timestamp;
+    header->sample_rate = sample_rate;
+    header->sample_count = sample_count;
+    header->payload_bytes = (uint16_t)payload_bytes;
+    header->codec = codec;
+    header->flags = flags;
+    header->channels = channels;
+    header->reserved = 0;
+    header->wall_clock_us = wall_clock_us;
+
+    uint32_t crc = crc32Update(0, packet->packet(), offsetof(AudioPacketHeader, crc32));
+    header->crc32 = crc32Update(crc, packet->payload(), payload_bytes);
+
+    packet->length = sizeof(AudioPacketHeader) + payload_bytes;
+}
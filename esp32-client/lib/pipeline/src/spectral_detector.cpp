@@ -0,0 +1,256 @@
+// lib/pipeline/src/spectral_detector.cpp
+
+#include <math.h>
+#include <string.h>
+
+#include "spectral_detector.h"
+
+#if __has_include("esp_dsp.h") && !defined(SPECTRAL_FORCE_SCALAR)
+#include "esp_dsp.h"
+#define SPECTRAL_HAVE_ESP_DSP 1
+#else
+#define SPECTRAL_HAVE_ESP_DSP 0
+#endif
+
+#define SPECTRAL_COMPLEX_POINTS (SPECTRAL_FFT_SIZE / 2)
+
+// Noise floor tracking per analysis (about 94 per second at 48 kHz)
+#define FLOOR_FALL_ALPHA 0.1f      // Quiet again: follow within a few frames
+#define FLOOR_RISE_ALPHA 0.002f    // Louder background: ~5 s time constant
+#define FLOOR_RISE_ACTIVE 0.0005f  // During a detection: ~20 s, so a long call is not absorbed
+
+#if !SPECTRAL_HAVE_ESP_DSP
+// Portable in-place radix-2 complex FFT on interleaved re/im, natural order out
+static float scalar_twiddle[SPECTRAL_COMPLEX_POINTS]; // cos/sin of 2*pi*i/M, i < M/2
+static bool scalar_ready = false;
+
+static void scalarFftInit()
+{
+    for (size_t i = 0; i < SPECTRAL_COMPLEX_POINTS / 2; ++i)
+    {
+        const double angle = 2.0 * M_PI * i / SPECTRAL_COMPLEX_POINTS;
+        scalar_twiddle[2 * i] = (float)cos(angle);
+        scalar_twiddle[2 * i + 1] = (float)sin(angle);
+    }
+    scalar_ready = true;
+}
+
+static void scalarFft(float *data, size_t n)
+{
+    for (size_t i = 1, j = 0; i < n; ++i)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            float re = data[2 * i], im = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = re;
+            data[2 * j + 1] = im;
+        }
+    }
+    for (size_t len = 2; len <= n; len <<= 1)
+    {
+        const size_t stride = n / len;
+        for (size_t start = 0; start < n; start += len)
+        {
+            for (size_t k = 0; k < len / 2; ++k)
+            {
+                const float wr = scalar_twiddle[2 * k * stride];
+                const float wi = -scalar_twiddle[2 * k * stride + 1];
+                float *a = &data[2 * (start + k)];
+                float *b = &data[2 * (start + k + len / 2)];
+                const float tr = b[0] * wr - b[1] * wi;
+                const float ti = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+}
+#endif
+
+bool SpectralDetector::usingEspDsp()
+{
+    return SPECTRAL_HAVE_ESP_DSP;
+}
+
+bool SpectralDetector::begin(uint32_t sample_rate, float band_low_hz, float band_high_hz)
+{
+#if SPECTRAL_HAVE_ESP_DSP
+    // Shares esp-dsp's global table; "already initialised" is fine
+    esp_err_t err = dsps_fft2r_init_fc32(NULL, CONFIG_DSP_MAX_FFT_SIZE);
+    if (err != ESP_OK && err != ESP_ERR_DSP_REINITIALIZED)
+    {
+        return false;
+    }
+#else
+    if (!scalar_ready)
+    {
+        scalarFftInit();
+    }
+#endif
+
+    window_power = 0.0f;
+    for (size_t i = 0; i < SPECTRAL_FFT_SIZE; ++i)
+    {
+        window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / SPECTRAL_FFT_SIZE); // Periodic Hann
+        window_power += window[i] * window[i];
+    }
+    for (size_t k = 0; k < SPECTRAL_COMPLEX_POINTS; ++k)
+    {
+        const double angle = 2.0 * M_PI * k / SPECTRAL_FFT_SIZE;
+        split_twiddle[2 * k] = (float)cos(angle);
+        split_twiddle[2 * k + 1] = (float)sin(angle);
+    }
+
+    memset(history, 0, sizeof(history));
+    pending = 0;
+    filled = 0;
+    primed = false;
+    band_db = SPECTRAL_MIN_DB;
+    floor_db = SPECTRAL_MIN_DB;
+    rate = sample_rate;
+    setBand(band_low_hz, band_high_hz);
+    return true;
+}
+
+void SpectralDetector::setBand(float band_low_hz, float band_high_hz)
+{
+    if (rate == 0)
+    {
+        return;
+    }
+    const float bin_hz = (float)rate / SPECTRAL_FFT_SIZE;
+    const float lo = fmaxf(band_low_hz, 0.0f) / bin_hz;
+    const float hi = fmaxf(band_high_hz, 0.0f) / bin_hz;
+    // Skip DC and stay below Nyquist (bin N/2 is not produced by the split)
+    bin_low = (size_t)fminf(fmaxf(ceilf(lo), 1.0f), SPECTRAL_COMPLEX_POINTS - 1);
+    bin_high = (size_t)fminf(fmaxf(floorf(hi), (float)bin_low), SPECTRAL_COMPLEX_POINTS - 1);
+}
+
+float SpectralDetector::bandLowHz() const
+{
+    return (float)bin_low * rate / SPECTRAL_FFT_SIZE;
+}
+
+float SpectralDetector::bandHighHz() const
+{
+    return (float)bin_high * rate / SPECTRAL_FFT_SIZE;
+}
+
+size_t SpectralDetector::process(const int32_t *raw, size_t count)
+{
+    static const float scale = 1.0f / 2147483648.0f; // Left-justified I2S word to +-1.0
+    size_t analyses = 0;
+    while (count > 0)
+    {
+        const size_t take = count < SPECTRAL_HOP - pending ? count : SPECTRAL_HOP - pending;
+        // Slide the window left and append: SPECTRAL_FFT_SIZE floats per hop at most
+        memmove(history, history + take, (SPECTRAL_FFT_SIZE - take) * sizeof(float));
+        float *dst = history + SPECTRAL_FFT_SIZE - take;
+        for (size_t i = 0; i < take; ++i)
+        {
+            dst[i] = raw[i] * scale;
+        }
+        raw += take;
+        count -= take;
+        pending += take;
+        filled = filled + take < SPECTRAL_FFT_SIZE ? filled + take : SPECTRAL_FFT_SIZE;
+
+        if (pending == SPECTRAL_HOP)
+        {
+            pending = 0;
+            if (filled == SPECTRAL_FFT_SIZE)
+            {
+                analyse();
+                ++analyses;
+            }
+        }
+    }
+    return analyses;
+}
+
+void SpectralDetector::analyse()
+{
+    // Pack even/odd samples as one complex sequence of half the length
+    for (size_t m = 0; m < SPECTRAL_COMPLEX_POINTS; ++m)
+    {
+        work[2 * m] = history[2 * m] * window[2 * m];
+        work[2 * m + 1] = history[2 * m + 1] * window[2 * m + 1];
+    }
+
+#if SPECTRAL_HAVE_ESP_DSP
+    dsps_fft2r_fc32(work, SPECTRAL_COMPLEX_POINTS);
+    dsps_bit_rev_fc32(work, SPECTRAL_COMPLEX_POINTS);
+#else
+    scalarFft(work, SPECTRAL_COMPLEX_POINTS);
+#endif
+
+    // Only the bins in the band are split out of the packed result
+    double energy = 0.0;
+    for (size_t k = bin_low; k <= bin_high; ++k)
+    {
+        energy += binEnergy(k);
+    }
+    ++analyses_run;
+
+    // One-sided band power as a mean square (Parseval), so a full-scale
+    // sine inside the band reads -3 dBFS regardless of window and size
+    const double power = 2.0 * energy / ((double)SPECTRAL_FFT_SIZE * window_power);
+    band_db = power > 1e-12 ? 10.0f * (float)log10(power) : SPECTRAL_MIN_DB;
+
+    if (!primed)
+    {
+        floor_db = band_db;
+        primed = true;
+        return;
+    }
+    updateFloor(band_db - floor_db > 0.0f);
+}
+
+// Split bin k (1 .. M-1) of the packed FFT into the real signal's spectrum:
+//   X[k] = (Z[k] + Z*[M-k]) / 2 - j W^k (Z[k] - Z*[M-k]) / 2
+// and return |X[k]|^2, unscaled
+inline float SpectralDetector::binEnergy(size_t k) const
+{
+    const size_t mk = SPECTRAL_COMPLEX_POINTS - k;
+    const float zr = work[2 * k], zi = work[2 * k + 1];
+    const float cr = work[2 * mk], ci = -work[2 * mk + 1];
+    const float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+    const float odr = 0.5f * (zr - cr), odi = 0.5f * (zi - ci);
+    // -j * W^k, W^k = cos - j sin  =>  -j W^k = -sin - j cos
+    const float wr = -split_twiddle[2 * k + 1];
+    const float wi = -split_twiddle[2 * k];
+    const float xr = er + odr * wr - odi * wi;
+    const float xi = ei + odr * wi + odi * wr;
+    return xr * xr + xi * xi;
+}
+
+void SpectralDetector::powerSpectrum(float *out, size_t first_bin, size_t last_bin) const
+{
+    const float scale = 2.0f / ((float)SPECTRAL_FFT_SIZE * window_power);
+    for (size_t k = first_bin; k <= last_bin && k < SPECTRAL_COMPLEX_POINTS; ++k)
+    {
+        *out++ = k == 0 ? 0.0f : binEnergy(k) * scale;
+    }
+}
+
+void SpectralDetector::updateFloor(bool louder)
+{
+    if (!louder)
+    {
+        floor_db += FLOOR_FALL_ALPHA * (band_db - floor_db);
+        return;
+    }
+    // Rise slower still once well above the floor (likely a call, not noise)
+    const float alpha = band_db - floor_db > 6.0f ? FLOOR_RISE_ACTIVE : FLOOR_RISE_ALPHA;
+    floor_db += alpha * (band_db - floor_db);
+}
@@ -6,31 +6,107 @@ import pyqtgraph as pg
 from pyqtgraph.Qt import QtWidgets, QtCore, QtGui # Use Qt bindings provided by pyqtgraph
 import sys
 import threading
-import wave
+import os
+import socket
 import queue
 import logging
 import traceback
 import signal
 import concurrent.futures
 import collections # For deque
+import struct
+import zlib
+import json
 from websockets.server import serve
 from websockets.exceptions import ConnectionClosedOK, ConnectionClosedError
 
 # === Configuration Constants ===
 HOST = "0.0.0.0"  # Listen on all available network interfaces
 PORT = 8080
+UDP_PORT = 5004 # Datagram audio (transport = UDP or RTP on the node)
 SAMPLE_RATE = 48000
 CHANNELS = 1
 AUDIO_BYTES_PER_SAMPLE = 2  # For int16
-EXPECTED_AUDIO_FORMAT = np.int16 # Corresponds to sampwidth=2 in wave
+EXPECTED_AUDIO_FORMAT = np.int16 # 16-bit playback/visualizer samples
 NUMPY_AUDIO_FORMAT = np.int16 # Numpy format for received bytes
 SOUNDDEVICE_DTYPE = 'int16' # Sounddevice format
 
-# Header format from ESP32 (Little-Endian)
-# 4 bytes sequence (uint32_t) + 8 bytes timestamp (uint64_t)
-HEADER_SIZE = 12
-SEQ_NUM_BYTES = 4
-TIMESTAMP_BYTES = 8
+# Header format from ESP32 (Little-Endian), see AudioPacketHeader in esp32-client/lib/pipeline/include/packet_format.h
+# magic u16, version u8, header_size u8, sequence u32, timestamp u64 (us), sample_rate u32,
+# sample_count u16, payload_bytes u16, codec u8, flags u8, channels u8, reserved u8, crc32 u32
+HEADER_FORMAT = '<HBBIQIHHBBBxI'
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT) # 32
+CRC_OFFSET = HEADER_SIZE - 4
+PACKET_MAGIC = 0x4E43
+PACKET_VERSION = 1
+# Version 2 appends the capture time on this server's clock, Unix us (0 until the node has synced);
+# not covered by the CRC, so version 1 parsers still accept the packet
+WALL_CLOCK_VERSION = 2
+WALL_CLOCK_FORMAT = '<q'
+WALL_CLOCK_SIZE = struct.calcsize(WALL_CLOCK_FORMAT)
+
+# Header flags
+FLAG_TRIGGER_START = 0x01
+FLAG_TRIGGER_END = 0x02
+FLAG_PREROLL = 0x04
+FLAG_OVERRUN = 0x08
+FLAG_SPOOLED = 0x10 # Stored on the node while the link was down, delivered after reconnecting
+
+# UDP / RTP transport (esp32-client/include/udp_transport.h)
+RTP_HEADER_SIZE = 12
+RTP_VERSION = 2
+JITTER_BUFFER_PACKETS = 4     # Packets held back waiting for a gap to fill (~43 ms of 512-sample packets at 48 kHz)
+JITTER_MAX_HOLD_S = 0.08      # Held packets are released anyway once the oldest has waited this long
+JITTER_RESYNC_PACKETS = 1000  # A sequence jump this large (node reboot) restarts the stream instead of counting loss
+UDP_REPORT_INTERVAL_S = 1.0   # Loss/reorder counters sent back to the node over its WebSocket
+
+# Clock sync and latency (esp32-client/include/time_sync.h). Nodes send
+# {"type":"time_ping"} on their WebSocket and get this server's clock back in a
+# time_pong, so the capture times they stamp are on the clock used to time arrivals.
+LATENCY_REPORT_INTERVAL_S = 10.0 # Per-node capture-to-arrival percentiles logged this often
+LATENCY_WINDOW_PACKETS = 5000    # Most recent packets a report covers
+
+# Ingest flow control (esp32-client/include/flow_control.h). While the fleet's
+# total rate stays above INGEST_BUDGET_KBPS, or playback cannot keep up, every
+# node is stepped one FLOW_LEVELS entry further down with a {"type":"flow"}
+# message; once load has stayed low for FLOW_RELAX_S they step back up.
+INGEST_BUDGET_KBPS = 2048.0    # KB/s the inference tier can absorb, in the throughput monitor's units
+FLOW_ESCALATE_S = 3            # Seconds over budget before the next step down
+FLOW_RELAX_S = 30              # Seconds below FLOW_RELAX_FRACTION of the budget before a step back up
+FLOW_RELAX_FRACTION = 0.5
+FLOW_QUEUE_HIGH_FRACTION = 0.8 # Playback queue fill that counts as overloaded
+FLOW_TTL_MS = 60000            # Nodes drop a request this long after the last repeat
+FLOW_REFRESH_S = 20            # Requests in force are repeated this often
+_FLOW_REDUCED = {"pause": False, "batch_max_bytes": 8192, "batch_max_delay_ms": 200, "codec": None, "decimate": None}
+FLOW_LEVELS = [
+    {"clear": True},
+    _FLOW_REDUCED,                                             # Fewer, larger WebSocket messages
+    dict(_FLOW_REDUCED, codec="ima_adpcm"),                    # ~4x less audio data
+    dict(_FLOW_REDUCED, codec="ima_adpcm", decimate=2),        # Half the sample rate on top
+    dict(_FLOW_REDUCED, codec="ima_adpcm", decimate=2, pause=True), # Nodes spool and drain later
+]
+
+# Payload codecs (AudioCodecId in esp32-client/lib/pipeline/include/audio_codec.h)
+CODEC_PCM16 = 0
+CODEC_PCM24 = 1
+CODEC_IMA_ADPCM = 2
+CODEC_LOG_MEL = 3 # Not audio: log-mel frames from output_mode features (mel_features.h)
+CODEC_NAMES = {CODEC_PCM16: "pcm16", CODEC_PCM24: "pcm24", CODEC_IMA_ADPCM: "ima_adpcm", CODEC_LOG_MEL: "log_mel"}
+
+# MelPayloadHeader: bands u8, reserved u8, fft_size u16, hop u16, low_hz u16, high_hz u16,
+# db_floor i8, db_step_q4 u8; then sample_count frames of `bands` bytes
+MEL_HEADER_FORMAT = '<BxHHHHbB'
+MEL_HEADER_SIZE = struct.calcsize(MEL_HEADER_FORMAT) # 12
+FEATURE_FILE_PREFIX = "features" # One .npz per FEATURE_SAVE_INTERVAL_S
+
+IMA_INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8]
+IMA_STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+]
 
 # Queue sizes (in number of messages/chunks) - prevents runaway memory usage
 # Adjust based on expected chunk size and processing speed vs network speed
@@ -38,8 +114,32 @@ TIMESTAMP_BYTES = 8
 PLAYBACK_QUEUE_MAX_SIZE = 100
 VISUALIZER_QUEUE_MAX_SIZE = 50 # GUI doesn't need as deep a buffer
 
-WAV_SAVE_INTERVAL_S = 5 # How often to save WAV chunks
-WAV_FILE_PREFIX = "recording"
+FEATURE_SAVE_INTERVAL_S = 5 # How often to save feature .npz files
+
+# --- Recording ---
+# Every received packet is appended to segment files, the same container the
+# C++ ingest gateway writes (ingest-gateway/include/segment_format.h); its
+# chirp-export tool turns them into WAV files.
+SEGMENT_DIR = "recordings"
+SEGMENT_FILE_PREFIX = "recording"
+SEGMENT_MAX_BYTES = 256 << 20
+SEGMENT_FLUSH_INTERVAL_S = 1.0       # Queued chunks are written and fsynced this often: all a crash can lose
+SEGMENT_INDEX_INTERVAL_US = 1000000  # One index entry per node per second of audio
+SEGMENT_FORMAT_VERSION = 2
+SEGMENT_FILE_MAGIC = b"CNSEG\0\0\0"
+SEGMENT_FOOTER_MAGIC = b"CNSEGEND"
+SEGMENT_CHUNK_MAGIC = 0x43534E43 # "CNSC"
+SEGMENT_ALIGN = 8
+SEGMENT_CHUNK_PACKET = 0
+SEGMENT_CHUNK_INDEX = 1
+SEGMENT_FILE_HEADER_FORMAT = '<8sHHIqQ'          # SegmentFileHeader
+SEGMENT_CHUNK_FORMAT = '<IBBBBIIIHHIB3xQqq'      # SegmentChunkHeader
+SEGMENT_CHUNK_SIZE = struct.calcsize(SEGMENT_CHUNK_FORMAT) # 56
+SEGMENT_INDEX_ENTRY_FORMAT = '<qQII'             # SegmentIndexEntry
+SEGMENT_FOOTER_FORMAT = '<QQqq8s'                # SegmentFooter
+TRANSPORT_WS = 0
+TRANSPORT_UDP = 1
+TRANSPORT_RTP = 2
 TIMING_PLOT_HISTORY = 500 # How many packets to show in timing plot
 
 # === Logging Setup ===
@@ -60,10 +160,9 @@ clients = set()
 packet_count_session = 0 # Packets since last client connect
 total_bytes_session = 0  # Bytes since last client connect
 bytes_last_second = 0
-write_buffer = bytearray() # Buffer for WAV writing
+feature_buffer = [] # (client_id, timestamp_us, frames x bands dB array) for the feature writer
 playback_queue = asyncio.Queue(maxsize=PLAYBACK_QUEUE_MAX_SIZE)
 visualizer_queue = queue.Queue(maxsize=VISUALIZER_QUEUE_MAX_SIZE) # Thread-safe queue for GUI
-last_sequence = None
 # Use deque for automatic history limit and better thread safety for append/read
 # Store (sequence, timestamp_us, delta_us)
 timestamp_log = collections.deque(maxlen=TIMING_PLOT_HISTORY + 50)
@@ -73,9 +172,356 @@ shutdown_event = asyncio.Event()
 # Thread pool for blocking I/O (like file saving)
 executor = concurrent.futures.ThreadPoolExecutor(max_workers=2, thread_name_prefix="BlockingIO")
 
+# === Payload Decoding ===
+def decode_ima_adpcm(data):
+    """Decodes one IMA-ADPCM payload (4-byte state header + nibbles, low nibble first) to int16 samples."""
+    if len(data) < 4:
+        return np.zeros(0, dtype=np.int16)
+    predictor, index = struct.unpack_from('<hB', data, 0)
+    index = min(max(index, 0), 88)
+    out = np.empty((len(data) - 4) * 2, dtype=np.int16)
+    n = 0
+    for byte in data[4:]:
+        for nibble in (byte & 0x0F, byte >> 4):
+            step = IMA_STEP_TABLE[index]
+            delta = step >> 3
+            if nibble & 4:
+                delta += step
+            if nibble & 2:
+                delta += step >> 1
+            if nibble & 1:
+                delta += step >> 2
+            predictor = predictor - delta if nibble & 8 else predictor + delta
+            predictor = min(max(predictor, -32768), 32767)
+            index = min(max(index + IMA_INDEX_TABLE[nibble], 0), 88)
+            out[n] = predictor
+            n += 1
+    return out
+
+def decode_payload(codec, data, sample_count=0, channels=1):
+    """Returns the payload as int16 PCM bytes (what playback expects), or None if unknown.
+    Multi-channel PCM is already interleaved; multi-channel IMA-ADPCM carries one block per
+    channel (sample_count samples each), which is decoded per block and interleaved here."""
+    if codec == CODEC_IMA_ADPCM and channels > 1:
+        block = 4 + (sample_count + 1) // 2
+        planes = [decode_ima_adpcm(data[c * block:(c + 1) * block])[:sample_count] for c in range(channels)]
+        if any(len(plane) < sample_count for plane in planes):
+            return None
+        return np.stack(planes, axis=1).tobytes()
+    if codec == CODEC_PCM16:
+        return bytes(data)
+    if codec == CODEC_PCM24:
+        # Keep the top 16 of the 24 bits, matching the node's own 16-bit view
+        raw = np.frombuffer(data[:len(data) - len(data) % 3], dtype=np.uint8).reshape(-1, 3).astype(np.uint16)
+        return (raw[:, 1] | (raw[:, 2] << 8)).astype(np.uint16).view(np.int16).tobytes()
+    if codec == CODEC_IMA_ADPCM:
+        # Blocks decode to an even count; the last nibble of an odd one is padding
+        return decode_ima_adpcm(data)[:sample_count].tobytes()
+    return None
+
+def resample_to_output(audio_data, rate):
+    """Brings a decimated payload (output_sample_rate on the node) up to SAMPLE_RATE so
+    playback and the visualizer keep running on a single clock."""
+    if rate == SAMPLE_RATE or rate == 0 or not audio_data:
+        return audio_data
+    samples = np.frombuffer(audio_data, dtype=NUMPY_AUDIO_FORMAT).astype(np.float32)
+    count = int(round(len(samples) * SAMPLE_RATE / rate))
+    positions = np.arange(count) * (rate / SAMPLE_RATE)
+    return np.interp(positions, np.arange(len(samples)), samples).astype(NUMPY_AUDIO_FORMAT).tobytes()
+
+def downmix_to_mono(audio_data, channels):
+    """Averages interleaved channels: playback and the visualizer are mono."""
+    if channels <= 1 or not audio_data:
+        return audio_data
+    samples = np.frombuffer(audio_data, dtype=NUMPY_AUDIO_FORMAT)
+    samples = samples[:len(samples) - len(samples) % channels].reshape(-1, channels)
+    return samples.mean(axis=1, dtype=np.float32).astype(NUMPY_AUDIO_FORMAT).tobytes()
+
+def decode_log_mel(data, frame_count):
+    """Returns (info dict, frames x bands float32 dB array) for a log-mel payload, or None if malformed."""
+    if len(data) < MEL_HEADER_SIZE:
+        return None
+    bands, fft_size, hop, low_hz, high_hz, db_floor, db_step_q4 = struct.unpack_from(MEL_HEADER_FORMAT, data, 0)
+    codes = np.frombuffer(data, dtype=np.uint8, offset=MEL_HEADER_SIZE)
+    if bands == 0 or len(codes) < frame_count * bands:
+        return None
+    frames = db_floor + codes[:frame_count * bands].reshape(frame_count, bands).astype(np.float32) * (db_step_q4 / 16.0)
+    return {"bands": bands, "fft_size": fft_size, "hop": hop, "low_hz": low_hz, "high_hz": high_hz}, frames
+
+class PacketError(ValueError):
+    pass
+
+def iter_packets(message):
+    """Yields (header dict, payload memoryview) for each packet in a message.
+    A message may carry several packets back to back; each is located via its own header."""
+    view = memoryview(message)
+    offset = 0
+    while offset < len(view):
+        if len(view) - offset < HEADER_SIZE:
+            raise PacketError(f"truncated header at offset {offset} ({len(view) - offset} bytes left)")
+        (magic, version, header_size, seq, timestamp_us, sample_rate, sample_count,
+         payload_bytes, codec, flags, channels, crc) = struct.unpack_from(HEADER_FORMAT, view, offset)
+        if magic != PACKET_MAGIC:
+            raise PacketError(f"bad magic 0x{magic:04x} at offset {offset}")
+        # Newer versions may append header fields, but must keep this prefix
+        if version < PACKET_VERSION or header_size < HEADER_SIZE:
+            raise PacketError(f"unsupported header version {version} (size {header_size})")
+        end = offset + header_size + payload_bytes
+        if end > len(view):
+            raise PacketError(f"payload of packet {seq} runs past end of message")
+        payload = view[offset + header_size:end]
+        expected_crc = zlib.crc32(payload, zlib.crc32(view[offset:offset + CRC_OFFSET])) & 0xFFFFFFFF
+        if crc != expected_crc:
+            raise PacketError(f"CRC mismatch on packet {seq}: got 0x{crc:08x}, expected 0x{expected_crc:08x}")
+        wall_clock_us = 0
+        if version >= WALL_CLOCK_VERSION and header_size >= HEADER_SIZE + WALL_CLOCK_SIZE:
+            (wall_clock_us,) = struct.unpack_from(WALL_CLOCK_FORMAT, view, offset + HEADER_SIZE)
+        yield {
+            "seq": seq,
+            "timestamp_us": timestamp_us,
+            "sample_rate": sample_rate,
+            "sample_count": sample_count,
+            "codec": codec,
+            "flags": flags,
+            "channels": channels,
+            "wall_clock_us": wall_clock_us,
+            "packet": view[offset:end], # Whole wire packet, as the recorder stores it
+        }, payload
+        offset = end
+
+def describe_flags(flags):
+    names = [name for bit, name in ((FLAG_TRIGGER_START, "start"), (FLAG_TRIGGER_END, "end"),
+                                    (FLAG_PREROLL, "preroll"), (FLAG_OVERRUN, "overrun"),
+                                    (FLAG_SPOOLED, "spooled")) if flags & bit]
+    return "|".join(names) if names else "-"
+
+# === Clock Sync / Latency ===
+def unix_time_us():
+    return time.time_ns() // 1000
+
+def time_pong(ping, received_us):
+    """Reply to a node's time_ping: its own t0 back, plus our receive and send times."""
+    return {"type": "time_pong", "seq": ping.get("seq", 0), "t0": ping.get("t0", 0),
+            "t1": received_us, "t2": unix_time_us()}
+
+class LatencyTracker:
+    """Capture-to-arrival latency of one node's live packets, from the wall-clock capture time they carry."""
+    def __init__(self):
+        self.samples_ms = collections.deque(maxlen=LATENCY_WINDOW_PACKETS)
+        self.unsynced = 0 # Packets without a capture time since the last report
+
+    def record(self, header, arrival_us):
+        # Spooled and pre-roll packets are late on purpose, not because of the link
+        if header["flags"] & (FLAG_SPOOLED | FLAG_PREROLL):
+            return
+        if header["wall_clock_us"] == 0:
+            self.unsynced += 1
+            return
+        self.samples_ms.append((arrival_us - header["wall_clock_us"]) / 1000.0)
+
+    def report(self):
+        """Percentile summary since the last report (None if nothing arrived), then starts a new window."""
+        unsynced, self.unsynced = self.unsynced, 0
+        if not self.samples_ms:
+            return f"no synced packets ({unsynced} without a capture time)" if unsynced else None
+        samples = np.fromiter(self.samples_ms, dtype=np.float64)
+        self.samples_ms.clear()
+        p50, p95, p99 = np.percentile(samples, [50, 95, 99])
+        return (f"n={len(samples)} p50={p50:.1f} ms p95={p95:.1f} ms p99={p99:.1f} ms "
+                f"min={samples.min():.1f} ms max={samples.max():.1f} ms" + (f" unsynced={unsynced}" if unsynced else ""))
+
+latency_trackers = {} # node IP -> LatencyTracker, shared by its WebSocket and UDP streams
+
+def record_latency(ip, header, arrival_us):
+    tracker = latency_trackers.get(ip)
+    if tracker is None:
+        tracker = latency_trackers[ip] = LatencyTracker()
+    tracker.record(header, arrival_us)
+
+async def latency_report_task():
+    """Logs each node's end-to-end latency percentiles, for tuning batching and buffering."""
+    logger.info("Latency report task started.")
+    while not shutdown_event.is_set():
+        try:
+            await asyncio.wait_for(shutdown_event.wait(), timeout=LATENCY_REPORT_INTERVAL_S)
+            break
+        except asyncio.TimeoutError:
+            pass
+        for ip, tracker in list(latency_trackers.items()):
+            summary = tracker.report()
+            if summary:
+                logger.info(f"Capture-to-arrival latency {ip}: {summary}")
+    logger.info("Latency report task finished.")
+
+# === Flow Control ===
+class FlowController:
+    """Fleet-wide ingest limit, driven once a second by the throughput monitor."""
+    def __init__(self):
+        self.level = 0
+        self.over_s = 0
+        self.under_s = 0
+        self.last_sent = 0.0
+
+    def message(self):
+        return dict(FLOW_LEVELS[self.level], type="flow", ttl_ms=FLOW_TTL_MS)
+
+    def update(self, kbps, queue_fill):
+        """Returns the flow message to broadcast now, or None."""
+        overloaded = kbps > INGEST_BUDGET_KBPS or queue_fill >= FLOW_QUEUE_HIGH_FRACTION
+        relaxed = kbps < INGEST_BUDGET_KBPS * FLOW_RELAX_FRACTION and queue_fill < FLOW_QUEUE_HIGH_FRACTION / 2
+        self.over_s = self.over_s + 1 if overloaded else 0
+        self.under_s = self.under_s + 1 if relaxed else 0
+        now = time.monotonic()
+        if self.over_s >= FLOW_ESCALATE_S and self.level < len(FLOW_LEVELS) - 1:
+            self.level += 1
+            self.over_s = 0
+            logger.warning(f"Ingest over budget ({kbps:.0f} of {INGEST_BUDGET_KBPS:.0f} KB/s, queue {queue_fill:.0%}): flow level {self.level}")
+        elif self.under_s >= FLOW_RELAX_S and self.level > 0:
+            self.level -= 1
+            self.under_s = 0
+            logger.info(f"Ingest back under budget ({kbps:.0f} KB/s): flow level {self.level}")
+        elif self.level == 0 or now - self.last_sent < FLOW_REFRESH_S:
+            return None
+        self.last_sent = now
+        return self.message()
+
+flow_controller = FlowController()
+
+async def broadcast(message):
+    text = json.dumps(message)
+    for websocket in list(clients):
+        try:
+            await websocket.send(text)
+        except Exception as e:
+            logger.debug(f"Could not send control message to {websocket.remote_address}: {e}")
+
+async def handle_control_message(websocket, client_id, message, received_us):
+    """Text messages from a node: time_ping is answered, flow_state logged, anything else ignored."""
+    try:
+        request = json.loads(message)
+    except ValueError:
+        request = None
+    kind = request.get("type") if isinstance(request, dict) else None
+    if kind == "time_ping":
+        await websocket.send(json.dumps(time_pong(request, received_us)))
+    elif kind == "flow_state":
+        fields = ", ".join(f"{key}={value}" for key, value in request.items() if key != "type")
+        logger.info(f"Flow state from {client_id}: {fields}")
+    else:
+        logger.debug(f"Ignoring text message from {client_id}: {message[:80]}")
+
+# === Packet Handling ===
+class StreamState:
+    """Sequence/timing bookkeeping for one sender, shared by the WebSocket and UDP paths."""
+    def __init__(self):
+        self.last_sequence = None
+        self.last_timestamp_us = None
+        self.sample_rate = SAMPLE_RATE
+        self.channels = CHANNELS
+        self.features = False # Log-mel packets seen (output_mode features on the node)
+
+def check_sequence(client_id, seq, stream):
+    """Audio and feature packets share one sequence per node."""
+    if stream.last_sequence is not None:
+        # Wrap expected sequence at 32 bits
+        expected = (stream.last_sequence + 1) & 0xFFFFFFFF
+        if seq != expected:
+            logger.warning(f"Packet out of order from {client_id}: expected {expected}, got {seq}")
+    stream.last_sequence = seq
+
+def handle_feature_packet(client_id, header, payload, stream):
+    """Log-mel frames: kept for the feature writer, never played. Their timestamps mark FFT
+    windows rather than audio reads, so they stay out of the jitter check."""
+    seq = header["seq"]
+    decoded = decode_log_mel(payload, header["sample_count"])
+    if decoded is None:
+        logger.warning(f"Malformed log-mel packet {seq} from {client_id}, dropping")
+        return
+    info, frames = decoded
+    if not stream.features:
+        logger.info(f"Client {client_id} sending log-mel features: {info['bands']} bands {info['low_hz']}-{info['high_hz']} Hz, "
+                    f"hop {info['hop']} of {info['fft_size']} at {header['sample_rate']} Hz")
+        stream.features = True
+    logger.debug(f"[RECV {client_id}] Seq={seq}, Timestamp={header['timestamp_us']} us, Codec=log_mel, "
+                 f"Frames={len(frames)}, Peak={frames.max():.1f} dB, Flags={describe_flags(header['flags'])}")
+    if header["flags"] & FLAG_TRIGGER_START:
+        logger.info(f"Detection started on {client_id} (log-mel seq {seq})")
+    if header["flags"] & FLAG_TRIGGER_END:
+        logger.info(f"Detection ended on {client_id} (log-mel seq {seq})")
+    if not header["flags"] & FLAG_SPOOLED:
+        check_sequence(client_id, seq, stream)
+    feature_buffer.append((client_id, header["timestamp_us"], frames))
+
+def handle_audio_packet(client_id, header, payload, stream):
+    """Decodes, checks and queues one packet for playback and the visualizer (recording happens on receipt)."""
+    seq = header["seq"]
+    timestamp_us = header["timestamp_us"]
+    codec = header["codec"]
+    if codec == CODEC_LOG_MEL:
+        handle_feature_packet(client_id, header, payload, stream)
+        return
+    channels = max(header["channels"], 1)
+    audio_data = decode_payload(codec, payload, header["sample_count"], channels)
+
+    logger.debug(f"[RECV {client_id}] Seq={seq}, Timestamp={timestamp_us} us, Codec={CODEC_NAMES.get(codec, codec)}, "
+                 f"Rate={header['sample_rate']}, Samples={header['sample_count']}x{channels}, Flags={describe_flags(header['flags'])}, AudioLen={len(payload)}")
+    if audio_data is None:
+        logger.warning(f"Unknown codec {codec} from {client_id}, dropping packet {seq}")
+        return
+
+    # --- Stream Format Check ---
+    # Playback runs at SAMPLE_RATE; decimated streams are interpolated back up
+    if header["sample_rate"] != stream.sample_rate:
+        logger.info(f"Client {client_id} now sending {header['sample_rate']} Hz (playback at {SAMPLE_RATE} Hz)")
+        stream.sample_rate = header["sample_rate"]
+    if channels != stream.channels:
+        logger.info(f"Client {client_id} now sending {channels} channel(s) (downmixed to {CHANNELS} for playback)")
+        stream.channels = channels
+    audio_data = resample_to_output(downmix_to_mono(audio_data, channels), header["sample_rate"])
+    if header["flags"] & FLAG_OVERRUN:
+        logger.warning(f"Client {client_id} reported a capture overrun before packet {seq}")
+    if header["flags"] & FLAG_TRIGGER_START:
+        logger.info(f"Detection started on {client_id} at {timestamp_us} us (seq {seq})")
+    if header["flags"] & FLAG_TRIGGER_END:
+        logger.info(f"Detection ended on {client_id} at {timestamp_us} us (seq {seq})")
+
+    # --- Spooled Backlog ---
+    # Recorded while the node was offline and drained alongside the live
+    # stream: already in the segment files, but too old to play and outside
+    # the live sequence/timing checks.
+    if header["flags"] & FLAG_SPOOLED:
+        return
+
+    # --- Sequence Check ---
+    check_sequence(client_id, seq, stream)
+
+    # --- Timestamp/Jitter Check ---
+    # Pre-roll packets are replayed in a burst, so their spacing says nothing about the link
+    if stream.last_timestamp_us is not None and not header["flags"] & FLAG_PREROLL:
+        delta_us = 0 # Default if timestamp didn't advance (unlikely for uint64)
+        if timestamp_us > stream.last_timestamp_us: # Avoid negative delta on potential timer wrap or error
+            delta_us = timestamp_us - stream.last_timestamp_us
+            timestamp_log.append((seq, timestamp_us, delta_us)) # Store data for timing plot
+            # Log if jitter > 100ms (adjust threshold as needed)
+            if delta_us > 100000:
+                logger.warning(f"Large Jitter from {client_id}: Packet {seq} delta: {delta_us / 1000.0:.2f} ms")
+        else:
+            logger.warning(f"Timestamp anomaly from {client_id}: current {timestamp_us} <= previous {stream.last_timestamp_us}. Seq {seq}")
+    stream.last_timestamp_us = timestamp_us # Update for next iteration
+
+    # --- Queue Data for Processing ---
+    try:
+        # Use put_nowait to avoid blocking the handler if queues are full
+        playback_queue.put_nowait(audio_data)
+        visualizer_queue.put_nowait(audio_data) # For GUI thread
+    except asyncio.QueueFull:
+        logger.warning(f"Playback queue full for {client_id}. Discarding packet {seq}.")
+    except queue.Full:
+         logger.warning(f"Visualizer queue full for {client_id}. Discarding packet {seq}.")
+
 # === WebSocket Handler ===
 async def handler(websocket, path): # path argument is required by serve
-    global packet_count_session, total_bytes_session, bytes_last_second, last_sequence
+    global packet_count_session, total_bytes_session, bytes_last_second
     clients.add(websocket)
     remote_ip, remote_port = websocket.remote_address
     client_id = f"{remote_ip}:{remote_port}"
@@ -85,65 +531,35 @@ async def handler(websocket, path): # path argument is required by serve
     packet_count_session = 0
     total_bytes_session = 0
     bytes_last_second = 0
-    last_sequence = None
-    last_timestamp_us = None
+    stream = StreamState()
 
     try:
+        if flow_controller.level > 0:
+            await websocket.send(json.dumps(flow_controller.message())) # Joins the fleet's current limits
         async for message in websocket:
+            arrival_us = unix_time_us()
             packet_count_session += 1
             message_len = len(message)
             total_bytes_session += message_len
             bytes_last_second += message_len
 
-            if message_len >= HEADER_SIZE:
-                try:
-                    # --- Parse Header (Little-Endian) ---
-                    seq = int.from_bytes(message[0:SEQ_NUM_BYTES], byteorder='little', signed=False)
-                    timestamp_us = int.from_bytes(message[SEQ_NUM_BYTES:HEADER_SIZE], byteorder='little', signed=False)
-                    audio_data = message[HEADER_SIZE:]
-                    audio_len = len(audio_data)
-
-                    logger.debug(f"[RECV {client_id}] Seq={seq}, Timestamp={timestamp_us} us, AudioLen={audio_len}")
-
-                    # --- Sequence Check ---
-                    if last_sequence is not None:
-                        # Wrap expected sequence at 32 bits
-                        expected = (last_sequence + 1) & 0xFFFFFFFF
-                        if seq != expected:
-                            logger.warning(f"Packet out of order from {client_id}: expected {expected}, got {seq}")
-                    last_sequence = seq
-
-                    # --- Timestamp/Jitter Check ---
-                    if last_timestamp_us is not None:
-                        delta_us = 0 # Default if timestamp didn't advance (unlikely for uint64)
-                        if timestamp_us > last_timestamp_us: # Avoid negative delta on potential timer wrap or error
-                            delta_us = timestamp_us - last_timestamp_us
-                            timestamp_log.append((seq, timestamp_us, delta_us)) # Store data for timing plot
-                            # Log if jitter > 100ms (adjust threshold as needed)
-                            if delta_us > 100000:
-                                logger.warning(f"Large Jitter from {client_id}: Packet {seq} delta: {delta_us / 1000.0:.2f} ms")
-                        else:
-                            logger.warning(f"Timestamp anomaly from {client_id}: current {timestamp_us} <= previous {last_timestamp_us}. Seq {seq}")
-                    last_timestamp_us = timestamp_us # Update for next iteration
-
-                    # --- Queue Data for Processing ---
-                    try:
-                        # Use put_nowait to avoid blocking the handler if queues are full
-                        playback_queue.put_nowait(audio_data)
-                        visualizer_queue.put_nowait(audio_data) # For GUI thread
-                        write_buffer.extend(audio_data) # For WAV writer task
-                    except asyncio.QueueFull:
-                        logger.warning(f"Playback queue full for {client_id}. Discarding packet {seq}.")
-                    except queue.Full:
-                         logger.warning(f"Visualizer queue full for {client_id}. Discarding packet {seq}.")
-
-                except ValueError as e:
-                    logger.error(f"Error converting header bytes from {client_id}: {e}. MsgLen={message_len}")
-                except Exception as e:
-                    logger.error(f"Error processing message from {client_id}: {e}\n{traceback.format_exc()}")
-
-            else:
+            if isinstance(message, str):
+                await handle_control_message(websocket, client_id, message, arrival_us)
+                continue
+            if message_len < HEADER_SIZE:
                 logger.warning(f"Received short message from {client_id}: Len={message_len}, expected >= {HEADER_SIZE}")
+                continue
+
+            try:
+                for header, payload in iter_packets(message):
+                    record_latency(remote_ip, header, arrival_us)
+                    recorder.add(header, remote_ip, remote_port, TRANSPORT_WS, arrival_us)
+                    handle_audio_packet(client_id, header, payload, stream)
+
+            except PacketError as e:
+                logger.error(f"Malformed message from {client_id}: {e}. MsgLen={message_len}")
+            except Exception as e:
+                logger.error(f"Error processing message from {client_id}: {e}\n{traceback.format_exc()}")
 
     except ConnectionClosedOK:
         logger.info(f"Client {client_id} disconnected gracefully.")
@@ -159,84 +575,309 @@ async def handler(websocket, path): # path argument is required by serve
         # Reset sequence tracking only if this was the last client
         if not clients:
             logger.info("Last client disconnected, resetting sequence tracking.")
-            last_sequence = None
             timestamp_log.clear() # Clear timing log
 
-# === Synchronous File Saving Function (for executor) ===
-def save_wave_sync(filename, data_bytes, channels, sampwidth, framerate):
-    """Saves audio data to a WAV file. Runs in executor thread."""
+# === UDP / RTP Receiver ===
+def seq_delta(a, b):
+    """a - b in 32-bit sequence space, as a signed number."""
+    d = (a - b) & 0xFFFFFFFF
+    return d - (1 << 32) if d >= (1 << 31) else d
+
+class JitterBuffer:
+    """Puts one sender's datagrams back in packet-sequence order.
+
+    Packets behind a gap are held until it fills, for at most JITTER_BUFFER_PACKETS
+    packets or JITTER_MAX_HOLD_S; then the gap is counted as lost and skipped.
+    Packets older than what was already released are late and dropped."""
+    def __init__(self, depth=JITTER_BUFFER_PACKETS):
+        self.depth = depth
+        self.pending = {} # seq -> (arrival time, header, payload)
+        self.next_seq = None
+        self.highest = None
+        self.received = 0
+        self.lost = 0
+        self.reordered = 0
+        self.late = 0
+        self.duplicates = 0
+
+    def push(self, header, payload, now):
+        """Adds a packet; returns the (header, payload) pairs now ready, in order."""
+        seq = header["seq"]
+        self.received += 1
+        if self.next_seq is None or abs(seq_delta(seq, self.next_seq)) > JITTER_RESYNC_PACKETS:
+            if self.next_seq is not None:
+                logger.info(f"UDP sequence jumped from {self.next_seq} to {seq}; restarting the jitter buffer")
+            self.pending.clear()
+            self.next_seq = seq
+            self.highest = seq
+        if seq_delta(seq, self.next_seq) < 0:
+            self.late += 1
+            return []
+        if seq in self.pending:
+            self.duplicates += 1
+            return []
+        if seq_delta(seq, self.highest) < 0:
+            self.reordered += 1
+        else:
+            self.highest = seq
+        self.pending[seq] = (now, header, payload)
+        return self.release(now)
+
+    def release(self, now):
+        """Returns whatever is in order, giving up on a gap once too much is held or it is too old."""
+        ready = []
+        while self.pending:
+            if self.next_seq in self.pending:
+                _, header, payload = self.pending.pop(self.next_seq)
+                ready.append((header, payload))
+                self.next_seq = (self.next_seq + 1) & 0xFFFFFFFF
+                continue
+            oldest = min(arrival for arrival, _, _ in self.pending.values())
+            if len(self.pending) <= self.depth and now - oldest < JITTER_MAX_HOLD_S:
+                break
+            lowest = min(self.pending, key=lambda s: seq_delta(s, self.next_seq))
+            self.lost += seq_delta(lowest, self.next_seq)
+            self.next_seq = lowest
+        return ready
+
+    def report(self):
+        return {"type": "udp_stats", "received": self.received, "lost": self.lost,
+                "reordered": self.reordered, "late": self.late, "duplicates": self.duplicates}
+
+class UdpAudioProtocol(asyncio.DatagramProtocol):
+    """One wire packet per datagram, optionally behind an RTP header, re-ordered per sender IP."""
+    def __init__(self):
+        self.streams = {} # ip -> (JitterBuffer, StreamState)
+        self.flush_handle = None
+
+    def datagram_received(self, data, addr):
+        global packet_count_session, total_bytes_session, bytes_last_second
+        arrival_us = unix_time_us()
+        packet_count_session += 1
+        total_bytes_session += len(data)
+        bytes_last_second += len(data)
+
+        ip = addr[0]
+        client_id = f"udp:{ip}"
+        view = memoryview(data)
+        transport = TRANSPORT_UDP
+        # RTP version 2 sets the top two bits; the wire magic's first byte (0x43) does not
+        if len(view) >= RTP_HEADER_SIZE and view[0] >> 6 == RTP_VERSION:
+            view = view[RTP_HEADER_SIZE:]
+            transport = TRANSPORT_RTP
+        if ip not in self.streams:
+            logger.info(f"UDP audio from {ip}")
+            self.streams[ip] = (JitterBuffer(), StreamState())
+        buffer, stream = self.streams[ip]
+        try:
+            for header, payload in iter_packets(view):
+                record_latency(ip, header, arrival_us) # Before the jitter buffer: link latency only
+                recorder.add(header, ip, addr[1], transport, arrival_us) # Arrival order, like the gateway
+                for ready_header, ready_payload in buffer.push(header, payload, time.monotonic()):
+                    handle_audio_packet(client_id, ready_header, ready_payload, stream)
+        except PacketError as e:
+            logger.error(f"Malformed datagram from {client_id}: {e}. Len={len(data)}")
+        except Exception as e:
+            logger.error(f"Error processing datagram from {client_id}: {e}\n{traceback.format_exc()}")
+        self.schedule_flush()
+
+    def schedule_flush(self):
+        # Held packets must come out even if the stream stops right after a gap
+        if self.flush_handle is None and any(buffer.pending for buffer, _ in self.streams.values()):
+            self.flush_handle = asyncio.get_running_loop().call_later(JITTER_MAX_HOLD_S, self.flush_expired)
+
+    def flush_expired(self):
+        self.flush_handle = None
+        now = time.monotonic()
+        for ip, (buffer, stream) in self.streams.items():
+            for header, payload in buffer.release(now):
+                handle_audio_packet(f"udp:{ip}", header, payload, stream)
+        self.schedule_flush()
+
+udp_protocol = UdpAudioProtocol()
+
+async def udp_report_task():
+    """Sends each node its receive counters over its WebSocket, so they show up in the node's /status.json."""
+    logger.info("UDP report task started.")
+    while not shutdown_event.is_set():
+        try:
+            await asyncio.wait_for(shutdown_event.wait(), timeout=UDP_REPORT_INTERVAL_S)
+            break
+        except asyncio.TimeoutError:
+            pass
+        for websocket in list(clients):
+            entry = udp_protocol.streams.get(websocket.remote_address[0])
+            if entry is None:
+                continue
+            try:
+                await websocket.send(json.dumps(entry[0].report()))
+            except Exception as e:
+                logger.debug(f"Could not send UDP report to {websocket.remote_address}: {e}")
+    logger.info("UDP report task finished.")
+
+# === Segment Recording ===
+class SegmentRecorder:
+    """Appends received packets to segment files as they arrive, in the gateway's format: fixed-size chunk
+    headers, each packet stored whole, and a sparse (node, time) index plus footer appended when a file
+    closes, so readers mmap a file and seek without scanning it. Chunks are queued here on the event loop
+    and written by recording_task() in the executor; crash-truncated files are readable too, and
+    `chirp-export --repair` gives them their index."""
+    def __init__(self, directory):
+        self.directory = directory
+        self.path = None
+        self.pending = bytearray() # Not yet written to self.path
+        self.finished = []         # (path, bytes) of rolled files still to write, index and footer included
+        self.size = 0              # Bytes of the open file, pending included
+        self.index = []            # (time_unix_us, offset, node_ip, sequence)
+        self.marks = {}            # node_ip -> [indexed_us, next_sequence]
+        self.chunks = 0
+        self.first_us = 0
+        self.last_us = 0
+
+    def open(self, now_us):
+        os.makedirs(self.directory, exist_ok=True)
+        self.path = os.path.join(self.directory, f"{SEGMENT_FILE_PREFIX}-{now_us}.seg")
+        self.pending = bytearray(struct.pack(SEGMENT_FILE_HEADER_FORMAT, SEGMENT_FILE_MAGIC, SEGMENT_FORMAT_VERSION, 0,
+                                             SEGMENT_INDEX_INTERVAL_US // 1000, now_us, 0))
+        self.size = len(self.pending)
+        self.index, self.marks = [], {}
+        self.chunks, self.first_us, self.last_us = 0, 0, 0
+        logger.info(f"Recording to {self.path}")
+
+    def index_chunk(self, time_us, offset, node_ip, seq):
+        """Same rule as SegmentIndexBuilder: a node's first chunk, one per interval, and any sequence break."""
+        if self.chunks == 0 or time_us < self.first_us:
+            self.first_us = time_us
+        self.last_us = max(self.last_us, time_us)
+        self.chunks += 1
+        mark = self.marks.get(node_ip)
+        if (mark is None or seq != mark[1] or time_us - mark[0] >= SEGMENT_INDEX_INTERVAL_US or time_us < mark[0]):
+            self.index.append((time_us, offset, node_ip, seq))
+            self.marks[node_ip] = [time_us, (seq + 1) & 0xFFFFFFFF]
+        else:
+            mark[1] = (seq + 1) & 0xFFFFFFFF
+
+    def add(self, header, ip, port, transport, arrival_us):
+        packet = header["packet"]
+        pad = -len(packet) % SEGMENT_ALIGN
+        chunk_bytes = SEGMENT_CHUNK_SIZE + len(packet) + pad
+        # Roll between chunks, so every offset is known when it is indexed
+        if self.path and self.chunks and self.size + chunk_bytes > SEGMENT_MAX_BYTES:
+            self.finished.append((self.path, self.pending + self.tail()))
+            self.path = None
+        if self.path is None:
+            self.open(arrival_us)
+        try:
+            (node_ip,) = struct.unpack('<I', socket.inet_aton(ip)) # Network byte order in memory, as in C
+        except OSError:
+            node_ip = 0
+        wall_clock_us = header["wall_clock_us"]
+        self.index_chunk(wall_clock_us or arrival_us, self.size, node_ip, header["seq"])
+        self.pending += struct.pack(SEGMENT_CHUNK_FORMAT, SEGMENT_CHUNK_MAGIC, SEGMENT_CHUNK_PACKET, transport,
+                                    header["codec"], header["flags"], len(packet), header["seq"], node_ip, port,
+                                    header["sample_count"], header["sample_rate"], header["channels"],
+                                    header["timestamp_us"], wall_clock_us, arrival_us)
+        self.pending += packet
+        self.pending += bytes(pad)
+        self.size += chunk_bytes
+
+    def tail(self):
+        """Index chunk and footer for the open file."""
+        entries = sorted(self.index, key=lambda entry: (entry[2], entry[0]))
+        body = b"".join(struct.pack(SEGMENT_INDEX_ENTRY_FORMAT, *entry) for entry in entries)
+        chunk = struct.pack(SEGMENT_CHUNK_FORMAT, SEGMENT_CHUNK_MAGIC, SEGMENT_CHUNK_INDEX, 0, 0, 0, len(body),
+                            0, 0, 0, 0, 0, 0, 0, 0, unix_time_us())
+        footer = struct.pack(SEGMENT_FOOTER_FORMAT, self.size, self.chunks, self.first_us, self.last_us,
+                             SEGMENT_FOOTER_MAGIC)
+        return chunk + body + footer
+
+    def take_writes(self):
+        """Everything queued since the last call, as (path, bytes) for append_segments_sync()."""
+        writes, self.finished = self.finished, []
+        if self.pending:
+            writes.append((self.path, self.pending))
+            self.pending = bytearray()
+        return writes
+
+    def close(self):
+        """take_writes() plus the open file's index and footer."""
+        if self.path:
+            self.pending += self.tail()
+        writes = self.take_writes()
+        self.path = None
+        return writes
+
+recorder = SegmentRecorder(SEGMENT_DIR)
+
+# === Synchronous File Saving Functions (for executor) ===
+def append_segments_sync(writes):
+    """Appends queued segment bytes and fsyncs them. Runs in executor thread."""
+    for path, data in writes:
+        try:
+            with open(path, 'ab') as f:
+                f.write(data)
+                f.flush()
+                os.fsync(f.fileno())
+        except Exception as e:
+            logger.error(f"Failed to append {len(data)} bytes to {path}: {e}")
+
+def save_features_sync(filename, entries):
+    """Saves log-mel frames as .npz: per-packet client, timestamp_us and frames x bands dB. Runs in executor thread."""
     try:
-        with wave.open(filename, 'wb') as wf:
-            wf.setnchannels(channels)
-            wf.setsampwidth(sampwidth)
-            wf.setframerate(framerate)
-            wf.writeframes(data_bytes)
-        logger.info(f"Finished saving {filename} ({len(data_bytes)} audio bytes)")
+        np.savez_compressed(filename,
+                            clients=np.array([client for client, _, _ in entries]),
+                            timestamps_us=np.array([timestamp for _, timestamp, _ in entries], dtype=np.uint64),
+                            frames=np.array([frames for _, _, frames in entries], dtype=object))
+        logger.info(f"Finished saving {filename} ({len(entries)} feature packets)")
         return True
     except Exception as e:
         logger.error(f"Failed to save {filename}: {e}\n{traceback.format_exc()}")
         return False
 
-# === Async WAV File Writer Task ===
-async def wav_writer_task():
-    global write_buffer
-    file_counter = 0
+# === Async Recording Task ===
+async def recording_task():
+    global feature_buffer
+    feature_counter = 0
+    last_feature_save = time.monotonic()
     loop = asyncio.get_running_loop()
-    logger.info("WAV writer task started.")
+    logger.info("Recording task started.")
 
     while not shutdown_event.is_set():
         try:
             # Wait for the specified interval, but wake up sooner if shutdown is signaled
-            await asyncio.wait_for(shutdown_event.wait(), timeout=WAV_SAVE_INTERVAL_S)
-            # If we wake up because shutdown_event was set, break the loop
+            await asyncio.wait_for(shutdown_event.wait(), timeout=SEGMENT_FLUSH_INTERVAL_S)
             if shutdown_event.is_set():
-                logger.info("WAV writer task: Shutdown signal received.")
+                logger.info("Recording task: Shutdown signal received.")
                 break
         except asyncio.TimeoutError:
-            # This is the normal case: timeout reached, proceed to check buffer
+            # This is the normal case: timeout reached, proceed to write what arrived
             pass
 
         try:
-            if len(write_buffer) > 0:
-                # Copy buffer and clear original immediately
-                buffer_to_write = bytes(write_buffer) # Make immutable copy
-                current_buffer_len = len(buffer_to_write)
-                write_buffer = bytearray() # Clear original immediately
-
-                filename = f"{WAV_FILE_PREFIX}_{file_counter:04d}.wav"
-                file_counter += 1
-
-                logger.info(f"Scheduling save for {filename} ({current_buffer_len} bytes)...")
-
-                # Run the blocking save function in the executor
-                await loop.run_in_executor(
-                    executor,
-                    save_wave_sync,
-                    filename,
-                    buffer_to_write,
-                    CHANNELS,
-                    AUDIO_BYTES_PER_SAMPLE,
-                    SAMPLE_RATE
-                )
-            # else:
-            #     logger.debug("wav_writer_task: No data in buffer to save.")
+            writes = recorder.take_writes()
+            if writes:
+                await loop.run_in_executor(executor, append_segments_sync, writes)
+            if feature_buffer and time.monotonic() - last_feature_save >= FEATURE_SAVE_INTERVAL_S:
+                entries, feature_buffer = feature_buffer, []
+                filename = f"{FEATURE_FILE_PREFIX}_{feature_counter:04d}.npz"
+                feature_counter += 1
+                last_feature_save = time.monotonic()
+                await loop.run_in_executor(executor, save_features_sync, filename, entries)
 
         except asyncio.CancelledError:
-            logger.info("WAV writer task cancelled during operation.")
+            logger.info("Recording task cancelled during operation.")
             break # Exit loop if cancelled
         except Exception as e:
-            logger.error(f"Error in wav_writer_task main loop: {e}\n{traceback.format_exc()}")
+            logger.error(f"Error in recording_task main loop: {e}\n{traceback.format_exc()}")
             await asyncio.sleep(5) # Avoid fast error loops
 
-    # Final save on shutdown if buffer still has data
-    if len(write_buffer) > 0:
-         logger.info("Performing final WAV save on shutdown...")
-         final_buffer = bytes(write_buffer)
-         filename = f"{WAV_FILE_PREFIX}_{file_counter:04d}_final.wav"
-         # Use the sync function directly here as the event loop is stopping anyway
-         save_wave_sync(filename, final_buffer, CHANNELS, AUDIO_BYTES_PER_SAMPLE, SAMPLE_RATE)
+    # Final write on shutdown: the rest of the data, then the index and footer
+    # Use the sync functions directly here as the event loop is stopping anyway
+    append_segments_sync(recorder.close())
+    if feature_buffer:
+         save_features_sync(f"{FEATURE_FILE_PREFIX}_{feature_counter:04d}_final.npz", feature_buffer)
 
-    logger.info("WAV writer task finished.")
+    logger.info("Recording task finished.")
 
 
 # === Async Throughput Monitor Task ===
@@ -261,10 +902,13 @@ async def throughput_monitor_task():
                 elif kbps == 0 and packet_count_session > 0:
                     status = f"Connected ({active_client_count}), no data flow..."
                 else:
-                    status = f"Clients:{active_client_count}|Pkts:{packet_count_session:<7}|Rate:{kbps:<7.2f} KB/s|Q:{q_size:<4}"
+                    status = f"Clients:{active_client_count}|Pkts:{packet_count_session:<7}|Rate:{kbps:<7.2f} KB/s|Q:{q_size:<4}|Flow:{flow_controller.level}"
 
                 print(f"\r{status}{' '*15}", end='', flush=True) # Overwrite line with padding
                 bytes_last_second = 0
+                flow_message = flow_controller.update(kbps, q_size / PLAYBACK_QUEUE_MAX_SIZE)
+                if flow_message:
+                    await broadcast(flow_message)
             except Exception as e:
                 logger.error(f"Error calculating throughput: {e}")
 
@@ -565,18 +1209,23 @@ async def main():
 
     # Start the WebSocket server
     server_instance = None
+    udp_transport = None
     try:
         logger.info(f"Starting WebSocket server on ws://{HOST}:{PORT}")
         # Start server and keep track of the server object to close it later
         server_instance = await serve(handler, HOST, PORT)
         logger.info("Server started successfully.")
+        logger.info(f"Listening for UDP/RTP audio on {HOST}:{UDP_PORT}")
+        udp_transport, _ = await loop.create_datagram_endpoint(lambda: udp_protocol, local_addr=(HOST, UDP_PORT))
 
         # Start background tasks
         logger.info("Starting background tasks...")
         monitor_task = asyncio.create_task(throughput_monitor_task(), name="ThroughputMonitor")
         player_task = asyncio.create_task(audio_player_task(), name="AudioPlayer")
-        writer_task = asyncio.create_task(wav_writer_task(), name="WavWriter")
-        background_tasks = [monitor_task, player_task, writer_task]
+        writer_task = asyncio.create_task(recording_task(), name="Recording")
+        report_task = asyncio.create_task(udp_report_task(), name="UdpReport")
+        latency_task = asyncio.create_task(latency_report_task(), name="LatencyReport")
+        background_tasks = [monitor_task, player_task, writer_task, report_task, latency_task]
 
         # Wait indefinitely until the shutdown event is set by the signal handler
         await shutdown_event.wait()
@@ -587,6 +1236,8 @@ async def main():
     except Exception as e:
          logger.error(f"Error during main execution: {e}\n{traceback.format_exc()}")
     finally:
+        if udp_transport:
+            udp_transport.close()
         # Cleanup server if it was started
         if server_instance:
             logger.info("Closing WebSocket server...")
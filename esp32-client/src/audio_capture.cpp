@@ -0,0 +1,371 @@
+// src/audio_capture.cpp
+
+#include <Arduino.h>
+#include <atomic>
+#include <driver/i2s.h>
+#include <esp_timer.h>
+#include <soc/soc_caps.h>
+
+#include "audio_capture.h"
+#include "globals.h"
+#include "logging.h"
+#include "memory_policy.h"
+#include "settings_manager.h"
+#include "synthetic_source.h"
+
+// === PIN DEFINITIONS ===
+#define I2S_BCLK 4
+#define I2S_WS 5
+#define I2S_SD 8
+#define I2S_PORT I2S_NUM_0
+
+// === GLOBALS ===
+SpscRing<CaptureFrame> capture_ring;
+volatile uint32_t capture_overruns = 0; // Frames dropped because the ring was full
+CaptureStats capture_stats;
+
+static CaptureFrame *capture_storage = nullptr;
+static TaskHandle_t capture_consumer = nullptr;
+static uint32_t overflow_scratch[MAX_SAMPLES_PER_READ]; // Keeps DMA drained while the ring is full
+static QueueHandle_t i2s_event_queue = nullptr;         // Driver events, drained by the capture task
+
+// Driver configuration. active_config is written by whoever installs the
+// driver (setupI2S(), then the capture task); pending_config is written by
+// the network task before it raises reconfigure_pending.
+static CaptureConfig active_config = {};
+static CaptureConfig pending_config = {};
+static std::atomic<bool> reconfigure_pending{false};
+static std::atomic<uint16_t> capture_generation{0};
+
+// Sample rate measurement: samples delivered between two read completions.
+// Each end is only known to within one DMA buffer, so the window runs from
+// setupI2S() on and the error shrinks as it grows (10 ms after 10 minutes
+// is ~17 ppm).
+static volatile bool rate_restart = true;
+static uint64_t rate_start_us = 0;
+static uint64_t rate_samples = 0;
+static uint64_t rate_published_us = 0;
+
+static void measureSampleRate(uint64_t now_us, size_t samples)
+{
+    if (rate_restart)
+    {
+        // Samples up to the first completion belong to no measured interval
+        rate_restart = false;
+        rate_start_us = now_us;
+        rate_published_us = now_us;
+        rate_samples = 0;
+        return;
+    }
+    rate_samples += samples;
+    if (now_us - rate_published_us >= CAPTURE_RATE_PUBLISH_US)
+    {
+        rate_published_us = now_us;
+        capture_stats.measured_rate_hz = (float)((double)rate_samples * 1e6 / (double)(now_us - rate_start_us));
+    }
+}
+
+// Counts what the driver reported since the last read; RX_DONE is ignored
+static void drainI2sEvents()
+{
+    i2s_event_t event;
+    while (i2s_event_queue && xQueueReceive(i2s_event_queue, &event, 0) == pdTRUE)
+    {
+        if (event.type == I2S_EVENT_RX_Q_OVF)
+        {
+            capture_stats.dma_overflows = capture_stats.dma_overflows + 1;
+        }
+        else if (event.type == I2S_EVENT_DMA_ERROR)
+        {
+            capture_stats.dma_errors = capture_stats.dma_errors + 1;
+        }
+    }
+}
+
+static void reinstallI2S();
+
+// === Capture Task ===
+// Does nothing but move DMA buffers into the ring so a stalled network task
+// can never back up the I2S peripheral.
+static void captureTask(void *param)
+{
+    LOG_INFO("Capture task running on core %d", xPortGetCoreID());
+    bool dropped = false;
+
+    for (;;)
+    {
+        if (reconfigure_pending.load(std::memory_order_acquire))
+        {
+            reinstallI2S();
+            dropped = true; // Receiver sees the gap as an overrun
+        }
+
+        CaptureFrame *frame = capture_ring.writeSlot();
+        void *dest = frame ? (void *)frame->samples : (void *)overflow_scratch;
+
+        size_t bytes_read = 0;
+        uint64_t now_us = 0;
+        const int64_t wait_start_us = esp_timer_get_time();
+        if (active_config.simulate)
+        {
+            bytes_read = synthetic_source.read(static_cast<int32_t *>(dest), MAX_SAMPLES_PER_READ, active_config.channels, now_us) *
+                         sizeof(int32_t);
+        }
+        else
+        {
+            esp_err_t i2s_result = i2s_read(I2S_PORT, dest, I2S_READ_BUFFER_SIZE, &bytes_read, portMAX_DELAY);
+            if (i2s_result != ESP_OK)
+            {
+                LOG_WARN("I2S read failed! Error: %d", i2s_result);
+                vTaskDelay(pdMS_TO_TICKS(10));
+                continue;
+            }
+            now_us = esp_timer_get_time();
+        }
+        if (bytes_read == 0)
+        {
+            continue;
+        }
+        if (bytes_read % 4 != 0)
+        {
+            LOG_WARN("I2S read returned non-integral number of samples! (%u bytes)", bytes_read);
+            continue;
+        }
+        metricsRecord(METRIC_STAGE_I2S_WAIT, (uint32_t)(esp_timer_get_time() - wait_start_us));
+        capture_stats.frames = capture_stats.frames + 1;
+        measureSampleRate(now_us, bytes_read / 4 / active_config.channels);
+        drainI2sEvents();
+
+        if (!frame)
+        {
+            // Network side has fallen behind; the read above kept DMA moving.
+            capture_overruns = capture_overruns + 1;
+            dropped = true;
+            continue;
+        }
+
+        // Both sources report when the read completed; the frame is stamped
+        // with its first sample
+        frame->sample_count = bytes_read / 4;
+        frame->channels = active_config.channels;
+        frame->after_overrun = dropped;
+        frame->sample_rate = active_config.sample_rate;
+        frame->generation = capture_generation.load(std::memory_order_relaxed);
+        frame->timestamp = now_us - captureFrameDurationUs(*frame);
+        dropped = false;
+        capture_ring.commitWrite();
+
+        if (capture_consumer)
+        {
+            xTaskNotifyGive(capture_consumer);
+        }
+    }
+}
+
+bool startCaptureTask(TaskHandle_t consumer)
+{
+    capture_storage = (CaptureFrame *)memoryAlloc(MEMORY_HOT, CAPTURE_RING_FRAMES * sizeof(CaptureFrame), "capture ring",
+                                                  alignof(CaptureFrame));
+    if (!capture_storage || !capture_ring.begin(capture_storage, CAPTURE_RING_FRAMES))
+    {
+        LOG_ERROR("Failed to allocate capture ring (%u bytes)", CAPTURE_RING_FRAMES * sizeof(CaptureFrame));
+        return false;
+    }
+    LOG_INFO("Allocated capture ring (%u frames, %u bytes). Free Heap: %u",
+             CAPTURE_RING_FRAMES, CAPTURE_RING_FRAMES * sizeof(CaptureFrame), ESP.getFreeHeap());
+
+    capture_consumer = consumer;
+    BaseType_t created = xTaskCreatePinnedToCore(captureTask, "capture", CAPTURE_TASK_STACK, nullptr,
+                                                 CAPTURE_TASK_PRIORITY, nullptr, CAPTURE_TASK_CORE);
+    if (created != pdPASS)
+    {
+        LOG_ERROR("Failed to create capture task");
+        return false;
+    }
+    return true;
+}
+
+// === I2S Setup ===
+CaptureConfig captureConfigFor(const AudioSettings &settings)
+{
+    CaptureConfig config;
+    config.sample_rate = settings.sample_rate;
+#if SOC_I2S_SUPPORTS_TDM
+    config.channels = settings.channels >= CAPTURE_CHANNELS_TDM      ? CAPTURE_CHANNELS_TDM
+                      : settings.channels >= CAPTURE_CHANNELS_STEREO ? CAPTURE_CHANNELS_STEREO
+                                                                     : CAPTURE_CHANNELS_MONO;
+#else
+    config.channels = settings.channels >= CAPTURE_CHANNELS_STEREO ? CAPTURE_CHANNELS_STEREO : CAPTURE_CHANNELS_MONO;
+#endif
+    config.dma_buf_count = constrain((int)settings.dma_buf_count, I2S_DMA_BUF_COUNT_MIN, I2S_DMA_BUF_COUNT_MAX);
+    // A DMA buffer holds dma_buf_len frames of every channel and the driver
+    // caps its size in bytes, so the longest buffer shrinks with the channels
+    config.dma_buf_len = constrain((int)settings.dma_buf_len, I2S_DMA_BUF_LEN_MIN, I2S_DMA_BUF_LEN_MAX / config.channels);
+#if SOC_I2S_SUPPORTS_APLL
+    config.use_apll = settings.use_apll;
+#else
+    config.use_apll = false;
+#endif
+    config.simulate = settings.simulate_mic;
+    return config;
+}
+
+// Installs the driver and sets its pins; false leaves it possibly installed.
+// A simulated configuration installs nothing and restarts the generator.
+static bool installI2S(const CaptureConfig &config)
+{
+    if (config.simulate)
+    {
+        synthetic_source.restart(config.sample_rate);
+        active_config = config;
+        capture_stats.apll = false;
+        capture_stats.clock_hz = config.sample_rate; // Paced exactly
+        capture_stats.measured_rate_hz = 0.0f;
+        rate_restart = true;
+        LOG_INFO("Capture: simulated microphone at %u Hz, %u channel(s) (no I2S driver)", config.sample_rate, config.channels);
+        return true;
+    }
+    i2s_channel_fmt_t channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    if (config.channels == CAPTURE_CHANNELS_STEREO)
+    {
+        channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT; // Left (WS low) lands first
+    }
+#if SOC_I2S_SUPPORTS_TDM
+    else if (config.channels > CAPTURE_CHANNELS_STEREO)
+    {
+        channel_format = I2S_CHANNEL_FMT_MULTIPLE;
+    }
+#endif
+    i2s_config_t i2s_config = {.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
+                               .sample_rate = config.sample_rate,
+                               .bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT,
+                               .channel_format = channel_format,
+                               .communication_format = I2S_COMM_FORMAT_STAND_I2S,
+                               .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+                               .dma_buf_count = config.dma_buf_count,
+                               .dma_buf_len = config.dma_buf_len,
+                               .use_apll = config.use_apll,
+                               .tx_desc_auto_clear = false,
+                               .fixed_mclk = 0};
+#if SOC_I2S_SUPPORTS_TDM
+    if (channel_format == I2S_CHANNEL_FMT_MULTIPLE)
+    {
+        // One 32-bit slot per mic, TDM_CH0 first
+        uint32_t mask = 0;
+        for (uint8_t slot = 0; slot < config.channels; ++slot)
+        {
+            mask |= I2S_TDM_ACTIVE_CH0 << slot;
+        }
+        i2s_config.chan_mask = (i2s_channel_t)mask;
+        i2s_config.total_chan = config.channels;
+    }
+#endif
+    i2s_pin_config_t pin_config = {.mck_io_num = I2S_PIN_NO_CHANGE,
+                                   .bck_io_num = I2S_BCLK,
+                                   .ws_io_num = I2S_WS,
+                                   .data_out_num = I2S_PIN_NO_CHANGE,
+                                   .data_in_num = I2S_SD};
+    if (i2s_driver_install(I2S_PORT, &i2s_config, I2S_EVENT_QUEUE_LEN, &i2s_event_queue) != ESP_OK)
+    {
+        LOG_ERROR("Failed I2S install");
+        i2s_event_queue = nullptr;
+        return false;
+    }
+    if (i2s_set_pin(I2S_PORT, &pin_config) != ESP_OK)
+    {
+        LOG_ERROR("Failed I2S pins");
+        return false;
+    }
+    if (i2s_zero_dma_buffer(I2S_PORT) != ESP_OK)
+    {
+        LOG_ERROR("Failed zero DMA"); /* Might continue */
+    }
+
+    active_config = config;
+    capture_stats.apll = config.use_apll;
+    capture_stats.clock_hz = i2s_get_clk(I2S_PORT);
+    capture_stats.measured_rate_hz = 0.0f;
+    rate_restart = true;
+    LOG_INFO("I2S: %u Hz x %u channel(s), %u x %u frame DMA buffers (%.1f ms), %s clock %.2f Hz", config.sample_rate,
+             config.channels, config.dma_buf_count, config.dma_buf_len, config.dma_buf_count * config.dma_buf_len * 1000.0f / config.sample_rate,
+             config.use_apll ? "APLL" : "PLL", capture_stats.clock_hz);
+    return true;
+}
+
+void setupI2S()
+{
+    LOG_DEBUG("Configuring I2S...");
+    const CaptureConfig config = captureConfigFor(Settings.settings);
+    if (config.dma_buf_count != Settings.settings.dma_buf_count || config.dma_buf_len != Settings.settings.dma_buf_len)
+    {
+        LOG_WARN("I2S DMA %u x %u frames is outside the driver's range, using %u x %u",
+                 Settings.settings.dma_buf_count, Settings.settings.dma_buf_len, config.dma_buf_count, config.dma_buf_len);
+    }
+    if (Settings.settings.use_apll && !config.use_apll && !config.simulate)
+    {
+        LOG_WARN("use_apll is set but this chip has no audio PLL; I2S stays on the default clock");
+    }
+    if (config.channels != Settings.settings.channels)
+    {
+        LOG_WARN("%u capture channels are not supported here, capturing %u", Settings.settings.channels, config.channels);
+    }
+    if (!installI2S(config))
+    {
+        ESP.restart();
+    }
+}
+
+// Capture task, between two reads
+static void reinstallI2S()
+{
+    const CaptureConfig previous = active_config;
+    const int64_t start_us = esp_timer_get_time();
+    if (!previous.simulate)
+    {
+        i2s_driver_uninstall(I2S_PORT);
+        i2s_event_queue = nullptr;
+    }
+    if (installI2S(pending_config))
+    {
+        capture_generation.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        LOG_ERROR("I2S reconfiguration failed, restoring the previous configuration");
+        i2s_driver_uninstall(I2S_PORT); // The simulated source never fails, so this was the driver
+        i2s_event_queue = nullptr;
+        if (!installI2S(previous))
+        {
+            LOG_ERROR("FATAL: Failed to restore the I2S driver!");
+            ESP.restart();
+        }
+    }
+    capture_stats.reinstall_us = (uint32_t)(esp_timer_get_time() - start_us);
+    reconfigure_pending.store(false, std::memory_order_release);
+}
+
+bool requestCaptureReconfigure(const CaptureConfig &config)
+{
+    if (reconfigure_pending.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    pending_config = config;
+    reconfigure_pending.store(true, std::memory_order_release);
+    return true;
+}
+
+bool captureReconfigurePending()
+{
+    return reconfigure_pending.load(std::memory_order_acquire);
+}
+
+CaptureConfig activeCaptureConfig()
+{
+    return active_config;
+}
+
+uint16_t captureGeneration()
+{
+    return capture_generation.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,122 @@
+// src/audio_packet.cpp
+
+#include <Arduino.h>
+
+#include "audio_packet.h"
+#include "logging.h"
+
+PacketPool packet_pool;
+PacketBatch packet_batch;
+
+bool PacketPool::begin(size_t buffer_count, size_t payload_bytes, MemoryClass placement)
+{
+    // Round each buffer up so every payload stays 16-byte aligned
+    const size_t storage_size = (PACKET_PAYLOAD_OFFSET + payload_bytes + 15) & ~(size_t)15;
+
+    // Bookkeeping is tiny and always internal; only the packet storage honours `placement`
+    buffers = (PacketBuffer *)calloc(buffer_count, sizeof(PacketBuffer));
+    free_list = (PacketBuffer **)calloc(buffer_count, sizeof(PacketBuffer *));
+    uint8_t *storage = (uint8_t *)memoryAlloc(placement, buffer_count * storage_size, "packet pool");
+    if (!buffers || !free_list || !storage)
+    {
+        LOG_ERROR("Failed to allocate packet pool (%u x %u bytes)", buffer_count, storage_size);
+        free(buffers);
+        free(free_list);
+        memoryFree(storage);
+        buffers = nullptr;
+        free_list = nullptr;
+        return false;
+    }
+
+    for (size_t i = 0; i < buffer_count; ++i)
+    {
+        buffers[i].storage = storage + i * storage_size;
+        buffers[i].length = 0;
+        free_list[i] = &buffers[i];
+    }
+    count = buffer_count;
+    free_count = buffer_count;
+    payload_capacity = payload_bytes;
+
+    LOG_INFO("Allocated packet pool (%u x %u bytes). Free Heap: %u", buffer_count, storage_size, ESP.getFreeHeap());
+    return true;
+}
+
+PacketBuffer *PacketPool::acquire()
+{
+    PacketBuffer *buffer = nullptr;
+    portENTER_CRITICAL(&lock);
+    if (free_count > 0)
+    {
+        buffer = free_list[--free_count];
+    }
+    else
+    {
+        exhausted = exhausted + 1;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (buffer)
+    {
+        buffer->length = 0;
+    }
+    return buffer;
+}
+
+void PacketPool::release(PacketBuffer *buffer)
+{
+    if (!buffer)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&lock);
+    if (free_count < count)
+    {
+        free_list[free_count++] = buffer;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+bool PacketBatch::begin(size_t capacity, MemoryClass placement)
+{
+    storage = (uint8_t *)memoryAlloc(placement, PACKET_HEADROOM + capacity, "packet batch");
+    if (!storage)
+    {
+        LOG_ERROR("Failed to allocate packet batch (%u bytes)", PACKET_HEADROOM + capacity);
+        return false;
+    }
+    capacity_bytes = capacity;
+    clear();
+    LOG_INFO("Allocated packet batch (%u bytes). Free Heap: %u", capacity, ESP.getFreeHeap());
+    return true;
+}
+
+bool PacketBatch::append(PacketBuffer *packet, uint32_t now_ms)
+{
+    if (used + packet->length > capacity_bytes)
+    {
+        return false;
+    }
+    if (packet_count == 0)
+    {
+        first_ms = now_ms;
+    }
+    memcpy(storage + PACKET_HEADROOM + used, packet->packet(), packet->length);
+    used += packet->length;
+    ++packet_count;
+    return true;
+}
+
+void PacketBatch::markSent()
+{
+    batches_sent++;
+    packets_sent += packet_count;
+    bytes_sent += used;
+    clear();
+}
+
+void PacketBatch::clear()
+{
+    used = 0;
+    packet_count = 0;
+}
@@ -0,0 +1,144 @@
+// src/dsp_benchmark.cpp
+//
+// Boot-time micro-benchmark for the sample kernels. Build the
+// `dsp-benchmark` environment (defines DSP_BENCHMARK) and read the serial log.
+
+#ifdef DSP_BENCHMARK
+
+#include <Arduino.h>
+
+#include "audio_capture.h"
+#include "audio_dsp.h"
+#include "spectral_detector.h"
+#include "logging.h"
+
+#define DSP_BENCHMARK_ITERATIONS 200
+
+typedef size_t (*ConvertFn)(const int32_t *, size_t, uint8_t, uint8_t *, FrameStats &);
+
+static void benchmarkKernel(const char *name, ConvertFn fn, const int32_t *raw, uint8_t output_bits, uint8_t *out)
+{
+    FrameStats stats;
+    fn(raw, MAX_SAMPLES_PER_READ, output_bits, out, stats); // Warm caches
+
+    uint32_t best = UINT32_MAX;
+    uint64_t total = 0;
+    for (int i = 0; i < DSP_BENCHMARK_ITERATIONS; ++i)
+    {
+        const uint32_t start = ESP.getCycleCount();
+        fn(raw, MAX_SAMPLES_PER_READ, output_bits, out, stats);
+        const uint32_t cycles = ESP.getCycleCount() - start;
+        best = min(best, cycles);
+        total += cycles;
+    }
+
+    const float avg = (float)total / DSP_BENCHMARK_ITERATIONS;
+    LOG_INFO("[DSP] %-6s %-10s best %.2f avg %.2f cycles/sample", name,
+             out ? (output_bits == 16 ? "16-bit" : "24-bit") : "stats-only",
+             (float)best / MAX_SAMPLES_PER_READ, avg / MAX_SAMPLES_PER_READ);
+}
+
+// Gain + DC blocker + 100 Hz high-pass fused into the conversion. Runs in
+// place on the benchmark frame; the values drift but the cost does not.
+static SamplePreprocessor bench_preprocessor;
+
+static size_t preprocessKernel(const int32_t *raw, size_t count, uint8_t output_bits, uint8_t *out, FrameStats &stats)
+{
+    return processConvertFrame(const_cast<int32_t *>(raw), count, output_bits, out, stats, bench_preprocessor);
+}
+
+// One capture frame through the spectral trigger (window + FFT + band split)
+static void benchmarkSpectral(const int32_t *raw)
+{
+    static SpectralDetector detector; // ~16 KB, keep it off the stack
+    detector.begin(48000, 1000.0f, 10000.0f);
+    for (size_t filled = 0; filled < SPECTRAL_FFT_SIZE; filled += MAX_SAMPLES_PER_READ)
+    {
+        detector.process(raw, MAX_SAMPLES_PER_READ); // Fill the window
+    }
+
+    uint32_t best = UINT32_MAX;
+    uint64_t total = 0;
+    for (int i = 0; i < DSP_BENCHMARK_ITERATIONS; ++i)
+    {
+        const uint32_t start = ESP.getCycleCount();
+        detector.process(raw, MAX_SAMPLES_PER_READ);
+        const uint32_t cycles = ESP.getCycleCount() - start;
+        best = min(best, cycles);
+        total += cycles;
+    }
+
+    const float avg = (float)total / DSP_BENCHMARK_ITERATIONS;
+    const float frame_cycles = (float)MAX_SAMPLES_PER_READ / 48000.0f * getCpuFrequencyMhz() * 1e6f;
+    LOG_INFO("[DSP] spectral %s best %.2f avg %.2f cycles/sample (%.1f%% of a 48 kHz frame)",
+             SpectralDetector::usingEspDsp() ? "esp-dsp " : "portable", (float)best / MAX_SAMPLES_PER_READ,
+             avg / MAX_SAMPLES_PER_READ, 100.0f * avg / frame_cycles);
+}
+
+// One capture frame through the output_sample_rate decimator, per input sample
+static void benchmarkDecimator(const int32_t *raw, uint8_t factor)
+{
+    static PolyphaseDecimator decimator;
+    static int32_t decimated[MAX_SAMPLES_PER_READ / 2 + 1];
+    decimator.configure(factor);
+    decimator.process(raw, MAX_SAMPLES_PER_READ, decimated); // Warm caches
+
+    uint32_t best = UINT32_MAX;
+    uint64_t total = 0;
+    for (int i = 0; i < DSP_BENCHMARK_ITERATIONS; ++i)
+    {
+        const uint32_t start = ESP.getCycleCount();
+        decimator.process(raw, MAX_SAMPLES_PER_READ, decimated);
+        const uint32_t cycles = ESP.getCycleCount() - start;
+        best = min(best, cycles);
+        total += cycles;
+    }
+
+    const float avg = (float)total / DSP_BENCHMARK_ITERATIONS;
+    LOG_INFO("[DSP] decim  %ux (%u taps) best %.2f avg %.2f cycles/sample", factor, decimator.taps(),
+             (float)best / MAX_SAMPLES_PER_READ, avg / MAX_SAMPLES_PER_READ);
+}
+
+void runDspBenchmark()
+{
+    int32_t *raw = (int32_t *)heap_caps_aligned_alloc(AUDIO_DSP_ALIGN, MAX_SAMPLES_PER_READ * sizeof(int32_t), MALLOC_CAP_INTERNAL);
+    uint8_t *out = (uint8_t *)heap_caps_aligned_alloc(AUDIO_DSP_ALIGN, MAX_SAMPLES_PER_READ * 3, MALLOC_CAP_INTERNAL);
+    if (!raw || !out)
+    {
+        LOG_ERROR("[DSP] Benchmark allocation failed");
+        heap_caps_free(raw);
+        heap_caps_free(out);
+        return;
+    }
+
+    // Mic-like input: 24-bit samples left-justified in 32-bit words
+    uint32_t lcg = 12345;
+    for (size_t i = 0; i < MAX_SAMPLES_PER_READ; ++i)
+    {
+        lcg = lcg * 1664525u + 1013904223u;
+        raw[i] = (int32_t)(lcg & 0xFFFFFF00u);
+    }
+
+    LOG_INFO("[DSP] %u samples/frame, %d iterations, CPU %u MHz, SIMD %s",
+             MAX_SAMPLES_PER_READ, DSP_BENCHMARK_ITERATIONS, getCpuFrequencyMhz(), audioDspUsingSimd() ? "on" : "off");
+    benchmarkKernel("scalar", convertFrameScalar, raw, 16, nullptr);
+    benchmarkKernel("scalar", convertFrameScalar, raw, 16, out);
+    benchmarkKernel("scalar", convertFrameScalar, raw, 24, out);
+    benchmarkKernel("active", convertFrame, raw, 16, nullptr);
+    benchmarkKernel("active", convertFrame, raw, 16, out);
+    benchmarkKernel("active", convertFrame, raw, 24, out);
+    bench_preprocessor.configure(4.0f, true, 100.0f, 48000);
+    benchmarkKernel("filter", preprocessKernel, raw, 16, nullptr);
+    benchmarkKernel("filter", preprocessKernel, raw, 16, out);
+    benchmarkKernel("filter", preprocessKernel, raw, 24, out);
+    for (uint8_t factor = 2; factor <= DECIMATOR_MAX_FACTOR; ++factor)
+    {
+        benchmarkDecimator(raw, factor);
+    }
+    benchmarkSpectral(raw);
+
+    heap_caps_free(raw);
+    heap_caps_free(out);
+}
+
+#endif // DSP_BENCHMARK
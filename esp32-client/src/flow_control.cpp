@@ -0,0 +1,232 @@
+// src/flow_control.cpp
+
+#include <Arduino.h>
+
+#include "flow_control.h"
+#include "audio_codec.h"
+#include "audio_dsp.h"
+#include "settings_manager.h"
+#include "logging.h"
+
+// Receiver requests; 0 / false = no request
+static bool server_active = false;
+static uint32_t server_until_ms = 0;
+static bool server_pause = false;
+static bool server_adpcm = false;
+static uint8_t server_decimate = 0;
+static uint16_t server_batch_bytes = 0;
+static uint16_t server_batch_delay_ms = 0;
+
+static uint8_t auto_level = 0;
+static uint32_t high_since_ms = 0; // Ring above FLOW_AUTO_HIGH_PCT since; 0 = not above
+static uint32_t low_since_ms = 0;  // Ring empty since; 0 = not empty
+
+static bool state_dirty = false; // flow_state owed to the receiver
+static uint32_t requests = 0;
+static uint32_t auto_changes = 0;
+static uint64_t paused_total_ms = 0;
+static uint32_t paused_since_ms = 0;
+
+static void setPaused(bool pause, uint32_t now_ms)
+{
+    if (pause == server_pause)
+    {
+        return;
+    }
+    if (pause)
+    {
+        paused_since_ms = now_ms;
+        LOG_WARN("Receiver paused live audio; spooling");
+    }
+    else
+    {
+        paused_total_ms += now_ms - paused_since_ms;
+        LOG_INFO("Receiver resumed live audio after %lu ms", (unsigned long)(now_ms - paused_since_ms));
+    }
+    server_pause = pause;
+}
+
+static void clearServerLimits(uint32_t now_ms)
+{
+    setPaused(false, now_ms);
+    server_active = false;
+    server_adpcm = false;
+    server_decimate = 0;
+    server_batch_bytes = 0;
+    server_batch_delay_ms = 0;
+}
+
+static void updateServerActive()
+{
+    server_active = server_pause || server_adpcm || server_decimate > 1 || server_batch_bytes > 0 || server_batch_delay_ms > 0;
+}
+
+void flowRequest(const FlowRequest &request)
+{
+    const uint32_t now = millis();
+    requests++;
+    state_dirty = true;
+    if (request.clear)
+    {
+        clearServerLimits(now);
+    }
+    if (request.has_pause)
+    {
+        setPaused(request.pause, now);
+    }
+    if (request.has_codec)
+    {
+        server_adpcm = request.adpcm;
+    }
+    if (request.has_decimate)
+    {
+        server_decimate = min(request.decimate, (uint8_t)DECIMATOR_MAX_FACTOR);
+    }
+    if (request.has_batch_bytes)
+    {
+        server_batch_bytes = min(request.batch_bytes, (uint16_t)FLOW_AUTO_BATCH_BYTES);
+    }
+    if (request.has_batch_delay)
+    {
+        server_batch_delay_ms = min(request.batch_delay_ms, (uint16_t)1000);
+    }
+    updateServerActive();
+    const uint32_t ttl_ms = request.ttl_ms ? min(request.ttl_ms, (uint32_t)FLOW_REQUEST_TTL_MAX_MS) : FLOW_REQUEST_TTL_MS;
+    server_until_ms = now + ttl_ms;
+    LOG_INFO("Flow request: pause=%d adpcm=%d decimate=%u batch=%u B/%u ms for %lu ms", server_pause, server_adpcm,
+             server_decimate, server_batch_bytes, server_batch_delay_ms, (unsigned long)ttl_ms);
+}
+
+void flowDisconnected()
+{
+    if (server_active)
+    {
+        LOG_INFO("Receiver flow limits dropped with the connection");
+        clearServerLimits(millis());
+    }
+}
+
+// Send-queue depth: frames the capture task has queued that the network
+// task has not picked up, which only builds while a send is blocking it
+static void followBacklog(uint32_t now_ms, size_t ring_fill, size_t ring_capacity)
+{
+    if (!Settings.settings.flow_auto || ring_capacity == 0)
+    {
+        if (auto_level != 0)
+        {
+            auto_level = 0;
+            auto_changes++;
+            state_dirty = true;
+        }
+        high_since_ms = low_since_ms = 0;
+        return;
+    }
+    const bool high = ring_fill * 100 >= ring_capacity * FLOW_AUTO_HIGH_PCT;
+    const bool drained = ring_fill <= 1;
+    if (!high)
+    {
+        high_since_ms = 0;
+    }
+    else if (high_since_ms == 0)
+    {
+        high_since_ms = now_ms | 1; // 0 means "not above"
+    }
+    if (!drained)
+    {
+        low_since_ms = 0;
+    }
+    else if (low_since_ms == 0)
+    {
+        low_since_ms = now_ms | 1;
+    }
+
+    if (high_since_ms && now_ms - high_since_ms >= FLOW_AUTO_RAISE_MS && auto_level < FLOW_AUTO_LEVELS)
+    {
+        auto_level++;
+        high_since_ms = now_ms | 1; // Next step needs another full period
+        auto_changes++;
+        state_dirty = true;
+        LOG_WARN("Send path backed up (%u/%u frames queued): flow level %u", ring_fill, ring_capacity, auto_level);
+    }
+    else if (low_since_ms && now_ms - low_since_ms >= FLOW_AUTO_RECOVER_MS && auto_level > 0)
+    {
+        auto_level--;
+        low_since_ms = now_ms | 1;
+        auto_changes++;
+        state_dirty = true;
+        LOG_INFO("Send path clear: flow level %u", auto_level);
+    }
+}
+
+bool flowService(uint32_t now_ms, size_t ring_fill, size_t ring_capacity, bool ws_up, char *message, size_t size)
+{
+    if (server_active && (int32_t)(now_ms - server_until_ms) >= 0)
+    {
+        LOG_INFO("Receiver flow limits expired");
+        clearServerLimits(now_ms);
+        state_dirty = true;
+    }
+    followBacklog(now_ms, ring_fill, ring_capacity);
+
+    if (!state_dirty || !ws_up)
+    {
+        return false;
+    }
+    state_dirty = false;
+    const uint8_t factor = flowDecimation(1, Settings.settings.sample_rate);
+    snprintf(message, size,
+             "{\"type\":\"flow_state\",\"paused\":%s,\"codec\":\"%s\",\"decimate\":%u,\"batch_max_bytes\":%u,"
+             "\"batch_max_delay_ms\":%u,\"auto_level\":%u,\"server_limits\":%s}",
+             server_pause ? "true" : "false",
+             flowCodec(Settings.settings.codec) == CODEC_SETTING_IMA_ADPCM ? "ima_adpcm" : "pcm", factor,
+             flowBatchBytes(Settings.settings.batch_max_bytes), flowBatchDelay(Settings.settings.batch_max_delay_ms),
+             auto_level, server_active ? "true" : "false");
+    return true;
+}
+
+bool flowPaused()
+{
+    return server_pause;
+}
+
+uint8_t flowCodec(uint8_t codec_setting)
+{
+    return server_adpcm || auto_level >= 2 ? CODEC_SETTING_IMA_ADPCM : codec_setting;
+}
+
+uint8_t flowDecimation(uint8_t factor, uint32_t sample_rate)
+{
+    uint8_t wanted = max(server_decimate, (uint8_t)(auto_level >= 3 ? 2 : 1));
+    if (wanted <= factor)
+    {
+        return factor;
+    }
+    while (wanted > factor && sample_rate % wanted != 0)
+    {
+        wanted--; // Packets carry a whole sample rate
+    }
+    return wanted;
+}
+
+uint16_t flowBatchBytes(uint16_t batch_max_bytes)
+{
+    const uint16_t wanted = max(server_batch_bytes, (uint16_t)(auto_level >= 1 ? FLOW_AUTO_BATCH_BYTES : 0));
+    return max(batch_max_bytes, wanted);
+}
+
+uint16_t flowBatchDelay(uint16_t batch_max_delay_ms)
+{
+    const uint16_t wanted = max(server_batch_delay_ms, (uint16_t)(auto_level >= 1 ? FLOW_AUTO_BATCH_DELAY_MS : 0));
+    return max(batch_max_delay_ms, wanted);
+}
+
+void flowFillStats(FlowStats &stats)
+{
+    const uint32_t now = millis();
+    stats.paused = server_pause;
+    stats.server_limits = server_active;
+    stats.auto_level = auto_level;
+    stats.requests = requests;
+    stats.auto_changes = auto_changes;
+    stats.paused_ms = (uint32_t)(paused_total_ms + (server_pause ? now - paused_since_ms : 0));
+}
@@ -0,0 +1,186 @@
+// src/live_monitor.cpp
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#include "live_monitor.h"
+#include "settings_manager.h"
+#include "logging.h"
+
+static AsyncWebSocket live_socket(LIVE_MONITOR_PATH);
+
+// Snapshot being accumulated and the last completed one. Both are only
+// touched from the network task; the web server task just counts clients.
+struct LiveAccumulator
+{
+    int16_t envelope[LIVE_BUCKETS][2];
+    size_t bucket = 0;          // Bucket being filled
+    size_t bucket_fill = 0;     // Samples in that bucket
+    size_t samples_per_bucket = 1;
+    uint32_t sample_rate = 0;
+    uint8_t rate_hz = 0;
+    uint64_t sum_sq = 0;
+    uint32_t count = 0;
+    int16_t peak = 0;
+    bool triggered = false;
+};
+
+static LiveAccumulator live;
+static uint8_t live_ready[sizeof(LiveSnapshotHeader) + LIVE_BUCKETS * 2 * sizeof(int16_t)];
+static bool live_pending = false;
+static uint32_t live_sequence = 0;
+static uint32_t live_dropped = 0;
+static volatile size_t live_clients = 0;
+static unsigned long live_last_cleanup = 0;
+
+static void resetBucket(size_t bucket)
+{
+    live.envelope[bucket][0] = INT16_MAX;
+    live.envelope[bucket][1] = INT16_MIN;
+}
+
+// Re-derives the decimation when the sample rate or snapshot rate changes
+static void configureAccumulator()
+{
+    live.sample_rate = Settings.settings.sample_rate;
+    live.rate_hz = Settings.settings.live_rate_hz;
+    const uint32_t window = live.rate_hz ? live.sample_rate / live.rate_hz : live.sample_rate;
+    live.samples_per_bucket = max((uint32_t)1, (window + LIVE_BUCKETS - 1) / LIVE_BUCKETS);
+    live.bucket = 0;
+    live.bucket_fill = 0;
+    live.sum_sq = 0;
+    live.count = 0;
+    live.peak = 0;
+    live.triggered = false;
+    resetBucket(0);
+}
+
+static void finishSnapshot()
+{
+    LiveSnapshotHeader header;
+    header.magic = LIVE_SNAPSHOT_MAGIC;
+    header.version = LIVE_SNAPSHOT_VERSION;
+    header.flags = live.triggered ? LIVE_FLAG_TRIGGERED : 0;
+    header.sequence = live_sequence++;
+    header.sample_rate = live.sample_rate;
+    header.samples_per_bucket = (uint16_t)min(live.samples_per_bucket, (size_t)UINT16_MAX);
+    header.buckets = LIVE_BUCKETS;
+    header.rms = live.count ? sqrtf((float)((double)live.sum_sq / live.count)) / 32768.0f : 0.0f;
+    header.peak = live.peak;
+    header.reserved = 0;
+
+    memcpy(live_ready, &header, sizeof(header));
+    memcpy(live_ready + sizeof(header), live.envelope, sizeof(live.envelope));
+    if (live_pending)
+    {
+        ++live_dropped; // Previous one never went out
+    }
+    live_pending = true;
+
+    live.bucket = 0;
+    live.bucket_fill = 0;
+    live.sum_sq = 0;
+    live.count = 0;
+    live.peak = 0;
+    live.triggered = false;
+    resetBucket(0);
+}
+
+static void onLiveEvent(AsyncWebSocket *socket, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t length)
+{
+    switch (type)
+    {
+    case WS_EVT_CONNECT:
+        LOG_INFO("Live monitor client #%u connected", client->id());
+        live_clients = socket->count();
+        break;
+    case WS_EVT_DISCONNECT:
+        LOG_INFO("Live monitor client #%u disconnected", client->id());
+        live_clients = socket->count();
+        break;
+    default:
+        break; // The page never sends anything we act on
+    }
+}
+
+void setupLiveMonitor(AsyncWebServer &server)
+{
+    live_socket.onEvent(onLiveEvent);
+    server.addHandler(&live_socket);
+    configureAccumulator();
+}
+
+void liveMonitorFeed(const int32_t *raw, size_t count, const FrameStats &stats, bool triggered)
+{
+    if (live_clients == 0 || Settings.settings.live_rate_hz == 0)
+    {
+        return;
+    }
+    if (live.sample_rate != Settings.settings.sample_rate || live.rate_hz != Settings.settings.live_rate_hz)
+    {
+        configureAccumulator();
+    }
+
+    live.sum_sq += stats.sum_sq;
+    live.count += stats.count;
+    live.peak = max(live.peak, stats.peak);
+    live.triggered |= triggered;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int16_t sample = rawToSample16(raw[i]);
+        int16_t *bucket = live.envelope[live.bucket];
+        bucket[0] = min(bucket[0], sample);
+        bucket[1] = max(bucket[1], sample);
+        if (++live.bucket_fill < live.samples_per_bucket)
+        {
+            continue;
+        }
+        live.bucket_fill = 0;
+        if (++live.bucket == LIVE_BUCKETS)
+        {
+            finishSnapshot();
+        }
+        else
+        {
+            resetBucket(live.bucket);
+        }
+    }
+}
+
+void liveMonitorService()
+{
+    const unsigned long now = millis();
+    if (now - live_last_cleanup >= 1000)
+    {
+        live_last_cleanup = now;
+        live_socket.cleanupClients();
+        live_clients = live_socket.count();
+    }
+    if (!live_pending)
+    {
+        return;
+    }
+    live_pending = false;
+    if (live_clients == 0)
+    {
+        return;
+    }
+    // A slow browser just misses snapshots; it never queues up memory
+    if (!live_socket.availableForWriteAll())
+    {
+        ++live_dropped;
+        return;
+    }
+    live_socket.binaryAll(live_ready, sizeof(live_ready));
+}
+
+size_t liveMonitorClients()
+{
+    return live_clients;
+}
+
+uint32_t liveMonitorDropped()
+{
+    return live_dropped;
+}
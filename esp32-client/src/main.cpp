@@ -2,40 +2,92 @@
 
 // Core Arduino/ESP32 Libraries
 #include <Arduino.h>
-#include <driver/i2s.h>
 #include <WiFi.h>
 #include <esp_timer.h> // For high-resolution timer
+#include <new>             // Placement new for the extra spectral detectors
 
 // Networking & Web Libraries
 #include <ESPAsyncWebServer.h> // For the HTTP server part
 #include <WebSocketsClient.h>  // WebSocket Client
+#include <ArduinoJson.h>       // Text control messages on the WebSocket
 
 // Peripherals & Utilities
 #include <Adafruit_NeoPixel.h>
-#include <math.h> // For sqrtf in RMS calculation
 
 // Project-specific Headers
 #include "settings_manager.h" // Access to Settings.settings.xxx
 #include "settings_api.h"     // Access to setupWebEndpoints()
 #include "globals.h"          // Access/Definition of shared runtime globals
+#include "audio_capture.h"    // Capture task, capture ring and setupI2S()
+#include "audio_packet.h"     // AudioPacketHeader and the preallocated packet pool
+#include "frame_encoder.h"    // Preprocessing, decimation and codec for each frame
+#include "trigger.h"          // Pre-roll buffer and trigger hangover state machine
+#include "audio_codec.h"      // IMA-ADPCM encoder and wire codec ids
+#include "live_monitor.h"     // /live WebSocket snapshots for the settings page
+#include "spectral_detector.h" // FFT band-energy trigger
+#include "mel_features.h"     // Log-mel frames for the features output modes
+#include "power_manager.h"    // CPU scaling / modem sleep between detections
+#include "packet_spool.h"     // Store-and-forward while the WebSocket is down
+#include "reconnect_backoff.h" // Jittered exponential backoff for WiFi / WS retries
+#include "udp_transport.h"    // UDP / RTP datagrams for live audio
+#include "synthetic_source.h" // simulate_mic signal generator
+#include "metrics.h"          // Per-stage histograms for /metrics
+#include "time_sync.h"        // SNTP + time_ping offset for wall-clock capture times
+#include "flow_control.h"     // Receiver / send-queue driven pause, codec, decimation and batch limits
+#include "memory_policy.h"    // Hot / bulk placement of the large buffers
+#include "logging.h"          // LOG_INFO / LOG_WARN / LOG_ERROR / LOG_DEBUG
 
 // === PIN DEFINITIONS ===
-#define I2S_BCLK 4
-#define I2S_WS 5
-#define I2S_SD 8
-#define I2S_PORT I2S_NUM_0
 #define PIN_NEOPIXEL 48
 #define NUM_NEOPIXELS 1
 
 // === CONSTANTS ===
-#define I2S_READ_BUFFER_SIZE 2048                       // Size of the buffer for i2s_read in bytes
-#define MAX_SAMPLES_PER_READ (I2S_READ_BUFFER_SIZE / 4) // Max samples based on 32-bit I2S read
+#define NETWORK_TASK_CORE 0 // PRO CPU, alongside the WiFi/lwIP tasks
+#define NETWORK_TASK_PRIORITY 5
+#define NETWORK_TASK_STACK 8192
+
+// Connection manager (see connectionService())
+#define WIFI_CONNECT_TIMEOUT_MS 15000
+#define WIFI_BACKOFF_BASE_MS 1000
+#define WIFI_BACKOFF_CAP_MS 60000
+#define WS_CONNECT_TIMEOUT_MS 6000      // Covers WEBSOCKETS_TCP_TIMEOUT plus the HTTP upgrade
+#define WS_BACKOFF_BASE_MS 100
+#define WS_BACKOFF_CAP_MS 10000
+#define WS_BACKOFF_RESET_MS 10000       // Connection must last this long before the backoff starts over
+#define WS_FIRST_ATTEMPT_SPREAD_MS 2000 // First WS attempt after WiFi comes up lands randomly in this window
+#define WIFI_REJOIN_DELAY_MS 500        // After new credentials: lets the old association's events pass
 
 // === GLOBALS ===
 // --- Definitions for runtime state variables declared as 'extern' in globals.h ---
 float current_rms = 0.0f;
 int16_t current_peak = 0;
-bool transmitting = false; // Example: Set true when RMS exceeds threshold
+bool transmitting = false; // True while the trigger gate is active (including hangover)
+PreRollBuffer preroll;     // Untransmitted frames replayed when the trigger fires
+TriggerGate trigger_gate;  // RMS threshold + trigger_timeout_ms hangover
+CodecStats codec_stats;    // Encoder ratio/CPU telemetry for /status.json
+DetectorStats detector_stats; // Spectral trigger CPU telemetry for /status.json
+FeatureStats feature_stats;   // Log-mel output telemetry for /status.json
+SpectralDetector spectral_detector; // Band energy vs. adaptive noise floor (network task only)
+FrameEncoder frame_encoder;         // Gain / DC / high-pass, output_sample_rate decimator and codec state (network task only)
+Seqlock<StatusSnapshot> status_snapshot; // Published by the network task after every frame
+
+// Per-channel view of the last frame (network task only). Channel 0 uses
+// spectral_detector; the others get theirs the first time they are captured.
+static uint8_t current_channels = 1;
+static float channel_rms[AUDIO_MAX_CHANNELS] = {};
+static int16_t channel_peak[AUDIO_MAX_CHANNELS] = {};
+static uint8_t trigger_channels = 0;  // Bit c: channel c above the trigger
+static uint8_t spectral_channel = 0;  // Channel with the largest band margin, shown in /status.json
+static SpectralDetector *channel_detectors[AUDIO_MAX_CHANNELS] = {&spectral_detector};
+
+// Log-mel frames not yet sent (network task only)
+static MelFeatureExtractor mel_features;
+static uint8_t mel_frames[MEL_FRAMES_PER_PACKET][MEL_BANDS];
+static size_t mel_frame_count = 0;
+static uint64_t mel_first_us = 0; // FFT window start of mel_frames[0]
+static uint8_t mel_flags = 0;     // Trigger edges since the last feature packet
+
+static_assert(sizeof(MelPayloadHeader) + sizeof(mel_frames) <= MAX_PACKET_PAYLOAD_BYTES, "Feature packet does not fit a packet buffer");
 
 // --- Other necessary global objects and state variables ---
 AsyncWebServer server(80);                       // For HTTP settings API
@@ -44,51 +96,68 @@ bool wsConnected = false;                        // Flag for WebSocket connectio
 int16_t *latest_samples = nullptr;               // Buffer for status samples (size from Settings)
 size_t latest_sample_index = 0;                  // Index for status buffer
 size_t latest_sample_capacity = 0;               // Total number of samples allocated for status diagnostics
-static uint8_t i2s_buffer[I2S_READ_BUFFER_SIZE]; // Buffer for raw I2S data
-unsigned long lastReconnectAttempt = 0;          // Timer for WS reconnect attempts
 uint32_t packet_sequence = 0;                    // Sequence number for audio packets
+TaskHandle_t networkTaskHandle = nullptr;        // Drains the capture ring and owns wsClient
 Adafruit_NeoPixel pixels(NUM_NEOPIXELS, PIN_NEOPIXEL, NEO_GRB + NEO_KHZ800);
 
-// === STRUCTS & ENUMS ===
-struct AudioPacketHeader
-{
-    uint32_t sequence;     // Packet sequence number
-    uint64_t timestamp;    // Capture timestamp (microseconds from esp_timer)
-} __attribute__((packed)); // Prevent compiler padding
+static_assert(PACKET_HEADROOM == WEBSOCKETS_MAX_HEADER_SIZE, "Packet headroom must fit a WebSocket frame header");
 
-enum SystemState
-{
-    STATE_BOOTING,
-    STATE_WIFI_CONNECTING,
-    STATE_WIFI_CONNECTED, // WiFi connected, WS disconnected
-    STATE_WS_CONNECTING,  // Attempting WS connection
-    STATE_WS_CONNECTED    // WS connected
-};
+// === CONNECTION MANAGER STATE ===
+// Owned by the network task; only the WiFi event flags are written elsewhere
 SystemState systemState = STATE_BOOTING;
+static volatile bool wifi_up_event = false;   // Set by onWiFiEvent() (WiFi event task)
+static volatile bool wifi_down_event = false;
+static volatile uint8_t wifi_down_reason = 0; // wifi_err_reason_t of the last disconnect
+static ReconnectBackoff wifi_backoff(WIFI_BACKOFF_BASE_MS, WIFI_BACKOFF_CAP_MS);
+static ReconnectBackoff ws_backoff(WS_BACKOFF_BASE_MS, WS_BACKOFF_CAP_MS);
+static bool wifi_attempting = false;  // WiFi.begin() issued, no result yet
+static uint32_t attempt_deadline_ms = 0; // Running attempt gives up at this time
+static uint32_t retry_at_ms = 0;         // Next attempt once the backoff has passed
+static uint32_t ws_connected_at_ms = 0;
+static uint32_t wifi_attempts = 0;
+static uint32_t ws_attempts = 0;
+static String link_ssid;   // Credentials and server the running attempts use
+static String link_pass;
+static String link_server;
+static String link_port;
 
-// === LOGGING MACROS ===
-#define LOG_INFO(format, ...) Serial.printf("[INFO] " format "\n", ##__VA_ARGS__)
-#define LOG_WARN(format, ...) Serial.printf("[WARN] " format "\n", ##__VA_ARGS__)
-#define LOG_ERROR(format, ...) Serial.printf("[ERROR] " format "\n", ##__VA_ARGS__)
-#ifdef CORE_DEBUG_LEVEL
-#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_DEBUG
-#define LOG_DEBUG(format, ...) Serial.printf("[DEBUG] " format "\n", ##__VA_ARGS__)
-#else
-#define LOG_DEBUG(format, ...)
-#endif
-#else
-#define LOG_DEBUG(format, ...)
-#endif
+// === LIVE RECONFIGURATION STATE ===
+// Network task only (see applyCaptureConfig())
+static ReconfigStats reconfig_stats = {};
+static CaptureConfig reconfig_requested = {}; // Last configuration handed to the capture task
+static bool reconfig_in_flight = false;       // Requested, first frame of the new generation not seen yet
+static uint16_t reconfig_generation = 0;      // Generation the request will produce
+static uint64_t last_frame_end_us = 0;        // Capture time just past the last frame processed
+static CaptureFrame *preroll_storage = nullptr;
+static SendStats ws_send_stats = {};          // WebSocket audio sends for /metrics
 
 // === FUNCTION PROTOTYPES ===
-void setupI2S();
-bool connectToWiFi();
 // void setupWebEndpoints(); // Definition expected from settings_api.h/cpp
 void updateLed();
-void maintainConnections();
 void updateNeoPixelColor(uint32_t color);
-void attemptWebSocketConnect();
+void connectionBegin();
+void connectionService();
+void attemptWebSocketConnect(uint32_t now);
+static void setSystemState(SystemState state);
+static void scheduleWebSocketRetry(uint32_t now, const char *why);
+static void fillLinkStats(LinkStats &stats);
 void webSocketEvent(WStype_t type, uint8_t *payload, size_t length);
+void networkTask(void *param);
+void processFrame(CaptureFrame &frame);
+static void publishStatus(uint64_t timestamp);
+static void flushBatch();
+static void drainSpool();
+static void handleControlMessage(const uint8_t *payload, size_t length);
+static bool allocateStatusSamples(size_t samples);
+static bool allocatePreRoll(uint32_t sample_rate, uint8_t channels);
+static void applyStatusSampleCount();
+static void applyCaptureConfig();
+static void applySyntheticConfig();
+static bool acceptFrame(const CaptureFrame &frame);
+static void connectionApplySettings();
+#ifdef DSP_BENCHMARK
+void runDspBenchmark(); // src/dsp_benchmark.cpp
+#endif
 
 // === WebSocket Event Handler ===
 void webSocketEvent(WStype_t type, uint8_t *payload, size_t length)
@@ -99,20 +168,22 @@ void webSocketEvent(WStype_t type, uint8_t *payload, size_t length)
     case WStype_DISCONNECTED:
         LOG_WARN("WebSocket disconnected!");
         wsConnected = false;
-        if (systemState != STATE_WIFI_CONNECTING)
+        packet_batch.clear(); // Never replay a half-sent batch onto a new connection
+        flowDisconnected();
+        if (systemState == STATE_WS_CONNECTED || systemState == STATE_WS_CONNECTING)
         {
-            systemState = STATE_WIFI_CONNECTED;
+            scheduleWebSocketRetry(millis(), "closed");
         }
-        updateLed();
         break;
     case WStype_CONNECTED:
         LOG_INFO("WebSocket connected to: %s", (char *)payload);
         wsConnected = true;
-        systemState = STATE_WS_CONNECTED;
-        updateLed();
+        ws_connected_at_ms = millis();
+        setSystemState(STATE_WS_CONNECTED);
+        timeSyncConnected();
         break;
     case WStype_TEXT:
-        LOG_INFO("WebSocket received text: %s", (char *)payload);
+        handleControlMessage(payload, length);
         break;
     case WStype_BIN:
         LOG_INFO("WebSocket received %u bytes binary", length);
@@ -126,6 +197,50 @@ void webSocketEvent(WStype_t type, uint8_t *payload, size_t length)
     }
 }
 
+// === WebSocket Control Messages ===
+// JSON objects from the server, dispatched on their "type"
+static void handleControlMessage(const uint8_t *payload, size_t length)
+{
+    StaticJsonDocument<512> doc; // Room for a flow message with every field
+    const DeserializationError error = deserializeJson(doc, payload, length);
+    if (error)
+    {
+        LOG_WARN("Ignoring malformed control message (%u bytes): %s", length, error.c_str());
+        return;
+    }
+    const char *type = doc["type"] | "";
+    if (strcmp(type, "udp_stats") == 0)
+    {
+        udpTransportPeerReport(doc["received"] | 0u, doc["lost"] | 0u, doc["reordered"] | 0u, doc["late"] | 0u);
+    }
+    else if (strcmp(type, "time_pong") == 0)
+    {
+        timeSyncPong(doc["seq"] | 0u, doc["t0"].as<int64_t>(), doc["t1"].as<int64_t>(), doc["t2"].as<int64_t>());
+    }
+    else if (strcmp(type, "flow") == 0)
+    {
+        // A present-but-null field lifts that limit
+        FlowRequest request = {};
+        request.clear = doc["clear"] | false;
+        request.has_pause = doc.containsKey("pause");
+        request.pause = doc["pause"] | false;
+        request.has_codec = doc.containsKey("codec");
+        request.adpcm = strcmp(doc["codec"] | "", "ima_adpcm") == 0;
+        request.has_decimate = doc.containsKey("decimate");
+        request.decimate = (uint8_t)min(doc["decimate"] | 0u, 255u);
+        request.has_batch_bytes = doc.containsKey("batch_max_bytes");
+        request.batch_bytes = (uint16_t)min(doc["batch_max_bytes"] | 0u, 65535u);
+        request.has_batch_delay = doc.containsKey("batch_max_delay_ms");
+        request.batch_delay_ms = (uint16_t)min(doc["batch_max_delay_ms"] | 0u, 65535u);
+        request.ttl_ms = doc["ttl_ms"] | 0u;
+        flowRequest(request);
+    }
+    else
+    {
+        LOG_DEBUG("Unhandled control message type '%s'", type);
+    }
+}
+
 // === SETUP ===
 void setup()
 {
@@ -138,21 +253,48 @@ void setup()
 
     Settings.load(); // Load settings using the global SettingsManager instance
     LOG_INFO("Settings loaded.");
+    if (!Settings.startWriter())
+    {
+        LOG_WARN("Settings writer task not started; saving synchronously");
+    }
     // Log some key settings
     LOG_INFO(" > Sample Rate: %u Hz", Settings.settings.sample_rate);
+    LOG_INFO(" > Output Sample Rate: %u Hz", Settings.settings.output_sample_rate ? Settings.settings.output_sample_rate : Settings.settings.sample_rate);
     LOG_INFO(" > Status Sample Count: %u", Settings.settings.status_sample_count);
     LOG_INFO(" > WS Server: %s:%s", Settings.settings.ws_server.c_str(), Settings.settings.ws_port.c_str());
 
     // Allocate buffer for status samples based on loaded settings
-    latest_samples = (int16_t *)malloc(Settings.settings.status_sample_count * sizeof(int16_t));
-    if (!latest_samples)
+    if (!allocateStatusSamples(Settings.settings.status_sample_count))
     {
-        LOG_ERROR("FATAL: Failed to allocate latest_samples buffer! (%u bytes)", Settings.settings.status_sample_count * sizeof(int16_t));
+        LOG_ERROR("FATAL: Failed to allocate latest_samples buffer! (%u samples)", Settings.settings.status_sample_count);
         ESP.restart();
     }
-    latest_sample_capacity = Settings.settings.status_sample_count;
-    memset(latest_samples, 0, latest_sample_capacity * sizeof(int16_t));
-    LOG_INFO("Allocated status sample buffer (%u samples). Free Heap: %u", latest_sample_capacity, ESP.getFreeHeap());
+
+    const uint8_t boot_channels = captureConfigFor(Settings.settings).channels;
+    if (allocatePreRoll(Settings.settings.sample_rate, boot_channels))
+    {
+        preroll.setDepth(prerollFramesFor(Settings.settings.preroll_ms, Settings.settings.sample_rate, boot_channels));
+        LOG_INFO("Allocated pre-roll buffer (%u frames, using %u). Free Heap: %u", preroll.capacity(), preroll.depth(), ESP.getFreeHeap());
+    }
+    else
+    {
+        LOG_WARN("Failed to allocate pre-roll buffer; triggers will start without pre-roll.");
+    }
+
+    // Packet buffers for the send path, allocated once so sending never touches the heap
+    if (!packet_pool.begin(PACKET_POOL_SIZE, MAX_PACKET_PAYLOAD_BYTES, PACKET_POOL_MEMORY))
+    {
+        LOG_ERROR("FATAL: Failed to allocate packet pool!");
+        ESP.restart();
+    }
+    if (!packet_batch.begin(PACKET_BATCH_MAX_BYTES, PACKET_POOL_MEMORY))
+    {
+        LOG_WARN("Failed to allocate packet batch; every read will be sent on its own.");
+    }
+    if (Settings.settings.spool_enabled && !packet_spool.begin(SPOOL_RAM_BYTES, Settings.settings.spool_flash))
+    {
+        LOG_WARN("Failed to allocate packet spool; detections are dropped while the WebSocket is down.");
+    }
 
     pixels.begin();
     pixels.setBrightness(Settings.settings.led_brightness); // Use setting
@@ -160,17 +302,24 @@ void setup()
     pixels.show();
     updateLed(); // Show boot color
 
+    LOG_INFO("Sample kernel: %s", audioDspInit() ? "ESP32-S3 SIMD" : "scalar");
+    frame_encoder.setClock(esp_timer_get_time); // codec_encode_us in /status.json
+    if (!spectral_detector.begin(Settings.settings.sample_rate, Settings.settings.band_low_hz, Settings.settings.band_high_hz))
+    {
+        LOG_ERROR("FATAL: Failed to initialise the spectral detector FFT!");
+        ESP.restart();
+    }
+    LOG_INFO("Spectral detector: %u-point FFT (%s), band %.0f-%.0f Hz", SPECTRAL_FFT_SIZE,
+             SpectralDetector::usingEspDsp() ? "esp-dsp" : "portable", spectral_detector.bandLowHz(), spectral_detector.bandHighHz());
+#ifdef DSP_BENCHMARK
+    runDspBenchmark();
+#endif
+
+    applySyntheticConfig(); // Before setupI2S(): simulate_mic starts the generator instead of the driver
     setupI2S(); // Configure I2S peripheral using settings
     LOG_INFO("I2S setup complete.");
 
-    if (!connectToWiFi())
-    { // Use settings for connection
-        LOG_WARN("Initial WiFi connection failed, will retry in loop.");
-    }
-    else
-    {
-        LOG_INFO("WiFi connected.");
-    }
+    connectionBegin(); // Non-blocking; the network task brings WiFi and the WebSocket up
 
     setupWebEndpoints(); // Initialize HTTP server endpoints (defined externally)
     LOG_INFO("Web endpoints initialized.");
@@ -178,225 +327,948 @@ void setup()
     server.begin(); // Start HTTP server
     LOG_INFO("HTTP Server started.");
 
+    powerBegin(Settings.settings.power_mode); // Idle clock and radio until the first detection
+
     wsClient.onEvent(webSocketEvent); // Register WebSocket event handler
     // wsClient.setHeartbeatInterval(30000); // Optional: Enable pings
 
-    lastReconnectAttempt = millis() - 4500; // Trigger first WS attempt shortly
+    // Network task first so the capture task has someone to notify
+    if (xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, nullptr,
+                                NETWORK_TASK_PRIORITY, &networkTaskHandle, NETWORK_TASK_CORE) != pdPASS)
+    {
+        LOG_ERROR("FATAL: Failed to create network task!");
+        ESP.restart();
+    }
+    if (!startCaptureTask(networkTaskHandle))
+    {
+        LOG_ERROR("FATAL: Failed to start capture task!");
+        ESP.restart();
+    }
+    memoryLogSummary();
     LOG_INFO("Setup complete. Free Heap: %u bytes", ESP.getFreeHeap());
 }
 
 // === MAIN LOOP ===
 void loop()
 {
-    maintainConnections(); // Handles WiFi state and reconnects
-    wsClient.loop();       // Process WebSocket events
+    // All work runs in the capture and network tasks
+    vTaskDelete(NULL);
+}
+
+// === Network Task ===
+// Owns wsClient: services the connection, then drains whatever the capture
+// task has queued. Pinned away from the capture core so a blocking send only
+// ever delays this task, never the I2S reads.
+void networkTask(void *param)
+{
+    LOG_INFO("Network task running on core %d", xPortGetCoreID());
+
+    int64_t busy_start_us = esp_timer_get_time();
+    for (;;)
+    {
+        if (Settings.apply()) // Settings published by /control.json since the last pass
+        {
+            applyStatusSampleCount();
+            applySyntheticConfig();
+            connectionApplySettings();
+        }
+        applyCaptureConfig(); // Every pass: follows a reinstall through to its first frame
+        const int64_t service_start_us = esp_timer_get_time();
+        connectionService(); // WiFi / WS state machine; runs wsClient.loop() while it has a connection
+        metricsRecord(METRIC_STAGE_WS_LOOP, (uint32_t)(esp_timer_get_time() - service_start_us));
+        char ping[TIME_SYNC_PING_BYTES];
+        if (timeSyncService(millis(), wsConnected, ping, sizeof(ping)))
+        {
+            wsClient.sendTXT(ping);
+        }
+        udpTransportService(systemState >= STATE_WIFI_CONNECTED);
+        powerService();
+
+        // Sleep until the capture task commits a frame; the timeout keeps
+        // wsClient serviced while nothing is being captured.
+        powerAccountBusy((uint32_t)(esp_timer_get_time() - busy_start_us));
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+        busy_start_us = esp_timer_get_time();
+
+        CaptureFrame *frame;
+        size_t ring_peak = 0; // Send-queue depth for flow control
+        while ((frame = capture_ring.readSlot()) != nullptr)
+        {
+            ring_peak = max(ring_peak, capture_ring.size());
+            const int64_t frame_start_us = esp_timer_get_time();
+            const int64_t read_done_us = (int64_t)(frame->timestamp + captureFrameDurationUs(*frame));
+            metricsRecord(METRIC_STAGE_QUEUE_DELAY, (uint32_t)(frame_start_us - read_done_us));
+            if (acceptFrame(*frame))
+            {
+                processFrame(*frame);
+                metricsRecord(METRIC_STAGE_FRAME, (uint32_t)(esp_timer_get_time() - frame_start_us));
+            }
+            publishStatus(frame->timestamp);
+            capture_ring.releaseRead();
+        }
+        char flow_state[FLOW_STATE_BYTES];
+        if (flowService(millis(), ring_peak, capture_ring.capacity(), wsConnected, flow_state, sizeof(flow_state)))
+        {
+            wsClient.sendTXT(flow_state);
+        }
+
+        liveMonitorService();
+
+        // Latency bound for a partly filled batch
+        if (packet_batch.due(millis(), flowBatchDelay(Settings.settings.batch_max_delay_ms)))
+        {
+            flushBatch();
+        }
+
+        packet_spool.service(Settings.settings.spool_flash);
+        drainSpool();
+    }
+}
 
-    // Attempt WebSocket connection if WiFi is up but WS is down
-    if (WiFi.status() == WL_CONNECTED && !wsConnected && millis() - lastReconnectAttempt > 5000)
+// === Status Sample Buffer ===
+// (Re)allocates the rolling diagnostics buffer; on failure the old one stays
+static bool allocateStatusSamples(size_t samples)
+{
+    samples = min(samples, (size_t)STATUS_SAMPLES_MAX);
+    const size_t bytes = max(samples, (size_t)1) * sizeof(int16_t);
+    int16_t *buffer = (int16_t *)memoryAlloc(MEMORY_BULK, bytes, "status samples");
+    if (!buffer)
     {
-        attemptWebSocketConnect();
-        lastReconnectAttempt = millis();
+        return false;
     }
+    memset(buffer, 0, bytes);
+    memoryFree(latest_samples);
+    latest_samples = buffer;
+    latest_sample_capacity = samples;
+    latest_sample_index = 0;
+    LOG_INFO("Allocated status sample buffer (%u samples). Free Heap: %u", latest_sample_capacity, ESP.getFreeHeap());
+    return true;
+}
 
-    // --- I2S Read ---
-    size_t buffer_size = sizeof(i2s_buffer);
-    size_t bytes_read = 0;
-    esp_err_t i2s_result = i2s_read(I2S_PORT, &i2s_buffer, buffer_size, &bytes_read, pdMS_TO_TICKS(10)); // Use 10ms timeout
+static void applyStatusSampleCount()
+{
+    const size_t wanted = min((size_t)Settings.settings.status_sample_count, (size_t)STATUS_SAMPLES_MAX);
+    if (wanted != latest_sample_capacity && !allocateStatusSamples(wanted))
+    {
+        LOG_WARN("Failed to resize the status sample buffer to %u samples; keeping %u", wanted, latest_sample_capacity);
+    }
+}
 
-    if (i2s_result == ESP_ERR_TIMEOUT)
+// Copies the first samples of a frame into the rolling diagnostics buffer in
+// at most two contiguous runs (no per-sample modulo).
+static void updateStatusSamples(const int32_t *raw, size_t num_samples)
+{
+    const size_t status_capacity = latest_sample_capacity;
+    if (latest_samples == nullptr || status_capacity == 0)
     {
-        // This is expected if no data arrives for 10ms
-        delay(1); // Yield briefly
         return;
     }
-    if (i2s_result != ESP_OK)
+
+    size_t remaining = min(status_capacity, num_samples);
+    size_t index = latest_sample_index;
+    while (remaining > 0)
+    {
+        const size_t run = min(remaining, status_capacity - index);
+        for (size_t i = 0; i < run; ++i)
+        {
+            latest_samples[index + i] = rawToSample16(raw[i]);
+        }
+        raw += run;
+        remaining -= run;
+        index = (index + run) % status_capacity;
+    }
+    latest_sample_index = index;
+}
+
+// === Pre-roll Storage ===
+// Sized for PREROLL_MAX_MS at `sample_rate` x `channels`, in PSRAM when
+// available; internal RAM only gets a short fallback. Storage that is
+// already large enough is kept, and on failure the current buffer stays in use.
+static bool allocatePreRoll(uint32_t sample_rate, uint8_t channels)
+{
+    size_t frames = prerollFramesFor(PREROLL_MAX_MS, sample_rate, channels);
+    if (preroll_storage && preroll.capacity() >= frames)
+    {
+        return true;
+    }
+    CaptureFrame *storage = (CaptureFrame *)memoryAlloc(MEMORY_PSRAM_ONLY, frames * sizeof(CaptureFrame), "pre-roll",
+                                                        alignof(CaptureFrame));
+    if (!storage)
+    {
+        frames = min(frames, (size_t)PREROLL_INTERNAL_MAX_FRAMES);
+        if (preroll_storage && preroll.capacity() >= frames)
+        {
+            return true;
+        }
+        storage = (CaptureFrame *)memoryAlloc(MEMORY_BULK, frames * sizeof(CaptureFrame), "pre-roll", alignof(CaptureFrame));
+    }
+    if (!storage)
+    {
+        return false;
+    }
+    preroll.begin(storage, frames);
+    memoryFree(preroll_storage);
+    preroll_storage = storage;
+    return true;
+}
+
+// === Live Reconfiguration ===
+// sample_rate and the DMA / APLL settings are applied by reinstalling the
+// I2S driver from the capture task (audio_capture.h); everything downstream
+// that depends on the rate (pre-roll, decimator, preprocessor, spectral
+// detector, live monitor) follows Settings.settings on the next frame.
+// Frames still queued at the old rate are dropped, and the audio lost until
+// the first frame of the new driver generation is reported as downtime.
+static void applyCaptureConfig()
+{
+    if (captureReconfigurePending())
     {
-        LOG_WARN("I2S read failed! Error: %d", i2s_result);
-        delay(10);
         return;
     }
-    if (bytes_read == 0)
+    const CaptureConfig active = activeCaptureConfig();
+    const CaptureConfig wanted = captureConfigFor(Settings.settings);
+    if (wanted == active)
     {
-        delay(1);
         return;
     }
-    if (bytes_read % 4 != 0)
+    if (reconfig_in_flight && wanted == reconfig_requested)
     {
-        LOG_WARN("I2S read returned non-integral number of samples! (%u bytes)", bytes_read);
+        // The capture task restored the old driver: put the settings back so
+        // the rest of the pipeline matches what is actually captured
+        reconfig_in_flight = false;
+        reconfig_stats.failures++;
+        LOG_ERROR("I2S rejected %u Hz, %u x %u%s; reverting to %u Hz, %u x %u%s", wanted.sample_rate, wanted.dma_buf_count,
+                  wanted.dma_buf_len, wanted.use_apll ? " (APLL)" : "", active.sample_rate, active.dma_buf_count,
+                  active.dma_buf_len, active.use_apll ? " (APLL)" : "");
+        AudioSettings reverted = Settings.snapshot();
+        reverted.sample_rate = active.sample_rate;
+        reverted.dma_buf_count = active.dma_buf_count;
+        reverted.dma_buf_len = active.dma_buf_len;
+        reverted.use_apll = active.use_apll;
+        reverted.channels = active.channels;
+        Settings.publish(reverted);
         return;
     }
+    reconfig_generation = captureGeneration() + 1;
+    if (requestCaptureReconfigure(wanted))
+    {
+        reconfig_requested = wanted;
+        reconfig_in_flight = true;
+    }
+}
 
-    // --- Sample Processing & State Update ---
-    uint32_t *samples_32bit_raw = reinterpret_cast<uint32_t *>(i2s_buffer);
-    size_t num_samples = bytes_read / 4;
+// Signal, level and duty cycle reach the generator without a reinstall;
+// switching simulate_mic itself goes through applyCaptureConfig()
+static void applySyntheticConfig()
+{
+    synthetic_source.configure(syntheticConfigFor(Settings.settings));
+    if (Settings.settings.simulate_mic && Settings.settings.sim_signal == SIM_SIGNAL_CLIP)
+    {
+        synthetic_source.requestClip();
+    }
+}
 
-    if (num_samples > MAX_SAMPLES_PER_READ)
-    { // Sanity check
-        LOG_WARN("I2S samples (%u) > MAX_SAMPLES_PER_READ (%d)!", num_samples, MAX_SAMPLES_PER_READ);
-        num_samples = MAX_SAMPLES_PER_READ;
+// Drops frames captured at a rate the pipeline is no longer configured for,
+// and closes the downtime measurement on the first frame of a new generation
+static bool acceptFrame(const CaptureFrame &frame)
+{
+    if (frame.sample_rate != Settings.settings.sample_rate)
+    {
+        reconfig_stats.stale_frames++;
+        return false;
+    }
+    if (reconfig_in_flight && frame.generation == reconfig_generation)
+    {
+        reconfig_in_flight = false;
+        const uint32_t downtime_us = last_frame_end_us && frame.timestamp > last_frame_end_us
+                                         ? (uint32_t)(frame.timestamp - last_frame_end_us)
+                                         : 0;
+        reconfig_stats.count++;
+        reconfig_stats.last_downtime_us = downtime_us;
+        reconfig_stats.max_downtime_us = max(reconfig_stats.max_downtime_us, downtime_us);
+        LOG_INFO("I2S reconfigured live: %.1f ms of audio lost (driver reinstall %.1f ms)", downtime_us / 1000.0f,
+                 capture_stats.reinstall_us / 1000.0f);
     }
+    last_frame_end_us = frame.timestamp + captureFrameDurationUs(frame);
+    return true;
+}
 
-    const size_t status_capacity = latest_sample_capacity;
-    size_t samples_to_process_for_status = 0;
-    if (latest_samples != nullptr && status_capacity > 0)
+// === Status Snapshot ===
+// Publishes the state other tasks may look at. Writing never waits on a
+// reader; a reader that races this retries on its side of the seqlock.
+static void publishStatus(uint64_t timestamp)
+{
+    StatusSnapshot &snapshot = status_snapshot.beginWrite();
+    snapshot.frames++;
+    snapshot.timestamp = timestamp;
+    snapshot.rms = current_rms;
+    snapshot.peak = current_peak;
+    snapshot.channels = current_channels;
+    memcpy(snapshot.channel_rms, channel_rms, sizeof(channel_rms));
+    memcpy(snapshot.channel_peak, channel_peak, sizeof(channel_peak));
+    snapshot.trigger_channels = trigger_channels;
+    snapshot.triggered = transmitting;
+    snapshot.trigger_state = trigger_gate.current();
+    snapshot.preroll_frames = (uint16_t)preroll.size();
+    snapshot.preroll_depth = (uint16_t)preroll.depth();
+    snapshot.preroll_capacity = (uint16_t)preroll.capacity();
+    const SpectralDetector *shown = channel_detectors[spectral_channel] ? channel_detectors[spectral_channel] : &spectral_detector;
+    snapshot.band_db = shown->bandDb();
+    snapshot.floor_db = shown->floorDb();
+    powerFillStats(snapshot.power);
+    packet_spool.fillStats(snapshot.spool);
+    fillLinkStats(snapshot.link);
+    udpTransportFillStats(snapshot.udp);
+    snapshot.reconfig = reconfig_stats;
+    snapshot.ws_send = ws_send_stats;
+    snapshot.capture = capture_stats;
+    snapshot.codec = codec_stats;
+    snapshot.detector = detector_stats;
+    snapshot.features = feature_stats;
+    flowFillStats(snapshot.flow);
+    timeSyncFillStats(snapshot.time_sync);
+
+    // Unroll the diagnostics ring oldest-first
+    const size_t capacity = latest_samples ? latest_sample_capacity : 0;
+    if (capacity > 0)
+    {
+        const size_t oldest_run = capacity - latest_sample_index;
+        memcpy(snapshot.samples, latest_samples + latest_sample_index, oldest_run * sizeof(int16_t));
+        memcpy(snapshot.samples + oldest_run, latest_samples, latest_sample_index * sizeof(int16_t));
+    }
+    snapshot.sample_count = (uint16_t)capacity;
+    status_snapshot.endWrite();
+}
+
+// === Payload Encoding ===
+// Folds an ADPCM encode into the /status.json codec telemetry
+static void recordCodecStats(const EncodedPayload &encoded)
+{
+    if (encoded.codec != AUDIO_CODEC_IMA_ADPCM || encoded.bytes == 0)
     {
-        samples_to_process_for_status = min(status_capacity, num_samples);
+        return; // PCM, or only statistics were gathered
     }
-    double sum_sq = 0.0;           // For RMS calculation
-    int16_t peak_val = 0;          // For peak calculation
-    int16_t current_sample_16 = 0; // Temp variable for current sample
+    codec_stats.frames++;
+    codec_stats.ratio += 0.05f * ((float)(encoded.samples * 2) / encoded.bytes - codec_stats.ratio);
+    codec_stats.encode_us += 0.05f * ((float)encoded.encode_us - codec_stats.encode_us);
+    codec_stats.encode_us_max = max(codec_stats.encode_us_max, encoded.encode_us);
+}
+
+// Frames that already went through the preprocessor (pre-roll, re-sends)
+static size_t encodePayload(const CaptureFrame &frame, uint8_t *payload, FrameStats &stats, EncodedPayload &encoded)
+{
+    frame_encoder.setFormat(Settings.settings.sample_rate, Settings.settings.output_bits, flowCodec(Settings.settings.codec),
+                            frame.channels);
+    const size_t num_samples = min((size_t)frame.sample_count, (size_t)MAX_SAMPLES_PER_READ);
+    const int32_t *raw = frame.samples;
+    const size_t bytes = frame_encoder.encode(raw, num_samples, payload, stats, encoded);
+    recordCodecStats(encoded);
+    return bytes;
+}
 
-    // Process samples for status buffer, RMS, and Peak
-    for (size_t i = 0; i < num_samples; ++i)
+// A fresh frame: gain/DC/high-pass run in the conversion pass and the
+// conditioned samples replace raw[] for everything downstream. `channels`
+// words per frame are interleaved in raw[].
+static size_t conditionAndEncode(int32_t *raw, size_t num_samples, uint8_t channels, uint8_t *payload, FrameStats &stats,
+                                 EncodedPayload &encoded)
+{
+    static float applied_gain = -1.0f;
+    static bool applied_dc_block = false;
+    static uint16_t applied_highpass_hz = 0;
+    static uint32_t applied_sample_rate = 0;
+    frame_encoder.setFormat(Settings.settings.sample_rate, Settings.settings.output_bits, flowCodec(Settings.settings.codec),
+                            channels);
+    if (applied_gain != Settings.settings.gain || applied_dc_block != Settings.settings.dc_block ||
+        applied_highpass_hz != Settings.settings.highpass_hz || applied_sample_rate != Settings.settings.sample_rate)
     {
-        int32_t sample_32 = (int32_t)(samples_32bit_raw[i]) >> 8; // Apply initial shift based on mic data format
-        current_sample_16 = (int16_t)(sample_32 >> 8);            // Get final 16-bit value
+        applied_gain = Settings.settings.gain;
+        applied_dc_block = Settings.settings.dc_block;
+        applied_highpass_hz = Settings.settings.highpass_hz;
+        applied_sample_rate = Settings.settings.sample_rate;
+        frame_encoder.configurePreprocessor(applied_gain, applied_dc_block, applied_highpass_hz);
+    }
+
+    const size_t bytes = frame_encoder.conditionAndEncode(raw, num_samples, payload, stats, encoded);
+    recordCodecStats(encoded);
+    return bytes;
+}
 
-        // Store in status buffer (only up to its limit)
-        if (samples_to_process_for_status > 0 && i < samples_to_process_for_status)
+// Picks up sample_rate / output_sample_rate changes from /control.json and
+// any further decimation flow control asks for
+static void applyOutputSampleRate()
+{
+    static uint32_t applied_sample_rate = 0;
+    static uint32_t applied_output_rate = UINT32_MAX;
+    static uint8_t configured_factor = 1;
+    static uint8_t applied_factor = 0;
+    if (applied_sample_rate != Settings.settings.sample_rate || applied_output_rate != Settings.settings.output_sample_rate)
+    {
+        applied_sample_rate = Settings.settings.sample_rate;
+        applied_output_rate = Settings.settings.output_sample_rate;
+        configured_factor = decimationFactorFor(applied_sample_rate, applied_output_rate);
+        if (configured_factor == 0)
         {
-            const size_t slot = (latest_sample_index + i) % status_capacity;
-            latest_samples[slot] = current_sample_16;
+            LOG_WARN("Output rate %u Hz is not %u Hz / 1..%u, sending at the mic rate", applied_output_rate,
+                     applied_sample_rate, DECIMATOR_MAX_FACTOR);
+            configured_factor = 1;
         }
+        applied_factor = 0; // Rebuild for the new rate even if the factor stays
+    }
 
-        // Update Peak (absolute value)
-        int16_t abs_sample = abs(current_sample_16);
-        if (abs_sample > peak_val)
+    const uint8_t factor = flowDecimation(configured_factor, applied_sample_rate);
+    if (factor == applied_factor)
+    {
+        return;
+    }
+    applied_factor = factor;
+    frame_encoder.setDecimation(factor);
+    LOG_INFO("Output sample rate: %u Hz (decimation %ux, %u taps%s)", applied_sample_rate / factor, factor,
+             frame_encoder.decimatorTaps(), factor != configured_factor ? ", flow control" : "");
+}
+
+// === Spectral Trigger ===
+// The FFT detector of one channel: allocated the first time the channel is
+// captured, restarted whenever the channel count changes so a channel that
+// comes back does not resume a stale noise floor. Also picks up rate and
+// band changes from /control.json. nullptr if there is no memory for it.
+static SpectralDetector *channelDetector(uint8_t channel, bool restart)
+{
+    static float applied_low_hz[AUDIO_MAX_CHANNELS];
+    static float applied_high_hz[AUDIO_MAX_CHANNELS];
+    SpectralDetector *&detector = channel_detectors[channel];
+    if (!detector)
+    {
+        void *storage = memoryAlloc(MEMORY_HOT, sizeof(SpectralDetector), "spectral detector", alignof(SpectralDetector));
+        if (!storage)
         {
-            peak_val = abs_sample;
+            return nullptr;
         }
+        detector = new (storage) SpectralDetector();
+        restart = true;
+        LOG_INFO("Spectral detector for channel %u allocated (%u bytes). Free Heap: %u", channel, sizeof(SpectralDetector),
+                 ESP.getFreeHeap());
+    }
+    if (restart || detector->sampleRate() != Settings.settings.sample_rate)
+    {
+        detector->begin(Settings.settings.sample_rate, Settings.settings.band_low_hz, Settings.settings.band_high_hz);
+        applied_low_hz[channel] = Settings.settings.band_low_hz;
+        applied_high_hz[channel] = Settings.settings.band_high_hz;
+    }
+    else if (applied_low_hz[channel] != Settings.settings.band_low_hz || applied_high_hz[channel] != Settings.settings.band_high_hz)
+    {
+        applied_low_hz[channel] = Settings.settings.band_low_hz;
+        applied_high_hz[channel] = Settings.settings.band_high_hz;
+        detector->setBand(applied_low_hz[channel], applied_high_hz[channel]);
+    }
+    return detector;
+}
 
-        // Accumulate sum of squares for RMS (use float to avoid overflow)
-        sum_sq += (double)current_sample_16 * (double)current_sample_16;
+// Feeds every channel's plane to its detector and returns a bit per channel
+// whose band is above its own noise floor. The cost grows with the channel
+// count; spectral_us in /status.json is for all channels together.
+static uint8_t spectralTriggerChannels(uint8_t channels, size_t frames)
+{
+    static uint8_t applied_channels = 0;
+    const bool restart = channels != applied_channels;
+    applied_channels = channels;
+
+    uint8_t above = 0;
+    float best_margin = -1e9f;
+    size_t analyses = 0;
+    const int64_t start_us = esp_timer_get_time();
+    for (uint8_t c = 0; c < channels; ++c)
+    {
+        SpectralDetector *detector = channelDetector(c, restart);
+        if (!detector)
+        {
+            if (restart)
+            {
+                LOG_WARN("No memory for a spectral detector on channel %u; it is left out of the trigger", c);
+            }
+            continue;
+        }
+        analyses += detector->process(frame_encoder.plane(c), frames);
+        if (detector->above(Settings.settings.spectral_threshold_db))
+        {
+            above |= 1 << c;
+        }
+        const float margin = detector->bandDb() - detector->floorDb();
+        if (margin > best_margin)
+        {
+            best_margin = margin;
+            spectral_channel = c;
+        }
     }
-    if (samples_to_process_for_status > 0)
+    const uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    detector_stats.analyses += analyses;
+    detector_stats.analyse_us += 0.05f * ((float)elapsed_us - detector_stats.analyse_us);
+    detector_stats.analyse_us_max = max(detector_stats.analyse_us_max, elapsed_us);
+    return above;
+}
+
+// RMS mode: a bit per channel above trigger_rms_threshold
+static uint8_t rmsTriggerChannels(uint8_t channels)
+{
+    uint8_t above = 0;
+    for (uint8_t c = 0; c < channels; ++c)
     {
-        latest_sample_index = (latest_sample_index + samples_to_process_for_status) % status_capacity; // Update index after loop
+        if (channel_rms[c] > Settings.settings.trigger_rms_threshold)
+        {
+            above |= 1 << c;
+        }
     }
+    return above;
+}
 
-    // --- Update Global Runtime State Variables ---
-    current_peak = peak_val;
-    if (num_samples > 0)
+// === Packet Sending ===
+// Live audio goes over the WebSocket or, with a datagram transport, over UDP
+static bool audioLinkUp()
+{
+    if (flowPaused())
     {
-        current_rms = sqrtf(sum_sq / num_samples) / 32768.0f; // Calculate RMS and normalize to approx -1.0 to 1.0 range
+        return false; // Receiver asked for a pause: spool instead
     }
-    else
+    return Settings.settings.transport == TRANSPORT_WS ? wsConnected : udpTransportReady();
+}
+
+// True when a finished packet has somewhere to go: the live link or the spool
+static bool canSend()
+{
+    return audioLinkUp() || (Settings.settings.spool_enabled && packet_spool.enabled());
+}
+
+// One timed WebSocket message of `packets` audio packets. `frame` starts
+// PACKET_HEADROOM bytes before the data, where sendBIN() puts its header.
+static bool wsSend(uint8_t *frame, size_t length, size_t packets)
+{
+    const int64_t start_us = esp_timer_get_time();
+    const bool sent = wsClient.sendBIN(frame, length, true);
+    metricsRecord(METRIC_STAGE_SEND, (uint32_t)(esp_timer_get_time() - start_us));
+    if (!sent)
     {
-        current_rms = 0.0f;
+        ws_send_stats.failures++;
+        return false;
     }
+    ws_send_stats.packets += packets;
+    ws_send_stats.bytes += length;
+    return true;
+}
 
-    // Example logic for 'transmitting' state (adjust as needed)
-    transmitting = (current_rms > Settings.settings.trigger_rms_threshold); // Set based on RMS threshold
+// Stamps and sends a packet whose payload is already filled, then returns it to the pool.
+// While the audio link is down the packet goes to the spool instead.
+static void sendPacket(PacketBuffer *packet, uint64_t timestamp, const EncodedPayload &encoded, uint8_t flags)
+{
+    const bool spooling = !audioLinkUp();
+    if (spooling)
+    {
+        flags |= PACKET_FLAG_SPOOLED;
+    }
+    const AudioCodecId codec = encoded.codec;
+    // Timestamp is the capture time of the payload's first sample, also mapped
+    // onto the receiver's clock; rate and count describe the payload
+    finalizePacket(packet, packet_sequence++, timestamp, timeSyncWallClock(timestamp),
+                   encoded.sample_rate, encoded.samples, encoded.channels, codec, flags, encoded.bytes);
 
-    // --- Data Sending ---
-    if (wsConnected && transmitting)
-    { // Send only if connected AND transmitting flag is set
-        AudioPacketHeader header;
-        header.sequence = packet_sequence++;
-        header.timestamp = esp_timer_get_time(); // Microsecond timestamp
-
-        uint8_t *audio_payload_ptr = nullptr;
-        size_t audio_payload_size = 0;
-        bool buffer_allocated = false;
-
-        // --- Prepare Payload Buffer ---
-        if (Settings.settings.output_bits == 16)
-        {
-            audio_payload_size = num_samples * 2;
-            audio_payload_ptr = (uint8_t *)malloc(audio_payload_size);
-            if (audio_payload_ptr)
-            {
-                buffer_allocated = true;
-                int16_t *send_buffer_16bit = reinterpret_cast<int16_t *>(audio_payload_ptr);
-                for (size_t i = 0; i < num_samples; ++i)
-                {
-                    int32_t sample_32 = (int32_t)(samples_32bit_raw[i]) >> 8;
-                    send_buffer_16bit[i] = (int16_t)(sample_32 >> 8);
-                }
-            }
+    if (spooling)
+    {
+        if (!packet_spool.push(packet->packet(), packet->length))
+        {
+            LOG_WARN("Spool rejected Seq=%u (Size: %u)", packet->header()->sequence, packet->length);
         }
-        else if (Settings.settings.output_bits == 24)
+        packet_pool.release(packet);
+        return;
+    }
+    if (Settings.settings.transport != TRANSPORT_WS)
+    {
+        flushBatch(); // Anything batched before a transport switch goes first
+        const int64_t start_us = esp_timer_get_time();
+        const bool sent = udpTransportSend(packet);
+        metricsRecord(METRIC_STAGE_SEND, (uint32_t)(esp_timer_get_time() - start_us));
+        if (!sent)
         {
-            audio_payload_size = num_samples * 3;
-            audio_payload_ptr = (uint8_t *)malloc(audio_payload_size);
-            if (audio_payload_ptr)
-            {
-                buffer_allocated = true;
-                for (size_t i = 0; i < num_samples; ++i)
-                {
-                    int32_t sample_32 = (int32_t)(samples_32bit_raw[i]) >> 8;
-                    audio_payload_ptr[i * 3 + 0] = (uint8_t)(sample_32 & 0xFF);
-                    audio_payload_ptr[i * 3 + 1] = (uint8_t)((sample_32 >> 8) & 0xFF);
-                    audio_payload_ptr[i * 3 + 2] = (uint8_t)((sample_32 >> 16) & 0xFF);
-                }
-            }
+            LOG_DEBUG("UDP send dropped Seq=%u (Size: %u)", packet->header()->sequence, packet->length);
         }
-        // --- End Prepare Payload ---
+        packet_pool.release(packet);
+        return;
+    }
 
-        if (!buffer_allocated)
+    // Coalesce into the current batch when batching is on and the packet fits at all
+    const size_t batch_limit = flowBatchBytes(Settings.settings.batch_max_bytes);
+    if (packet_batch.capacity() > 0 && packet->length <= min(batch_limit, packet_batch.capacity()))
+    {
+        if (!packet_batch.fits(packet->length, batch_limit))
         {
-            LOG_ERROR("Failed to allocate memory for audio payload (%u bytes), skipping send", audio_payload_size);
+            flushBatch();
+        }
+        const size_t packet_bytes = packet->length;
+        packet_batch.append(packet, millis());
+        LOG_DEBUG("Batched Seq=%u, Codec=%s, Flags=0x%02x (%u packets, %u bytes)", packet->header()->sequence,
+                  codecName(codec), flags, packet_batch.packets(), packet_batch.length());
+        packet_pool.release(packet);
+        if ((flags & PACKET_FLAG_TRIGGER_END) || !packet_batch.fits(packet_bytes, batch_limit))
+        {
+            flushBatch(); // Detection closed, or the next packet of this size would not fit
+        }
+        return;
+    }
+
+    flushBatch(); // Keep ordering if something is still queued
+    // Frame header goes into the reserved headroom
+    if (!wsSend(packet->wsFrame(), packet->length, 1))
+    {
+        LOG_WARN("wsClient.sendBIN failed! (Size: %u)", packet->length);
+    }
+    else
+    {
+        LOG_DEBUG("Sent WS BIN: Seq=%u, TS=%llu, Codec=%s, Flags=0x%02x, Size=%u", packet->header()->sequence,
+                  timestamp, codecName(codec), packet->header()->flags, packet->length);
+    }
+    packet_pool.release(packet);
+}
+
+static void sendAudioPacket(PacketBuffer *packet, const CaptureFrame &frame, const EncodedPayload &encoded, uint8_t flags)
+{
+    if (frame.after_overrun)
+    {
+        flags |= PACKET_FLAG_OVERRUN;
+    }
+    sendPacket(packet, frame.timestamp, encoded, flags);
+}
+
+// === Feature Output ===
+// Sends the collected log-mel frames as one AUDIO_CODEC_LOG_MEL packet
+static void sendFeaturePacket()
+{
+    const size_t count = mel_frame_count;
+    mel_frame_count = 0;
+    if (count == 0)
+    {
+        return;
+    }
+    PacketBuffer *packet = canSend() ? packet_pool.acquire() : nullptr;
+    if (!packet)
+    {
+        feature_stats.dropped += count;
+        return;
+    }
+    MelPayloadHeader header;
+    mel_features.fillHeader(header);
+    memcpy(packet->payload(), &header, sizeof(header));
+    memcpy(packet->payload() + sizeof(header), mel_frames, count * MEL_BANDS);
+
+    EncodedPayload encoded;
+    encoded.codec = AUDIO_CODEC_LOG_MEL;
+    encoded.sample_rate = mel_features.filterbank()->sample_rate;
+    encoded.samples = (uint16_t)count;
+    encoded.bytes = sizeof(header) + count * MEL_BANDS;
+    const uint8_t flags = mel_flags;
+    mel_flags = 0;
+    feature_stats.packets++;
+    feature_stats.bytes += sizeof(AudioPacketHeader) + encoded.bytes;
+    sendPacket(packet, mel_first_us, encoded, flags);
+}
+
+// One log-mel frame per analysis of channel 0's detector, sent
+// MEL_FRAMES_PER_PACKET at a time. The spectral trigger already runs that
+// detector; with the RMS trigger it is fed here. The hop is a whole number
+// of capture frames, so an analysis completes with the frame that fed it:
+// its window ends with that frame's last sample (the frame's first-sample
+// stamp plus its duration) and started SPECTRAL_FFT_SIZE samples earlier.
+static void featureFeed(const CaptureFrame &frame, size_t frames, TriggerEvent event)
+{
+    static uint32_t applied_rate = 0;
+    static uint32_t seen_analyses = 0;
+    if (Settings.settings.output_mode == OUTPUT_MODE_AUDIO)
+    {
+        mel_frame_count = 0;
+        mel_flags = 0;
+        applied_rate = 0; // Picked up again when a features mode comes back
+        return;
+    }
+    if (applied_rate != Settings.settings.sample_rate)
+    {
+        applied_rate = Settings.settings.sample_rate;
+        mel_frame_count = 0;
+        if (mel_features.begin(applied_rate))
+        {
+            LOG_INFO("Log-mel features: %u bands %u-%u Hz, %u frames per packet", MEL_BANDS,
+                     mel_features.filterbank()->low_hz, mel_features.filterbank()->high_hz, MEL_FRAMES_PER_PACKET);
         }
         else
         {
-            // --- Prepare Combined Buffer (Header + Payload) ---
-            size_t header_size = sizeof(AudioPacketHeader);
-            size_t total_size = header_size + audio_payload_size;
-            uint8_t *combined_buffer = (uint8_t *)malloc(total_size);
+            LOG_WARN("No log-mel filterbank for %lu Hz; features mode sends no frames", (unsigned long)applied_rate);
+        }
+    }
+    if (!mel_features.ready())
+    {
+        return;
+    }
+    if (event == TRIGGER_EVENT_START)
+    {
+        mel_flags |= PACKET_FLAG_TRIGGER_START;
+    }
+    else if (event == TRIGGER_EVENT_END)
+    {
+        mel_flags |= PACKET_FLAG_TRIGGER_END;
+    }
 
-            if (!combined_buffer)
-            {
-                LOG_ERROR("Failed to allocate memory for combined send buffer (%u bytes)", total_size);
-                free(audio_payload_ptr); // Free payload buffer if combined fails
-            }
-            else
-            {
-                memcpy(combined_buffer, &header, header_size);
-                memcpy(combined_buffer + header_size, audio_payload_ptr, audio_payload_size);
-
-                // --- Send Combined Buffer ---
-                if (!wsClient.sendBIN(combined_buffer, total_size))
-                {
-                    LOG_WARN("wsClient.sendBIN failed! (Size: %u)", total_size);
-                }
-                else
-                {
-                    LOG_DEBUG("Sent WS BIN: Seq=%u, TS=%llu, Samples=%u, Size=%u", header.sequence, header.timestamp, num_samples, total_size);
-                }
-                free(combined_buffer); // Free combined buffer
-            }
-            free(audio_payload_ptr); // Free payload buffer
-        } // End if(buffer_allocated)
-    } // end if(wsConnected && transmitting)
+    SpectralDetector *detector = channelDetector(0, false); // spectral_detector: never nullptr
+    const int64_t start_us = esp_timer_get_time();
+    if (Settings.settings.trigger_mode != TRIGGER_MODE_SPECTRAL)
+    {
+        detector->process(frame_encoder.plane(0), frames);
+    }
+    if (detector->analysisCount() == seen_analyses)
+    {
+        return;
+    }
+    seen_analyses = detector->analysisCount();
 
-    delay(1); // Yield
+    if (mel_frame_count == 0)
+    {
+        const uint64_t window_end_us = frame.timestamp + captureFrameDurationUs(frame);
+        mel_first_us = window_end_us - (uint64_t)SPECTRAL_FFT_SIZE * 1000000 / applied_rate;
+    }
+    mel_features.compute(*detector, mel_frames[mel_frame_count++]);
+    const uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+    feature_stats.frames++;
+    feature_stats.compute_us += 0.05f * ((float)elapsed_us - feature_stats.compute_us);
+    feature_stats.compute_us_max = max(feature_stats.compute_us_max, elapsed_us);
+
+    if (mel_frame_count == MEL_FRAMES_PER_PACKET || (mel_flags & PACKET_FLAG_TRIGGER_END))
+    {
+        sendFeaturePacket(); // Full, or a detection closed: the receiver gets the edge without waiting
+    }
 }
 
-// === WebSocket Connection Attempt ===
-void attemptWebSocketConnect()
+// Sends whatever the batch holds as one WS message
+static void flushBatch()
 {
-    // (Keep the implementation from the previous version - it correctly uses Settings)
-    if (WiFi.status() != WL_CONNECTED)
+    if (packet_batch.empty())
+    {
+        return;
+    }
+    if (!wsConnected)
+    {
+        packet_batch.clear();
+        return;
+    }
+    // WS frame header goes into the batch's own headroom
+    if (!wsSend(packet_batch.wsFrame(), packet_batch.length(), packet_batch.packets()))
+    {
+        LOG_WARN("wsClient.sendBIN failed for batch! (%u packets, %u bytes)", packet_batch.packets(), packet_batch.length());
+        packet_batch.clear();
+        return;
+    }
+    LOG_DEBUG("Sent WS batch: %u packets, %u bytes", packet_batch.packets(), packet_batch.length());
+    packet_batch.markSent();
+}
+
+// Sends spooled packets after a reconnect, one message per loop pass. A token
+// bucket at spool_drain_kbps keeps the backlog from crowding out live audio.
+static void drainSpool()
+{
+    static uint32_t last_ms = 0;
+    static size_t budget = 0; // Bytes that may go out now
+    const uint32_t now = millis();
+    const uint32_t elapsed = now - last_ms;
+    last_ms = now;
+    if (!wsConnected || flowPaused() || packet_spool.empty())
+    {
+        budget = 0;
+        return;
+    }
+    budget = min(budget + (size_t)elapsed * Settings.settings.spool_drain_kbps / 8, (size_t)SPOOL_MESSAGE_MAX_BYTES);
+
+    const size_t length = packet_spool.prepare(budget);
+    if (length == 0)
+    {
+        return; // Next packet does not fit the budget yet
+    }
+    if (!wsSend(packet_spool.wsFrame(), length, packet_spool.preparedPackets()))
+    {
+        LOG_WARN("wsClient.sendBIN failed for spool drain (%u packets, %u bytes); retrying", packet_spool.preparedPackets(), length);
+        return; // Still spooled; prepare() copies it again
+    }
+    LOG_DEBUG("Drained spool: %u packets, %u bytes", packet_spool.preparedPackets(), length);
+    budget -= length;
+    packet_spool.consume();
+}
+
+// Encodes and sends one buffered frame. Returns false if it could not be sent.
+static bool sendBufferedFrame(const CaptureFrame &frame, uint8_t flags)
+{
+    PacketBuffer *packet = packet_pool.acquire();
+    if (!packet)
+    {
+        return false;
+    }
+    FrameStats stats;
+    EncodedPayload encoded;
+    if (encodePayload(frame, packet->payload(), stats, encoded) == 0)
+    {
+        packet_pool.release(packet);
+        return false;
+    }
+    sendAudioPacket(packet, frame, encoded, flags);
+    return true;
+}
+
+// Replays the pre-roll oldest-first so the detection starts before the onset
+static void flushPreRoll()
+{
+    size_t flushed = 0;
+    const CaptureFrame *buffered;
+    while ((buffered = preroll.pop()) != nullptr)
+    {
+        if (!canSend() || !sendBufferedFrame(*buffered, PACKET_FLAG_PREROLL))
+        {
+            preroll.clear();
+            break;
+        }
+        ++flushed;
+    }
+    LOG_DEBUG("Trigger start: flushed %u pre-roll frames", flushed);
+}
+
+// === Frame Processing ===
+void processFrame(CaptureFrame &frame)
+{
+    // --- Sample Processing & State Update ---
+    int32_t *samples_32bit_raw = frame.samples; // Conditioned in place below
+    size_t num_samples = frame.sample_count;
+
+    if (num_samples > MAX_SAMPLES_PER_READ)
+    { // Sanity check
+        LOG_WARN("I2S samples (%u) > MAX_SAMPLES_PER_READ (%d)!", num_samples, MAX_SAMPLES_PER_READ);
+        num_samples = MAX_SAMPLES_PER_READ;
+    }
+
+    // Pick up pre-roll changes from /control.json (the buffer is only touched from this task)
+    static uint16_t applied_preroll_ms = Settings.settings.preroll_ms;
+    static uint32_t applied_preroll_rate = Settings.settings.sample_rate;
+    static uint8_t applied_preroll_channels = frame.channels;
+    if (applied_preroll_rate != Settings.settings.sample_rate || applied_preroll_channels != frame.channels)
+    {
+        // Buffered frames are at the old rate/width; a higher one may need more of them
+        applied_preroll_rate = Settings.settings.sample_rate;
+        applied_preroll_channels = frame.channels;
+        preroll.clear();
+        if (!allocatePreRoll(applied_preroll_rate, applied_preroll_channels))
+        {
+            LOG_WARN("Failed to grow the pre-roll buffer for %u Hz x %u; keeping %u frames", applied_preroll_rate,
+                     applied_preroll_channels, preroll.capacity());
+        }
+        applied_preroll_ms = UINT16_MAX; // Depth below is in frames at the new rate
+    }
+    if (applied_preroll_ms != Settings.settings.preroll_ms)
+    {
+        applied_preroll_ms = Settings.settings.preroll_ms;
+        preroll.setDepth(prerollFramesFor(applied_preroll_ms, Settings.settings.sample_rate, applied_preroll_channels));
+    }
+    applyOutputSampleRate();
+
+    // --- Condition + Convert + RMS/Peak in a single pass ---
+    // While a detection is open, convert straight into a pooled packet;
+    // otherwise only gather statistics (the frame may go to pre-roll).
+    const bool send_audio = Settings.settings.output_mode != OUTPUT_MODE_FEATURES_ONLY;
+    PacketBuffer *packet = (send_audio && canSend() && trigger_gate.active()) ? packet_pool.acquire() : nullptr;
+    FrameStats stats;
+    EncodedPayload encoded;
+    const uint32_t condition_start = ESP.getCycleCount();
+    size_t audio_payload_size =
+        conditionAndEncode(samples_32bit_raw, num_samples, frame.channels, packet ? packet->payload() : nullptr, stats, encoded);
+    metricsRecord(METRIC_STAGE_CONDITION, ESP.getCycleCount() - condition_start);
+    // Diagnostics and the live view follow channel 0
+    const size_t frames = frame_encoder.frames();
+    updateStatusSamples(frame_encoder.plane(0), frames);
+
+    // --- Update Global Runtime State Variables ---
+    current_peak = stats.peak; // Across all channels
+    current_rms = stats.rms(); // Normalised to approx 0.0 .. 1.0
+    current_channels = frame_encoder.channels();
+    for (uint8_t c = 0; c < current_channels; ++c)
+    {
+        channel_rms[c] = frame_encoder.channelStats(c).rms();
+        channel_peak[c] = frame_encoder.channelStats(c).peak;
+    }
+
+    // --- Trigger Gate ---
+    // Any channel above its threshold opens the detection; trigger_channels
+    // records which ones were
+    const uint32_t frame_ms = (uint32_t)(frame.timestamp / 1000);
+    const uint32_t trigger_start = ESP.getCycleCount();
+    trigger_channels = Settings.settings.trigger_mode == TRIGGER_MODE_SPECTRAL ? spectralTriggerChannels(current_channels, frames)
+                                                                                : rmsTriggerChannels(current_channels);
+    metricsRecord(METRIC_STAGE_TRIGGER, ESP.getCycleCount() - trigger_start);
+    TriggerEvent event = trigger_gate.update(trigger_channels != 0, frame_ms, Settings.settings.trigger_timeout_ms);
+    transmitting = trigger_gate.active();
+    powerSetActive(transmitting); // Full speed before the pre-roll burst below
+    liveMonitorFeed(frame_encoder.plane(0), frames, frame_encoder.channelStats(0), transmitting);
+    featureFeed(frame, frames, event);
+    if (!send_audio)
+    {
+        preroll.clear(); // Nothing to replay once audio comes back
+        return;
+    }
+
+    if (event == TRIGGER_EVENT_END && packet && audio_payload_size > 0)
+    {
+        // Close the detection explicitly so the receiver can cut the clip here
+        // (the frame is sent instead of going to pre-roll, so it is never duplicated)
+        sendAudioPacket(packet, frame, encoded, PACKET_FLAG_TRIGGER_END);
+        return;
+    }
+    if (!transmitting)
+    {
+        // Idle (or the detection just ended): keep the frame for the next onset
+        packet_pool.release(packet);
+        preroll.push(frame);
+        return;
+    }
+    const uint8_t flags = event == TRIGGER_EVENT_START ? PACKET_FLAG_TRIGGER_START : 0;
+    if (event == TRIGGER_EVENT_START)
     {
-        LOG_WARN("Cannot attempt WebSocket connect, WiFi not connected.");
+        frame_encoder.resetDecimator(); // A new detection does not continue the last one's filter history
+        flushPreRoll();
+    }
+
+    // --- Data Sending ---
+    if (!canSend())
+    { // Send (or spool) only while transmitting
+        packet_pool.release(packet);
+        return;
+    }
+    if (!packet)
+    {
+        // Trigger fired on this frame: it was only measured, convert it now
+        if (!sendBufferedFrame(frame, flags))
+        {
+            LOG_WARN("Packet pool exhausted or unsupported output_bits (%u), skipping send", Settings.settings.output_bits);
+        }
         return;
     }
-    if (wsConnected)
+    if (audio_payload_size == 0)
     {
-        LOG_WARN("WebSocket already connected, not attempting.");
+        LOG_ERROR("Unsupported output_bits (%u), skipping send", Settings.settings.output_bits);
+        packet_pool.release(packet);
         return;
     }
+    sendAudioPacket(packet, frame, encoded, flags);
+}
+
+// === WebSocket Connection Attempt ===
+// Starts one attempt; connectionService() gives up on it after WS_CONNECT_TIMEOUT_MS
+void attemptWebSocketConnect(uint32_t now)
+{
     if (Settings.settings.ws_server.isEmpty())
     {
         LOG_WARN("WebSocket server not provisioned; skipping connection attempt.");
-        systemState = STATE_WIFI_CONNECTED;
-        updateLed();
+        retry_at_ms = now + WS_BACKOFF_CAP_MS; // Check again later
         return;
     }
 
-    systemState = STATE_WS_CONNECTING;
-    updateLed();
-
     String ws_host_str = Settings.settings.ws_server;
     String ws_port_str = Settings.settings.ws_port;
     String ws_path_str = "/"; // <<< ADJUST IF NEEDED
@@ -411,13 +1283,23 @@ void attemptWebSocketConnect()
     if (ws_port_int <= 0 || ws_port_int > 65535)
     {
         LOG_ERROR("Invalid WebSocket Port: %s", ws_port_str.c_str());
-        systemState = STATE_WIFI_CONNECTED;
-        updateLed();
+        retry_at_ms = now + WS_BACKOFF_CAP_MS;
         return;
     }
 
-    LOG_INFO("Attempting WebSocket connection to: %s:%d%s", ws_host_str.c_str(), ws_port_int, ws_path_str.c_str());
-    wsClient.begin(ws_host_str, ws_port_int, ws_path_str); // Non-blocking
+    ws_attempts++;
+    attempt_deadline_ms = now + WS_CONNECT_TIMEOUT_MS;
+    setSystemState(STATE_WS_CONNECTING);
+    LOG_INFO("Attempting WebSocket connection to: %s:%d%s (attempt %u)", ws_host_str.c_str(), ws_port_int, ws_path_str.c_str(), ws_backoff.failures() + 1);
+    wsClient.begin(ws_host_str, ws_port_int, ws_path_str); // Connects from the next wsClient.loop()
+}
+
+static void scheduleWebSocketRetry(uint32_t now, const char *why)
+{
+    const uint32_t delay_ms = ws_backoff.next();
+    retry_at_ms = now + delay_ms;
+    setSystemState(STATE_WIFI_CONNECTED);
+    LOG_WARN("WebSocket %s; next attempt in %lu ms", why, (unsigned long)delay_ms);
 }
 
 // === LED Status Update ===
@@ -453,113 +1335,213 @@ void updateNeoPixelColor(uint32_t color)
     pixels.show();
 }
 
-// === WiFi Connection Maintenance ===
-void maintainConnections()
+static void setSystemState(SystemState state)
 {
-    // (Keep the implementation from the previous version)
-    if (WiFi.status() != WL_CONNECTED)
+    if (state != systemState)
     {
-        if (wsConnected)
-        {
-            LOG_WARN("Lost WiFi connection, WebSocket disconnected.");
-            wsConnected = false;
-        }
-        if (systemState != STATE_WIFI_CONNECTING)
-        {
-            systemState = STATE_WIFI_CONNECTING;
-            updateLed();
-            lastReconnectAttempt = millis();
-        }
-        if (millis() - lastReconnectAttempt > 5000)
-        {
-            LOG_WARN("WiFi disconnected, attempting reconnect...");
-            connectToWiFi();
-            lastReconnectAttempt = millis();
-        }
-    }
-}
-
-// === I2S Setup ===
-void setupI2S()
-{
-    // (Keep the implementation from the previous version - it correctly uses Settings)
-    LOG_DEBUG("Configuring I2S...");
-    int dma_buf_len_samples = Settings.settings.buffer_len / 2;
-    if (dma_buf_len_samples <= 0 || dma_buf_len_samples > 1024)
-    {
-        LOG_WARN("Calculated I2S dma_buf_len (%d samples) is unusual. Clamping to 512.", dma_buf_len_samples);
-        dma_buf_len_samples = 512;
-    }
-    i2s_config_t i2s_config = {/* ... I2S config using Settings ... */
-                               .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
-                               .sample_rate = Settings.settings.sample_rate,
-                               .bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT,
-                               .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
-                               .communication_format = I2S_COMM_FORMAT_STAND_I2S,
-                               .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-                               .dma_buf_count = 8,
-                               .dma_buf_len = dma_buf_len_samples,
-                               .use_apll = false,
-                               .tx_desc_auto_clear = false,
-                               .fixed_mclk = 0};
-    i2s_pin_config_t pin_config = {/* ... Pin config ... */
-                                   .mck_io_num = I2S_PIN_NO_CHANGE,
-                                   .bck_io_num = I2S_BCLK,
-                                   .ws_io_num = I2S_WS,
-                                   .data_out_num = I2S_PIN_NO_CHANGE,
-                                   .data_in_num = I2S_SD};
-    // Install driver, set pins, zero DMA... with error checking
-    if (i2s_driver_install(I2S_PORT, &i2s_config, 0, NULL) != ESP_OK)
-    { /* Error handling */
-        LOG_ERROR("Failed I2S install");
-        ESP.restart();
-    }
-    if (i2s_set_pin(I2S_PORT, &pin_config) != ESP_OK)
-    { /* Error handling */
-        LOG_ERROR("Failed I2S pins");
-        ESP.restart();
+        systemState = state;
+        updateLed();
     }
-    if (i2s_zero_dma_buffer(I2S_PORT) != ESP_OK)
+}
+
+// === Connection Manager ===
+// WiFi and the WebSocket are brought up by a state machine on top of
+// SystemState that the network task steps once per loop pass. Nothing in it
+// waits: WiFi.begin() returns at once and its outcome arrives as a WiFi
+// event, and a WebSocket attempt is given WS_CONNECT_TIMEOUT_MS of
+// wsClient.loop() calls. Failed attempts are retried with jittered
+// exponential backoff (reconnect_backoff.h). While waiting, wsClient.loop()
+// is not called, so the library cannot retry on its own schedule.
+
+// Runs in the WiFi event task: only flags the change for connectionService()
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
+{
+    switch (event)
     {
-        LOG_ERROR("Failed zero DMA"); /* Might continue */
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        wifi_up_event = true;
+        break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        wifi_down_reason = info.wifi_sta_disconnected.reason;
+        wifi_down_event = true;
+        break;
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+        wifi_down_event = true;
+        break;
+    default:
+        break;
     }
 }
 
-// === WiFi Connection Logic ===
-bool connectToWiFi()
+void connectionBegin()
 {
-    // (Keep the implementation from the previous version - it correctly uses Settings)
-    systemState = STATE_WIFI_CONNECTING;
-    updateLed();
-    // ... (Disconnect, Mode, Begin using Settings.settings.wifi_ssid/pass) ...
-    WiFi.disconnect(true);
-    delay(100);
+    WiFi.onEvent(onWiFiEvent);
     WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false); // Retries follow wifi_backoff instead of the driver's fixed cadence
+    wsClient.setReconnectInterval(WS_CONNECT_TIMEOUT_MS); // At most one library attempt per window
+    link_ssid = Settings.settings.wifi_ssid;
+    link_pass = Settings.settings.wifi_pass;
+    link_server = Settings.settings.ws_server;
+    link_port = Settings.settings.ws_port;
+    retry_at_ms = millis();
+    setSystemState(STATE_WIFI_CONNECTING);
+}
+
+// Follows /control.json changes: new credentials rejoin WiFi, a new server or
+// port reconnects the WebSocket, both without waiting out the backoff
+static void connectionApplySettings()
+{
+    const uint32_t now = millis();
+    if (systemState >= STATE_WIFI_CONNECTED)
+    {
+        timeSyncSetNtpServer(Settings.settings.ntp_server); // Otherwise picked up once WiFi is up
+    }
+    if (Settings.settings.wifi_ssid != link_ssid || Settings.settings.wifi_pass != link_pass)
+    {
+        link_ssid = Settings.settings.wifi_ssid;
+        link_pass = Settings.settings.wifi_pass;
+        link_server = Settings.settings.ws_server;
+        link_port = Settings.settings.ws_port;
+        LOG_INFO("WiFi settings changed; rejoining");
+        setSystemState(STATE_WIFI_CONNECTING); // Before disconnect() so its event does not schedule a WS retry
+        wsClient.disconnect();
+        wsConnected = false;
+        WiFi.disconnect();
+        wifi_attempting = false;
+        wifi_backoff.reset();
+        retry_at_ms = now + WIFI_REJOIN_DELAY_MS;
+        return;
+    }
+    if (Settings.settings.ws_server != link_server || Settings.settings.ws_port != link_port)
+    {
+        link_server = Settings.settings.ws_server;
+        link_port = Settings.settings.ws_port;
+        if (systemState >= STATE_WIFI_CONNECTED)
+        {
+            LOG_INFO("WebSocket server changed; reconnecting");
+            setSystemState(STATE_WIFI_CONNECTED); // State first, see webSocketEvent()
+            wsClient.disconnect();
+            wsConnected = false;
+            ws_backoff.reset();
+            retry_at_ms = now;
+        }
+    }
+}
+
+static void startWiFiAttempt(uint32_t now)
+{
     if (Settings.settings.wifi_ssid.isEmpty())
     {
         LOG_WARN("WiFi SSID not provisioned; skipping connection attempt.");
-        return false;
+        retry_at_ms = now + WIFI_BACKOFF_CAP_MS;
+        return;
     }
-    LOG_INFO("Starting WiFi connection to SSID: %s", Settings.settings.wifi_ssid.c_str());
+    wifi_attempts++;
+    wifi_attempting = true;
+    attempt_deadline_ms = now + WIFI_CONNECT_TIMEOUT_MS;
+    LOG_INFO("Starting WiFi connection to SSID: %s (attempt %u)", Settings.settings.wifi_ssid.c_str(), wifi_backoff.failures() + 1);
     WiFi.begin(Settings.settings.wifi_ssid.c_str(), Settings.settings.wifi_pass.c_str());
+}
+
+static void scheduleWiFiRetry(uint32_t now, const char *why)
+{
+    wifi_attempting = false;
+    const uint32_t delay_ms = wifi_backoff.next();
+    retry_at_ms = now + delay_ms;
+    LOG_WARN("WiFi %s (reason %u); next attempt in %lu ms", why, wifi_down_reason, (unsigned long)delay_ms);
+}
+
+static bool reached(uint32_t now, uint32_t at)
+{
+    return (int32_t)(now - at) >= 0; // Survives the millis() wrap
+}
 
-    unsigned long startAttemptTime = millis();
-    const unsigned long connectionTimeout = 15000;
-    while (WiFi.status() != WL_CONNECTED)
+void connectionService()
+{
+    const uint32_t now = millis();
+
+    // WiFi events first: they can arrive in any state
+    if (wifi_down_event)
+    {
+        wifi_down_event = false;
+        if (systemState != STATE_WIFI_CONNECTING)
+        {
+            setSystemState(STATE_WIFI_CONNECTING); // Before disconnect() so its event does not schedule a WS retry
+            if (wsConnected)
+            {
+                LOG_WARN("Lost WiFi connection, WebSocket disconnected.");
+            }
+            wsClient.disconnect();
+            wsConnected = false;
+            scheduleWiFiRetry(now, "lost");
+        }
+        else if (wifi_attempting)
+        {
+            WiFi.disconnect();
+            scheduleWiFiRetry(now, "attempt failed");
+        }
+    }
+    if (wifi_up_event)
     {
-        if (millis() - startAttemptTime > connectionTimeout)
+        wifi_up_event = false;
+        if (systemState == STATE_WIFI_CONNECTING)
         {
-            LOG_ERROR("WiFi connection timed out after %lu ms!", connectionTimeout);
-            systemState = STATE_WIFI_CONNECTING;
-            updateLed();
-            return false;
+            LOG_INFO("WiFi connected successfully! IP: %s, RSSI: %d", WiFi.localIP().toString().c_str(), (int)WiFi.RSSI());
+            wifi_attempting = false;
+            wifi_backoff.reset();
+            ws_backoff.reset();
+            retry_at_ms = now + ReconnectBackoff::spread(WS_FIRST_ATTEMPT_SPREAD_MS);
+            setSystemState(STATE_WIFI_CONNECTED);
+            timeSyncSetNtpServer(Settings.settings.ntp_server);
         }
-        delay(100);
     }
-    // ... (Log connection details, update state, update LED) ...
-    LOG_INFO("WiFi connected successfully!");
-    systemState = STATE_WIFI_CONNECTED;
-    // ... Log IP, RSSI etc ...
-    updateLed();
-    return true;
-}
\ No newline at end of file
+
+    switch (systemState)
+    {
+    case STATE_BOOTING:
+        break;
+    case STATE_WIFI_CONNECTING:
+        if (wifi_attempting && reached(now, attempt_deadline_ms))
+        {
+            WiFi.disconnect(); // Its DISCONNECTED event is ignored: no attempt is running any more
+            wifi_down_reason = 0;
+            scheduleWiFiRetry(now, "connection timed out");
+        }
+        else if (!wifi_attempting && reached(now, retry_at_ms))
+        {
+            startWiFiAttempt(now);
+        }
+        break;
+    case STATE_WIFI_CONNECTED:
+        if (reached(now, retry_at_ms))
+        {
+            attemptWebSocketConnect(now);
+        }
+        break;
+    case STATE_WS_CONNECTING:
+        wsClient.loop(); // WStype_CONNECTED moves on to STATE_WS_CONNECTED
+        if (systemState == STATE_WS_CONNECTING && reached(now, attempt_deadline_ms))
+        {
+            scheduleWebSocketRetry(now, "connection timed out"); // State first, see webSocketEvent()
+            wsClient.disconnect();
+        }
+        break;
+    case STATE_WS_CONNECTED:
+        wsClient.loop();
+        if (ws_backoff.failures() > 0 && reached(now, ws_connected_at_ms + WS_BACKOFF_RESET_MS))
+        {
+            ws_backoff.reset(); // Stable again; a server that accepts and drops at once keeps backing off
+        }
+        break;
+    }
+}
+
+static void fillLinkStats(LinkStats &stats)
+{
+    const uint32_t now = millis();
+    const bool waiting = systemState == STATE_WIFI_CONNECTED || (systemState == STATE_WIFI_CONNECTING && !wifi_attempting);
+    stats.state = systemState;
+    stats.wifi_attempts = wifi_attempts;
+    stats.ws_attempts = ws_attempts;
+    stats.retry_in_ms = waiting && !reached(now, retry_at_ms) ? retry_at_ms - now : 0;
+}
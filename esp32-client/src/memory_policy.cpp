@@ -0,0 +1,217 @@
+// src/memory_policy.cpp
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+
+#include "memory_policy.h"
+#include "logging.h"
+
+struct RegistryEntry
+{
+    void *ptr;
+    MemoryBlock block;
+};
+
+static RegistryEntry registry[MEMORY_MAX_BLOCKS];
+static size_t registry_count = 0;
+static uint32_t class_bytes[MEMORY_CLASS_COUNT];
+static uint32_t class_psram_bytes[MEMORY_CLASS_COUNT];
+static uint16_t fallbacks = 0;
+static uint16_t failures = 0;
+static portMUX_TYPE registry_lock = portMUX_INITIALIZER_UNLOCKED;
+
+const char *memoryClassName(uint8_t cls)
+{
+    switch (cls)
+    {
+    case MEMORY_HOT:
+        return "hot";
+    case MEMORY_BULK:
+        return "bulk";
+    case MEMORY_PSRAM_ONLY:
+        return "psram_only";
+    default:
+        return "unknown";
+    }
+}
+
+static void *allocFrom(uint32_t caps, size_t bytes, size_t align)
+{
+    return heap_caps_aligned_alloc(align, bytes, caps);
+}
+
+bool memoryInPsram(const void *block)
+{
+    bool psram = false;
+    portENTER_CRITICAL(&registry_lock);
+    for (size_t i = 0; i < registry_count; ++i)
+    {
+        if (registry[i].ptr == block)
+        {
+            psram = registry[i].block.psram;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&registry_lock);
+    return psram;
+}
+
+void *memoryAlloc(MemoryClass cls, size_t bytes, const char *what, size_t align)
+{
+    void *ptr = nullptr;
+    bool psram = false;
+    bool fallback = false;
+    switch (cls)
+    {
+    case MEMORY_HOT:
+        ptr = allocFrom(MEMORY_HOT_CAPS, bytes, align);
+        break;
+    case MEMORY_BULK:
+        ptr = allocFrom(MEMORY_PSRAM_CAPS, bytes, align);
+        psram = ptr != nullptr;
+        if (!ptr)
+        {
+            ptr = allocFrom(MEMORY_INTERNAL_CAPS, bytes, align);
+            fallback = ptr != nullptr;
+        }
+        break;
+    case MEMORY_PSRAM_ONLY:
+        ptr = allocFrom(MEMORY_PSRAM_CAPS, bytes, align);
+        psram = ptr != nullptr;
+        break;
+    default:
+        break;
+    }
+
+    if (!ptr)
+    {
+        portENTER_CRITICAL(&registry_lock);
+        failures++;
+        portEXIT_CRITICAL(&registry_lock);
+        // PSRAM-only misses are expected on boards without it; the owner logs its fallback
+        if (cls != MEMORY_PSRAM_ONLY)
+        {
+            LOG_ERROR("No %s memory for %s (%u bytes); largest internal block %u", memoryClassName(cls), what, bytes,
+                      heap_caps_get_largest_free_block(MEMORY_INTERNAL_CAPS));
+        }
+        return nullptr;
+    }
+
+    bool listed = false;
+    portENTER_CRITICAL(&registry_lock);
+    if (registry_count < MEMORY_MAX_BLOCKS)
+    {
+        registry[registry_count++] = {ptr, {what, (uint32_t)bytes, (uint8_t)cls, psram}};
+        listed = true;
+        class_bytes[cls] += bytes;
+        if (psram)
+        {
+            class_psram_bytes[cls] += bytes;
+        }
+    }
+    if (fallback)
+    {
+        fallbacks++;
+    }
+    portEXIT_CRITICAL(&registry_lock);
+
+    if (fallback)
+    {
+        LOG_WARN("No PSRAM for %s; %u bytes placed in internal RAM", what, bytes);
+    }
+    if (!listed)
+    {
+        LOG_WARN("Memory registry full; %s (%u bytes) is not listed", what, bytes);
+    }
+    return ptr;
+}
+
+void memoryFree(void *block)
+{
+    if (!block)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&registry_lock);
+    for (size_t i = 0; i < registry_count; ++i)
+    {
+        if (registry[i].ptr != block)
+        {
+            continue;
+        }
+        const MemoryBlock &entry = registry[i].block;
+        class_bytes[entry.cls] -= entry.bytes;
+        if (entry.psram)
+        {
+            class_psram_bytes[entry.cls] -= entry.bytes;
+        }
+        // Keep allocation order for the listing
+        memmove(&registry[i], &registry[i + 1], (registry_count - i - 1) * sizeof(RegistryEntry));
+        registry_count--;
+        break;
+    }
+    portEXIT_CRITICAL(&registry_lock);
+    heap_caps_free(block);
+}
+
+static void fillRegion(HeapRegionStats &region, uint32_t caps)
+{
+    region.total = heap_caps_get_total_size(caps);
+    region.free = heap_caps_get_free_size(caps);
+    region.largest = heap_caps_get_largest_free_block(caps);
+    region.min_free = heap_caps_get_minimum_free_size(caps);
+}
+
+void memoryFillStats(MemoryStats &stats)
+{
+    fillRegion(stats.internal, MEMORY_INTERNAL_CAPS);
+    fillRegion(stats.dma, MEMORY_HOT_CAPS);
+    fillRegion(stats.psram, MEMORY_PSRAM_CAPS);
+    portENTER_CRITICAL(&registry_lock);
+    memcpy(stats.class_bytes, class_bytes, sizeof(class_bytes));
+    memcpy(stats.class_psram_bytes, class_psram_bytes, sizeof(class_psram_bytes));
+    stats.blocks = registry_count;
+    stats.fallbacks = fallbacks;
+    stats.failures = failures;
+    portEXIT_CRITICAL(&registry_lock);
+}
+
+size_t memoryBlocks(MemoryBlock *out, size_t max)
+{
+    portENTER_CRITICAL(&registry_lock);
+    const size_t count = min(max, registry_count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = registry[i].block;
+    }
+    portEXIT_CRITICAL(&registry_lock);
+    return count;
+}
+
+void memoryLogSummary()
+{
+    MemoryStats stats;
+    memoryFillStats(stats);
+    LOG_INFO("Heap internal: %u/%u free (largest %u, min %u)", stats.internal.free, stats.internal.total,
+             stats.internal.largest, stats.internal.min_free);
+    LOG_INFO("Heap DMA-capable: %u/%u free (largest %u, min %u)", stats.dma.free, stats.dma.total, stats.dma.largest,
+             stats.dma.min_free);
+    if (stats.psram.total > 0)
+    {
+        LOG_INFO("Heap PSRAM: %u/%u free (largest %u, min %u)", stats.psram.free, stats.psram.total, stats.psram.largest,
+                 stats.psram.min_free);
+    }
+    else
+    {
+        LOG_WARN("No PSRAM: bulk buffers share internal RAM and run at their reduced sizes");
+    }
+
+    MemoryBlock blocks[MEMORY_MAX_BLOCKS];
+    const size_t count = memoryBlocks(blocks, MEMORY_MAX_BLOCKS);
+    for (size_t i = 0; i < count; ++i)
+    {
+        LOG_INFO("  %-20s %7u bytes  %-10s -> %s", blocks[i].what, blocks[i].bytes, memoryClassName(blocks[i].cls),
+                 blocks[i].psram ? "PSRAM" : "internal");
+    }
+}
@@ -0,0 +1,117 @@
+// src/metrics.cpp
+
+#include <Arduino.h>
+
+#include "metrics.h"
+
+StageHistogram stage_metrics[METRIC_STAGE_COUNT];
+
+static const char *const stage_names[METRIC_STAGE_COUNT] = {
+    "i2s_wait", "queue_delay", "condition", "trigger", "frame", "send", "ws_loop",
+};
+
+const char *metricStageName(MetricStage stage)
+{
+    return stage < METRIC_STAGE_COUNT ? stage_names[stage] : "unknown";
+}
+
+bool metricStageInCycles(MetricStage stage)
+{
+    return stage == METRIC_STAGE_CONDITION || stage == METRIC_STAGE_TRIGGER;
+}
+
+// === Buckets ===
+// Values below 4 get their own bucket; above that each power of two
+// [2^m, 2^(m+1)) is split into METRICS_SUB_BUCKETS equal parts.
+static inline size_t bucketFor(uint32_t value)
+{
+    if (value < METRICS_SUB_BUCKETS)
+    {
+        return value;
+    }
+    const int msb = 31 - __builtin_clz(value);
+    return (msb - 1) * METRICS_SUB_BUCKETS + ((value >> (msb - 2)) & (METRICS_SUB_BUCKETS - 1));
+}
+
+// Midpoint of a bucket, what a quantile landing in it reports
+static uint32_t bucketValue(size_t bucket)
+{
+    if (bucket < METRICS_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    const int msb = bucket / METRICS_SUB_BUCKETS + 1;
+    const uint32_t width = 1u << (msb - 2);
+    const uint32_t lower = (uint32_t)(METRICS_SUB_BUCKETS + bucket % METRICS_SUB_BUCKETS) << (msb - 2);
+    return lower + width / 2;
+}
+
+// === Histogram ===
+void StageHistogram::rotate(TickType_t now)
+{
+    active ^= 1;
+    memset(buckets[active], 0, sizeof(buckets[active]));
+    window_count[active] = 0;
+    window_max[active] = 0;
+    window_start = now;
+}
+
+void StageHistogram::record(uint32_t value)
+{
+    const TickType_t now = xTaskGetTickCount();
+    if (now - window_start >= pdMS_TO_TICKS(METRICS_WINDOW_MS))
+    {
+        rotate(now);
+    }
+    buckets[active][bucketFor(value)]++;
+    window_count[active]++;
+    if (value > window_max[active])
+    {
+        window_max[active] = value;
+    }
+
+    Totals &t = totals.beginWrite();
+    t.count++;
+    t.sum += value;
+    totals.endWrite();
+}
+
+// Smallest bucket value with at least `rank` samples at or below it, over
+// both windows. Buckets are read while the owner may be adding to them; at
+// worst the answer belongs to a sample or two earlier.
+uint32_t StageHistogram::quantile(uint32_t rank) const
+{
+    uint32_t seen = 0;
+    for (size_t i = 0; i < METRICS_BUCKETS; ++i)
+    {
+        seen += buckets[0][i] + buckets[1][i];
+        if (seen >= rank)
+        {
+            return bucketValue(i);
+        }
+    }
+    return 0;
+}
+
+void StageHistogram::summarize(StageSummary &out) const
+{
+    Totals t = {};
+    totals.read(t);
+    out.count = t.count;
+    out.sum = t.sum;
+    out.window_count = window_count[0] + window_count[1];
+    out.max = max(window_max[0], window_max[1]);
+    if (xTaskGetTickCount() - window_start >= 2 * pdMS_TO_TICKS(METRICS_WINDOW_MS))
+    {
+        out.window_count = 0; // Nothing recorded for two windows (e.g. no sends while the link is down)
+    }
+    if (out.window_count == 0)
+    {
+        out.max = 0;
+        out.p50 = out.p99 = 0;
+        return;
+    }
+    // Ranks rounded up, so p99 of fewer than 100 samples is the largest one
+    out.p50 = min(quantile((out.window_count + 1) / 2), out.max);
+    out.p99 = min(quantile((uint32_t)(((uint64_t)out.window_count * 99 + 99) / 100)), out.max);
+}
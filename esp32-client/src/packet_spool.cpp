@@ -0,0 +1,444 @@
+// src/packet_spool.cpp
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "packet_spool.h"
+#include "logging.h"
+#include "memory_policy.h"
+
+#define SPOOL_RECORD_PREFIX 2 // uint16 little-endian packet length
+
+PacketSpool packet_spool;
+
+// Full check of a stored packet: magic, self-described length and CRC
+static bool intactPacket(const uint8_t *packet, size_t length)
+{
+    if (length < sizeof(AudioPacketHeader) || length > sizeof(AudioPacketHeader) + MAX_PACKET_PAYLOAD_BYTES)
+    {
+        return false;
+    }
+    const AudioPacketHeader *header = reinterpret_cast<const AudioPacketHeader *>(packet);
+    if (header->magic != AUDIO_PACKET_MAGIC || (size_t)header->header_size + header->payload_bytes != length)
+    {
+        return false;
+    }
+    uint32_t crc = crc32Update(0, packet, offsetof(AudioPacketHeader, crc32));
+    crc = crc32Update(crc, packet + header->header_size, header->payload_bytes);
+    return crc == header->crc32;
+}
+
+static void segmentPath(char *path, size_t size, uint32_t id)
+{
+    snprintf(path, size, SPOOL_DIR "/%08lu.seg", (unsigned long)id);
+}
+
+bool PacketSpool::begin(size_t ram_bytes, bool use_flash)
+{
+    ram = (uint8_t *)memoryAlloc(MEMORY_PSRAM_ONLY, ram_bytes, "spool RAM tier");
+    if (!ram)
+    {
+        ram_bytes = min(ram_bytes, (size_t)SPOOL_RAM_INTERNAL_BYTES);
+        ram = (uint8_t *)memoryAlloc(MEMORY_BULK, ram_bytes, "spool RAM tier");
+    }
+    if (!ram)
+    {
+        LOG_ERROR("Failed to allocate spool RAM tier (%u bytes)", ram_bytes);
+        return false;
+    }
+    ram_capacity = ram_bytes;
+    LOG_INFO("Allocated spool RAM tier (%u bytes). Free Heap: %u", ram_capacity, ESP.getFreeHeap());
+
+    if (use_flash)
+    {
+        if (LittleFS.begin(true) && (LittleFS.exists(SPOOL_DIR) || LittleFS.mkdir(SPOOL_DIR)))
+        {
+            flash_ready = true;
+            scanSegments();
+            LOG_INFO("Spool flash tier: %u segments, %u packets (%u bytes) left from before", segment_count, flash_packets, flash_bytes);
+        }
+        else
+        {
+            LOG_WARN("LittleFS mount failed; spool is RAM only");
+        }
+    }
+    return true;
+}
+
+// === RAM Ring ===
+void PacketSpool::ramCopyIn(size_t offset, const uint8_t *data, size_t length)
+{
+    const size_t first = min(length, ram_capacity - offset);
+    memcpy(ram + offset, data, first);
+    memcpy(ram, data + first, length - first);
+}
+
+void PacketSpool::ramCopyOut(size_t offset, uint8_t *data, size_t length) const
+{
+    const size_t first = min(length, ram_capacity - offset);
+    memcpy(data, ram + offset, first);
+    memcpy(data + first, ram, length - first);
+}
+
+uint16_t PacketSpool::ramRecordLength(size_t offset) const
+{
+    return (uint16_t)(ram[offset] | ram[(offset + 1) % ram_capacity] << 8);
+}
+
+void PacketSpool::ramDropOldest()
+{
+    const size_t length = ramRecordLength(ram_head);
+    ram_head = (ram_head + SPOOL_RECORD_PREFIX + length) % ram_capacity;
+    ram_used -= SPOOL_RECORD_PREFIX + length;
+    ram_packets--;
+    dropped_packets++;
+    dropped_bytes += length;
+}
+
+bool PacketSpool::push(const uint8_t *packet, size_t length)
+{
+    const size_t record = SPOOL_RECORD_PREFIX + length;
+    if (!ram || length > UINT16_MAX || record > ram_capacity)
+    {
+        return false;
+    }
+    while (ram_capacity - ram_used < record)
+    {
+        ramDropOldest();
+    }
+
+    const uint8_t prefix[SPOOL_RECORD_PREFIX] = {(uint8_t)(length & 0xFF), (uint8_t)(length >> 8)};
+    const size_t tail = (ram_head + ram_used) % ram_capacity;
+    ramCopyIn(tail, prefix, SPOOL_RECORD_PREFIX);
+    ramCopyIn((tail + SPOOL_RECORD_PREFIX) % ram_capacity, packet, length);
+    ram_used += record;
+    ram_packets++;
+    spooled++;
+    return true;
+}
+
+// === Flash Segments ===
+// Counts the intact records at the start of a segment
+uint32_t PacketSpool::validRecords(fs::File &file, uint32_t &valid_bytes)
+{
+    uint8_t *scratch = message + PACKET_HEADROOM;
+    uint32_t records = 0;
+    valid_bytes = 0;
+    for (;;)
+    {
+        uint8_t prefix[SPOOL_RECORD_PREFIX];
+        if (file.read(prefix, SPOOL_RECORD_PREFIX) != SPOOL_RECORD_PREFIX)
+        {
+            break;
+        }
+        const size_t length = prefix[0] | prefix[1] << 8;
+        if (length > SPOOL_MESSAGE_MAX_BYTES || file.read(scratch, length) != length || !intactPacket(scratch, length))
+        {
+            break;
+        }
+        valid_bytes += SPOOL_RECORD_PREFIX + length;
+        records++;
+    }
+    return records;
+}
+
+void PacketSpool::scanSegments()
+{
+    // Ids of segments on flash; only the newest SPOOL_MAX_SEGMENTS are kept
+    uint32_t ids[SPOOL_MAX_SEGMENTS];
+    size_t found = 0;
+    char path[32];
+
+    fs::File dir = LittleFS.open(SPOOL_DIR);
+    fs::File entry;
+    while (dir && (entry = dir.openNextFile()))
+    {
+        char *end = nullptr;
+        const uint32_t id = strtoul(entry.name(), &end, 10);
+        const bool segment = end && strcmp(end, ".seg") == 0;
+        entry.close();
+        if (!segment)
+        {
+            continue;
+        }
+
+        uint32_t evict = id;
+        if (found < SPOOL_MAX_SEGMENTS)
+        {
+            ids[found++] = id;
+            evict = UINT32_MAX;
+        }
+        else
+        {
+            size_t oldest = 0;
+            for (size_t i = 1; i < found; ++i)
+            {
+                oldest = ids[i] < ids[oldest] ? i : oldest;
+            }
+            if (ids[oldest] < id)
+            {
+                evict = ids[oldest];
+                ids[oldest] = id;
+            }
+        }
+        if (evict != UINT32_MAX)
+        {
+            segmentPath(path, sizeof(path), evict);
+            LittleFS.remove(path);
+        }
+    }
+    dir.close();
+
+    // Oldest first
+    for (size_t i = 1; i < found; ++i)
+    {
+        const uint32_t id = ids[i];
+        size_t j = i;
+        for (; j > 0 && ids[j - 1] > id; --j)
+        {
+            ids[j] = ids[j - 1];
+        }
+        ids[j] = id;
+    }
+
+    for (size_t i = 0; i < found; ++i)
+    {
+        segmentPath(path, sizeof(path), ids[i]);
+        fs::File file = LittleFS.open(path, "r");
+        uint32_t bytes = 0;
+        const uint32_t packets = file ? validRecords(file, bytes) : 0;
+        file.close();
+        next_segment_id = ids[i] + 1;
+        if (packets == 0)
+        {
+            LittleFS.remove(path);
+            continue;
+        }
+        Segment &segment = segmentAt(segment_count++);
+        segment.id = ids[i];
+        segment.bytes = bytes; // A torn tail past this is never read
+        segment.packets = packets;
+        flash_bytes += bytes;
+        flash_packets += packets;
+    }
+}
+
+void PacketSpool::sealWriter()
+{
+    if (writer_open)
+    {
+        writer.close();
+        writer_open = false;
+    }
+}
+
+// Removes the oldest segment; anything not yet drained from it counts as dropped
+void PacketSpool::dropOldestSegment()
+{
+    Segment &segment = segmentAt(0);
+    if (segment_count == 1)
+    {
+        sealWriter();
+    }
+    if (reader_id == segment.id)
+    {
+        reader.close();
+        reader_id = UINT32_MAX;
+    }
+    dropped_packets += segment.packets;
+    dropped_bytes += segment.bytes - read_offset;
+    flash_packets -= segment.packets;
+    flash_bytes -= segment.bytes - read_offset;
+    read_offset = 0;
+
+    char path[32];
+    segmentPath(path, sizeof(path), segment.id);
+    LittleFS.remove(path);
+    segment_head = (segment_head + 1) % SPOOL_MAX_SEGMENTS;
+    segment_count--;
+}
+
+bool PacketSpool::flashAppend(const uint8_t *record, size_t length)
+{
+    char path[32];
+    if (!writer_open)
+    {
+        if (segment_count == SPOOL_MAX_SEGMENTS)
+        {
+            dropOldestSegment();
+        }
+        segmentPath(path, sizeof(path), next_segment_id);
+        writer = LittleFS.open(path, "w");
+        if (!writer)
+        {
+            LOG_WARN("Failed to create spool segment %s", path);
+            return false;
+        }
+        Segment &segment = segmentAt(segment_count++);
+        segment.id = next_segment_id++;
+        segment.bytes = 0;
+        segment.packets = 0;
+        writer_open = true;
+    }
+
+    Segment &segment = segmentAt(segment_count - 1);
+    if (writer.write(record, length) != length)
+    {
+        // Whatever part did land sits past segment.bytes and is never read
+        LOG_WARN("Spool segment %lu write failed; sealing it", (unsigned long)segment.id);
+        sealWriter();
+        return false;
+    }
+    segment.bytes += length;
+    segment.packets++;
+    flash_bytes += length;
+    flash_packets++;
+    if (segment.bytes + SPOOL_RECORD_PREFIX + sizeof(AudioPacketHeader) + MAX_PACKET_PAYLOAD_BYTES > SPOOL_SEGMENT_BYTES)
+    {
+        sealWriter();
+    }
+    return true;
+}
+
+void PacketSpool::service(bool use_flash)
+{
+    if (!ram || !flash_ready || !use_flash)
+    {
+        return;
+    }
+
+    uint8_t *scratch = message + PACKET_HEADROOM; // Free outside prepare()/consume()
+    size_t moved = 0;
+    while (ram_packets > 0 && ram_used * 100 > ram_capacity * SPOOL_SPILL_PERCENT && moved < SPOOL_SPILL_CHUNK_BYTES)
+    {
+        const size_t record = SPOOL_RECORD_PREFIX + ramRecordLength(ram_head);
+        ramCopyOut(ram_head, scratch, record);
+        if (!flashAppend(scratch, record))
+        {
+            break;
+        }
+        ram_head = (ram_head + record) % ram_capacity;
+        ram_used -= record;
+        ram_packets--;
+        moved += record;
+    }
+    if (moved > 0 && writer_open)
+    {
+        writer.flush();
+    }
+}
+
+// === Draining ===
+size_t PacketSpool::prepare(size_t max_bytes)
+{
+    prepared_bytes = 0;
+    prepared_packets = 0;
+    max_bytes = min(max_bytes, (size_t)SPOOL_MESSAGE_MAX_BYTES);
+    uint8_t *out = message + PACKET_HEADROOM;
+    size_t length = 0;
+
+    if (flash_packets > 0)
+    {
+        prepared_from_flash = true;
+        if (segment_count == 1)
+        {
+            sealWriter(); // Draining the segment still being written; spills start a new one
+        }
+        Segment &segment = segmentAt(0);
+        if (reader_id != segment.id)
+        {
+            char path[32];
+            segmentPath(path, sizeof(path), segment.id);
+            reader.close();
+            reader = LittleFS.open(path, "r");
+            reader_id = segment.id;
+        }
+        if (!reader || !reader.seek(read_offset))
+        {
+            LOG_WARN("Spool segment %lu unreadable; dropping it", (unsigned long)segment.id);
+            dropOldestSegment();
+            return 0;
+        }
+
+        uint32_t offset = read_offset;
+        while (offset < segment.bytes)
+        {
+            uint8_t prefix[SPOOL_RECORD_PREFIX];
+            if (reader.read(prefix, SPOOL_RECORD_PREFIX) != SPOOL_RECORD_PREFIX)
+            {
+                break;
+            }
+            const size_t record_length = prefix[0] | prefix[1] << 8;
+            if (length + record_length > max_bytes || reader.read(out + length, record_length) != record_length)
+            {
+                break;
+            }
+            length += record_length;
+            offset += SPOOL_RECORD_PREFIX + record_length;
+            prepared_packets++;
+        }
+        prepared_bytes = offset - read_offset;
+        return length;
+    }
+
+    prepared_from_flash = false;
+    size_t offset = ram_head;
+    for (uint32_t i = 0; i < ram_packets; ++i)
+    {
+        const size_t record_length = ramRecordLength(offset);
+        if (length + record_length > max_bytes)
+        {
+            break;
+        }
+        ramCopyOut((offset + SPOOL_RECORD_PREFIX) % ram_capacity, out + length, record_length);
+        length += record_length;
+        offset = (offset + SPOOL_RECORD_PREFIX + record_length) % ram_capacity;
+        prepared_bytes += SPOOL_RECORD_PREFIX + record_length;
+        prepared_packets++;
+    }
+    return length;
+}
+
+void PacketSpool::consume()
+{
+    if (prepared_packets == 0)
+    {
+        return;
+    }
+
+    if (prepared_from_flash)
+    {
+        Segment &segment = segmentAt(0);
+        read_offset += prepared_bytes;
+        segment.packets -= prepared_packets;
+        flash_packets -= prepared_packets;
+        flash_bytes -= prepared_bytes;
+        if (segment.packets == 0)
+        {
+            dropOldestSegment(); // Nothing left in it, so nothing is counted as dropped
+        }
+    }
+    else
+    {
+        ram_head = (ram_head + prepared_bytes) % ram_capacity;
+        ram_used -= prepared_bytes;
+        ram_packets -= prepared_packets;
+    }
+
+    drained += prepared_packets;
+    prepared_bytes = 0;
+    prepared_packets = 0;
+}
+
+void PacketSpool::fillStats(SpoolStats &stats) const
+{
+    stats.ram_capacity = ram_capacity;
+    stats.ram_bytes = ram_used;
+    stats.flash_capacity = flash_ready ? SPOOL_MAX_SEGMENTS * SPOOL_SEGMENT_BYTES : 0;
+    stats.flash_bytes = flash_bytes;
+    stats.packets = ram_packets + flash_packets;
+    stats.spooled = spooled;
+    stats.drained = drained;
+    stats.dropped_packets = dropped_packets;
+    stats.dropped_bytes = dropped_bytes;
+}
@@ -0,0 +1,177 @@
+// src/power_manager.cpp
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_timer.h>
+
+#if __has_include("sdkconfig.h")
+#include "sdkconfig.h"
+#endif
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#include <esp_idf_version.h>
+#endif
+
+#include "power_manager.h"
+#include "settings_manager.h"
+#include "logging.h"
+
+static uint8_t power_mode = POWER_MODE_FULL;
+static uint8_t power_state = POWER_STATE_IDLE;
+static uint64_t state_since_us = 0;
+static uint64_t state_us[POWER_STATE_COUNT] = {};
+static uint32_t transitions = 0;
+static uint32_t wake_us_max = 0;
+static uint64_t busy_us = 0;
+static uint64_t boot_us = 0;
+static bool modem_sleep = false;
+static bool radio_pending = true; // Radio setting not yet accepted by the WiFi driver
+static bool radio_connected = false;
+
+#if CONFIG_PM_ENABLE
+// With the PM framework the idle clock is its minimum and detections hold this lock
+static esp_pm_lock_handle_t cpu_lock = nullptr;
+static bool cpu_lock_held = false;
+#endif
+
+static bool wantsFullPower()
+{
+    return power_mode == POWER_MODE_FULL || power_state == POWER_STATE_ACTIVE;
+}
+
+static void applyCpu()
+{
+    const bool full = wantsFullPower();
+#if CONFIG_PM_ENABLE
+    if (cpu_lock)
+    {
+        if (full && !cpu_lock_held)
+        {
+            esp_pm_lock_acquire(cpu_lock);
+        }
+        else if (!full && cpu_lock_held)
+        {
+            esp_pm_lock_release(cpu_lock);
+        }
+        cpu_lock_held = full;
+        return;
+    }
+#endif
+    const uint32_t mhz = full ? POWER_ACTIVE_CPU_MHZ : POWER_IDLE_CPU_MHZ;
+    if (getCpuFrequencyMhz() != mhz)
+    {
+        setCpuFrequencyMhz(mhz);
+    }
+}
+
+// Modem sleep only makes sense (and is only accepted) while associated
+static void applyRadio()
+{
+    if (!radio_connected)
+    {
+        radio_pending = true;
+        return;
+    }
+    const bool doze = !wantsFullPower();
+    radio_pending = !WiFi.setSleep(doze ? WIFI_PS_MAX_MODEM : WIFI_PS_NONE);
+    if (!radio_pending)
+    {
+        modem_sleep = doze;
+    }
+}
+
+static void setMode(uint8_t mode)
+{
+    power_mode = mode == POWER_MODE_LOW ? POWER_MODE_LOW : POWER_MODE_FULL;
+    applyCpu();
+    applyRadio();
+    LOG_INFO("Power mode: %s", power_mode == POWER_MODE_LOW ? "low (scaling + modem sleep when idle)" : "full");
+}
+
+void powerBegin(uint8_t mode)
+{
+    boot_us = esp_timer_get_time();
+    state_since_us = boot_us;
+
+#if CONFIG_PM_ENABLE
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    esp_pm_config_t pm_config = {};
+#else
+    esp_pm_config_esp32s3_t pm_config = {};
+#endif
+    pm_config.max_freq_mhz = POWER_ACTIVE_CPU_MHZ;
+    pm_config.min_freq_mhz = POWER_IDLE_CPU_MHZ;
+    pm_config.light_sleep_enable = false;
+    if (esp_pm_configure(&pm_config) != ESP_OK || esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "detection", &cpu_lock) != ESP_OK)
+    {
+        LOG_WARN("Power management framework unavailable; scaling the CPU clock directly");
+        cpu_lock = nullptr;
+    }
+#endif
+    setMode(mode);
+}
+
+void powerSetActive(bool active)
+{
+    const uint8_t next = active ? POWER_STATE_ACTIVE : POWER_STATE_IDLE;
+    if (next == power_state)
+    {
+        return;
+    }
+
+    const uint64_t now_us = esp_timer_get_time();
+    state_us[power_state] += now_us - state_since_us;
+    state_since_us = now_us;
+    power_state = next;
+
+    applyCpu();
+    applyRadio();
+    if (active)
+    {
+        transitions++;
+        const uint32_t wake_us = (uint32_t)(esp_timer_get_time() - now_us);
+        wake_us_max = max(wake_us_max, wake_us);
+    }
+}
+
+void powerService()
+{
+    if (Settings.settings.power_mode != power_mode)
+    {
+        setMode(Settings.settings.power_mode);
+    }
+
+    // Re-applied whenever the link comes up; before that the driver rejects it
+    const bool connected = WiFi.status() == WL_CONNECTED;
+    if (connected != radio_connected)
+    {
+        radio_connected = connected;
+        radio_pending = true;
+    }
+    if (radio_pending && radio_connected)
+    {
+        applyRadio();
+    }
+}
+
+void powerAccountBusy(uint32_t elapsed_us)
+{
+    busy_us += elapsed_us;
+}
+
+void powerFillStats(PowerStats &stats)
+{
+    const uint64_t now_us = esp_timer_get_time();
+    for (size_t i = 0; i < POWER_STATE_COUNT; ++i)
+    {
+        stats.state_us[i] = state_us[i];
+    }
+    stats.state_us[power_state] += now_us - state_since_us;
+    stats.transitions = transitions;
+    stats.wake_us_max = wake_us_max;
+    stats.busy_us = busy_us;
+    stats.uptime_us = now_us - boot_us;
+    stats.cpu_mhz = (uint16_t)getCpuFrequencyMhz();
+    stats.state = power_state;
+    stats.modem_sleep = modem_sleep;
+}
@@ -1,4 +1,5 @@
 #include <Arduino.h>
+#include <stdarg.h>
 #include <ESPAsyncWebServer.h>
 #include <AsyncJson.h>
 #include <ArduinoJson.h>
@@ -6,16 +7,575 @@
 #include "settings_api.h"
 #include "settings_web.h"
 #include "settings_manager.h"
+#include "audio_capture.h"
+#include "audio_packet.h"
+#include "packet_spool.h"
+#include "udp_transport.h"
+#include "synthetic_source.h"
+#include "trigger.h"
+#include "live_monitor.h"
+#include "spectral_detector.h"
+#include "mel_features.h"
+#include "audio_dsp.h"
+#include "metrics.h"
+#include "time_sync.h"
+#include "flow_control.h"
+#include "memory_policy.h"
 
 extern AsyncWebServer server;
-extern float current_rms;
-extern int16_t current_peak;
-extern bool transmitting;
-extern int16_t *latest_samples;
-extern size_t latest_sample_index;
-extern size_t latest_sample_capacity;
 unsigned long boot_time = 0;
 
+// === /status.json ===
+// The response is written with snprintf into buffers allocated once at boot.
+// The config part only changes through /control.json, so it is formatted
+// into its own cache then and copied in verbatim; each poll only formats
+// the live fields and the sample window. Polls closer together than
+// STATUS_CACHE_MS (several dashboards, several tabs) share one rendering.
+// Two buffers alternate; a new rendering only goes into one no response is
+// still reading, and while both are busy the current one is served again.
+#define STATUS_CACHE_MS 50
+#define STATUS_CONFIG_BYTES 1536
+#define STATUS_LIVE_BYTES 6144
+#define STATUS_BYTES_PER_SAMPLE 7 // "-32768,"
+
+// beginResponse() does not copy the body: it is read out of the buffer as
+// the client ACKs it, until the connection closes. in_flight counts those
+// responses, so a buffer is only rewritten once nothing reads it any more.
+// Responses start and end on the async_tcp task, which is the only one
+// that renders, so the count needs no lock.
+struct ResponseBuffer {
+    char *data = nullptr;
+    size_t capacity = 0;
+    size_t length = 0;
+    uint8_t in_flight = 0;
+};
+
+static void sendBuffer(AsyncWebServerRequest *request, const char *type, ResponseBuffer *buffer) {
+    buffer->in_flight++;
+    request->onDisconnect([buffer]() { buffer->in_flight--; });
+    request->send(request->beginResponse(200, type, (const uint8_t *)buffer->data, buffer->length));
+}
+
+static ResponseBuffer status_buffers[2];
+static size_t status_current = 0;
+static unsigned long status_rendered_ms = 0;
+static bool status_valid = false;
+static char status_config[STATUS_CONFIG_BYTES];
+static size_t status_config_length = 0;
+static volatile bool status_config_dirty = true;
+static AudioSettings status_settings; // Snapshot the config section was rendered from
+
+// Bounded appender: never writes past capacity, remembers if it had to stop
+struct JsonWriter {
+    char *out;
+    size_t capacity;
+    size_t length;
+    bool overflow;
+
+    JsonWriter(char *buffer, size_t size) : out(buffer), capacity(size), length(0), overflow(false) {}
+
+    void append(const char *text, size_t n) {
+        if (length + n >= capacity) {
+            overflow = true;
+            return;
+        }
+        memcpy(out + length, text, n);
+        length += n;
+        out[length] = '\0';
+    }
+
+    void printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+        if (overflow) {
+            return;
+        }
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(out + length, capacity - length, format, args);
+        va_end(args);
+        if (n < 0 || (size_t)n >= capacity - length) {
+            overflow = true;
+            out[length] = '\0';
+            return;
+        }
+        length += n;
+    }
+
+    // JSON string with quotes and minimal escaping
+    void string(const char *text) {
+        append("\"", 1);
+        for (const char *c = text; *c; ++c) {
+            if (*c == '"' || *c == '\\') {
+                append("\\", 1);
+            }
+            if ((uint8_t)*c >= 0x20) {
+                append(c, 1);
+            }
+        }
+        append("\"", 1);
+    }
+
+    // Faster than printf("%d,") for the sample window
+    void integer(int32_t value) {
+        char digits[12];
+        char *p = digits + sizeof(digits);
+        uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+        do {
+            *--p = '0' + magnitude % 10;
+            magnitude /= 10;
+        } while (magnitude);
+        if (value < 0) {
+            *--p = '-';
+        }
+        append(p, digits + sizeof(digits) - p);
+    }
+};
+
+// Sized for STATUS_SAMPLES_MAX so status_sample_count can change at runtime
+// (a response may still be reading a buffer, so they are never reallocated)
+static bool allocateStatusBuffers() {
+    const size_t capacity = STATUS_CONFIG_BYTES + STATUS_LIVE_BYTES + STATUS_SAMPLES_MAX * STATUS_BYTES_PER_SAMPLE;
+    for (ResponseBuffer &buffer : status_buffers) {
+        buffer.data = (char *)memoryAlloc(MEMORY_BULK, capacity, "status buffer");
+        if (!buffer.data) {
+            return false;
+        }
+        buffer.capacity = capacity;
+    }
+    return true;
+}
+
+// Per-capability heap figures and where each registered buffer went
+static void renderMemory(JsonWriter &json) {
+    MemoryStats memory;
+    memoryFillStats(memory);
+    const struct {
+        const char *name;
+        const HeapRegionStats &region;
+    } regions[] = {{"internal", memory.internal}, {"dma", memory.dma}, {"psram", memory.psram}};
+    for (const auto &heap : regions) {
+        json.printf("\"heap_%s_free\":%lu,\"heap_%s_largest\":%lu,\"heap_%s_min_free\":%lu,\"heap_%s_total\":%lu,",
+                    heap.name, (unsigned long)heap.region.free, heap.name, (unsigned long)heap.region.largest,
+                    heap.name, (unsigned long)heap.region.min_free, heap.name, (unsigned long)heap.region.total);
+    }
+    for (uint8_t cls = 0; cls < MEMORY_CLASS_COUNT; ++cls) {
+        json.printf("\"memory_%s_bytes\":%lu,\"memory_%s_psram_bytes\":%lu,", memoryClassName(cls),
+                    (unsigned long)memory.class_bytes[cls], memoryClassName(cls), (unsigned long)memory.class_psram_bytes[cls]);
+    }
+    json.printf("\"memory_fallbacks\":%u,\"memory_failures\":%u,", memory.fallbacks, memory.failures);
+
+    MemoryBlock blocks[MEMORY_MAX_BLOCKS];
+    const size_t count = memoryBlocks(blocks, MEMORY_MAX_BLOCKS);
+    json.append("\"memory_blocks\":[", 17);
+    for (size_t i = 0; i < count; ++i) {
+        json.printf("%s{\"what\":\"%s\",\"bytes\":%lu,\"class\":\"%s\",\"psram\":%s}", i ? "," : "", blocks[i].what,
+                    (unsigned long)blocks[i].bytes, memoryClassName(blocks[i].cls), blocks[i].psram ? "true" : "false");
+    }
+    json.append("],", 2);
+}
+
+// Consistent copy of the network task's per-frame state. If the copy keeps
+// tearing (should not happen) the previous one is reused. Only called from
+// the web server task, which serves one request at a time.
+static const StatusSnapshot &latestSnapshot() {
+    static StatusSnapshot snapshot;
+    static StatusSnapshot scratch;
+    if (status_snapshot.read(scratch)) {
+        memcpy(&snapshot, &scratch, sizeof(snapshot));
+    }
+    return snapshot;
+}
+
+// Everything that only changes when settings do. Ends with a ','.
+static void renderStatusConfig() {
+    status_settings = Settings.snapshot();
+    JsonWriter json(status_config, sizeof(status_config));
+    json.printf("\"threshold\":%.4f,", status_settings.trigger_rms_threshold);
+    json.printf("\"timeout\":%lu,", (unsigned long)status_settings.trigger_timeout_ms);
+    json.printf("\"trigger_mode\":%u,", status_settings.trigger_mode);
+    json.printf("\"band_low_hz\":%.0f,", status_settings.band_low_hz);
+    json.printf("\"band_high_hz\":%.0f,", status_settings.band_high_hz);
+    json.printf("\"spectral_threshold_db\":%.1f,", status_settings.spectral_threshold_db);
+    json.printf("\"preroll_ms\":%u,", status_settings.preroll_ms);
+    json.printf("\"sample_rate\":%lu,", (unsigned long)status_settings.sample_rate);
+    json.printf("\"output_sample_rate\":%lu,", (unsigned long)status_settings.output_sample_rate);
+    json.printf("\"dma_buf_count\":%u,", status_settings.dma_buf_count);
+    json.printf("\"dma_buf_len\":%u,", status_settings.dma_buf_len);
+    json.printf("\"dma_buffer_ms\":%.1f,", status_settings.dma_buf_count * status_settings.dma_buf_len * 1000.0f / status_settings.sample_rate);
+    json.printf("\"use_apll\":%s,", status_settings.use_apll ? "true" : "false");
+    json.printf("\"channels\":%u,", status_settings.channels);
+    json.append("\"wifi_ssid\":", 12);
+    json.string(status_settings.wifi_ssid.c_str());
+    json.append(",\"ws_server\":", 13);
+    json.string(status_settings.ws_server.c_str());
+    json.printf(",\"ws_port\":%ld,", status_settings.ws_port.toInt());
+    json.append("\"ntp_server\":", 13);
+    json.string(status_settings.ntp_server.c_str());
+    json.append(",", 1);
+    json.printf("\"simulate_mic\":%s,", status_settings.simulate_mic ? "true" : "false");
+    json.printf("\"sim_signal\":%u,", status_settings.sim_signal);
+    json.printf("\"sim_freq_hz\":%.0f,", status_settings.sim_freq_hz);
+    json.printf("\"sim_freq_end_hz\":%.0f,", status_settings.sim_freq_end_hz);
+    json.printf("\"sim_level\":%.3f,", status_settings.sim_level);
+    json.printf("\"sim_duty_pct\":%u,", status_settings.sim_duty_pct);
+    json.printf("\"sim_period_ms\":%u,", status_settings.sim_period_ms);
+    json.printf("\"status_sample_count\":%u,", status_settings.status_sample_count);
+    json.printf("\"power_mode\":%u,", status_settings.power_mode);
+    json.printf("\"spool_enabled\":%s,", status_settings.spool_enabled ? "true" : "false");
+    json.printf("\"spool_flash\":%s,", status_settings.spool_flash ? "true" : "false");
+    json.printf("\"spool_drain_kbps\":%u,", status_settings.spool_drain_kbps);
+    json.printf("\"transport\":%u,", status_settings.transport);
+    json.printf("\"udp_port\":%u,", status_settings.udp_port);
+    json.printf("\"flow_auto\":%s,", status_settings.flow_auto ? "true" : "false");
+    json.printf("\"gain\":%.2f,", status_settings.gain);
+    json.printf("\"dc_block\":%s,", status_settings.dc_block ? "true" : "false");
+    json.printf("\"highpass_hz\":%u,", status_settings.highpass_hz);
+    json.printf("\"output_bits\":%u,", status_settings.output_bits);
+    json.printf("\"codec\":%u,", status_settings.codec);
+    json.printf("\"output_mode\":%u,", status_settings.output_mode);
+    json.printf("\"led_brightness\":%u,", status_settings.led_brightness);
+    json.printf("\"capture_ring_frames\":%u,", (unsigned)capture_ring.capacity());
+    json.printf("\"batch_max_bytes\":%u,", status_settings.batch_max_bytes);
+    json.printf("\"batch_max_delay_ms\":%u,", status_settings.batch_max_delay_ms);
+    json.printf("\"live_rate_hz\":%u,", status_settings.live_rate_hz);
+    if (json.overflow) {
+        Serial.println("[WARN] /status.json config section truncated");
+    }
+    status_config_length = json.length;
+}
+
+static void renderStatus(ResponseBuffer &buffer) {
+    if (status_config_dirty) {
+        status_config_dirty = false;
+        renderStatusConfig();
+    }
+
+    const StatusSnapshot &snapshot = latestSnapshot();
+    JsonWriter json(buffer.data, buffer.capacity);
+    json.append("{", 1);
+    json.append(status_config, status_config_length);
+
+    json.printf("\"rms\":%.5f,", snapshot.rms);
+    json.printf("\"peak\":%d,", snapshot.peak);
+    json.printf("\"capture_channels\":%u,", snapshot.channels);
+    json.printf("\"trigger_channels\":%u,", snapshot.trigger_channels); // Bit per channel above the trigger
+    json.append("\"channel_rms\":[", 15);
+    for (uint8_t c = 0; c < snapshot.channels; ++c) {
+        json.printf(c ? ",%.5f" : "%.5f", snapshot.channel_rms[c]);
+    }
+    json.append("],\"channel_peak\":[", 18);
+    for (uint8_t c = 0; c < snapshot.channels; ++c) {
+        json.printf(c ? ",%d" : "%d", snapshot.channel_peak[c]);
+    }
+    json.append("],", 2);
+    json.printf("\"triggered\":%s,", snapshot.triggered ? "true" : "false");
+    json.printf("\"trigger_state\":\"%s\",", triggerStateName((TriggerState)snapshot.trigger_state));
+    json.printf("\"preroll_frames\":%u,", snapshot.preroll_frames);
+    json.printf("\"preroll_depth\":%u,", snapshot.preroll_depth);
+    json.printf("\"preroll_capacity\":%u,", snapshot.preroll_capacity);
+    json.printf("\"frames\":%lu,", (unsigned long)snapshot.frames);
+    json.printf("\"spectral_band_db\":%.1f,", snapshot.band_db);
+    json.printf("\"spectral_floor_db\":%.1f,", snapshot.floor_db);
+    json.printf("\"spectral_snr_db\":%.1f,", snapshot.band_db - snapshot.floor_db);
+    json.printf("\"spectral_analyses\":%lu,", (unsigned long)snapshot.detector.analyses);
+    json.printf("\"spectral_us\":%.1f,", snapshot.detector.analyse_us);
+    json.printf("\"spectral_us_max\":%lu,", (unsigned long)snapshot.detector.analyse_us_max);
+    // A frame holds MAX_SAMPLES_PER_READ words of all channels together
+    const float frame_samples = (float)MAX_SAMPLES_PER_READ / max(snapshot.channels, (uint8_t)1);
+    json.printf("\"spectral_budget_us\":%.0f,", frame_samples * 1e6f / status_settings.sample_rate);
+    json.printf("\"spectral_cpu_pct\":%.2f,", snapshot.detector.analyse_us * status_settings.sample_rate / (frame_samples * 10000.0f));
+    json.printf("\"uptime_ms\":%lu,", millis() - boot_time);
+    json.printf("\"wifi_rssi\":%d,", (int)WiFi.RSSI());
+    json.printf("\"link_state\":\"%s\",", systemStateName(snapshot.link.state));
+    json.printf("\"wifi_attempts\":%lu,", (unsigned long)snapshot.link.wifi_attempts);
+    json.printf("\"ws_attempts\":%lu,", (unsigned long)snapshot.link.ws_attempts);
+    json.printf("\"link_retry_ms\":%lu,", (unsigned long)snapshot.link.retry_in_ms);
+
+    const TimeSyncStats &clock = snapshot.time_sync;
+    json.printf("\"time_source\":\"%s\",", timeSourceName(clock.source));
+    json.printf("\"time_capture_unix_ms\":%lld,",
+                clock.source != TIME_SOURCE_NONE ? (long long)(((int64_t)snapshot.timestamp + clock.offset_us) / 1000) : 0LL);
+    json.printf("\"time_rtt_ms\":%.2f,", clock.rtt_us / 1000.0f);
+    json.printf("\"time_offset_age_ms\":%lu,", (unsigned long)clock.age_ms);
+    json.printf("\"time_last_step_ms\":%.2f,", clock.last_step_us / 1000.0f);
+    json.printf("\"time_pings\":%lu,", (unsigned long)clock.pings);
+    json.printf("\"time_pongs\":%lu,", (unsigned long)clock.pongs);
+    json.printf("\"time_pongs_rejected\":%lu,", (unsigned long)clock.rejected);
+    json.printf("\"heap\":%u,", (unsigned)ESP.getFreeHeap());
+    renderMemory(json);
+    json.printf("\"codec_frames\":%lu,", (unsigned long)snapshot.codec.frames);
+    json.printf("\"codec_ratio\":%.2f,", snapshot.codec.ratio);
+    json.printf("\"codec_encode_us\":%.1f,", snapshot.codec.encode_us);
+    json.printf("\"codec_encode_us_max\":%lu,", (unsigned long)snapshot.codec.encode_us_max);
+    json.printf("\"codec_cpu_pct\":%.2f,", snapshot.codec.encode_us * status_settings.sample_rate / (MAX_SAMPLES_PER_READ * 10000.0f));
+    json.printf("\"features_available\":%s,", melFilterbankFor(status_settings.sample_rate) ? "true" : "false");
+    json.printf("\"feature_frames\":%lu,", (unsigned long)snapshot.features.frames);
+    json.printf("\"feature_packets\":%lu,", (unsigned long)snapshot.features.packets);
+    json.printf("\"feature_bytes\":%llu,", (unsigned long long)snapshot.features.bytes);
+    json.printf("\"feature_dropped\":%lu,", (unsigned long)snapshot.features.dropped);
+    json.printf("\"feature_us\":%.1f,", snapshot.features.compute_us);
+    json.printf("\"feature_us_max\":%lu,", (unsigned long)snapshot.features.compute_us_max);
+    json.printf("\"capture_overruns\":%lu,", (unsigned long)capture_overruns);
+    json.printf("\"i2s_dma_overflows\":%lu,", (unsigned long)snapshot.capture.dma_overflows);
+    json.printf("\"i2s_dma_errors\":%lu,", (unsigned long)snapshot.capture.dma_errors);
+    json.printf("\"i2s_apll\":%s,", snapshot.capture.apll ? "true" : "false");
+    json.printf("\"i2s_clock_hz\":%.2f,", snapshot.capture.clock_hz);
+    json.printf("\"capture_rate_hz\":%.2f,", snapshot.capture.measured_rate_hz);
+    json.printf("\"i2s_reconfigurations\":%lu,", (unsigned long)snapshot.reconfig.count);
+    json.printf("\"i2s_reconfig_failures\":%lu,", (unsigned long)snapshot.reconfig.failures);
+    json.printf("\"i2s_reconfig_downtime_ms\":%.1f,", snapshot.reconfig.last_downtime_us / 1000.0f);
+    json.printf("\"i2s_reconfig_max_downtime_ms\":%.1f,", snapshot.reconfig.max_downtime_us / 1000.0f);
+    json.printf("\"i2s_reinstall_ms\":%.1f,", snapshot.capture.reinstall_us / 1000.0f);
+    json.printf("\"i2s_stale_frames\":%lu,", (unsigned long)snapshot.reconfig.stale_frames);
+    json.printf("\"capture_rate_ppm\":%.0f,",
+                snapshot.capture.measured_rate_hz > 0.0f ? (snapshot.capture.measured_rate_hz / status_settings.sample_rate - 1.0f) * 1e6f : 0.0f);
+    json.printf("\"capture_ring_fill\":%u,", (unsigned)capture_ring.size());
+    json.printf("\"packet_pool_free\":%u,", (unsigned)packet_pool.available());
+    json.printf("\"packet_pool_exhausted\":%lu,", (unsigned long)packet_pool.exhaustedCount());
+    json.printf("\"batches_sent\":%lu,", (unsigned long)packet_batch.batchesSent());
+    json.printf("\"batch_avg_packets\":%.2f,", packet_batch.averagePackets());
+    json.printf("\"batch_avg_bytes\":%.0f,", packet_batch.averageBytes());
+    json.printf("\"batch_avg_fill_pct\":%.1f,",
+                status_settings.batch_max_bytes ? 100.0f * packet_batch.averageBytes() / status_settings.batch_max_bytes : 0.0f);
+
+    const PowerStats &power = snapshot.power;
+    const float uptime_ms = power.uptime_us / 1000.0f;
+    json.printf("\"power_state\":\"%s\",", power.state == POWER_STATE_ACTIVE ? "active" : "idle");
+    json.printf("\"cpu_mhz\":%u,", power.cpu_mhz);
+    json.printf("\"modem_sleep\":%s,", power.modem_sleep ? "true" : "false");
+    json.printf("\"time_idle_ms\":%llu,", (unsigned long long)(power.state_us[POWER_STATE_IDLE] / 1000));
+    json.printf("\"time_active_ms\":%llu,", (unsigned long long)(power.state_us[POWER_STATE_ACTIVE] / 1000));
+    json.printf("\"duty_cycle_pct\":%.2f,", uptime_ms > 0.0f ? 100.0f * power.state_us[POWER_STATE_ACTIVE] / power.uptime_us : 0.0f);
+    json.printf("\"power_transitions\":%lu,", (unsigned long)power.transitions);
+    json.printf("\"wake_us_max\":%lu,", (unsigned long)power.wake_us_max);
+    json.printf("\"network_busy_pct\":%.2f,", uptime_ms > 0.0f ? 100.0f * power.busy_us / power.uptime_us : 0.0f);
+
+    const SpoolStats &spool = snapshot.spool;
+    json.printf("\"spool_packets\":%lu,", (unsigned long)spool.packets);
+    json.printf("\"spool_ram_bytes\":%lu,", (unsigned long)spool.ram_bytes);
+    json.printf("\"spool_ram_capacity\":%lu,", (unsigned long)spool.ram_capacity);
+    json.printf("\"spool_ram_fill_pct\":%.1f,", spool.ram_capacity ? 100.0f * spool.ram_bytes / spool.ram_capacity : 0.0f);
+    json.printf("\"spool_flash_bytes\":%lu,", (unsigned long)spool.flash_bytes);
+    json.printf("\"spool_flash_capacity\":%lu,", (unsigned long)spool.flash_capacity);
+    json.printf("\"spool_flash_fill_pct\":%.1f,", spool.flash_capacity ? 100.0f * spool.flash_bytes / spool.flash_capacity : 0.0f);
+    json.printf("\"spool_spooled\":%lu,", (unsigned long)spool.spooled);
+    json.printf("\"spool_drained\":%lu,", (unsigned long)spool.drained);
+    json.printf("\"spool_dropped\":%lu,", (unsigned long)spool.dropped_packets);
+    json.printf("\"spool_dropped_bytes\":%llu,", (unsigned long long)spool.dropped_bytes);
+    json.printf("\"nvs_writes\":%lu,", (unsigned long)Settings.nvsWrites());
+    json.printf("\"nvs_saves\":%lu,", (unsigned long)Settings.nvsSaves());
+
+    const UdpStats &udp = snapshot.udp;
+    json.printf("\"udp_ready\":%s,", udp.ready ? "true" : "false");
+    json.printf("\"udp_datagrams\":%lu,", (unsigned long)udp.datagrams);
+    json.printf("\"udp_send_errors\":%lu,", (unsigned long)udp.send_errors);
+    json.printf("\"udp_bytes\":%llu,", (unsigned long long)udp.bytes);
+    json.printf("\"udp_peer_received\":%lu,", (unsigned long)udp.peer_received);
+    json.printf("\"udp_peer_lost\":%lu,", (unsigned long)udp.peer_lost);
+    json.printf("\"udp_peer_reordered\":%lu,", (unsigned long)udp.peer_reordered);
+    json.printf("\"udp_peer_late\":%lu,", (unsigned long)udp.peer_late);
+    json.printf("\"udp_loss_pct\":%.2f,",
+                udp.peer_received + udp.peer_lost ? 100.0f * udp.peer_lost / (udp.peer_received + udp.peer_lost) : 0.0f);
+    const FlowStats &flow = snapshot.flow;
+    json.printf("\"flow_paused\":%s,", flow.paused ? "true" : "false");
+    json.printf("\"flow_server_limits\":%s,", flow.server_limits ? "true" : "false");
+    json.printf("\"flow_auto_level\":%u,", flow.auto_level);
+    json.printf("\"flow_requests\":%lu,", (unsigned long)flow.requests);
+    json.printf("\"flow_auto_changes\":%lu,", (unsigned long)flow.auto_changes);
+    json.printf("\"flow_paused_ms\":%lu,", (unsigned long)flow.paused_ms);
+    json.printf("\"live_clients\":%u,", (unsigned)liveMonitorClients());
+    json.printf("\"live_dropped\":%lu,", (unsigned long)liveMonitorDropped());
+
+    json.append("\"samples\":[", 11);
+    for (size_t i = 0; i < snapshot.sample_count; ++i) {
+        if (i > 0) {
+            json.append(",", 1);
+        }
+        json.integer(snapshot.samples[i]);
+    }
+    json.append("]}", 2);
+
+    if (json.overflow) {
+        Serial.printf("[WARN] /status.json truncated at %u bytes\n", (unsigned)buffer.capacity);
+    }
+    buffer.length = json.length;
+}
+
+// Renders into the other buffer unless the current rendering is still fresh
+// or the other one is still being sent
+static ResponseBuffer *currentStatus() {
+    if (!status_buffers[0].data) {
+        return nullptr;
+    }
+    const unsigned long now = millis();
+    if (!status_valid || status_config_dirty || now - status_rendered_ms >= STATUS_CACHE_MS) {
+        const size_t next = status_valid ? status_current ^ 1 : status_current;
+        if (status_buffers[next].in_flight == 0) {
+            renderStatus(status_buffers[next]);
+            status_current = next;
+            status_rendered_ms = now;
+            status_valid = true;
+        }
+    }
+    return &status_buffers[status_current];
+}
+
+// === /metrics ===
+// Prometheus text exposition (format 0.0.4) of the hot-path histograms and
+// pipeline counters, rendered per scrape into whichever of two buffers
+// allocated at boot no response is still reading. With both busy the scrape
+// gets the latest rendering again.
+#define METRICS_BYTES 9216
+
+static ResponseBuffer metrics_buffers[2];
+static size_t metrics_current = 0;
+
+static void renderStageFamily(JsonWriter &out, bool cycles, const StageSummary *summaries) {
+    const char *family = cycles ? "chirp_stage_cycles" : "chirp_stage_seconds";
+    const double scale = cycles ? 1.0 : 1e-6;
+    out.printf("# HELP %s %s per call of a hot-path stage; quantiles over the last %u-%u s, sum and count since boot\n",
+               family, cycles ? "CPU cycles" : "Wall time", METRICS_WINDOW_MS / 1000, 2 * METRICS_WINDOW_MS / 1000);
+    out.printf("# TYPE %s summary\n", family);
+    for (uint8_t i = 0; i < METRIC_STAGE_COUNT; ++i) {
+        const MetricStage stage = (MetricStage)i;
+        if (metricStageInCycles(stage) != cycles) {
+            continue;
+        }
+        const StageSummary &summary = summaries[i];
+        const char *name = metricStageName(stage);
+        out.printf("%s{stage=\"%s\",quantile=\"0.5\"} %.9g\n", family, name, summary.p50 * scale);
+        out.printf("%s{stage=\"%s\",quantile=\"0.99\"} %.9g\n", family, name, summary.p99 * scale);
+        out.printf("%s_sum{stage=\"%s\"} %.9g\n", family, name, summary.sum * scale);
+        out.printf("%s_count{stage=\"%s\"} %llu\n", family, name, (unsigned long long)summary.count);
+    }
+    out.printf("# HELP %s_max Largest value over the same window\n# TYPE %s_max gauge\n", family, family);
+    for (uint8_t i = 0; i < METRIC_STAGE_COUNT; ++i) {
+        const MetricStage stage = (MetricStage)i;
+        if (metricStageInCycles(stage) == cycles) {
+            out.printf("%s_max{stage=\"%s\"} %.9g\n", family, metricStageName(stage), summaries[i].max * scale);
+        }
+    }
+}
+
+static void renderMetric(JsonWriter &out, const char *name, const char *type, const char *help) {
+    out.printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static size_t renderMetrics(char *buffer) {
+    StageSummary summaries[METRIC_STAGE_COUNT];
+    for (uint8_t i = 0; i < METRIC_STAGE_COUNT; ++i) {
+        stage_metrics[i].summarize(summaries[i]);
+    }
+    const StatusSnapshot &snapshot = latestSnapshot();
+    JsonWriter out(buffer, METRICS_BYTES);
+
+    renderStageFamily(out, true, summaries);
+    renderStageFamily(out, false, summaries);
+
+    renderMetric(out, "chirp_frames_captured_total", "counter", "Frames read from I2S (or the synthetic source)");
+    out.printf("chirp_frames_captured_total %lu\n", (unsigned long)snapshot.capture.frames);
+    renderMetric(out, "chirp_frames_processed_total", "counter", "Frames taken off the capture ring by the network task");
+    out.printf("chirp_frames_processed_total %lu\n", (unsigned long)snapshot.frames);
+    renderMetric(out, "chirp_frames_dropped_total", "counter", "Frames or packets lost before reaching the link");
+    out.printf("chirp_frames_dropped_total{reason=\"ring_overrun\"} %lu\n", (unsigned long)capture_overruns);
+    out.printf("chirp_frames_dropped_total{reason=\"stale_rate\"} %lu\n", (unsigned long)snapshot.reconfig.stale_frames);
+    out.printf("chirp_frames_dropped_total{reason=\"pool_exhausted\"} %lu\n", (unsigned long)packet_pool.exhaustedCount());
+    out.printf("chirp_frames_dropped_total{reason=\"spool_full\"} %lu\n", (unsigned long)snapshot.spool.dropped_packets);
+    renderMetric(out, "chirp_i2s_dma_overflows_total", "counter", "I2S DMA ring overflows (capture task late)");
+    out.printf("chirp_i2s_dma_overflows_total %lu\n", (unsigned long)snapshot.capture.dma_overflows);
+
+    renderMetric(out, "chirp_packets_sent_total", "counter", "Audio packets sent (UDP: datagrams)");
+    out.printf("chirp_packets_sent_total{transport=\"ws\"} %lu\n", (unsigned long)snapshot.ws_send.packets);
+    out.printf("chirp_packets_sent_total{transport=\"udp\"} %lu\n", (unsigned long)snapshot.udp.datagrams);
+    renderMetric(out, "chirp_send_failures_total", "counter", "Sends the transport rejected");
+    out.printf("chirp_send_failures_total{transport=\"ws\"} %lu\n", (unsigned long)snapshot.ws_send.failures);
+    out.printf("chirp_send_failures_total{transport=\"udp\"} %lu\n", (unsigned long)snapshot.udp.send_errors);
+    renderMetric(out, "chirp_sent_bytes_total", "counter", "Audio bytes handed to the transport");
+    out.printf("chirp_sent_bytes_total{transport=\"ws\"} %llu\n", (unsigned long long)snapshot.ws_send.bytes);
+    out.printf("chirp_sent_bytes_total{transport=\"udp\"} %llu\n", (unsigned long long)snapshot.udp.bytes);
+
+    renderMetric(out, "chirp_feature_frames_total", "counter", "Log-mel frames computed in a features output mode");
+    out.printf("chirp_feature_frames_total %lu\n", (unsigned long)snapshot.features.frames);
+    renderMetric(out, "chirp_feature_bytes_total", "counter", "Wire bytes of log-mel packets, headers included");
+    out.printf("chirp_feature_bytes_total %llu\n", (unsigned long long)snapshot.features.bytes);
+    renderMetric(out, "chirp_feature_frames_dropped_total", "counter", "Log-mel frames lost to a full packet pool or no link");
+    out.printf("chirp_feature_frames_dropped_total %lu\n", (unsigned long)snapshot.features.dropped);
+
+    renderMetric(out, "chirp_flow_paused", "gauge", "1 while the receiver has paused live audio");
+    out.printf("chirp_flow_paused %d\n", snapshot.flow.paused ? 1 : 0);
+    renderMetric(out, "chirp_flow_auto_level", "gauge", "Automatic send limit level from send-queue depth (0 = none)");
+    out.printf("chirp_flow_auto_level %u\n", snapshot.flow.auto_level);
+    renderMetric(out, "chirp_flow_paused_seconds_total", "counter", "Time live audio spent paused by the receiver");
+    out.printf("chirp_flow_paused_seconds_total %.3f\n", snapshot.flow.paused_ms / 1000.0);
+
+    const TimeSyncStats &clock = snapshot.time_sync;
+    renderMetric(out, "chirp_time_synced", "gauge", "1 while packets carry a wall-clock capture time, by clock source");
+    for (uint8_t source = TIME_SOURCE_SNTP; source <= TIME_SOURCE_SERVER; ++source) {
+        out.printf("chirp_time_synced{source=\"%s\"} %d\n", timeSourceName(source), clock.source == source ? 1 : 0);
+    }
+    renderMetric(out, "chirp_time_sync_rtt_seconds", "gauge", "Round trip of the time_ping exchange the offset comes from");
+    out.printf("chirp_time_sync_rtt_seconds %.6f\n", clock.rtt_us * 1e-6);
+    renderMetric(out, "chirp_time_sync_age_seconds", "gauge", "Time since the clock offset was last refreshed");
+    out.printf("chirp_time_sync_age_seconds %.3f\n", clock.age_ms / 1000.0);
+    renderMetric(out, "chirp_time_sync_last_step_seconds", "gauge", "Size of the last clock offset correction");
+    out.printf("chirp_time_sync_last_step_seconds %.6f\n", clock.last_step_us * 1e-6);
+
+    renderMetric(out, "chirp_channel_rms", "gauge", "RMS of the last frame per capture channel, 0..1");
+    for (uint8_t c = 0; c < snapshot.channels; ++c) {
+        out.printf("chirp_channel_rms{channel=\"%u\"} %.5f\n", c, snapshot.channel_rms[c]);
+    }
+    renderMetric(out, "chirp_channel_peak", "gauge", "Peak 16-bit sample of the last frame per capture channel");
+    for (uint8_t c = 0; c < snapshot.channels; ++c) {
+        out.printf("chirp_channel_peak{channel=\"%u\"} %d\n", c, snapshot.channel_peak[c]);
+    }
+    renderMetric(out, "chirp_channel_triggered", "gauge", "1 while a capture channel is above the trigger");
+    for (uint8_t c = 0; c < snapshot.channels; ++c) {
+        out.printf("chirp_channel_triggered{channel=\"%u\"} %d\n", c, (snapshot.trigger_channels >> c) & 1);
+    }
+
+    renderMetric(out, "chirp_heap_free_bytes", "gauge", "Free heap now");
+    out.printf("chirp_heap_free_bytes %u\n", (unsigned)ESP.getFreeHeap());
+    renderMetric(out, "chirp_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+    out.printf("chirp_heap_min_free_bytes %u\n", (unsigned)ESP.getMinFreeHeap());
+    MemoryStats memory;
+    memoryFillStats(memory);
+    const struct {
+        const char *caps;
+        const HeapRegionStats &region;
+    } regions[] = {{"internal", memory.internal}, {"dma", memory.dma}, {"psram", memory.psram}};
+    renderMetric(out, "chirp_heap_caps_free_bytes", "gauge", "Free heap now, by capability");
+    for (const auto &heap : regions) {
+        out.printf("chirp_heap_caps_free_bytes{caps=\"%s\"} %lu\n", heap.caps, (unsigned long)heap.region.free);
+    }
+    renderMetric(out, "chirp_heap_caps_min_free_bytes", "gauge", "Lowest free heap since boot, by capability");
+    for (const auto &heap : regions) {
+        out.printf("chirp_heap_caps_min_free_bytes{caps=\"%s\"} %lu\n", heap.caps, (unsigned long)heap.region.min_free);
+    }
+    renderMetric(out, "chirp_heap_caps_largest_free_block_bytes", "gauge", "Largest free block, by capability");
+    for (const auto &heap : regions) {
+        out.printf("chirp_heap_caps_largest_free_block_bytes{caps=\"%s\"} %lu\n", heap.caps, (unsigned long)heap.region.largest);
+    }
+    renderMetric(out, "chirp_memory_allocated_bytes", "gauge", "Bytes in registered buffers, by placement class and heap");
+    for (uint8_t cls = 0; cls < MEMORY_CLASS_COUNT; ++cls) {
+        const uint32_t psram = memory.class_psram_bytes[cls];
+        out.printf("chirp_memory_allocated_bytes{class=\"%s\",heap=\"internal\"} %lu\n", memoryClassName(cls),
+                   (unsigned long)(memory.class_bytes[cls] - psram));
+        out.printf("chirp_memory_allocated_bytes{class=\"%s\",heap=\"psram\"} %lu\n", memoryClassName(cls), (unsigned long)psram);
+    }
+    renderMetric(out, "chirp_capture_ring_frames", "gauge", "Frames waiting for the network task");
+    out.printf("chirp_capture_ring_frames %u\n", (unsigned)capture_ring.size());
+    renderMetric(out, "chirp_capture_rate_hz", "gauge", "Measured capture sample rate");
+    out.printf("chirp_capture_rate_hz %.2f\n", snapshot.capture.measured_rate_hz);
+    renderMetric(out, "chirp_wifi_rssi_dbm", "gauge", "WiFi signal strength");
+    out.printf("chirp_wifi_rssi_dbm %d\n", (int)WiFi.RSSI());
+    renderMetric(out, "chirp_uptime_seconds", "gauge", "Time since boot");
+    out.printf("chirp_uptime_seconds %.3f\n", (millis() - boot_time) / 1000.0);
+
+    if (out.overflow) {
+        Serial.printf("[WARN] /metrics truncated at %u bytes\n", (unsigned)METRICS_BYTES);
+    }
+    return out.length;
+}
+
 const char* methodToString(AsyncWebServerRequest *request) {
     switch (request->method()) {
         case HTTP_GET: return "GET";
@@ -36,120 +596,262 @@ void setupWebEndpoints() {
         request->send(200, "text/html", settings_html);
     });
 
-    server.on("/status.json", HTTP_GET, [](AsyncWebServerRequest *request){
-        String json = "{";
-        json += "\"rms\":" + String(current_rms, 5) + ",";
-        json += "\"peak\":" + String(current_peak) + ",";
-        json += "\"triggered\":" + String(transmitting ? "true" : "false") + ",";
-        json += "\"threshold\":" + String(Settings.settings.trigger_rms_threshold, 4) + ",";
-        json += "\"timeout\":" + String(Settings.settings.trigger_timeout_ms) + ",";
-        json += "\"uptime_ms\":" + String(millis() - boot_time) + ",";
-        json += "\"wifi_rssi\":" + String(WiFi.RSSI()) + ",";
-        json += "\"heap\":" + String(ESP.getFreeHeap()) + ",";
-        json += "\"sample_rate\":" + String(Settings.settings.sample_rate) + ",";
-        json += "\"buffer_len\":" + String(Settings.settings.buffer_len) + ",";
-        json += "\"wifi_ssid\":\"" + Settings.settings.wifi_ssid + "\",";
-        json += "\"ws_server\":\"" + Settings.settings.ws_server + "\",";
-        json += "\"simulate_mic\":" + String(Settings.settings.simulate_mic ? "true" : "false") + ",";
-        json += "\"pwr_offset\":" + String(Settings.settings.simulated_power_offset, 1) + ",";
-        json += "\"pwr_var\":" + String(Settings.settings.simulated_power_variation, 1) + ",";
-        json += "\"gain\":" + String(Settings.settings.gain) + ",";
-        json += "\"output_bits\":" + String(Settings.settings.output_bits) + ",";
-        json += "\"led_brightness\":" + String(Settings.settings.led_brightness) + ",";
-
-        float simulated_power = Settings.settings.simulated_power_offset +
-                                Settings.settings.simulated_power_variation * sin(millis() * 0.0005);
-        json += "\"power_mW\":" + String(simulated_power, 1) + ",";
-
-        json += "\"samples\":";
-        json += "[";
-        if (latest_samples == nullptr || latest_sample_capacity == 0) {
-            json += "]";
-        } else {
-            for (size_t i = 0; i < latest_sample_capacity; ++i) {
-                size_t slot = (latest_sample_index + i) % latest_sample_capacity;
-                json += String(latest_samples[slot]);
-                if (i < latest_sample_capacity - 1) {
-                    json += ",";
-                }
-            }
-            json += "]";
+    if (!allocateStatusBuffers()) {
+        Serial.println("[ERROR] Failed to allocate /status.json buffers");
+    }
+    for (ResponseBuffer &buffer : metrics_buffers) {
+        buffer.data = (char *)memoryAlloc(MEMORY_BULK, METRICS_BYTES, "metrics buffer");
+        buffer.capacity = buffer.data ? METRICS_BYTES : 0;
+    }
+    if (!metrics_buffers[0].data || !metrics_buffers[1].data) {
+        Serial.println("[ERROR] Failed to allocate /metrics buffers");
+    }
+
+    server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (!metrics_buffers[0].data || !metrics_buffers[1].data) {
+            request->send(503, "text/plain", "metrics unavailable\n");
+            return;
         }
-        json += "}";
+        const size_t next = metrics_current ^ 1;
+        if (metrics_buffers[next].in_flight == 0) {
+            metrics_buffers[next].length = renderMetrics(metrics_buffers[next].data);
+            metrics_current = next;
+        }
+        sendBuffer(request, "text/plain; version=0.0.4", &metrics_buffers[metrics_current]);
+    });
 
-        request->send(200, "application/json", json);
+    server.on("/status.json", HTTP_GET, [](AsyncWebServerRequest *request){
+        ResponseBuffer *status = currentStatus();
+        if (!status) {
+            request->send(503, "application/json", "{\"error\":\"status unavailable\"}");
+            return;
+        }
+        sendBuffer(request, "application/json", status);
     });
 
     AsyncCallbackJsonWebHandler* handler = new AsyncCallbackJsonWebHandler("/control.json", [](AsyncWebServerRequest *request, JsonVariant &json) {
         JsonObject obj = json.as<JsonObject>();
+        AudioSettings next = Settings.snapshot();
         bool needsRestart = false;
 
         if (obj.containsKey("threshold")) {
-            Settings.settings.trigger_rms_threshold = obj["threshold"];
+            next.trigger_rms_threshold = obj["threshold"];
         }
         if (obj.containsKey("timeout")) {
-            Settings.settings.trigger_timeout_ms = obj["timeout"];
+            next.trigger_timeout_ms = obj["timeout"];
+        }
+        if (obj.containsKey("trigger_mode")) {
+            uint8_t mode = obj["trigger_mode"];
+            if (mode == TRIGGER_MODE_RMS || mode == TRIGGER_MODE_SPECTRAL) {
+                next.trigger_mode = mode;
+            }
+        }
+        if (obj.containsKey("band_low_hz")) {
+            next.band_low_hz = obj["band_low_hz"]; // Detector clamps to its FFT range
         }
-        if (obj.containsKey("pwr_offset")) {
-            Settings.settings.simulated_power_offset = obj["pwr_offset"];
+        if (obj.containsKey("band_high_hz")) {
+            next.band_high_hz = obj["band_high_hz"];
         }
-        if (obj.containsKey("pwr_var")) {
-            Settings.settings.simulated_power_variation = obj["pwr_var"];
+        if (obj.containsKey("spectral_threshold_db")) {
+            next.spectral_threshold_db = obj["spectral_threshold_db"];
+        }
+        if (obj.containsKey("preroll_ms")) {
+            uint32_t ms = obj["preroll_ms"];
+            next.preroll_ms = min(ms, (uint32_t)PREROLL_MAX_MS); // Network task resizes the pre-roll
+        }
+        if (obj.containsKey("power_mode")) {
+            uint8_t mode = obj["power_mode"];
+            if (mode == POWER_MODE_FULL || mode == POWER_MODE_LOW) {
+                next.power_mode = mode; // Network task switches clock and radio
+            }
+        }
+        if (obj.containsKey("spool_enabled")) {
+            bool spool = obj["spool_enabled"];
+            if (spool != next.spool_enabled) {
+                next.spool_enabled = spool;
+                needsRestart = spool && !packet_spool.enabled(); // Allocated at boot only
+            }
+        }
+        if (obj.containsKey("spool_flash")) {
+            next.spool_flash = obj["spool_flash"]; // Spilling only; LittleFS is mounted at boot
+        }
+        if (obj.containsKey("spool_drain_kbps")) {
+            int kbps = constrain(obj["spool_drain_kbps"].as<int>(), 8, SPOOL_DRAIN_MAX_KBPS);
+            next.spool_drain_kbps = kbps;
+        }
+        if (obj.containsKey("flow_auto")) {
+            next.flow_auto = obj["flow_auto"];
+        }
+        if (obj.containsKey("transport")) {
+            uint8_t transport = obj["transport"];
+            if (transport == TRANSPORT_WS || transport == TRANSPORT_UDP || transport == TRANSPORT_RTP) {
+                next.transport = transport; // Network task opens or closes the socket
+            }
+        }
+        if (obj.containsKey("udp_port")) {
+            uint16_t port = obj["udp_port"];
+            if (port != 0) {
+                next.udp_port = port;
+            }
         }
         if (obj.containsKey("sample_rate")) {
-            Settings.settings.sample_rate = obj["sample_rate"];
+            uint32_t rate = obj["sample_rate"];
+            if (rate >= CAPTURE_SAMPLE_RATE_MIN && rate <= CAPTURE_SAMPLE_RATE_MAX) {
+                next.sample_rate = rate; // Capture task reinstalls the I2S driver between reads
+            } else {
+                Serial.printf("[WARN] sample_rate %lu outside %u..%u Hz, ignored\n", (unsigned long)rate, CAPTURE_SAMPLE_RATE_MIN, CAPTURE_SAMPLE_RATE_MAX);
+            }
         }
-        if (obj.containsKey("buffer_len")) {
-            Settings.settings.buffer_len = obj["buffer_len"];
+        if (obj.containsKey("output_sample_rate")) {
+            uint32_t rate = obj["output_sample_rate"];
+            if (decimationFactorFor(next.sample_rate, rate) != 0) {
+                next.output_sample_rate = rate; // Network task rebuilds the decimator
+            } else {
+                Serial.printf("[WARN] output_sample_rate %lu is not sample_rate / 1..%u, ignored\n", (unsigned long)rate, DECIMATOR_MAX_FACTOR);
+            }
+        }
+        if (obj.containsKey("dma_buf_count")) {
+            int count = constrain(obj["dma_buf_count"].as<int>(), I2S_DMA_BUF_COUNT_MIN, I2S_DMA_BUF_COUNT_MAX);
+            next.dma_buf_count = count; // Applied with a driver reinstall, like sample_rate
+        }
+        if (obj.containsKey("dma_buf_len")) {
+            int len = constrain(obj["dma_buf_len"].as<int>(), I2S_DMA_BUF_LEN_MIN, I2S_DMA_BUF_LEN_MAX);
+            next.dma_buf_len = len;
+        }
+        if (obj.containsKey("use_apll")) {
+            next.use_apll = obj["use_apll"];
+        }
+        if (obj.containsKey("channels")) {
+            uint8_t channels = obj["channels"];
+            if (channels == CAPTURE_CHANNELS_MONO || channels == CAPTURE_CHANNELS_STEREO || channels == CAPTURE_CHANNELS_TDM) {
+                next.channels = channels; // Driver reinstall, like sample_rate
+            } else {
+                Serial.printf("[WARN] channels %u is not 1, 2 or 4, ignored\n", channels);
+            }
         }
         if (obj.containsKey("wifi_ssid")) {
-            Settings.settings.wifi_ssid = obj["wifi_ssid"].as<String>();
+            next.wifi_ssid = obj["wifi_ssid"].as<String>();
         }
         if (obj.containsKey("wifi_pass")) {
-            Settings.settings.wifi_pass = obj["wifi_pass"].as<String>();
+            next.wifi_pass = obj["wifi_pass"].as<String>();
         }
         if (obj.containsKey("ws_server")) {
-            Settings.settings.ws_server = obj["ws_server"].as<String>();
+            next.ws_server = obj["ws_server"].as<String>(); // Network task reconnects to the new server
+        }
+        if (obj.containsKey("ws_port")) {
+            // Stored as a string; accept 8080 or "8080"
+            int port = obj["ws_port"].is<const char *>() ? atoi(obj["ws_port"].as<const char *>()) : obj["ws_port"].as<int>();
+            if (port > 0 && port <= 65535) {
+                next.ws_port = String(port);
+            }
+        }
+        if (obj.containsKey("ntp_server")) {
+            next.ntp_server = obj["ntp_server"].as<String>(); // Network task restarts SNTP
         }
         if (obj.containsKey("simulate_mic")) {
-            bool newSim = obj["simulate_mic"];
-            if (newSim != Settings.settings.simulate_mic) {
-                Settings.settings.simulate_mic = newSim;
-                needsRestart = true;
+            next.simulate_mic = obj["simulate_mic"]; // Capture task swaps the driver for the generator
+        }
+        if (obj.containsKey("sim_signal")) {
+            uint8_t signal = obj["sim_signal"];
+            if (signal < SIM_SIGNAL_COUNT) {
+                next.sim_signal = signal;
             }
         }
+        if (obj.containsKey("sim_freq_hz")) {
+            float hz = obj["sim_freq_hz"];
+            next.sim_freq_hz = constrain(hz, 0.0f, next.sample_rate / 2.0f);
+        }
+        if (obj.containsKey("sim_freq_end_hz")) {
+            float hz = obj["sim_freq_end_hz"];
+            next.sim_freq_end_hz = constrain(hz, 0.0f, next.sample_rate / 2.0f);
+        }
+        if (obj.containsKey("sim_level")) {
+            float level = obj["sim_level"];
+            next.sim_level = constrain(level, 0.0f, 1.0f);
+        }
+        if (obj.containsKey("sim_duty_pct")) {
+            next.sim_duty_pct = min(obj["sim_duty_pct"].as<uint32_t>(), (uint32_t)100);
+        }
+        if (obj.containsKey("sim_period_ms")) {
+            uint32_t ms = obj["sim_period_ms"];
+            next.sim_period_ms = constrain(ms, (uint32_t)SIM_PERIOD_MIN_MS, (uint32_t)60000);
+        }
+        if (obj.containsKey("status_sample_count")) {
+            uint32_t samples = obj["status_sample_count"];
+            next.status_sample_count = min(samples, (uint32_t)STATUS_SAMPLES_MAX); // Network task resizes its buffer
+        }
         if (obj.containsKey("gain")) {
-            Settings.settings.gain = obj["gain"];
+            float gain = obj["gain"];
+            next.gain = constrain(gain, 0.0f, PREPROCESS_MAX_GAIN);
+        }
+        if (obj.containsKey("dc_block")) {
+            next.dc_block = obj["dc_block"];
+        }
+        if (obj.containsKey("highpass_hz")) {
+            uint32_t hz = obj["highpass_hz"];
+            next.highpass_hz = min(hz, next.sample_rate / 4); // Network task recomputes the biquad
         }
         if (obj.containsKey("output_bits")) {
-            Settings.settings.output_bits = obj["output_bits"];
+            next.output_bits = obj["output_bits"];
+        }
+        if (obj.containsKey("codec")) {
+            uint8_t codec = obj["codec"];
+            if (codec == CODEC_SETTING_PCM || codec == CODEC_SETTING_IMA_ADPCM) {
+                next.codec = codec;
+            }
+        }
+        if (obj.containsKey("output_mode")) {
+            uint8_t mode = obj["output_mode"];
+            if (mode <= OUTPUT_MODE_FEATURES_ONLY) {
+                next.output_mode = mode;
+            } else {
+                Serial.printf("[WARN] output_mode %u unknown, ignored\n", mode);
+            }
+        }
+        if (obj.containsKey("batch_max_bytes")) {
+            uint32_t bytes = obj["batch_max_bytes"];
+            next.batch_max_bytes = min(bytes, (uint32_t)PACKET_BATCH_MAX_BYTES);
+        }
+        if (obj.containsKey("batch_max_delay_ms")) {
+            uint32_t ms = obj["batch_max_delay_ms"];
+            next.batch_max_delay_ms = min(ms, (uint32_t)1000);
+        }
+        if (obj.containsKey("live_rate_hz")) {
+            uint32_t hz = obj["live_rate_hz"];
+            next.live_rate_hz = min(hz, (uint32_t)LIVE_MAX_RATE_HZ);
         }
         if (obj.containsKey("led_brightness")) {
-            Settings.settings.led_brightness = obj["led_brightness"];
+            next.led_brightness = obj["led_brightness"];
         }
 
-        Settings.save();
+        Settings.publish(next); // Network task applies it; NVS follows after the debounce
+        status_config_dirty = true;
 
-        Serial.printf("[UPDATED SETTINGS]\n Threshold=%.4f\n Timeout=%lu\n PwrOffset=%.1f\n PwrVar=%.1f\n SampleRate=%lu\n BufferLen=%lu\n WS=%s\n Gain=%.1f\n LED Brightness=%u\n",
-            Settings.settings.trigger_rms_threshold,
-            Settings.settings.trigger_timeout_ms,
-            Settings.settings.simulated_power_offset,
-            Settings.settings.simulated_power_variation,
-            Settings.settings.sample_rate,
-            Settings.settings.buffer_len,
-            Settings.settings.ws_server.c_str(),
-            Settings.settings.gain,
-            Settings.settings.led_brightness);
+        Serial.printf("[UPDATED SETTINGS]\n Threshold=%.4f\n Timeout=%lu\n PowerMode=%u\n SampleRate=%lu x %u ch\n DMA=%ux%u%s\n WS=%s\n Gain=%.1f\n LED Brightness=%u\n",
+            next.trigger_rms_threshold,
+            next.trigger_timeout_ms,
+            next.power_mode,
+            next.sample_rate,
+            next.channels,
+            next.dma_buf_count,
+            next.dma_buf_len,
+            next.use_apll ? " (APLL)" : "",
+            next.ws_server.c_str(),
+            next.gain,
+            next.led_brightness);
 
         request->send(200, "application/json", "{\"status\":\"ok\"}");
 
         if (needsRestart) {
+            Settings.flush();
             delay(500);
             ESP.restart();
         }
     });
     server.addHandler(handler);
 
+    setupLiveMonitor(server);
+
     server.onNotFound([](AsyncWebServerRequest *request){
         Serial.printf("[404] Not Found: %s %s\n",
             methodToString(request),
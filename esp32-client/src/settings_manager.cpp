@@ -1,3 +1,138 @@
+#include <Preferences.h>
 #include "settings_manager.h"
+#include "logging.h"
 
-SettingsManager Settings;
\ No newline at end of file
+SettingsManager Settings;
+
+// Keys older firmware wrote that no field reads any more, removed on first
+// boot after an upgrade. "gain" held a 10.0 default that was never applied;
+// read as applied gain it would add 20 dB, so the setting moved to
+// "gain_lin" and starts from 1.0. "pwr_offset" / "pwr_var" configured the
+// old simulated power trigger, and "buffer_len" became dma_buf_len.
+static const char *const RETIRED_KEYS[] = {"gain", "pwr_offset", "pwr_var", "buffer_len"};
+
+void SettingsManager::load() {
+    Preferences prefs;
+    prefs.begin("audio", true);
+#define LOAD_FIELD(type, member, key) settings.member = prefs.get##type(key, settings.member);
+    AUDIO_SETTINGS_FIELDS(LOAD_FIELD)
+#undef LOAD_FIELD
+    bool retired_present = false;
+    for (const char *key : RETIRED_KEYS) {
+        retired_present = retired_present || prefs.isKey(key);
+    }
+    prefs.end();
+
+    if (retired_present && prefs.begin("audio", false)) {
+        for (const char *key : RETIRED_KEYS) {
+            if (prefs.isKey(key)) {
+                prefs.remove(key);
+                LOG_INFO("Settings: dropped retired NVS key \"%s\"", key);
+            }
+        }
+        prefs.end();
+    }
+
+    if (!publish_mutex) {
+        publish_mutex = xSemaphoreCreateMutex();
+        nvs_mutex = xSemaphoreCreateMutex();
+    }
+    published = settings;
+    persisted = settings;
+}
+
+bool SettingsManager::startWriter() {
+    return xTaskCreatePinnedToCore(writerTask, "settings", SETTINGS_TASK_STACK, this,
+                                   SETTINGS_TASK_PRIORITY, &writer, 0) == pdPASS;
+}
+
+AudioSettings SettingsManager::snapshot() {
+    xSemaphoreTake(publish_mutex, portMAX_DELAY);
+    AudioSettings copy = published;
+    xSemaphoreGive(publish_mutex);
+    return copy;
+}
+
+void SettingsManager::publish(const AudioSettings &next) {
+    xSemaphoreTake(publish_mutex, portMAX_DELAY);
+    published = next;
+    published_version++;
+    xSemaphoreGive(publish_mutex);
+
+    if (writer) {
+        xTaskNotifyGive(writer); // Every publish restarts the quiet period
+    } else {
+        persist();
+    }
+}
+
+bool SettingsManager::apply() {
+    if (published_version == applied_version) {
+        return false; // Cheap check first: nothing is published most passes
+    }
+    xSemaphoreTake(publish_mutex, portMAX_DELAY);
+    settings = published;
+    applied_version = published_version;
+    xSemaphoreGive(publish_mutex);
+    return true;
+}
+
+void SettingsManager::flush() {
+    persist();
+}
+
+void SettingsManager::resetDefaults() {
+    publish(AudioSettings());
+    flush();
+}
+
+// Writes the keys whose published value differs from NVS. A key whose write
+// fails keeps its old persisted value, so the next save retries it.
+void SettingsManager::persist() {
+    xSemaphoreTake(nvs_mutex, portMAX_DELAY);
+    const AudioSettings target = snapshot();
+    uint32_t written = 0;
+    uint32_t failed = 0;
+
+    Preferences prefs;
+    if (prefs.begin("audio", false)) {
+#define SAVE_CHANGED(type, member, key)                 \
+        if (target.member != persisted.member) {        \
+            if (prefs.put##type(key, target.member)) {  \
+                persisted.member = target.member;       \
+                written++;                              \
+            } else {                                    \
+                failed++;                               \
+            }                                           \
+        }
+        AUDIO_SETTINGS_FIELDS(SAVE_CHANGED)
+#undef SAVE_CHANGED
+        prefs.end();
+    } else {
+        LOG_ERROR("Failed to open NVS namespace for writing; settings not saved");
+    }
+
+    if (written > 0) {
+        nvs_writes += written;
+        nvs_saves++;
+        LOG_INFO("Settings saved: %u keys written", written);
+    }
+    if (failed > 0) {
+        LOG_WARN("Settings save: %u keys failed to write", failed);
+    }
+    xSemaphoreGive(nvs_mutex);
+}
+
+// Waits for the first publish, then for SETTINGS_SAVE_DEBOUNCE_MS without a
+// further one (SETTINGS_SAVE_MAX_DELAY_MS at most), then saves once.
+void SettingsManager::writerTask(void *param) {
+    SettingsManager *self = static_cast<SettingsManager *>(param);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        const uint32_t first = millis();
+        while (millis() - first < SETTINGS_SAVE_MAX_DELAY_MS &&
+               ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SETTINGS_SAVE_DEBOUNCE_MS)) > 0) {
+        }
+        self->persist();
+    }
+}
@@ -0,0 +1,265 @@
+// src/synthetic_source.cpp
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_timer.h>
+
+#include "synthetic_source.h"
+#include "settings_manager.h"
+#include "logging.h"
+#include "memory_policy.h"
+
+SyntheticSource synthetic_source;
+
+SyntheticConfig syntheticConfigFor(const AudioSettings &settings)
+{
+    SyntheticConfig config;
+    config.signal = settings.sim_signal < SIM_SIGNAL_COUNT ? settings.sim_signal : SIM_SIGNAL_TONE;
+    config.freq_hz = settings.sim_freq_hz;
+    config.freq_end_hz = settings.sim_freq_end_hz;
+    config.level = constrain(settings.sim_level, 0.0f, 1.0f);
+    config.duty_pct = min(settings.sim_duty_pct, (uint8_t)100);
+    config.period_ms = max(settings.sim_period_ms, (uint16_t)SIM_PERIOD_MIN_MS);
+    return config;
+}
+
+void SyntheticSource::configure(const SyntheticConfig &next)
+{
+    pending.beginWrite() = next;
+    pending.endWrite();
+}
+
+// === Clip Loading ===
+static uint16_t readLe16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t readLe32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+void SyntheticSource::requestClip()
+{
+    bool expected = false;
+    if (clipLoaded() || !clip_requested.compare_exchange_strong(expected, true))
+    {
+        return; // Loaded or loading (or failed once: fix the file and reboot)
+    }
+    if (xTaskCreate(clipLoaderTask, "sim_clip", SIM_CLIP_TASK_STACK, this, SIM_CLIP_TASK_PRIORITY, nullptr) != pdPASS)
+    {
+        LOG_WARN("Simulated mic: could not start the clip loader");
+        clip_requested.store(false);
+    }
+}
+
+void SyntheticSource::clipLoaderTask(void *param)
+{
+    static_cast<SyntheticSource *>(param)->loadClip(SIM_CLIP_PATH);
+    vTaskDelete(nullptr);
+}
+
+bool SyntheticSource::loadClip(const char *path)
+{
+    if (!LittleFS.begin(false) || !LittleFS.exists(path))
+    {
+        LOG_WARN("Simulated mic: no clip at %s; bursts play the noise floor only", path);
+        return false;
+    }
+    fs::File file = LittleFS.open(path, "r");
+    uint8_t riff[12];
+    if (!file || file.read(riff, sizeof(riff)) != sizeof(riff) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0)
+    {
+        LOG_WARN("Simulated mic: %s is not a WAV file", path);
+        return false;
+    }
+
+    // Walk the chunks for "fmt " and "data"
+    uint16_t channels = 0;
+    uint16_t bits = 0;
+    uint32_t wav_rate = 0;
+    uint32_t data_bytes = 0;
+    uint8_t chunk[8];
+    while (file.read(chunk, sizeof(chunk)) == sizeof(chunk))
+    {
+        const uint32_t size = readLe32(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16)
+        {
+            uint8_t fmt[16];
+            file.read(fmt, sizeof(fmt));
+            if (readLe16(fmt) != 1)
+            {
+                break; // Not PCM
+            }
+            channels = readLe16(fmt + 2);
+            wav_rate = readLe32(fmt + 4);
+            bits = readLe16(fmt + 14);
+            file.seek(file.position() + size - sizeof(fmt) + (size & 1));
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            data_bytes = size;
+            break;
+        }
+        else
+        {
+            file.seek(file.position() + size + (size & 1)); // Chunks are word aligned
+        }
+    }
+    if (bits != 16 || channels == 0 || wav_rate == 0 || data_bytes == 0)
+    {
+        LOG_WARN("Simulated mic: %s must be 16-bit PCM (got %u-bit, %u channels, %u Hz)", path, bits, channels, wav_rate);
+        return false;
+    }
+
+    const uint32_t frame_bytes = 2u * channels;
+    const uint32_t frames = min(data_bytes, (uint32_t)SIM_CLIP_MAX_BYTES * channels) / frame_bytes;
+    int16_t *samples = (int16_t *)memoryAlloc(MEMORY_PSRAM_ONLY, frames * sizeof(int16_t), "simulated mic clip");
+    if (!samples)
+    {
+        LOG_WARN("Simulated mic: no PSRAM for a %u-sample clip", frames);
+        return false;
+    }
+    // First channel only, a block at a time
+    uint32_t loaded = 0;
+    int16_t block[256];
+    const uint32_t block_frames = sizeof(block) / frame_bytes;
+    while (block_frames > 0 && loaded < frames)
+    {
+        const size_t got = file.read((uint8_t *)block, min(block_frames, frames - loaded) * frame_bytes) / frame_bytes;
+        if (got == 0)
+        {
+            break;
+        }
+        for (size_t i = 0; i < got; ++i)
+        {
+            samples[loaded++] = block[i * channels];
+        }
+    }
+    if (loaded == 0)
+    {
+        memoryFree(samples);
+        return false;
+    }
+
+    clip_count = loaded;
+    clip_rate = wav_rate;
+    clip_samples.store(samples, std::memory_order_release);
+    LOG_INFO("Simulated mic: loaded %s (%u samples at %u Hz, %.1f s)", path, loaded, wav_rate, (float)loaded / wav_rate);
+    return true;
+}
+
+// === Generator ===
+void SyntheticSource::restart(uint32_t sample_rate)
+{
+    rate = sample_rate ? sample_rate : 1;
+    start_us = esp_timer_get_time();
+    produced = 0;
+    cycle_pos = 0;
+    phase = 0.0f;
+    noise_state = SIM_NOISE_SEED;
+    clip_pos = 0;
+    applied_version = UINT32_MAX; // Re-derive the burst geometry for the new rate
+}
+
+void SyntheticSource::applyConfig(const SyntheticConfig &next)
+{
+    config = next;
+    cycle_samples = max((uint32_t)((uint64_t)config.period_ms * rate / 1000), (uint32_t)1);
+    on_samples = (uint32_t)((uint64_t)cycle_samples * config.duty_pct / 100);
+    cycle_pos = min(cycle_pos, cycle_samples - 1);
+    clip_step = 0; // Derived in read() once the clip is published
+}
+
+// xorshift32, scaled to -1..1
+float SyntheticSource::noise()
+{
+    noise_state ^= noise_state << 13;
+    noise_state ^= noise_state >> 17;
+    noise_state ^= noise_state << 5;
+    return (int32_t)noise_state * (1.0f / 2147483648.0f);
+}
+
+size_t SyntheticSource::read(int32_t *out, size_t words, uint8_t channels, uint64_t &timestamp_us)
+{
+    channels = max(channels, (uint8_t)1);
+    const size_t samples = words / channels; // Per channel; pacing counts frames
+    if (pending.version() != applied_version)
+    {
+        SyntheticConfig next;
+        if (pending.read(next))
+        {
+            applied_version = pending.version();
+            applyConfig(next);
+        }
+    }
+
+    // Pace: the block is complete once its last sample is due
+    const uint64_t due_us = start_us + (produced + samples) * 1000000ULL / rate;
+    const int64_t wait_us = (int64_t)(due_us - esp_timer_get_time());
+    if (wait_us > 0)
+    {
+        vTaskDelay(pdMS_TO_TICKS((wait_us + 999) / 1000));
+    }
+    else if (wait_us < -SIM_MAX_LAG_US)
+    {
+        // Starved for a long time: drop the backlog the way full DMA buffers would
+        start_us = esp_timer_get_time() - samples * 1000000ULL / rate;
+        produced = 0;
+    }
+    timestamp_us = start_us + (produced + samples) * 1000000ULL / rate;
+    produced += samples;
+
+    const int16_t *clip = clip_samples.load(std::memory_order_acquire);
+    if (clip && clip_step == 0)
+    {
+        clip_step = (uint32_t)(((uint64_t)clip_rate << 16) / rate);
+    }
+    const float two_pi = 6.28318531f;
+    for (size_t i = 0; i < samples; ++i)
+    {
+        float value;
+        if (cycle_pos < on_samples)
+        {
+            float freq = config.freq_hz;
+            switch (config.signal)
+            {
+            case SIM_SIGNAL_CHIRP:
+                freq += (config.freq_end_hz - config.freq_hz) * cycle_pos / on_samples;
+                // Fall through
+            case SIM_SIGNAL_TONE:
+                value = config.level * sinf(two_pi * phase);
+                phase += freq / rate;
+                phase -= (int)phase;
+                break;
+            case SIM_SIGNAL_NOISE:
+                value = config.level * noise();
+                break;
+            default: // SIM_SIGNAL_CLIP
+                if (clip && (clip_pos >> 16) < clip_count)
+                {
+                    value = config.level * clip[clip_pos >> 16] * (1.0f / 32768.0f);
+                    clip_pos += clip_step;
+                }
+                else
+                {
+                    value = SIM_FLOOR_LEVEL * noise(); // Clip over (or missing) before the burst is
+                }
+                break;
+            }
+        }
+        else
+        {
+            value = SIM_FLOOR_LEVEL * noise();
+        }
+
+        if (++cycle_pos >= cycle_samples)
+        {
+            cycle_pos = 0; // Next burst starts from the same state
+            phase = 0.0f;
+            clip_pos = 0;
+        }
+        // 24-bit left-justified, as the mic delivers it
+        value = constrain(value, -1.0f, 1.0f);
+        const int32_t word = (int32_t)(value * 8388607.0f) * 256;
+        for (uint8_t c = 0; c < channels; ++c)
+        {
+            out[i * channels + c] = word;
+        }
+    }
+    return samples * channels;
+}
@@ -0,0 +1,198 @@
+// src/time_sync.cpp
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <esp_sntp.h>
+#include <esp_idf_version.h>
+#include <sys/time.h>
+
+#include "time_sync.h"
+#include "logging.h"
+
+#define TIME_SYNC_STEP_NOISE_US 100 // Offset changes below this are reading jitter, not a step
+
+struct SyncSample
+{
+    int64_t offset_us;
+    uint32_t rtt_us;
+    uint32_t taken_ms;
+};
+
+// SNTP keeps a pointer to the server name, so it lives here and only
+// changes while SNTP is stopped
+static String ntp_server;
+static bool sntp_running = false;
+static uint32_t last_sntp_check_ms = 0;
+
+static uint8_t source = TIME_SOURCE_NONE;
+static int64_t offset_us = 0;
+static uint32_t offset_rtt_us = 0;
+static uint32_t offset_taken_ms = 0;
+static int32_t last_step_us = 0;
+
+static SyncSample samples[TIME_SYNC_SAMPLES];
+static size_t sample_count = 0;
+static size_t sample_next = 0;
+static uint32_t last_pong_ms = 0;
+
+static uint32_t ping_seq = 0;
+static int64_t ping_t0 = 0; // esp_timer time of the unanswered ping; 0 = none
+static uint32_t next_ping_ms = 0;
+static uint8_t burst_left = 0;
+
+static uint32_t pings = 0;
+static uint32_t pongs = 0;
+static uint32_t rejected = 0;
+
+const char *timeSourceName(uint8_t value)
+{
+    static const char *const names[] = {"none", "sntp", "server"};
+    return value <= TIME_SOURCE_SERVER ? names[value] : "unknown";
+}
+
+static void setOffset(uint8_t new_source, int64_t offset, uint32_t rtt_us, uint32_t taken_ms)
+{
+    const int64_t step = offset - offset_us;
+    if (new_source != source)
+    {
+        LOG_INFO("Clock source %s -> %s (rtt %lu us)", timeSourceName(source), timeSourceName(new_source), (unsigned long)rtt_us);
+    }
+    if (source != TIME_SOURCE_NONE && (step >= TIME_SYNC_STEP_NOISE_US || step <= -TIME_SYNC_STEP_NOISE_US))
+    {
+        last_step_us = (int32_t)constrain(step, (int64_t)INT32_MIN, (int64_t)INT32_MAX);
+        LOG_DEBUG("Clock offset stepped by %ld us (%s)", (long)last_step_us, timeSourceName(new_source));
+    }
+    source = new_source;
+    offset_us = offset;
+    offset_rtt_us = rtt_us;
+    offset_taken_ms = taken_ms;
+}
+
+// System clock against esp_timer, once SNTP has set it. The receiver's own
+// clock wins while it keeps answering pings.
+static void followSntp(uint32_t now_ms)
+{
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    const int64_t timer_us = esp_timer_get_time();
+    if (tv.tv_sec < TIME_SYNC_MIN_EPOCH)
+    {
+        return;
+    }
+    if (source == TIME_SOURCE_SERVER && now_ms - last_pong_ms < TIME_SYNC_STALE_MS)
+    {
+        return;
+    }
+    setOffset(TIME_SOURCE_SNTP, (int64_t)tv.tv_sec * 1000000 + tv.tv_usec - timer_us, 0, now_ms);
+}
+
+void timeSyncSetNtpServer(const String &server)
+{
+    if (server == ntp_server && sntp_running == (server.length() > 0))
+    {
+        return;
+    }
+    if (sntp_running)
+    {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+        esp_sntp_stop();
+#else
+        sntp_stop();
+#endif
+        sntp_running = false;
+    }
+    ntp_server = server;
+    if (ntp_server.length() == 0)
+    {
+        LOG_INFO("SNTP off; wall clock from the receiver only");
+        return;
+    }
+    configTime(0, 0, ntp_server.c_str()); // UTC; polls again every hour
+    sntp_running = true;
+    LOG_INFO("SNTP started against %s", ntp_server.c_str());
+}
+
+void timeSyncConnected()
+{
+    sample_count = 0;
+    sample_next = 0;
+    ping_t0 = 0;
+    burst_left = TIME_SYNC_BURST_PINGS;
+    next_ping_ms = millis();
+}
+
+bool timeSyncService(uint32_t now_ms, bool ws_up, char *message, size_t size)
+{
+    if (now_ms - last_sntp_check_ms >= TIME_SYNC_SNTP_CHECK_MS)
+    {
+        last_sntp_check_ms = now_ms;
+        followSntp(now_ms);
+    }
+    if (!ws_up || (int32_t)(now_ms - next_ping_ms) < 0)
+    {
+        return false;
+    }
+    if (burst_left > 0)
+    {
+        burst_left--;
+    }
+    next_ping_ms = now_ms + (burst_left > 0 ? TIME_SYNC_BURST_INTERVAL_MS : TIME_SYNC_INTERVAL_MS);
+    ping_seq++;
+    pings++;
+    ping_t0 = esp_timer_get_time(); // Caller sends right away
+    snprintf(message, size, "{\"type\":\"time_ping\",\"seq\":%lu,\"t0\":%lld}", (unsigned long)ping_seq, (long long)ping_t0);
+    return true;
+}
+
+void timeSyncPong(uint32_t seq, int64_t t0, int64_t t1, int64_t t2)
+{
+    const int64_t t3 = esp_timer_get_time();
+    if (ping_t0 == 0 || seq != ping_seq || t0 != ping_t0)
+    {
+        rejected++; // Answer to a ping already given up on, or not ours
+        return;
+    }
+    ping_t0 = 0;
+    const int64_t rtt_us = (t3 - t0) - (t2 - t1);
+    if (rtt_us < 0 || rtt_us > TIME_SYNC_MAX_RTT_US)
+    {
+        rejected++; // Receiver clock stepped mid-exchange, or the reply sat behind a backlog
+        LOG_DEBUG("time_pong %lu discarded (rtt %lld us)", (unsigned long)seq, (long long)rtt_us);
+        return;
+    }
+    pongs++;
+    last_pong_ms = millis();
+    samples[sample_next] = {((t1 - t0) + (t2 - t3)) / 2, (uint32_t)rtt_us, last_pong_ms};
+    sample_next = (sample_next + 1) % TIME_SYNC_SAMPLES;
+    if (sample_count < TIME_SYNC_SAMPLES)
+    {
+        sample_count++;
+    }
+
+    const SyncSample *best = &samples[0];
+    for (size_t i = 1; i < sample_count; ++i)
+    {
+        if (samples[i].rtt_us < best->rtt_us)
+        {
+            best = &samples[i];
+        }
+    }
+    setOffset(TIME_SOURCE_SERVER, best->offset_us, best->rtt_us, best->taken_ms);
+}
+
+int64_t timeSyncWallClock(uint64_t timer_us)
+{
+    return source == TIME_SOURCE_NONE ? 0 : (int64_t)timer_us + offset_us;
+}
+
+void timeSyncFillStats(TimeSyncStats &stats)
+{
+    stats.source = source;
+    stats.offset_us = offset_us;
+    stats.rtt_us = offset_rtt_us;
+    stats.last_step_us = last_step_us;
+    stats.age_ms = source == TIME_SOURCE_NONE ? 0 : millis() - offset_taken_ms;
+    stats.pings = pings;
+    stats.pongs = pongs;
+    stats.rejected = rejected;
+}
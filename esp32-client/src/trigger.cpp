@@ -0,0 +1,102 @@
+// src/trigger.cpp
+
+#include <Arduino.h>
+
+#include "trigger.h"
+
+size_t prerollFramesFor(uint32_t ms, uint32_t sample_rate, uint8_t channels)
+{
+    const uint64_t samples = (uint64_t)ms * sample_rate * max(channels, (uint8_t)1) / 1000;
+    return (size_t)((samples + MAX_SAMPLES_PER_READ - 1) / MAX_SAMPLES_PER_READ);
+}
+
+// === PreRollBuffer ===
+bool PreRollBuffer::begin(CaptureFrame *storage, size_t frames)
+{
+    slots = storage;
+    frames_allocated = storage ? frames : 0;
+    active_depth = frames_allocated;
+    first = 0;
+    count = 0;
+    return storage != nullptr;
+}
+
+void PreRollBuffer::setDepth(size_t frames)
+{
+    active_depth = min(frames, frames_allocated);
+    // Keep only the newest frames that still fit
+    while (count > active_depth)
+    {
+        pop();
+    }
+}
+
+void PreRollBuffer::push(const CaptureFrame &frame)
+{
+    if (active_depth == 0)
+    {
+        return;
+    }
+    if (count == active_depth)
+    {
+        pop(); // Drop the oldest
+    }
+    CaptureFrame &slot = slots[(first + count) % frames_allocated];
+    memcpy(slot.samples, frame.samples, frame.sample_count * sizeof(int32_t));
+    static_cast<CaptureFrameInfo &>(slot) = frame;
+    ++count;
+}
+
+const CaptureFrame *PreRollBuffer::pop()
+{
+    if (count == 0)
+    {
+        return nullptr;
+    }
+    const CaptureFrame *frame = &slots[first];
+    first = (first + 1) % frames_allocated;
+    --count;
+    return frame;
+}
+
+// === TriggerGate ===
+TriggerEvent TriggerGate::update(bool above_threshold, uint32_t now_ms, uint32_t hangover_ms)
+{
+    if (above_threshold)
+    {
+        last_above_ms = now_ms;
+        if (state == TRIGGER_IDLE)
+        {
+            state = TRIGGER_ACTIVE;
+            return TRIGGER_EVENT_START;
+        }
+        state = TRIGGER_ACTIVE;
+        return TRIGGER_EVENT_NONE;
+    }
+
+    if (state == TRIGGER_IDLE)
+    {
+        return TRIGGER_EVENT_NONE;
+    }
+    if (now_ms - last_above_ms >= hangover_ms)
+    {
+        state = TRIGGER_IDLE;
+        return TRIGGER_EVENT_END;
+    }
+    state = TRIGGER_HANGOVER;
+    return TRIGGER_EVENT_NONE;
+}
+
+const char *triggerStateName(TriggerState state)
+{
+    switch (state)
+    {
+    case TRIGGER_IDLE:
+        return "idle";
+    case TRIGGER_ACTIVE:
+        return "active";
+    case TRIGGER_HANGOVER:
+        return "hangover";
+    }
+    return "unknown";
+}
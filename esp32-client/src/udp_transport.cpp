@@ -0,0 +1,187 @@
+// src/udp_transport.cpp
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <lwip/sockets.h>
+
+#include "udp_transport.h"
+#include "settings_manager.h"
+#include "logging.h"
+
+static int udp_socket = -1;
+static sockaddr_in destination = {};
+static String target_host; // Host and port the socket currently sends to
+static uint16_t target_port = 0;
+static uint32_t last_resolve_ms = 0;
+static bool resolve_attempted = false;
+static uint32_t rtp_ssrc = 0;
+
+static uint32_t datagrams = 0;
+static uint32_t send_errors = 0;
+static uint64_t bytes_sent = 0;
+static uint32_t peer_received = 0;
+static uint32_t peer_lost = 0;
+static uint32_t peer_reordered = 0;
+static uint32_t peer_late = 0;
+
+static void closeSocket()
+{
+    if (udp_socket >= 0)
+    {
+        close(udp_socket);
+        udp_socket = -1;
+        LOG_INFO("UDP audio transport closed");
+    }
+    target_host = "";
+    target_port = 0;
+    resolve_attempted = false;
+}
+
+// ws_server without the scheme or trailing slash, as attemptWebSocketConnect() uses it
+static String settingsHost()
+{
+    String host = Settings.settings.ws_server;
+    host.replace("ws://", "");
+    if (host.endsWith("/"))
+    {
+        host = host.substring(0, host.length() - 1);
+    }
+    return host;
+}
+
+static bool openSocket(const String &host, uint16_t port)
+{
+    IPAddress address;
+    if (!WiFi.hostByName(host.c_str(), address))
+    {
+        LOG_WARN("UDP transport: cannot resolve %s, retrying in %u ms", host.c_str(), UDP_RESOLVE_RETRY_MS);
+        return false;
+    }
+
+    const int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+    {
+        LOG_ERROR("UDP transport: socket() failed (errno %d)", errno);
+        return false;
+    }
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+
+    destination = {};
+    destination.sin_family = AF_INET;
+    destination.sin_port = htons(port);
+    destination.sin_addr.s_addr = (uint32_t)address;
+    udp_socket = sock;
+    target_host = host;
+    target_port = port;
+    if (rtp_ssrc == 0)
+    {
+        rtp_ssrc = esp_random() | 1; // Fixed for the whole boot, so reconnects stay one RTP stream
+    }
+    LOG_INFO("UDP audio transport (%s) to %s:%u", Settings.settings.transport == TRANSPORT_RTP ? "RTP" : "raw",
+             address.toString().c_str(), port);
+    return true;
+}
+
+bool udpTransportService(bool wifi_up)
+{
+    if (!wifi_up || Settings.settings.transport == TRANSPORT_WS || Settings.settings.ws_server.isEmpty())
+    {
+        closeSocket();
+        return false;
+    }
+
+    const uint16_t port = Settings.settings.udp_port;
+    const String host = settingsHost();
+    if (udp_socket >= 0 && port == target_port && host == target_host)
+    {
+        return true;
+    }
+    if (udp_socket >= 0)
+    {
+        closeSocket(); // Settings changed: re-target
+    }
+
+    // Resolution can block on DNS, so failed lookups are retried sparingly
+    const uint32_t now = millis();
+    if (resolve_attempted && now - last_resolve_ms < UDP_RESOLVE_RETRY_MS)
+    {
+        return false;
+    }
+    resolve_attempted = true;
+    last_resolve_ms = now;
+    return openSocket(host, port);
+}
+
+bool udpTransportReady()
+{
+    return udp_socket >= 0;
+}
+
+static void putBigEndian16(uint8_t *out, uint16_t value)
+{
+    out[0] = (uint8_t)(value >> 8);
+    out[1] = (uint8_t)value;
+}
+
+static void putBigEndian32(uint8_t *out, uint32_t value)
+{
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+}
+
+bool udpTransportSend(PacketBuffer *packet)
+{
+    if (udp_socket < 0)
+    {
+        return false;
+    }
+
+    uint8_t *datagram = packet->packet();
+    size_t length = packet->length;
+    if (Settings.settings.transport == TRANSPORT_RTP)
+    {
+        // Header goes into the headroom in front of the wire packet
+        const AudioPacketHeader *header = packet->header();
+        datagram -= RTP_HEADER_BYTES;
+        length += RTP_HEADER_BYTES;
+        const bool marker = header->flags & PACKET_FLAG_TRIGGER_START;
+        datagram[0] = RTP_VERSION << 6;
+        datagram[1] = (marker ? 0x80 : 0x00) | RTP_PAYLOAD_TYPE;
+        putBigEndian16(datagram + 2, (uint16_t)header->sequence);
+        putBigEndian32(datagram + 4, (uint32_t)(header->timestamp * header->sample_rate / 1000000ULL));
+        putBigEndian32(datagram + 8, rtp_ssrc);
+    }
+
+    const int sent = sendto(udp_socket, datagram, length, MSG_DONTWAIT,
+                            reinterpret_cast<const sockaddr *>(&destination), sizeof(destination));
+    if (sent != (int)length)
+    {
+        send_errors++; // Typically ENOMEM/EAGAIN: lwIP has no buffers, the datagram is gone
+        return false;
+    }
+    datagrams++;
+    bytes_sent += length;
+    return true;
+}
+
+void udpTransportPeerReport(uint32_t received, uint32_t lost, uint32_t reordered, uint32_t late)
+{
+    peer_received = received;
+    peer_lost = lost;
+    peer_reordered = reordered;
+    peer_late = late;
+}
+
+void udpTransportFillStats(UdpStats &stats)
+{
+    stats.datagrams = datagrams;
+    stats.send_errors = send_errors;
+    stats.bytes = bytes_sent;
+    stats.peer_received = peer_received;
+    stats.peer_lost = peer_lost;
+    stats.peer_reordered = peer_reordered;
+    stats.peer_late = peer_late;
+    stats.ready = udp_socket >= 0;
+}
@@ -0,0 +1,89 @@
+"""Payload decoding in server.py, checked against an encoder that writes blocks
+the way lib/pipeline/src/audio_codec.cpp does. Run from esp32-client:
+    python -m unittest discover tests
+"""
+import os
+import struct
+import sys
+import types
+import unittest
+
+import numpy as np
+
+# server.py pulls in audio, GUI and network packages at import time; decoding
+# needs none of them. Any name looked up on a stand-in is another stand-in
+# class, so "class TimingPlot(QtWidgets.QMainWindow)" still imports.
+class _Missing(type):
+    def __getattr__(cls, attr):
+        return _Missing(attr, (Exception,), {})
+
+
+for name in ("sounddevice", "pyqtgraph", "pyqtgraph.Qt", "websockets", "websockets.server", "websockets.exceptions"):
+    module = types.ModuleType(name)
+    module.__getattr__ = lambda attr: _Missing(attr, (Exception,), {})
+    sys.modules.setdefault(name, module)
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), ".."))
+import server  # noqa: E402
+
+
+def encode_ima_adpcm(samples, predictor=0, index=0):
+    """One block: int16 predictor, uint8 step index, reserved byte, then a nibble per sample, low first."""
+    out = bytearray(struct.pack('<hBx', predictor, index))
+    out.extend(bytes((len(samples) + 1) // 2))
+    for i, sample in enumerate(samples):
+        step = server.IMA_STEP_TABLE[index]
+        diff = int(sample) - predictor
+        nibble = 0
+        if diff < 0:
+            nibble, diff = 8, -diff
+        if diff >= step:
+            nibble |= 4
+            diff -= step
+        if diff >= step >> 1:
+            nibble |= 2
+            diff -= step >> 1
+        if diff >= step >> 2:
+            nibble |= 1
+        delta = step >> 3
+        if nibble & 4:
+            delta += step
+        if nibble & 2:
+            delta += step >> 1
+        if nibble & 1:
+            delta += step >> 2
+        predictor = min(max(predictor - delta if nibble & 8 else predictor + delta, -32768), 32767)
+        index = min(max(index + server.IMA_INDEX_TABLE[nibble], 0), 88)
+        out[4 + i // 2] |= nibble << (4 * (i & 1))
+    return bytes(out)
+
+
+def tone(count, phase=0.0):
+    return (8000 * np.sin(2 * np.pi * 1000 * np.arange(count) / 16000 + phase)).astype(np.int16)
+
+
+class ImaAdpcmDecodeTest(unittest.TestCase):
+    def test_mono_odd_count_keeps_sample_count(self):
+        # 512 samples decimated by 3 come out as 170 or 171 per packet
+        samples = tone(171)
+        decoded = np.frombuffer(server.decode_payload(server.CODEC_IMA_ADPCM, encode_ima_adpcm(samples), 171, 1),
+                                dtype=np.int16)
+        self.assertEqual(len(decoded), 171)
+        self.assertLess(np.max(np.abs(decoded[32:].astype(np.int32) - samples[32:])), 2000)
+
+    def test_mono_even_count_unchanged(self):
+        decoded = server.decode_payload(server.CODEC_IMA_ADPCM, encode_ima_adpcm(tone(170)), 170, 1)
+        self.assertEqual(len(decoded), 170 * 2)
+
+    def test_stereo_odd_count_interleaves_blocks(self):
+        left, right = tone(171), tone(171, np.pi)
+        payload = encode_ima_adpcm(left) + encode_ima_adpcm(right)
+        decoded = np.frombuffer(server.decode_payload(server.CODEC_IMA_ADPCM, payload, 171, 2), dtype=np.int16)
+        self.assertEqual(decoded.shape, (171 * 2,))
+        planes = decoded.reshape(-1, 2)
+        self.assertTrue(np.array_equal(planes[:, 0], server.decode_ima_adpcm(payload[:len(payload) // 2])[:171]))
+        self.assertTrue(np.array_equal(planes[:, 1], server.decode_ima_adpcm(payload[len(payload) // 2:])[:171]))
+
+
+if __name__ == "__main__":
+    unittest.main()
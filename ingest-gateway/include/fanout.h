@@ -0,0 +1,69 @@
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+// === FAN-OUT TO SUBSCRIBERS ===
+// The inference backend (and anything else) subscribes over a WebSocket on
+// /subscribe and gets the valid packets as binary messages of back-to-back
+// wire packets, the same framing a node's own WebSocket carries, so
+// backend-inference's AudioStreamHandler reads it unchanged. Every message
+// holds packets of one node; /subscribe?node=<ip> limits a subscriber to it.
+//
+// A message is copied out of the receive buffer once and shared by every
+// subscriber it is queued for. Each subscriber has a bounded queue that
+// drops its oldest message when full, so a slow consumer loses data instead
+// of holding up ingest or the other subscribers.
+typedef std::shared_ptr<const std::vector<uint8_t>> FanoutMessage;
+
+// Publishers (any worker) push, the worker owning the subscriber's socket pops
+class SubscriberQueue
+{
+public:
+    SubscriberQueue(size_t max_messages, uint32_t node_filter, int owner_wake_fd);
+
+    bool wants(uint32_t node_ip) const { return node == 0 || node == node_ip; }
+    void push(const FanoutMessage &message); // Wakes the owner if the queue was empty
+    bool pop(FanoutMessage &message);
+    uint64_t dropped() const { return drops.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex lock;
+    std::deque<FanoutMessage> queue;
+    const size_t limit;
+    const uint32_t node; // IPv4, network byte order; 0 = every node
+    const int wake_fd;
+    std::atomic<uint64_t> drops{0};
+};
+
+class FanoutHub
+{
+public:
+    void add(const std::shared_ptr<SubscriberQueue> &subscriber);
+    void remove(const SubscriberQueue *subscriber);
+    size_t subscribers() const { return count.load(std::memory_order_relaxed); }
+
+    // Queues a copy of data[0..bytes) for every subscriber that wants node_ip.
+    // Costs nothing but an atomic load while nobody is subscribed.
+    void publish(uint32_t node_ip, const uint8_t *data, size_t bytes);
+
+    uint64_t messagesPublished() const { return messages.load(std::memory_order_relaxed); }
+    uint64_t bytesPublished() const { return bytes_total.load(std::memory_order_relaxed); }
+    uint64_t messagesDropped() const; // By the subscribers still connected
+
+private:
+    mutable std::shared_mutex lock;
+    std::vector<std::shared_ptr<SubscriberQueue>> queues;
+    std::atomic<size_t> count{0};
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> bytes_total{0};
+};
+
+#endif // FANOUT_H
@@ -0,0 +1,24 @@
+#ifndef GATEWAY_CLOCK_H
+#define GATEWAY_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Unix microseconds: the clock time_pong hands out and arrivals are stamped
+// with, so node capture times and arrival times compare directly
+static inline int64_t unixTimeUs()
+{
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// For timeouts and rates; never steps
+static inline uint64_t monotonicMs()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+#endif // GATEWAY_CLOCK_H
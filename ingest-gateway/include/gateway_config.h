@@ -0,0 +1,44 @@
+#ifndef GATEWAY_CONFIG_H
+#define GATEWAY_CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// === GATEWAY DEFAULTS ===
+// Ports match esp32-client/server.py, so nodes need no change to switch
+#define GATEWAY_DEFAULT_PORT 8080
+#define GATEWAY_DEFAULT_UDP_PORT 5004             // UDP_DEFAULT_PORT on the node
+#define GATEWAY_DEFAULT_SEGMENT_MB 256
+#define GATEWAY_DEFAULT_CONN_BUFFER_KB 64         // Per connection; a node's batches are at most ~8 KB
+#define GATEWAY_DEFAULT_SUBSCRIBER_QUEUE 4096     // Messages (~40 s of one 48 kHz node)
+#define GATEWAY_DEFAULT_SYNC_MS 1000
+#define GATEWAY_DEFAULT_IDLE_TIMEOUT_S 60         // Nodes time_ping every 10 s
+#define GATEWAY_DEFAULT_STATS_S 10
+#define GATEWAY_LISTEN_BACKLOG 1024
+#define GATEWAY_MAX_EVENTS 256                    // epoll_wait batch
+#define GATEWAY_UDP_BATCH 64                      // recvmmsg batch
+#define GATEWAY_UDP_DATAGRAM_MAX 2048             // Largest wire packet plus RTP header fits
+#define GATEWAY_UDP_RESYNC_PACKETS 1000           // Sequence jump treated as a node reboot, not loss
+
+struct GatewayConfig
+{
+    std::string bind_address = "0.0.0.0";
+    uint16_t port = GATEWAY_DEFAULT_PORT;
+    uint16_t udp_port = GATEWAY_DEFAULT_UDP_PORT; // 0 = WebSocket only
+    unsigned threads = 0;                          // 0 = one per online CPU
+    bool pin_threads = true;                       // Worker i runs on CPU i
+    std::string data_dir = "ingest-data";          // Empty = no recording
+    uint64_t segment_bytes = (uint64_t)GATEWAY_DEFAULT_SEGMENT_MB << 20;
+    size_t connection_buffer = GATEWAY_DEFAULT_CONN_BUFFER_KB << 10;
+    size_t subscriber_queue = GATEWAY_DEFAULT_SUBSCRIBER_QUEUE;
+    unsigned sync_ms = GATEWAY_DEFAULT_SYNC_MS;    // fdatasync period; 0 = leave it to the kernel
+    unsigned idle_timeout_s = GATEWAY_DEFAULT_IDLE_TIMEOUT_S;
+    unsigned stats_interval_s = GATEWAY_DEFAULT_STATS_S;
+};
+
+// Command line into `config`. False (after printing why, or the usage for
+// --help) if the gateway should not start.
+bool parseArguments(int argc, char **argv, GatewayConfig &config);
+
+#endif // GATEWAY_CONFIG_H
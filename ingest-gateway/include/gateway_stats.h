@@ -0,0 +1,88 @@
+#ifndef GATEWAY_STATS_H
+#define GATEWAY_STATS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fanout.h"
+#include "gateway_config.h"
+#include "segment_writer.h"
+#include "wire_packet.h"
+
+// === COUNTERS ===
+// Written by one worker only, read by anyone: a relaxed load and store
+// instead of a locked read-modify-write on every packet.
+struct StatCounter
+{
+    std::atomic<uint64_t> value{0};
+
+    void add(uint64_t n) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    void set(uint64_t n) { value.store(n, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+};
+
+struct WorkerStats
+{
+    StatCounter nodes;                        // Node WebSocket connections open now
+    StatCounter subscribers;                  // Subscriber connections open now
+    StatCounter packets[3];                   // Valid packets by IngestTransport
+    StatCounter packet_bytes;                 // Wire bytes of valid packets
+    StatCounter rejected[PACKET_CHECK_COUNT]; // Invalid packets by PacketCheck
+    StatCounter protocol_errors;              // Connections closed for bad HTTP / WebSocket framing
+    StatCounter udp_lost;                     // Net of late arrivals, as reported to the node
+    StatCounter udp_reordered;
+    StatCounter latency_us_sum;               // Capture to arrival, live synced packets only
+    StatCounter latency_count;
+    StatCounter segment_records;              // Mirrors of SegmentWriter::stats()
+    StatCounter segment_bytes;
+    StatCounter segment_files;
+    StatCounter segment_dropped;
+    StatCounter segment_errors;
+    StatCounter subscriber_dropped;           // Queue drops of subscribers that have closed
+};
+
+// UDP loss as counted by the worker that receives a node's datagrams,
+// published once a second for whichever worker holds that node's WebSocket
+// to send back as {"type":"udp_stats",...} (udp_transport.h on the node)
+struct UdpPeerReport
+{
+    uint64_t received;
+    uint64_t lost;
+    uint64_t reordered;
+};
+
+class UdpPeerTable
+{
+public:
+    void publish(uint32_t node_ip, const UdpPeerReport &report);
+    bool lookup(uint32_t node_ip, UdpPeerReport &report) const;
+
+private:
+    mutable std::mutex lock;
+    std::unordered_map<uint32_t, UdpPeerReport> peers;
+};
+
+// Everything the workers share
+struct GatewayShared
+{
+    explicit GatewayShared(const GatewayConfig &gateway_config) : config(gateway_config) {}
+
+    const GatewayConfig &config;
+    FanoutHub fanout;
+    UdpPeerTable udp_peers;
+    std::vector<std::unique_ptr<WorkerStats>> stats; // One per worker, sized before they start
+    int64_t start_unix_us = 0;
+};
+
+// Prometheus text for GET /metrics, summed over the workers
+std::string renderMetrics(const GatewayShared &shared);
+
+// One line of totals and rates since the previous call, for the periodic log
+void logStats(const GatewayShared &shared);
+
+#endif // GATEWAY_STATS_H
@@ -0,0 +1,28 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <stdio.h>
+
+// === LOGGING MACROS ===
+// Same levels as the firmware's logging.h. One fprintf per line, which glibc
+// keeps whole when several workers log at once.
+void logTimestamp(char *out, size_t size);
+
+#define LOG_LINE(level, format, ...)                                             \
+    do                                                                           \
+    {                                                                            \
+        char log_time_[32];                                                      \
+        logTimestamp(log_time_, sizeof(log_time_));                              \
+        fprintf(stderr, "%s [" level "] " format "\n", log_time_, ##__VA_ARGS__); \
+    } while (0)
+
+#define LOG_INFO(format, ...) LOG_LINE("INFO", format, ##__VA_ARGS__)
+#define LOG_WARN(format, ...) LOG_LINE("WARN", format, ##__VA_ARGS__)
+#define LOG_ERROR(format, ...) LOG_LINE("ERROR", format, ##__VA_ARGS__)
+#ifdef GATEWAY_DEBUG
+#define LOG_DEBUG(format, ...) LOG_LINE("DEBUG", format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...)
+#endif
+
+#endif // LOGGING_H
@@ -0,0 +1,40 @@
+#ifndef MIRROR_RING_H
+#define MIRROR_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// === MIRRORED BYTE RING ===
+// Per-connection receive buffer. The same memfd pages are mapped twice back
+// to back, so whichever way the data wraps, the readable bytes and the free
+// space are each one contiguous run: recv() writes straight into the ring,
+// and WebSocket frames and the packets inside them are parsed, unmasked and
+// handed to writev() in place without ever being linearised.
+class MirrorRing
+{
+public:
+    MirrorRing() = default;
+    ~MirrorRing();
+    MirrorRing(const MirrorRing &) = delete;
+    MirrorRing &operator=(const MirrorRing &) = delete;
+
+    // Capacity is rounded up to whole pages. False if the mapping failed.
+    bool begin(size_t capacity);
+
+    uint8_t *readPtr() const { return base + read_pos; }
+    size_t readable() const { return count; }
+    uint8_t *writePtr() const { return base + (read_pos + count) % ring_capacity; }
+    size_t writable() const { return ring_capacity - count; }
+    size_t capacity() const { return ring_capacity; }
+
+    void commit(size_t bytes) { count += bytes; }   // After writing to writePtr()
+    void consume(size_t bytes);                     // Releases bytes from readPtr()
+
+private:
+    uint8_t *base = nullptr;
+    size_t ring_capacity = 0;
+    size_t read_pos = 0;
+    size_t count = 0;
+};
+
+#endif // MIRROR_RING_H
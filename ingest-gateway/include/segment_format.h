@@ -0,0 +1,139 @@
+#ifndef SEGMENT_FORMAT_H
+#define SEGMENT_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+// === SEGMENT FILES ===
+// Append-only recording of received packets, written by the gateway's
+// workers and by esp32-client/server.py. Layout, little-endian, every chunk
+// starting on an 8-byte boundary:
+//   SegmentFileHeader
+//   { SegmentChunkHeader, body, zero pad to 8 } ...
+//   index chunk: SegmentChunkHeader (kind INDEX), SegmentIndexEntry[]
+//   SegmentFooter
+// A packet chunk's body is the wire packet exactly as the node sent it (CRC
+// included), so segments replay through the same parsers as a live stream.
+// The chunk header repeats what a reader filters on (node, sequence, times,
+// codec) at fixed offsets, so walking a file touches the headers only.
+//
+// The index and footer are appended when the file is closed. The index is
+// sparse and sorted by (node, time), so a reader maps the file, finds the
+// footer at its end and binary-searches the entries in place. A file cut off
+// by a crash has neither; readers rebuild the index by stepping from chunk
+// header to chunk header, and `chirp-export --repair` appends it.
+#define SEGMENT_FILE_MAGIC "CNSEG\0\0\0"
+#define SEGMENT_FOOTER_MAGIC "CNSEGEND"
+#define SEGMENT_FORMAT_VERSION 2
+#define SEGMENT_CHUNK_MAGIC 0x43534E43 // "CNSC"
+#define SEGMENT_ALIGN 8
+#define SEGMENT_INDEX_INTERVAL_US 1000000 // One index entry per node per second of audio
+
+enum IngestTransport : uint8_t
+{
+    INGEST_TRANSPORT_WS = 0,
+    INGEST_TRANSPORT_UDP = 1,
+    INGEST_TRANSPORT_RTP = 2,
+};
+
+enum SegmentChunkKind : uint8_t
+{
+    SEGMENT_CHUNK_PACKET = 0,
+    SEGMENT_CHUNK_INDEX = 1,
+};
+
+struct SegmentFileHeader
+{
+    char magic[8];              // SEGMENT_FILE_MAGIC
+    uint16_t version;           // SEGMENT_FORMAT_VERSION
+    uint16_t writer;            // Gateway worker number; 0 for server.py
+    uint32_t index_interval_ms; // SEGMENT_INDEX_INTERVAL_US the index was built with
+    int64_t created_unix_us;
+    uint64_t reserved;
+} __attribute__((packed));
+
+struct SegmentChunkHeader
+{
+    uint32_t magic;          // SEGMENT_CHUNK_MAGIC, for resyncing after a torn write
+    uint8_t kind;            // SegmentChunkKind
+    uint8_t transport;       // IngestTransport
+    uint8_t codec;           // AudioCodecId, from the packet header
+    uint8_t flags;           // PACKET_FLAG_*, from the packet header
+    uint32_t body_bytes;     // Body that follows, without the pad
+    uint32_t sequence;       // Packet sequence
+    uint32_t node_ip;        // IPv4, network byte order
+    uint16_t node_port;      // Host byte order
+    uint16_t sample_count;   // Samples per channel (log-mel: frames)
+    uint32_t sample_rate;
+    uint8_t channels;
+    uint8_t reserved[3];
+    uint64_t timestamp;      // Node capture timestamp, esp_timer microseconds
+    int64_t wall_clock_us;   // Capture time on the receiver's clock, 0 if the node was not synced
+    int64_t arrival_unix_us; // Receive time on the writer's clock
+} __attribute__((packed));
+
+struct SegmentIndexEntry
+{
+    int64_t time_unix_us; // segmentChunkTime() of the chunk
+    uint64_t offset;      // Of its SegmentChunkHeader from the start of the file
+    uint32_t node_ip;
+    uint32_t sequence;
+} __attribute__((packed));
+
+struct SegmentFooter
+{
+    uint64_t index_offset; // Of the index chunk's header
+    uint64_t packet_chunks;
+    int64_t first_unix_us; // Earliest and latest segmentChunkTime()
+    int64_t last_unix_us;
+    char magic[8];         // SEGMENT_FOOTER_MAGIC, last so a torn footer never matches
+} __attribute__((packed));
+
+static_assert(sizeof(SegmentFileHeader) == 32, "Segment file header layout changed");
+static_assert(sizeof(SegmentChunkHeader) == 56, "Segment chunk header layout changed");
+static_assert(sizeof(SegmentIndexEntry) == 24, "Segment index entry layout changed");
+static_assert(sizeof(SegmentFooter) == 40, "Segment footer layout changed");
+
+static inline size_t segmentPad(size_t bytes)
+{
+    return (SEGMENT_ALIGN - bytes % SEGMENT_ALIGN) % SEGMENT_ALIGN;
+}
+
+// Capture time when the node was synced, otherwise arrival
+static inline int64_t segmentChunkTime(const SegmentChunkHeader &chunk)
+{
+    return chunk.wall_clock_us != 0 ? chunk.wall_clock_us : chunk.arrival_unix_us;
+}
+
+// Decides which packet chunks get an index entry: a node's first chunk in the
+// file, one per SEGMENT_INDEX_INTERVAL_US after that, and any chunk that
+// breaks the node's sequence (a reboot, or packets lost in between).
+class SegmentIndexBuilder
+{
+public:
+    void clear();
+    void add(const SegmentChunkHeader &chunk, uint64_t offset);
+    void finish(); // Sorts by (node, time)
+
+    const std::vector<SegmentIndexEntry> &entries() const { return index; }
+    uint64_t packetChunks() const { return chunks; }
+    int64_t firstUnixUs() const { return first_us; }
+    int64_t lastUnixUs() const { return last_us; }
+
+private:
+    struct NodeMark
+    {
+        int64_t indexed_us;
+        uint32_t next_sequence;
+    };
+
+    std::vector<SegmentIndexEntry> index;
+    std::unordered_map<uint32_t, NodeMark> nodes;
+    uint64_t chunks = 0;
+    int64_t first_us = 0;
+    int64_t last_us = 0;
+};
+
+#endif // SEGMENT_FORMAT_H
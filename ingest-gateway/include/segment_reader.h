@@ -0,0 +1,78 @@
+#ifndef SEGMENT_READER_H
+#define SEGMENT_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "segment_format.h"
+
+// === SEGMENT READER ===
+// Maps a segment file read-only and hands out chunks in place; nothing is
+// copied or parsed beyond the chunk headers it is asked for. A closed file's
+// index is used straight from the mapping. Otherwise (the writer crashed, or
+// the file is still being written) the index is rebuilt by walking the chunk
+// headers, stopping at the first torn or corrupt one.
+struct SegmentChunk
+{
+    uint64_t offset = 0; // Of the header, from the start of the file
+    const SegmentChunkHeader *header = nullptr;
+    const uint8_t *body = nullptr; // header->body_bytes bytes
+};
+
+class SegmentReader
+{
+public:
+    SegmentReader() = default;
+    ~SegmentReader();
+    SegmentReader(const SegmentReader &) = delete;
+    SegmentReader &operator=(const SegmentReader &) = delete;
+
+    bool open(const std::string &path); // Logs why not
+    void close();
+
+    const std::string &path() const { return file_path; }
+    const SegmentFileHeader &fileHeader() const { return *(const SegmentFileHeader *)map; }
+    bool closedCleanly() const { return footer != nullptr; }
+    const SegmentFooter *fileFooter() const { return footer; }
+
+    // Sorted by (node, time)
+    const SegmentIndexEntry *index() const { return index_entries; }
+    size_t indexSize() const { return index_size; }
+    uint64_t packetChunks() const { return packet_chunks; }
+    int64_t firstUnixUs() const { return first_us; }
+    int64_t lastUnixUs() const { return last_us; }
+
+    // Where to start reading to see every chunk of `node_ip` (0: any node)
+    // from `time_unix_us` on; endOfChunks() if there are none. Chunks are in
+    // arrival order, so a reader still filters by segmentChunkTime().
+    uint64_t seek(uint32_t node_ip, int64_t time_unix_us) const;
+
+    uint64_t firstChunk() const { return sizeof(SegmentFileHeader); }
+    uint64_t endOfChunks() const { return chunks_end; } // Past the last packet chunk
+    // The intact chunk at `offset`, packet or index; false past the end or at damage
+    bool chunkAt(uint64_t offset, SegmentChunk &chunk) const;
+    static uint64_t nextOffset(const SegmentChunk &chunk)
+    {
+        return chunk.offset + sizeof(SegmentChunkHeader) + chunk.header->body_bytes + segmentPad(chunk.header->body_bytes);
+    }
+
+private:
+    bool loadFooter();
+    void rebuildIndex();
+
+    std::string file_path;
+    const uint8_t *map = nullptr;
+    size_t map_bytes = 0;
+    const SegmentFooter *footer = nullptr;
+    const SegmentIndexEntry *index_entries = nullptr;
+    size_t index_size = 0;
+    uint64_t packet_chunks = 0;
+    int64_t first_us = 0;
+    int64_t last_us = 0;
+    uint64_t chunks_end = 0;
+    SegmentIndexBuilder rebuilt; // Backs index_entries when there is no footer
+};
+
+#endif // SEGMENT_READER_H
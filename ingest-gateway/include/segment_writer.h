@@ -0,0 +1,76 @@
+#ifndef SEGMENT_WRITER_H
+#define SEGMENT_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <string>
+
+#include "segment_format.h"
+#include "wire_packet.h"
+
+// === SEGMENT WRITER ===
+// Each worker appends every valid packet it receives to its own segment
+// files (segment_format.h), <data_dir>/w<worker>-<created unix us>.seg,
+// rolling to a new file past the configured size.
+//
+// Packets are not copied on the way out: add() only points an iovec at the
+// packet where it already sits (the connection's receive ring or the UDP
+// batch buffers) and flush() hands them all to a single writev(), which the
+// caller must do before that memory is reused.
+#define SEGMENT_MAX_RECORDS 256 // Per flush; three iovecs each stays under IOV_MAX
+#define SEGMENT_REOPEN_US 1000000 // Retry period after a segment cannot be created
+
+struct SegmentStats
+{
+    uint64_t records;
+    uint64_t bytes;     // Written to disk, headers included
+    uint64_t dropped;   // Records lost to write errors
+    uint32_t segments;  // Files opened
+    uint32_t write_errors;
+};
+
+class SegmentWriter
+{
+public:
+    SegmentWriter() = default;
+    ~SegmentWriter();
+    SegmentWriter(const SegmentWriter &) = delete;
+    SegmentWriter &operator=(const SegmentWriter &) = delete;
+
+    // Empty `directory`: recording off, add() and flush() do nothing
+    bool begin(const std::string &directory, unsigned worker, uint64_t segment_bytes);
+    bool enabled() const { return !dir.empty(); }
+
+    // Queues one packet, rolling to a new segment first if it would not fit
+    void add(const uint8_t *packet, size_t packet_bytes, const AudioPacketHeader &header, uint32_t node_ip,
+             uint16_t node_port, uint8_t transport, int64_t arrival_unix_us);
+    void flush(); // Writes everything queued since the last flush
+    void sync();  // fdatasync() of the open segment
+    void close(); // Appends the index and footer
+
+    const SegmentStats &stats() const { return counters; }
+
+private:
+    bool openSegment(int64_t now_us);
+    void closeSegment();
+    bool writeAll(iovec *iov, int iov_count);
+    void dropQueued();
+
+    std::string dir;
+    unsigned worker_id = 0;
+    uint64_t max_bytes = 0;
+    int fd = -1;
+    int64_t reopen_after_us = 0;
+    uint64_t segment_size = 0; // Bytes in the open file
+    uint64_t queued_bytes = 0;
+    SegmentChunkHeader headers[SEGMENT_MAX_RECORDS];
+    iovec iov[3 * SEGMENT_MAX_RECORDS];
+    int iov_count = 0;
+    size_t record_count = 0;
+    bool dirty = false; // Written since the last sync()
+    SegmentIndexBuilder index; // Of the open segment, queued records included
+    SegmentStats counters = {};
+};
+
+#endif // SEGMENT_WRITER_H
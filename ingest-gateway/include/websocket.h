@@ -0,0 +1,63 @@
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// === WEBSOCKET (RFC 6455), SERVER SIDE ===
+// Just what nodes and subscribers need: the upgrade handshake, frame headers
+// both ways and unmasking. Payloads are never copied by this layer.
+#define WS_OPCODE_CONTINUATION 0x0
+#define WS_OPCODE_TEXT 0x1
+#define WS_OPCODE_BINARY 0x2
+#define WS_OPCODE_CLOSE 0x8
+#define WS_OPCODE_PING 0x9
+#define WS_OPCODE_PONG 0xA
+
+#define WS_CLOSE_NORMAL 1000
+#define WS_CLOSE_PROTOCOL_ERROR 1002
+#define WS_CLOSE_TOO_BIG 1009
+
+#define WS_SERVER_HEADER_MAX 10 // Unmasked frame with a 64-bit length
+#define HTTP_HEAD_MAX_BYTES 8192
+
+struct HttpRequest
+{
+    std::string method;
+    std::string path;          // Without the query string
+    std::string query;         // After '?', or empty
+    std::string websocket_key; // Sec-WebSocket-Key, empty if absent
+    bool upgrade = false;      // Upgrade: websocket
+};
+
+// Parses a request head once it is complete (through the blank line).
+// Returns the bytes it used, 0 while more are needed, -1 if malformed.
+long parseHttpRequest(const uint8_t *data, size_t length, HttpRequest &request);
+
+// The 101 Switching Protocols response for `key`
+std::string handshakeResponse(const std::string &key);
+
+struct WsFrame
+{
+    uint8_t opcode;
+    bool fin;
+    bool masked;
+    uint8_t mask[4];
+    size_t header_bytes;
+    uint64_t payload_bytes;
+};
+
+// Header of the frame at data[0..length). Returns 1 with `frame` filled,
+// 0 while the header is incomplete, -1 on a protocol error.
+int parseFrameHeader(const uint8_t *data, size_t length, WsFrame &frame);
+
+// XORs the client's mask out of `payload` in place, a word at a time.
+// `offset` is the payload position of payload[0], for payloads unmasked in pieces.
+void unmaskPayload(uint8_t *payload, size_t bytes, const uint8_t mask[4], size_t offset = 0);
+
+// FIN frame header for a server-to-client frame (never masked) into `out`
+// (WS_SERVER_HEADER_MAX bytes). Returns its length.
+size_t writeFrameHeader(uint8_t *out, uint8_t opcode, uint64_t payload_bytes);
+
+#endif // WEBSOCKET_H
@@ -0,0 +1,33 @@
+#ifndef WIRE_PACKET_H
+#define WIRE_PACKET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "packet_format.h"
+
+// Receiver-side checks on the node's wire packets (packet_format.h, shared
+// with the firmware). Same rules as iter_packets() in esp32-client/server.py:
+// the magic, a version 1 header prefix, a payload inside the message and the
+// CRC over the version 1 prefix and the payload.
+#define WIRE_HEADER_V1_BYTES 32
+
+enum PacketCheck : uint8_t
+{
+    PACKET_OK,
+    PACKET_TRUNCATED,   // Header or payload runs past the message
+    PACKET_BAD_MAGIC,
+    PACKET_BAD_VERSION, // Older than version 1, or a header shorter than its prefix
+    PACKET_BAD_CRC,
+    PACKET_CHECK_COUNT
+};
+
+const char *packetCheckName(uint8_t check);
+
+// The packet starting at data[0] of `available` bytes. On PACKET_OK fills
+// `header` (fields past the sender's header_size zeroed) and `packet_bytes`.
+PacketCheck checkPacket(const uint8_t *data, size_t available, AudioPacketHeader &header, size_t &packet_bytes);
+
+// Call once before any worker starts: crc32Update() builds its table lazily
+void wirePacketInit();
+
+#endif // WIRE_PACKET_H
@@ -0,0 +1,176 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "fanout.h"
+#include "gateway_stats.h"
+#include "mirror_ring.h"
+#include "segment_writer.h"
+#include "websocket.h"
+
+// === WORKERS ===
+// Thread per core, shared nothing on the packet path. Every worker has its
+// own epoll instance and its own SO_REUSEPORT TCP and UDP sockets on the same
+// ports, so the kernel spreads connections across workers and hashes a
+// node's datagrams to one of them; from then on the node's packets are
+// parsed, recorded and fanned out on that worker without a lock (the
+// fan-out queues are the only cross-thread hand-off).
+//
+// One port serves everything, told apart by the HTTP request:
+//   WebSocket upgrade on /subscribe[?node=<ip>]  fan-out subscriber (fanout.h)
+//   any other WebSocket upgrade                   node: binary packets, time_ping / flow_state text
+//   GET /metrics                                  Prometheus text, then close
+enum SourceKind : uint8_t
+{
+    SOURCE_LISTENER,
+    SOURCE_UDP,
+    SOURCE_WAKE,  // eventfd: stop, or fan-out messages for this worker's subscribers
+    SOURCE_TIMER, // 1 s tick: sync, idle timeouts, udp_stats, counters
+    SOURCE_CONNECTION,
+};
+
+struct PollSource
+{
+    SourceKind kind;
+    int fd = -1;
+};
+
+enum ConnectionRole : uint8_t
+{
+    ROLE_HANDSHAKE,  // Waiting for the request head
+    ROLE_NODE,
+    ROLE_SUBSCRIBER,
+    ROLE_HTTP,       // Plain HTTP reply in flight, closed once sent
+};
+
+#define SUBSCRIBER_WRITE_BATCH 16 // Fan-out messages per writev()
+#define CONNECTION_TX_MAX (256 * 1024) // Unsent control output before a peer counts as stuck
+
+struct Connection : PollSource
+{
+    ConnectionRole role = ROLE_HANDSHAKE;
+    bool closed = false;
+    bool writing = false;     // EPOLLOUT registered
+    bool close_after_tx = false;
+    uint32_t ip = 0;          // Network byte order
+    uint16_t port = 0;
+    char name[24] = {};       // "a.b.c.d:port" for the log
+    uint64_t last_rx_ms = 0;
+    MirrorRing rx;
+
+    // Handshake replies, control frames and HTTP bodies; only sent between fan-out messages
+    std::string tx;
+    size_t tx_sent = 0;
+
+    // Fragmented message being put back together (nodes never fragment, but the RFC allows it)
+    std::vector<uint8_t> fragments;
+    uint8_t fragment_opcode = 0;
+    bool in_fragment = false;
+
+    // Node
+    uint64_t rejected = 0;
+    UdpPeerReport udp_reported = {};
+
+    // Subscriber: messages being written, with their frame headers
+    std::shared_ptr<SubscriberQueue> queue;
+    FanoutMessage inflight[SUBSCRIBER_WRITE_BATCH];
+    uint8_t inflight_headers[SUBSCRIBER_WRITE_BATCH][WS_SERVER_HEADER_MAX];
+    uint8_t inflight_header_bytes[SUBSCRIBER_WRITE_BATCH];
+    size_t inflight_count = 0;
+    size_t inflight_sent = 0; // Bytes of the batch already written
+};
+
+class Worker
+{
+public:
+    Worker(unsigned worker_id, GatewayShared &gateway);
+    ~Worker();
+    Worker(const Worker &) = delete;
+    Worker &operator=(const Worker &) = delete;
+
+    // Sockets, epoll and the segment writer. On the main thread, so a port
+    // that cannot be bound stops the gateway before anything runs.
+    bool begin();
+    void start();
+    void stop(); // Any thread; run() finishes its current batch and returns
+    void join();
+
+private:
+    struct UdpPeer
+    {
+        uint16_t port = 0;
+        uint32_t next_sequence = 0;
+        bool started = false;
+        UdpPeerReport report = {};
+    };
+
+    void run();
+    bool watch(PollSource *source, uint32_t events);
+
+    // TCP side
+    void acceptConnections();
+    void onReadable(Connection *conn);
+    bool processInput(Connection *conn, int64_t arrival_us);
+    bool processHandshake(Connection *conn);
+    bool processFrames(Connection *conn, int64_t arrival_us);
+    bool handleFrame(Connection *conn, const WsFrame &frame, uint8_t *payload, int64_t arrival_us);
+    void handleNodeMessage(Connection *conn, const uint8_t *data, size_t bytes, int64_t arrival_us);
+    void handleText(Connection *conn, const char *text, size_t length, int64_t arrival_us);
+    void queueFrame(Connection *conn, uint8_t opcode, const void *payload, size_t bytes);
+    void queueHttp(Connection *conn, int status, const char *reason, const std::string &body, const char *type);
+    void flushOutput(Connection *conn);
+    bool flushTx(Connection *conn);
+    bool flushSubscriber(Connection *conn);
+    void setWriting(Connection *conn, bool writing);
+    void closeConnection(Connection *conn, const char *why);
+
+    // Packets from either side
+    void acceptPacket(const uint8_t *packet, size_t bytes, const AudioPacketHeader &header, uint32_t ip, uint16_t port,
+                      uint8_t transport, int64_t arrival_us);
+    void rejectPacket(uint8_t check, const char *from, uint64_t &count);
+
+    // UDP side
+    void receiveDatagrams();
+    void trackUdpSequence(uint32_t ip, uint16_t port, uint32_t sequence);
+
+    void onTick();
+    void serviceSubscribers();
+
+    const unsigned id;
+    GatewayShared &shared;
+    const GatewayConfig &config;
+    WorkerStats &stats;
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+
+    int epoll_fd = -1;
+    PollSource listener = {SOURCE_LISTENER};
+    PollSource udp = {SOURCE_UDP};
+    PollSource wake = {SOURCE_WAKE};
+    PollSource timer = {SOURCE_TIMER};
+
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    std::vector<std::unique_ptr<Connection>> graveyard; // Closed during this epoll batch, freed after it
+    std::vector<Connection *> subscribers;
+    SegmentWriter writer;
+    uint64_t last_sync_ms = 0;
+
+    std::unordered_map<uint32_t, UdpPeer> udp_peers; // By node IP
+    uint64_t udp_rejected = 0;
+    std::vector<uint8_t> udp_buffers;
+    sockaddr_in udp_sources[GATEWAY_UDP_BATCH];
+    iovec udp_iov[GATEWAY_UDP_BATCH];
+    mmsghdr udp_messages[GATEWAY_UDP_BATCH];
+};
+
+#endif // WORKER_H
@@ -0,0 +1,540 @@
+// src/export_tool.cpp
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "audio_codec.h"
+#include "logging.h"
+#include "segment_reader.h"
+#include "wire_packet.h"
+
+// === chirp-export ===
+// WAV export, listing and repair of segment files (segment_format.h), from
+// either the gateway or server.py. One WAV per node and stretch of audio: a
+// new file starts when the stream's format changes, when its capture clock
+// jumps (trigger gaps, reboots), and for spooled backlog, which is written
+// apart from the live stream it arrived interleaved with. Packets lost inside
+// a stretch are filled with silence so the WAV keeps the node's timing.
+#define EXPORT_DEFAULT_SPLIT_GAP_MS 1000
+#define EXPORT_MAX_FILL_PACKETS 1000  // Longer sequence gaps start a new file instead
+#define EXPORT_WAV_MAX_DATA 0xFFFFFF00u // RIFF sizes are 32 bits
+#define REPAIR_MIN_AGE_S 60           // Younger files may still be open in a writer
+
+struct ExportOptions
+{
+    std::string out_dir = ".";
+    uint32_t node_ip = 0; // 0 = every node
+    int64_t from_us = INT64_MIN;
+    int64_t to_us = INT64_MAX;
+    int64_t split_gap_us = (int64_t)EXPORT_DEFAULT_SPLIT_GAP_MS * 1000;
+    bool list = false;
+    bool repair = false;
+    std::vector<std::string> files;
+};
+
+static void printUsage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [options] SEGMENT...\n"
+            "  --out DIR           Directory for the WAV files (default .)\n"
+            "  --node IP           Only this node\n"
+            "  --from UNIX_S       Only audio captured from this time (seconds, fractions allowed)\n"
+            "  --to UNIX_S         ... up to this time\n"
+            "  --split-gap-ms N    Start a new WAV across capture gaps longer than this (default %d)\n"
+            "  --list              Summarise the files and their index instead of exporting\n"
+            "  --repair            Append the index and footer to files a crash left without one\n"
+            "                      (skips files changed in the last %d s, which a writer may still hold)\n",
+            program, EXPORT_DEFAULT_SPLIT_GAP_MS, REPAIR_MIN_AGE_S);
+}
+
+static bool parseTime(const char *text, int64_t &us)
+{
+    char *end = nullptr;
+    const double seconds = strtod(text, &end);
+    if (end == text || *end != '\0')
+    {
+        return false;
+    }
+    us = (int64_t)(seconds * 1e6);
+    return true;
+}
+
+static bool parseArguments(int argc, char **argv, ExportOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *option = argv[i];
+        if (strcmp(option, "--help") == 0 || strcmp(option, "-h") == 0)
+        {
+            printUsage(argv[0]);
+            return false;
+        }
+        if (strcmp(option, "--list") == 0)
+        {
+            options.list = true;
+            continue;
+        }
+        if (strcmp(option, "--repair") == 0)
+        {
+            options.repair = true;
+            continue;
+        }
+        if (strncmp(option, "--", 2) != 0)
+        {
+            options.files.push_back(option);
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            LOG_ERROR("Unknown option or missing value: %s", option);
+            printUsage(argv[0]);
+            return false;
+        }
+        const char *value = argv[++i];
+        bool ok = true;
+        if (strcmp(option, "--out") == 0)
+        {
+            options.out_dir = value;
+        }
+        else if (strcmp(option, "--node") == 0)
+        {
+            in_addr address;
+            ok = inet_pton(AF_INET, value, &address) == 1;
+            options.node_ip = address.s_addr;
+        }
+        else if (strcmp(option, "--from") == 0)
+        {
+            ok = parseTime(value, options.from_us);
+        }
+        else if (strcmp(option, "--to") == 0)
+        {
+            ok = parseTime(value, options.to_us);
+        }
+        else if (strcmp(option, "--split-gap-ms") == 0)
+        {
+            char *end = nullptr;
+            const long long gap_ms = strtoll(value, &end, 10);
+            ok = end != value && *end == '\0' && gap_ms > 0;
+            options.split_gap_us = gap_ms * 1000;
+        }
+        else
+        {
+            LOG_ERROR("Unknown option: %s", option);
+            printUsage(argv[0]);
+            return false;
+        }
+        if (!ok)
+        {
+            LOG_ERROR("Invalid value for %s: %s", option, value);
+            return false;
+        }
+    }
+    if (options.files.empty())
+    {
+        printUsage(argv[0]);
+        return false;
+    }
+    return true;
+}
+
+static std::string ipText(uint32_t node_ip)
+{
+    in_addr address;
+    address.s_addr = node_ip;
+    char text[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &address, text, sizeof(text));
+    return text;
+}
+
+// "20261014-174200.683", UTC
+static std::string timeText(int64_t unix_us)
+{
+    const time_t seconds = (time_t)(unix_us / 1000000);
+    tm utc;
+    gmtime_r(&seconds, &utc);
+    char text[40];
+    const size_t used = strftime(text, sizeof(text), "%Y%m%d-%H%M%S", &utc);
+    snprintf(text + used, sizeof(text) - used, ".%03d", (int)(unix_us % 1000000 / 1000));
+    return text;
+}
+
+// === WAV Output ===
+struct WavOutput
+{
+    FILE *file = nullptr;
+    std::string path;
+    uint32_t sample_rate = 0;
+    uint16_t channels = 0;
+    uint16_t bits = 0;
+    uint64_t data_bytes = 0;
+    uint64_t next_timestamp = 0; // Node clock, where the next packet should start
+    uint32_t next_sequence = 0;
+    uint64_t packets = 0;
+    uint64_t filled_packets = 0;
+};
+
+static void writeWavHeader(FILE *file, const WavOutput &wav)
+{
+    const uint32_t data_bytes = (uint32_t)wav.data_bytes;
+    const uint32_t riff_bytes = 36 + data_bytes;
+    const uint16_t format_pcm = 1;
+    const uint16_t block_align = (uint16_t)(wav.channels * wav.bits / 8);
+    const uint32_t byte_rate = wav.sample_rate * block_align;
+    const uint32_t format_bytes = 16;
+    fwrite("RIFF", 1, 4, file);
+    fwrite(&riff_bytes, 4, 1, file);
+    fwrite("WAVEfmt ", 1, 8, file);
+    fwrite(&format_bytes, 4, 1, file);
+    fwrite(&format_pcm, 2, 1, file);
+    fwrite(&wav.channels, 2, 1, file);
+    fwrite(&wav.sample_rate, 4, 1, file);
+    fwrite(&byte_rate, 4, 1, file);
+    fwrite(&block_align, 2, 1, file);
+    fwrite(&wav.bits, 2, 1, file);
+    fwrite("data", 1, 4, file);
+    fwrite(&data_bytes, 4, 1, file);
+}
+
+class WavExporter
+{
+public:
+    explicit WavExporter(const ExportOptions &export_options) : options(export_options) {}
+    ~WavExporter() { finishAll(); }
+
+    void add(const SegmentChunk &chunk);
+    void finishAll();
+    uint64_t filesWritten() const { return files_written; }
+    uint64_t skippedFeatures() const { return skipped_features; }
+    uint64_t badPackets() const { return bad_packets; }
+
+private:
+    bool decode(const AudioPacketHeader &header, const uint8_t *payload, uint16_t &bits);
+    bool startFile(WavOutput &wav, const SegmentChunkHeader &chunk, uint16_t bits);
+    void finish(WavOutput &wav);
+
+    const ExportOptions &options;
+    std::map<std::pair<uint32_t, bool>, WavOutput> outputs; // By node and spooled
+    std::vector<uint8_t> samples;                           // Decoded payload of the current packet
+    std::vector<int16_t> plane;
+    uint64_t files_written = 0;
+    uint64_t skipped_features = 0;
+    uint64_t bad_packets = 0;
+};
+
+// Into `samples` as WAV frames; false for payloads that are not audio
+bool WavExporter::decode(const AudioPacketHeader &header, const uint8_t *payload, uint16_t &bits)
+{
+    const size_t channels = header.channels ? header.channels : 1;
+    if (header.sample_rate == 0)
+    {
+        return false;
+    }
+    switch (header.codec)
+    {
+    case AUDIO_CODEC_PCM16:
+        bits = 16;
+        samples.assign(payload, payload + header.payload_bytes - header.payload_bytes % (2 * channels));
+        return true;
+    case AUDIO_CODEC_PCM24:
+        bits = 24;
+        samples.assign(payload, payload + header.payload_bytes - header.payload_bytes % (3 * channels));
+        return true;
+    case AUDIO_CODEC_IMA_ADPCM:
+    {
+        // One block per channel from its own encoder state, interleaved here
+        bits = 16;
+        const size_t block = imaAdpcmEncodedSize(header.sample_count);
+        if (block * channels > header.payload_bytes)
+        {
+            return false;
+        }
+        samples.assign((size_t)header.sample_count * channels * 2, 0);
+        int16_t *out = (int16_t *)samples.data();
+        plane.resize(header.sample_count);
+        for (size_t c = 0; c < channels; ++c)
+        {
+            const size_t decoded = imaAdpcmDecode(payload + c * block, block, plane.data(), plane.size());
+            for (size_t i = 0; i < decoded; ++i)
+            {
+                out[i * channels + c] = plane[i];
+            }
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool WavExporter::startFile(WavOutput &wav, const SegmentChunkHeader &chunk, uint16_t bits)
+{
+    const bool spooled = chunk.flags & PACKET_FLAG_SPOOLED;
+    const std::string base =
+        options.out_dir + "/" + ipText(chunk.node_ip) + "-" + timeText(segmentChunkTime(chunk)) + (spooled ? "-spooled" : "");
+    std::string path = base + ".wav";
+    for (int n = 2; access(path.c_str(), F_OK) == 0; ++n)
+    {
+        path = base + "-" + std::to_string(n) + ".wav";
+    }
+    wav = WavOutput();
+    wav.file = fopen(path.c_str(), "wb");
+    if (!wav.file)
+    {
+        LOG_ERROR("Cannot create %s: %m", path.c_str());
+        return false;
+    }
+    wav.path = path;
+    wav.sample_rate = chunk.sample_rate;
+    wav.channels = chunk.channels ? chunk.channels : 1;
+    wav.bits = bits;
+    writeWavHeader(wav.file, wav); // Sizes patched in finish()
+    return true;
+}
+
+void WavExporter::finish(WavOutput &wav)
+{
+    if (!wav.file)
+    {
+        return;
+    }
+    fseek(wav.file, 0, SEEK_SET);
+    writeWavHeader(wav.file, wav);
+    const bool ok = fclose(wav.file) == 0;
+    wav.file = nullptr;
+    const double seconds = (double)wav.data_bytes / (wav.channels * wav.bits / 8) / wav.sample_rate;
+    if (!ok)
+    {
+        LOG_ERROR("Writing %s failed", wav.path.c_str());
+        return;
+    }
+    files_written++;
+    LOG_INFO("Wrote %s: %.1f s, %u Hz x %u ch, %d-bit, %llu packets (%llu lost, filled with silence)",
+             wav.path.c_str(), seconds, wav.sample_rate, wav.channels, wav.bits, (unsigned long long)wav.packets,
+             (unsigned long long)wav.filled_packets);
+}
+
+void WavExporter::finishAll()
+{
+    for (auto &entry : outputs)
+    {
+        finish(entry.second);
+    }
+    outputs.clear();
+}
+
+void WavExporter::add(const SegmentChunk &chunk)
+{
+    AudioPacketHeader header;
+    size_t packet_bytes = 0;
+    if (checkPacket(chunk.body, chunk.header->body_bytes, header, packet_bytes) != PACKET_OK)
+    {
+        bad_packets++;
+        return;
+    }
+    uint16_t bits = 0;
+    if (!decode(header, chunk.body + header.header_size, bits))
+    {
+        skipped_features++;
+        return;
+    }
+
+    const SegmentChunkHeader &info = *chunk.header;
+    const uint16_t channels = header.channels ? header.channels : 1;
+    WavOutput &wav = outputs[std::make_pair(info.node_ip, (info.flags & PACKET_FLAG_SPOOLED) != 0)];
+    const uint32_t missing = header.sequence - wav.next_sequence;
+    const int64_t jump_us = (int64_t)(header.timestamp - wav.next_timestamp);
+    const bool same_format = wav.sample_rate == header.sample_rate && wav.channels == channels && wav.bits == bits;
+    const size_t frame_bytes = (size_t)channels * bits / 8;
+    const uint64_t fill_bytes = missing < EXPORT_MAX_FILL_PACKETS ? (uint64_t)missing * header.sample_count * frame_bytes : 0;
+    if (wav.file && (!same_format || jump_us > options.split_gap_us || jump_us < -options.split_gap_us ||
+                     missing >= EXPORT_MAX_FILL_PACKETS ||
+                     wav.data_bytes + fill_bytes + samples.size() > EXPORT_WAV_MAX_DATA))
+    {
+        finish(wav);
+    }
+    if (!wav.file)
+    {
+        if (!startFile(wav, info, bits))
+        {
+            return;
+        }
+    }
+    else if (fill_bytes)
+    {
+        static const uint8_t silence[4096] = {};
+        for (uint64_t left = fill_bytes; left > 0;)
+        {
+            const size_t part = left < sizeof(silence) ? (size_t)left : sizeof(silence);
+            fwrite(silence, 1, part, wav.file);
+            left -= part;
+        }
+        wav.data_bytes += fill_bytes;
+        wav.filled_packets += missing;
+    }
+    fwrite(samples.data(), 1, samples.size(), wav.file);
+    wav.data_bytes += samples.size();
+    wav.packets++;
+    wav.next_sequence = header.sequence + 1;
+    wav.next_timestamp = header.timestamp + (uint64_t)header.sample_count * 1000000 / header.sample_rate;
+}
+
+// === Commands ===
+static int exportFiles(const ExportOptions &options, std::vector<std::unique_ptr<SegmentReader>> &readers)
+{
+    if (mkdir(options.out_dir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        LOG_ERROR("Cannot create %s: %m", options.out_dir.c_str());
+        return 1;
+    }
+    WavExporter exporter(options);
+    uint64_t chunks = 0;
+    for (const std::unique_ptr<SegmentReader> &reader : readers)
+    {
+        SegmentChunk chunk;
+        for (uint64_t offset = reader->seek(options.node_ip, options.from_us);
+             offset < reader->endOfChunks() && reader->chunkAt(offset, chunk); offset = SegmentReader::nextOffset(chunk))
+        {
+            const SegmentChunkHeader &info = *chunk.header;
+            const int64_t time_us = segmentChunkTime(info);
+            if (info.kind != SEGMENT_CHUNK_PACKET || (options.node_ip && info.node_ip != options.node_ip) ||
+                time_us < options.from_us || time_us > options.to_us)
+            {
+                continue;
+            }
+            exporter.add(chunk);
+            chunks++;
+        }
+    }
+    exporter.finishAll();
+    LOG_INFO("Exported %llu packets into %llu WAV files (%llu non-audio packets skipped, %llu failed their CRC)",
+             (unsigned long long)chunks, (unsigned long long)exporter.filesWritten(),
+             (unsigned long long)exporter.skippedFeatures(), (unsigned long long)exporter.badPackets());
+    return 0;
+}
+
+static void listFile(const SegmentReader &reader)
+{
+    const SegmentFileHeader &header = reader.fileHeader();
+    printf("%s\n  writer %u, created %s UTC, %s\n  %llu packets from %s to %s UTC, %zu index entries\n",
+           reader.path().c_str(), header.writer, timeText(header.created_unix_us).c_str(),
+           reader.closedCleanly() ? "closed cleanly" : "not closed (index rebuilt)",
+           (unsigned long long)reader.packetChunks(), timeText(reader.firstUnixUs()).c_str(),
+           timeText(reader.lastUnixUs()).c_str(), reader.indexSize());
+    const SegmentIndexEntry *index = reader.index();
+    for (size_t i = 0; i < reader.indexSize();)
+    {
+        size_t end = i;
+        while (end < reader.indexSize() && index[end].node_ip == index[i].node_ip)
+        {
+            ++end;
+        }
+        printf("  node %-15s %6zu entries, %s to %s\n", ipText(index[i].node_ip).c_str(), end - i,
+               timeText(index[i].time_unix_us).c_str(), timeText(index[end - 1].time_unix_us).c_str());
+        i = end;
+    }
+}
+
+static bool repairFile(SegmentReader &reader)
+{
+    if (reader.closedCleanly())
+    {
+        return true;
+    }
+    const std::string path = reader.path();
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || time(nullptr) - info.st_mtime < REPAIR_MIN_AGE_S)
+    {
+        LOG_WARN("Skipping %s: changed in the last %d s, a writer may still have it open", path.c_str(),
+                 REPAIR_MIN_AGE_S);
+        return false;
+    }
+    const std::vector<SegmentIndexEntry> entries(reader.index(), reader.index() + reader.indexSize());
+    SegmentChunkHeader chunk = {};
+    chunk.magic = SEGMENT_CHUNK_MAGIC;
+    chunk.kind = SEGMENT_CHUNK_INDEX;
+    chunk.body_bytes = (uint32_t)(entries.size() * sizeof(SegmentIndexEntry));
+    chunk.arrival_unix_us = (int64_t)time(nullptr) * 1000000;
+    SegmentFooter footer = {};
+    footer.index_offset = reader.endOfChunks();
+    footer.packet_chunks = reader.packetChunks();
+    footer.first_unix_us = reader.firstUnixUs();
+    footer.last_unix_us = reader.lastUnixUs();
+    memcpy(footer.magic, SEGMENT_FOOTER_MAGIC, sizeof(footer.magic));
+    reader.close(); // Nothing may touch the mapping once the torn tail is cut off
+
+    const int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    bool ok = fd >= 0 && ftruncate(fd, (off_t)footer.index_offset) == 0 &&
+              pwrite(fd, &chunk, sizeof(chunk), (off_t)footer.index_offset) == (ssize_t)sizeof(chunk) &&
+              pwrite(fd, entries.data(), chunk.body_bytes, (off_t)(footer.index_offset + sizeof(chunk))) ==
+                  (ssize_t)chunk.body_bytes &&
+              pwrite(fd, &footer, sizeof(footer), (off_t)(footer.index_offset + sizeof(chunk) + chunk.body_bytes)) ==
+                  (ssize_t)sizeof(footer) &&
+              fdatasync(fd) == 0;
+    if (fd >= 0)
+    {
+        ok = ::close(fd) == 0 && ok;
+    }
+    if (!ok)
+    {
+        LOG_ERROR("Repairing %s failed: %m", path.c_str());
+        return false;
+    }
+    LOG_INFO("Repaired %s: %llu packets, %zu index entries", path.c_str(), (unsigned long long)footer.packet_chunks,
+             entries.size());
+    return reader.open(path);
+}
+
+int main(int argc, char **argv)
+{
+    ExportOptions options;
+    if (!parseArguments(argc, argv, options))
+    {
+        return 2;
+    }
+    wirePacketInit();
+
+    std::vector<std::unique_ptr<SegmentReader>> readers;
+    bool failed = false;
+    for (const std::string &path : options.files)
+    {
+        std::unique_ptr<SegmentReader> reader(new SegmentReader());
+        if (!reader->open(path) || (options.repair && !repairFile(*reader)))
+        {
+            failed = true;
+            continue;
+        }
+        readers.push_back(std::move(reader));
+    }
+    // Rolled segments of one writer continue each other: oldest first
+    std::stable_sort(readers.begin(), readers.end(),
+                     [](const std::unique_ptr<SegmentReader> &a, const std::unique_ptr<SegmentReader> &b) {
+                         return a->fileHeader().created_unix_us < b->fileHeader().created_unix_us;
+                     });
+
+    if (options.list)
+    {
+        for (const std::unique_ptr<SegmentReader> &reader : readers)
+        {
+            listFile(*reader);
+        }
+    }
+    else if (!options.repair)
+    {
+        failed = exportFiles(options, readers) != 0 || failed;
+    }
+    return failed ? 1 : 0;
+}
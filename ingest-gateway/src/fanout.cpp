@@ -0,0 +1,95 @@
+// src/fanout.cpp
+
+#include <unistd.h>
+#include <algorithm>
+
+#include "fanout.h"
+
+SubscriberQueue::SubscriberQueue(size_t max_messages, uint32_t node_filter, int owner_wake_fd)
+    : limit(max_messages), node(node_filter), wake_fd(owner_wake_fd)
+{
+}
+
+void SubscriberQueue::push(const FanoutMessage &message)
+{
+    bool was_empty;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        was_empty = queue.empty();
+        if (queue.size() >= limit)
+        {
+            queue.pop_front();
+            drops.fetch_add(1, std::memory_order_relaxed);
+        }
+        queue.push_back(message);
+    }
+    // One wake-up per empty-to-non-empty edge; the owner drains everything it finds
+    if (was_empty)
+    {
+        const uint64_t one = 1;
+        (void)!write(wake_fd, &one, sizeof(one));
+    }
+}
+
+bool SubscriberQueue::pop(FanoutMessage &message)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (queue.empty())
+    {
+        return false;
+    }
+    message = std::move(queue.front());
+    queue.pop_front();
+    return true;
+}
+
+void FanoutHub::add(const std::shared_ptr<SubscriberQueue> &subscriber)
+{
+    std::unique_lock<std::shared_mutex> guard(lock);
+    queues.push_back(subscriber);
+    count.store(queues.size(), std::memory_order_relaxed);
+}
+
+void FanoutHub::remove(const SubscriberQueue *subscriber)
+{
+    std::unique_lock<std::shared_mutex> guard(lock);
+    queues.erase(std::remove_if(queues.begin(), queues.end(),
+                                [subscriber](const std::shared_ptr<SubscriberQueue> &queue) { return queue.get() == subscriber; }),
+                 queues.end());
+    count.store(queues.size(), std::memory_order_relaxed);
+}
+
+void FanoutHub::publish(uint32_t node_ip, const uint8_t *data, size_t bytes)
+{
+    if (bytes == 0 || count.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+    FanoutMessage message;
+    std::shared_lock<std::shared_mutex> guard(lock);
+    for (const std::shared_ptr<SubscriberQueue> &queue : queues)
+    {
+        if (!queue->wants(node_ip))
+        {
+            continue;
+        }
+        if (!message)
+        {
+            message = std::make_shared<const std::vector<uint8_t>>(data, data + bytes);
+            messages.fetch_add(1, std::memory_order_relaxed);
+            bytes_total.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        queue->push(message);
+    }
+}
+
+uint64_t FanoutHub::messagesDropped() const
+{
+    std::shared_lock<std::shared_mutex> guard(lock);
+    uint64_t total = 0;
+    for (const std::shared_ptr<SubscriberQueue> &queue : queues)
+    {
+        total += queue->dropped();
+    }
+    return total;
+}
@@ -0,0 +1,140 @@
+// src/gateway_config.cpp
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gateway_config.h"
+#include "logging.h"
+
+static void printUsage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --bind ADDRESS          IPv4 address to listen on (default 0.0.0.0)\n"
+            "  --port N                WebSocket / HTTP port (default %d)\n"
+            "  --udp-port N            UDP / RTP port, 0 to disable (default %d)\n"
+            "  --threads N             Workers, 0 for one per CPU (default 0)\n"
+            "  --no-pin                Do not pin workers to CPUs\n"
+            "  --data-dir DIR          Segment file directory (default ingest-data)\n"
+            "  --no-record             Fan out only, write no segment files\n"
+            "  --segment-mb N          Roll segment files at this size (default %d)\n"
+            "  --conn-buffer-kb N      Receive ring per connection (default %d)\n"
+            "  --subscriber-queue N    Messages queued per subscriber (default %d)\n"
+            "  --sync-ms N             fdatasync period, 0 to disable (default %d)\n"
+            "  --idle-timeout-s N      Close silent nodes, 0 to disable (default %d)\n"
+            "  --stats-s N             Log totals every N seconds, 0 to disable (default %d)\n",
+            program, GATEWAY_DEFAULT_PORT, GATEWAY_DEFAULT_UDP_PORT, GATEWAY_DEFAULT_SEGMENT_MB,
+            GATEWAY_DEFAULT_CONN_BUFFER_KB, GATEWAY_DEFAULT_SUBSCRIBER_QUEUE, GATEWAY_DEFAULT_SYNC_MS,
+            GATEWAY_DEFAULT_IDLE_TIMEOUT_S, GATEWAY_DEFAULT_STATS_S);
+}
+
+static bool parseNumber(const char *option, const char *text, unsigned long long max, unsigned long long &value)
+{
+    char *end = nullptr;
+    errno = 0;
+    value = strtoull(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0' || text[0] == '-' || value > max)
+    {
+        LOG_ERROR("%s expects a number up to %llu, got '%s'", option, max, text);
+        return false;
+    }
+    return true;
+}
+
+bool parseArguments(int argc, char **argv, GatewayConfig &config)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *option = argv[i];
+        if (strcmp(option, "--help") == 0 || strcmp(option, "-h") == 0)
+        {
+            printUsage(argv[0]);
+            return false;
+        }
+        if (strcmp(option, "--no-pin") == 0)
+        {
+            config.pin_threads = false;
+            continue;
+        }
+        if (strcmp(option, "--no-record") == 0)
+        {
+            config.data_dir.clear();
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            LOG_ERROR("Unknown option or missing value: %s", option);
+            printUsage(argv[0]);
+            return false;
+        }
+        const char *value = argv[++i];
+        unsigned long long number = 0;
+        bool ok = true;
+        if (strcmp(option, "--bind") == 0)
+        {
+            config.bind_address = value;
+        }
+        else if (strcmp(option, "--data-dir") == 0)
+        {
+            config.data_dir = value;
+        }
+        else if (strcmp(option, "--port") == 0)
+        {
+            ok = parseNumber(option, value, 65535, number) && number > 0;
+            config.port = (uint16_t)number;
+        }
+        else if (strcmp(option, "--udp-port") == 0)
+        {
+            ok = parseNumber(option, value, 65535, number);
+            config.udp_port = (uint16_t)number;
+        }
+        else if (strcmp(option, "--threads") == 0)
+        {
+            ok = parseNumber(option, value, 1024, number);
+            config.threads = (unsigned)number;
+        }
+        else if (strcmp(option, "--segment-mb") == 0)
+        {
+            ok = parseNumber(option, value, 1 << 20, number) && number > 0;
+            config.segment_bytes = number << 20;
+        }
+        else if (strcmp(option, "--conn-buffer-kb") == 0)
+        {
+            ok = parseNumber(option, value, 1 << 20, number) && number >= 16;
+            config.connection_buffer = (size_t)number << 10;
+        }
+        else if (strcmp(option, "--subscriber-queue") == 0)
+        {
+            ok = parseNumber(option, value, 1 << 24, number) && number > 0;
+            config.subscriber_queue = (size_t)number;
+        }
+        else if (strcmp(option, "--sync-ms") == 0)
+        {
+            ok = parseNumber(option, value, 3600000, number);
+            config.sync_ms = (unsigned)number;
+        }
+        else if (strcmp(option, "--idle-timeout-s") == 0)
+        {
+            ok = parseNumber(option, value, 86400, number);
+            config.idle_timeout_s = (unsigned)number;
+        }
+        else if (strcmp(option, "--stats-s") == 0)
+        {
+            ok = parseNumber(option, value, 86400, number);
+            config.stats_interval_s = (unsigned)number;
+        }
+        else
+        {
+            LOG_ERROR("Unknown option: %s", option);
+            printUsage(argv[0]);
+            return false;
+        }
+        if (!ok)
+        {
+            LOG_ERROR("Invalid value for %s: %s", option, value);
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,185 @@
+// src/gateway_stats.cpp
+
+#include <stdio.h>
+
+#include "gateway_clock.h"
+#include "gateway_stats.h"
+#include "logging.h"
+
+void UdpPeerTable::publish(uint32_t node_ip, const UdpPeerReport &report)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    peers[node_ip] = report;
+}
+
+bool UdpPeerTable::lookup(uint32_t node_ip, UdpPeerReport &report) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto entry = peers.find(node_ip);
+    if (entry == peers.end())
+    {
+        return false;
+    }
+    report = entry->second;
+    return true;
+}
+
+// === Totals ===
+namespace
+{
+struct Totals
+{
+    uint64_t nodes = 0;
+    uint64_t subscribers = 0;
+    uint64_t packets[3] = {};
+    uint64_t packet_bytes = 0;
+    uint64_t rejected[PACKET_CHECK_COUNT] = {};
+    uint64_t protocol_errors = 0;
+    uint64_t udp_lost = 0;
+    uint64_t udp_reordered = 0;
+    uint64_t latency_us_sum = 0;
+    uint64_t latency_count = 0;
+    uint64_t segment_records = 0;
+    uint64_t segment_bytes = 0;
+    uint64_t segment_files = 0;
+    uint64_t segment_dropped = 0;
+    uint64_t segment_errors = 0;
+    uint64_t subscriber_dropped = 0;
+
+    uint64_t allPackets() const { return packets[0] + packets[1] + packets[2]; }
+    uint64_t allRejected() const
+    {
+        uint64_t total = 0;
+        for (uint64_t count : rejected)
+        {
+            total += count;
+        }
+        return total;
+    }
+};
+} // namespace
+
+static Totals sumWorkers(const GatewayShared &shared)
+{
+    Totals totals;
+    for (const std::unique_ptr<WorkerStats> &worker : shared.stats)
+    {
+        totals.nodes += worker->nodes.get();
+        totals.subscribers += worker->subscribers.get();
+        for (int i = 0; i < 3; ++i)
+        {
+            totals.packets[i] += worker->packets[i].get();
+        }
+        totals.packet_bytes += worker->packet_bytes.get();
+        for (int i = 0; i < PACKET_CHECK_COUNT; ++i)
+        {
+            totals.rejected[i] += worker->rejected[i].get();
+        }
+        totals.protocol_errors += worker->protocol_errors.get();
+        totals.udp_lost += worker->udp_lost.get();
+        totals.udp_reordered += worker->udp_reordered.get();
+        totals.latency_us_sum += worker->latency_us_sum.get();
+        totals.latency_count += worker->latency_count.get();
+        totals.segment_records += worker->segment_records.get();
+        totals.segment_bytes += worker->segment_bytes.get();
+        totals.segment_files += worker->segment_files.get();
+        totals.segment_dropped += worker->segment_dropped.get();
+        totals.segment_errors += worker->segment_errors.get();
+        totals.subscriber_dropped += worker->subscriber_dropped.get();
+    }
+    totals.subscriber_dropped += shared.fanout.messagesDropped();
+    return totals;
+}
+
+// === Prometheus ===
+static void appendMetric(std::string &out, const char *name, const char *type, const char *help, uint64_t value)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %llu\n", name, help, name, type, name,
+             (unsigned long long)value);
+    out += line;
+}
+
+std::string renderMetrics(const GatewayShared &shared)
+{
+    static const char *const transport_names[3] = {"ws", "udp", "rtp"};
+    const Totals totals = sumWorkers(shared);
+    std::string out;
+    out.reserve(4096);
+    char line[256];
+
+    appendMetric(out, "chirp_ingest_nodes", "gauge", "Node WebSocket connections open.", totals.nodes);
+    appendMetric(out, "chirp_ingest_subscribers", "gauge", "Fan-out subscribers connected.", totals.subscribers);
+
+    out += "# HELP chirp_ingest_packets_total Valid packets received.\n# TYPE chirp_ingest_packets_total counter\n";
+    for (int i = 0; i < 3; ++i)
+    {
+        snprintf(line, sizeof(line), "chirp_ingest_packets_total{transport=\"%s\"} %llu\n", transport_names[i],
+                 (unsigned long long)totals.packets[i]);
+        out += line;
+    }
+    appendMetric(out, "chirp_ingest_packet_bytes_total", "counter", "Wire bytes of valid packets.",
+                 totals.packet_bytes);
+
+    out += "# HELP chirp_ingest_rejected_total Invalid packets dropped.\n# TYPE chirp_ingest_rejected_total counter\n";
+    for (int i = PACKET_TRUNCATED; i < PACKET_CHECK_COUNT; ++i)
+    {
+        snprintf(line, sizeof(line), "chirp_ingest_rejected_total{reason=\"%s\"} %llu\n", packetCheckName(i),
+                 (unsigned long long)totals.rejected[i]);
+        out += line;
+    }
+    appendMetric(out, "chirp_ingest_protocol_errors_total", "counter",
+                 "Connections closed for bad HTTP or WebSocket framing.", totals.protocol_errors);
+    appendMetric(out, "chirp_ingest_udp_lost", "gauge", "UDP packets missing from a node's sequence, net of late arrivals.",
+                 totals.udp_lost);
+    appendMetric(out, "chirp_ingest_udp_reordered_total", "counter", "UDP packets that arrived out of order.",
+                 totals.udp_reordered);
+    appendMetric(out, "chirp_ingest_latency_us_sum", "counter", "Capture-to-arrival latency of live synced packets.",
+                 totals.latency_us_sum);
+    appendMetric(out, "chirp_ingest_latency_us_count", "counter", "Packets in chirp_ingest_latency_us_sum.",
+                 totals.latency_count);
+    appendMetric(out, "chirp_ingest_segment_records_total", "counter", "Packets written to segment files.",
+                 totals.segment_records);
+    appendMetric(out, "chirp_ingest_segment_bytes_total", "counter", "Bytes written to segment files.",
+                 totals.segment_bytes);
+    appendMetric(out, "chirp_ingest_segment_files_total", "counter", "Segment files opened.", totals.segment_files);
+    appendMetric(out, "chirp_ingest_segment_write_errors_total", "counter", "Failed segment writes.",
+                 totals.segment_errors);
+    appendMetric(out, "chirp_ingest_segment_dropped_total", "counter", "Packets not recorded after a write error.",
+                 totals.segment_dropped);
+    appendMetric(out, "chirp_ingest_fanout_messages_total", "counter", "Messages queued for subscribers.",
+                 shared.fanout.messagesPublished());
+    appendMetric(out, "chirp_ingest_fanout_bytes_total", "counter", "Bytes queued for subscribers.",
+                 shared.fanout.bytesPublished());
+    appendMetric(out, "chirp_ingest_fanout_dropped_total", "counter", "Messages dropped by full subscriber queues.",
+                 totals.subscriber_dropped);
+    appendMetric(out, "chirp_ingest_uptime_seconds", "gauge", "Seconds since the gateway started.",
+                 (uint64_t)((unixTimeUs() - shared.start_unix_us) / 1000000));
+    return out;
+}
+
+// === Periodic Log ===
+void logStats(const GatewayShared &shared)
+{
+    static Totals previous;
+    static uint64_t previous_ms = 0;
+    const Totals totals = sumWorkers(shared);
+    const uint64_t now_ms = monotonicMs();
+    const double seconds = previous_ms ? (now_ms - previous_ms) / 1000.0 : 0.0;
+    const uint64_t packets = totals.allPackets();
+    const double packet_rate = seconds > 0 ? (packets - previous.allPackets()) / seconds : 0.0;
+    const double byte_rate = seconds > 0 ? (totals.packet_bytes - previous.packet_bytes) / seconds : 0.0;
+    const uint64_t latency_count = totals.latency_count - previous.latency_count;
+    const double latency_ms =
+        latency_count ? (totals.latency_us_sum - previous.latency_us_sum) / 1000.0 / latency_count : 0.0;
+
+    LOG_INFO("Nodes %llu, subscribers %llu | %llu packets (%.0f/s, %.1f KB/s), %llu rejected, %llu UDP lost | "
+             "latency %.1f ms | %llu records in %llu segments, %llu write errors | %llu fan-out drops",
+             (unsigned long long)totals.nodes, (unsigned long long)totals.subscribers, (unsigned long long)packets,
+             packet_rate, byte_rate / 1024.0, (unsigned long long)totals.allRejected(),
+             (unsigned long long)totals.udp_lost, latency_ms, (unsigned long long)totals.segment_records,
+             (unsigned long long)totals.segment_files, (unsigned long long)totals.segment_errors,
+             (unsigned long long)totals.subscriber_dropped);
+    previous = totals;
+    previous_ms = now_ms;
+}
@@ -0,0 +1,16 @@
+// src/logging.cpp
+
+#include <sys/time.h>
+#include <time.h>
+
+#include "logging.h"
+
+void logTimestamp(char *out, size_t size)
+{
+    timeval now;
+    gettimeofday(&now, nullptr);
+    tm local;
+    localtime_r(&now.tv_sec, &local);
+    const size_t used = strftime(out, size, "%Y-%m-%d %H:%M:%S", &local);
+    snprintf(out + used, size - used, ".%03ld", (long)(now.tv_usec / 1000));
+}
@@ -0,0 +1,93 @@
+// src/main.cpp
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <memory>
+#include <vector>
+
+#include "gateway_clock.h"
+#include "gateway_config.h"
+#include "gateway_stats.h"
+#include "logging.h"
+#include "wire_packet.h"
+#include "worker.h"
+
+int main(int argc, char **argv)
+{
+    GatewayConfig config;
+    if (!parseArguments(argc, argv, config))
+    {
+        return 2;
+    }
+
+    // === Signals ===
+    // Workers inherit this mask, so SIGINT / SIGTERM only ever reach the
+    // sigtimedwait() below; peers that vanish mid-send must not kill us.
+    signal(SIGPIPE, SIG_IGN);
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+
+    wirePacketInit(); // CRC table before any worker thread can race to build it
+
+    if (config.threads == 0)
+    {
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        config.threads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    GatewayShared shared(config);
+    shared.start_unix_us = unixTimeUs();
+    for (unsigned i = 0; i < config.threads; ++i)
+    {
+        shared.stats.emplace_back(new WorkerStats());
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned i = 0; i < config.threads; ++i)
+    {
+        workers.emplace_back(new Worker(i, shared));
+        if (!workers.back()->begin())
+        {
+            return 1;
+        }
+    }
+    for (std::unique_ptr<Worker> &worker : workers)
+    {
+        worker->start();
+    }
+    LOG_INFO("Ingest gateway on %s: WebSocket %u, UDP %s, %u workers%s, %s", config.bind_address.c_str(),
+             config.port, config.udp_port ? std::to_string(config.udp_port).c_str() : "off", config.threads,
+             config.pin_threads ? " (pinned)" : "",
+             config.data_dir.empty() ? "not recording" : ("recording to " + config.data_dir).c_str());
+
+    // === Main Loop ===
+    timespec interval = {};
+    interval.tv_sec = config.stats_interval_s ? config.stats_interval_s : 3600;
+    while (true)
+    {
+        const int signal_number = sigtimedwait(&stop_signals, nullptr, &interval);
+        if (signal_number == SIGINT || signal_number == SIGTERM)
+        {
+            LOG_INFO("Signal %d, shutting down", signal_number);
+            break;
+        }
+        if (config.stats_interval_s)
+        {
+            logStats(shared);
+        }
+    }
+
+    for (std::unique_ptr<Worker> &worker : workers)
+    {
+        worker->stop();
+    }
+    for (std::unique_ptr<Worker> &worker : workers)
+    {
+        worker->join();
+    }
+    logStats(shared);
+    return 0;
+}
@@ -0,0 +1,66 @@
+// src/mirror_ring.cpp
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "mirror_ring.h"
+#include "logging.h"
+
+MirrorRing::~MirrorRing()
+{
+    if (base)
+    {
+        munmap(base, 2 * ring_capacity);
+    }
+}
+
+bool MirrorRing::begin(size_t capacity)
+{
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    capacity = (capacity + page - 1) / page * page;
+
+    const int fd = memfd_create("chirp-ring", MFD_CLOEXEC);
+    if (fd < 0)
+    {
+        LOG_ERROR("memfd_create failed: %m");
+        return false;
+    }
+    if (ftruncate(fd, (off_t)capacity) != 0)
+    {
+        LOG_ERROR("Ring of %zu bytes: ftruncate failed: %m", capacity);
+        close(fd);
+        return false;
+    }
+
+    // Reserve both halves first so nothing else can land in the second one
+    void *area = mmap(nullptr, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED)
+    {
+        LOG_ERROR("Ring of %zu bytes: address reservation failed: %m", capacity);
+        close(fd);
+        return false;
+    }
+    uint8_t *first = (uint8_t *)area;
+    const bool mapped =
+        mmap(first, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+        mmap(first + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+    close(fd); // The mappings keep the pages
+    if (!mapped)
+    {
+        LOG_ERROR("Ring of %zu bytes: mirror mapping failed: %m", capacity);
+        munmap(area, 2 * capacity);
+        return false;
+    }
+
+    base = first;
+    ring_capacity = capacity;
+    read_pos = 0;
+    count = 0;
+    return true;
+}
+
+void MirrorRing::consume(size_t bytes)
+{
+    count -= bytes;
+    read_pos = count == 0 ? 0 : (read_pos + bytes) % ring_capacity;
+}
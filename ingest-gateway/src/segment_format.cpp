@@ -0,0 +1,45 @@
+// src/segment_format.cpp
+
+#include <algorithm>
+
+#include "segment_format.h"
+
+void SegmentIndexBuilder::clear()
+{
+    index.clear();
+    nodes.clear();
+    chunks = 0;
+    first_us = 0;
+    last_us = 0;
+}
+
+void SegmentIndexBuilder::add(const SegmentChunkHeader &chunk, uint64_t offset)
+{
+    const int64_t time_us = segmentChunkTime(chunk);
+    if (chunks++ == 0 || time_us < first_us)
+    {
+        first_us = time_us;
+    }
+    if (time_us > last_us)
+    {
+        last_us = time_us;
+    }
+
+    auto mark = nodes.find(chunk.node_ip);
+    const bool first = mark == nodes.end();
+    if (first || chunk.sequence != mark->second.next_sequence ||
+        time_us - mark->second.indexed_us >= SEGMENT_INDEX_INTERVAL_US || time_us < mark->second.indexed_us)
+    {
+        index.push_back({time_us, offset, chunk.node_ip, chunk.sequence});
+        nodes[chunk.node_ip] = {time_us, chunk.sequence + 1};
+        return;
+    }
+    mark->second.next_sequence = chunk.sequence + 1;
+}
+
+void SegmentIndexBuilder::finish()
+{
+    std::stable_sort(index.begin(), index.end(), [](const SegmentIndexEntry &a, const SegmentIndexEntry &b) {
+        return a.node_ip != b.node_ip ? a.node_ip < b.node_ip : a.time_unix_us < b.time_unix_us;
+    });
+}
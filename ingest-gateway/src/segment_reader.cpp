@@ -0,0 +1,176 @@
+// src/segment_reader.cpp
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "segment_reader.h"
+#include "logging.h"
+
+SegmentReader::~SegmentReader()
+{
+    close();
+}
+
+void SegmentReader::close()
+{
+    if (map)
+    {
+        munmap((void *)map, map_bytes);
+    }
+    map = nullptr;
+    map_bytes = 0;
+    footer = nullptr;
+    index_entries = nullptr;
+    index_size = 0;
+    packet_chunks = 0;
+    first_us = 0;
+    last_us = 0;
+    chunks_end = 0;
+    rebuilt.clear();
+}
+
+bool SegmentReader::open(const std::string &path)
+{
+    close();
+    file_path = path;
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LOG_ERROR("Cannot open %s: %m", path.c_str());
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SegmentFileHeader))
+    {
+        LOG_ERROR("%s is not a segment file (too short)", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        LOG_ERROR("Cannot map %s: %m", path.c_str());
+        return false;
+    }
+    map = (const uint8_t *)mapping;
+    map_bytes = (size_t)info.st_size;
+
+    const SegmentFileHeader &header = fileHeader();
+    if (memcmp(header.magic, SEGMENT_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != SEGMENT_FORMAT_VERSION)
+    {
+        LOG_ERROR("%s is not a version %d segment file", path.c_str(), SEGMENT_FORMAT_VERSION);
+        close();
+        return false;
+    }
+    // Whole-file streaming is the common case; index lookups only touch a few pages
+    madvise(mapping, map_bytes, MADV_SEQUENTIAL);
+    if (!loadFooter())
+    {
+        rebuildIndex();
+    }
+    return true;
+}
+
+bool SegmentReader::chunkAt(uint64_t offset, SegmentChunk &chunk) const
+{
+    if (offset % SEGMENT_ALIGN != 0 || offset < firstChunk() || offset + sizeof(SegmentChunkHeader) > map_bytes)
+    {
+        return false;
+    }
+    const SegmentChunkHeader *header = (const SegmentChunkHeader *)(map + offset);
+    if (header->magic != SEGMENT_CHUNK_MAGIC ||
+        offset + sizeof(SegmentChunkHeader) + header->body_bytes > map_bytes)
+    {
+        return false;
+    }
+    chunk.offset = offset;
+    chunk.header = header;
+    chunk.body = map + offset + sizeof(SegmentChunkHeader);
+    return true;
+}
+
+bool SegmentReader::loadFooter()
+{
+    if (map_bytes < sizeof(SegmentFileHeader) + sizeof(SegmentFooter))
+    {
+        return false;
+    }
+    const SegmentFooter *candidate = (const SegmentFooter *)(map + map_bytes - sizeof(SegmentFooter));
+    SegmentChunk index_chunk;
+    if (memcmp(candidate->magic, SEGMENT_FOOTER_MAGIC, sizeof(candidate->magic)) != 0 ||
+        !chunkAt(candidate->index_offset, index_chunk) || index_chunk.header->kind != SEGMENT_CHUNK_INDEX ||
+        index_chunk.header->body_bytes % sizeof(SegmentIndexEntry) != 0 ||
+        nextOffset(index_chunk) != map_bytes - sizeof(SegmentFooter))
+    {
+        return false;
+    }
+    footer = candidate;
+    index_entries = (const SegmentIndexEntry *)index_chunk.body;
+    index_size = index_chunk.header->body_bytes / sizeof(SegmentIndexEntry);
+    packet_chunks = footer->packet_chunks;
+    first_us = footer->first_unix_us;
+    last_us = footer->last_unix_us;
+    chunks_end = footer->index_offset;
+    return true;
+}
+
+void SegmentReader::rebuildIndex()
+{
+    rebuilt.clear();
+    uint64_t offset = firstChunk();
+    SegmentChunk chunk;
+    while (chunkAt(offset, chunk))
+    {
+        if (chunk.header->kind == SEGMENT_CHUNK_PACKET)
+        {
+            rebuilt.add(*chunk.header, offset);
+        }
+        offset = nextOffset(chunk);
+    }
+    rebuilt.finish();
+    index_entries = rebuilt.entries().data();
+    index_size = rebuilt.entries().size();
+    packet_chunks = rebuilt.packetChunks();
+    first_us = rebuilt.firstUnixUs();
+    last_us = rebuilt.lastUnixUs();
+    chunks_end = std::min<uint64_t>(offset, map_bytes);
+    if (chunks_end < map_bytes)
+    {
+        LOG_WARN("%s: %llu bytes after the last intact chunk ignored", file_path.c_str(),
+                 (unsigned long long)(map_bytes - chunks_end));
+    }
+}
+
+uint64_t SegmentReader::seek(uint32_t node_ip, int64_t time_unix_us) const
+{
+    // Between two of a node's entries its chunks stay within one index interval
+    // of the earlier entry (SegmentIndexBuilder), so the first chunk at or after
+    // the time is never before the earliest entry later than time - interval.
+    const int64_t after_us =
+        time_unix_us < INT64_MIN + SEGMENT_INDEX_INTERVAL_US ? INT64_MIN : time_unix_us - SEGMENT_INDEX_INTERVAL_US;
+    const SegmentIndexEntry *end = index_entries + index_size;
+    uint64_t best = UINT64_MAX;
+    // Each node's entries are one run, sorted by time
+    for (const SegmentIndexEntry *run = index_entries; run < end;)
+    {
+        const uint32_t node = run->node_ip;
+        const SegmentIndexEntry *run_end =
+            std::partition_point(run, end, [node](const SegmentIndexEntry &entry) { return entry.node_ip <= node; });
+        if (node_ip == 0 || node == node_ip)
+        {
+            const SegmentIndexEntry *late = std::partition_point(
+                run, run_end, [after_us](const SegmentIndexEntry &entry) { return entry.time_unix_us <= after_us; });
+            for (; late < run_end; ++late)
+            {
+                best = std::min<uint64_t>(best, late->offset);
+            }
+        }
+        run = run_end;
+    }
+    return best == UINT64_MAX ? endOfChunks() : best;
+}
@@ -0,0 +1,232 @@
+// src/segment_writer.cpp
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "segment_writer.h"
+#include "gateway_clock.h"
+#include "logging.h"
+
+static const uint8_t zero_pad[SEGMENT_ALIGN] = {};
+
+SegmentWriter::~SegmentWriter()
+{
+    close();
+}
+
+bool SegmentWriter::begin(const std::string &directory, unsigned worker, uint64_t segment_bytes)
+{
+    dir = directory;
+    worker_id = worker;
+    max_bytes = segment_bytes;
+    if (dir.empty())
+    {
+        return true;
+    }
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        LOG_ERROR("Cannot create segment directory %s: %m", dir.c_str());
+        return false;
+    }
+    return openSegment(unixTimeUs());
+}
+
+bool SegmentWriter::openSegment(int64_t now_us)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/w%02u-%lld.seg", dir.c_str(), worker_id, (long long)now_us);
+    fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        LOG_ERROR("Cannot create segment %s: %m", path);
+        counters.write_errors++;
+        reopen_after_us = now_us + SEGMENT_REOPEN_US;
+        return false;
+    }
+    SegmentFileHeader header = {};
+    memcpy(header.magic, SEGMENT_FILE_MAGIC, sizeof(header.magic));
+    header.version = SEGMENT_FORMAT_VERSION;
+    header.writer = (uint16_t)worker_id;
+    header.index_interval_ms = SEGMENT_INDEX_INTERVAL_US / 1000;
+    header.created_unix_us = now_us;
+    iovec header_iov = {&header, sizeof(header)};
+    if (!writeAll(&header_iov, 1))
+    {
+        reopen_after_us = now_us + SEGMENT_REOPEN_US;
+        return false;
+    }
+    segment_size = sizeof(header);
+    index.clear();
+    counters.segments++;
+    LOG_INFO("Worker %u recording to %s", worker_id, path);
+    return true;
+}
+
+// Index and footer, so readers find their way around without a scan
+void SegmentWriter::closeSegment()
+{
+    flush();
+    if (fd < 0)
+    {
+        return;
+    }
+    index.finish();
+    const std::vector<SegmentIndexEntry> &entries = index.entries();
+    SegmentChunkHeader chunk = {};
+    chunk.magic = SEGMENT_CHUNK_MAGIC;
+    chunk.kind = SEGMENT_CHUNK_INDEX;
+    chunk.body_bytes = (uint32_t)(entries.size() * sizeof(SegmentIndexEntry));
+    chunk.arrival_unix_us = unixTimeUs();
+    SegmentFooter footer = {};
+    footer.index_offset = segment_size;
+    footer.packet_chunks = index.packetChunks();
+    footer.first_unix_us = index.firstUnixUs();
+    footer.last_unix_us = index.lastUnixUs();
+    memcpy(footer.magic, SEGMENT_FOOTER_MAGIC, sizeof(footer.magic));
+    // Entries are 24 bytes after a 56-byte header: already 8-byte aligned
+    iovec tail[3] = {{&chunk, sizeof(chunk)},
+                     {(void *)entries.data(), chunk.body_bytes},
+                     {&footer, sizeof(footer)}};
+    if (writeAll(tail, 3))
+    {
+        counters.bytes += sizeof(chunk) + chunk.body_bytes + sizeof(footer);
+        fdatasync(fd);
+        ::close(fd);
+        fd = -1;
+    }
+    dirty = false;
+    index.clear();
+}
+
+void SegmentWriter::add(const uint8_t *packet, size_t packet_bytes, const AudioPacketHeader &header, uint32_t node_ip,
+                        uint16_t node_port, uint8_t transport, int64_t arrival_unix_us)
+{
+    if (dir.empty())
+    {
+        return;
+    }
+    const size_t pad = segmentPad(packet_bytes);
+    const uint64_t chunk_bytes = sizeof(SegmentChunkHeader) + packet_bytes + pad;
+    // Roll between records, never inside one, so chunk offsets are known here
+    if (fd >= 0 && index.packetChunks() > 0 && segment_size + queued_bytes + chunk_bytes > max_bytes)
+    {
+        closeSegment();
+    }
+    if (record_count == SEGMENT_MAX_RECORDS)
+    {
+        flush();
+    }
+    if (fd < 0 && (arrival_unix_us < reopen_after_us || !openSegment(arrival_unix_us)))
+    {
+        counters.dropped++;
+        return;
+    }
+
+    SegmentChunkHeader &chunk = headers[record_count++];
+    chunk = {};
+    chunk.magic = SEGMENT_CHUNK_MAGIC;
+    chunk.kind = SEGMENT_CHUNK_PACKET;
+    chunk.transport = transport;
+    chunk.codec = header.codec;
+    chunk.flags = header.flags;
+    chunk.body_bytes = (uint32_t)packet_bytes;
+    chunk.sequence = header.sequence;
+    chunk.node_ip = node_ip;
+    chunk.node_port = node_port;
+    chunk.sample_count = header.sample_count;
+    chunk.sample_rate = header.sample_rate;
+    chunk.channels = header.channels;
+    chunk.timestamp = header.timestamp;
+    chunk.wall_clock_us = header.wall_clock_us;
+    chunk.arrival_unix_us = arrival_unix_us;
+    index.add(chunk, segment_size + queued_bytes);
+
+    iov[iov_count++] = {&chunk, sizeof(chunk)};
+    iov[iov_count++] = {(void *)packet, packet_bytes};
+    if (pad)
+    {
+        iov[iov_count++] = {(void *)zero_pad, pad};
+    }
+    queued_bytes += chunk_bytes;
+}
+
+void SegmentWriter::dropQueued()
+{
+    record_count = 0;
+    iov_count = 0;
+    queued_bytes = 0;
+}
+
+void SegmentWriter::flush()
+{
+    if (record_count == 0)
+    {
+        return;
+    }
+    if (writeAll(iov, iov_count))
+    {
+        segment_size += queued_bytes;
+        counters.records += record_count;
+        counters.bytes += queued_bytes;
+        dirty = true;
+    }
+    else
+    {
+        // The segment is closed without an index (readers rebuild it); the next record starts a new one
+        counters.dropped += record_count;
+        index.clear();
+        reopen_after_us = unixTimeUs() + SEGMENT_REOPEN_US;
+    }
+    dropQueued();
+}
+
+bool SegmentWriter::writeAll(iovec *vec, int count)
+{
+    while (count > 0)
+    {
+        const ssize_t written = writev(fd, vec, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            LOG_ERROR("Worker %u segment write failed: %m; closing the segment", worker_id);
+            counters.write_errors++;
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        // Short writes (disk nearly full, signals) resume mid-iovec
+        size_t left = (size_t)written;
+        while (count > 0 && left >= vec->iov_len)
+        {
+            left -= vec->iov_len;
+            ++vec;
+            --count;
+        }
+        if (count > 0)
+        {
+            vec->iov_base = (uint8_t *)vec->iov_base + left;
+            vec->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+void SegmentWriter::sync()
+{
+    if (fd >= 0 && dirty)
+    {
+        fdatasync(fd);
+        dirty = false;
+    }
+}
+
+void SegmentWriter::close()
+{
+    closeSegment();
+}
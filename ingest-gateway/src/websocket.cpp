@@ -0,0 +1,286 @@
+// src/websocket.cpp
+
+#include <string.h>
+#include <strings.h>
+
+#include "websocket.h"
+
+// === SHA-1 / BASE64 ===
+// Only for Sec-WebSocket-Accept, once per connection
+static uint32_t rotl(uint32_t value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static void sha1(const uint8_t *data, size_t length, uint8_t digest[20])
+{
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    const size_t padded = (length + 9 + 63) / 64 * 64;
+    for (size_t block = 0; block < padded; block += 64)
+    {
+        uint8_t chunk[64];
+        for (size_t i = 0; i < 64; ++i)
+        {
+            const size_t at = block + i;
+            if (at < length)
+            {
+                chunk[i] = data[at];
+            }
+            else if (at == length)
+            {
+                chunk[i] = 0x80;
+            }
+            else if (at >= padded - 8)
+            {
+                chunk[i] = (uint8_t)(((uint64_t)length * 8) >> (8 * (padded - 1 - at)));
+            }
+            else
+            {
+                chunk[i] = 0;
+            }
+        }
+
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i)
+        {
+            w[i] = (uint32_t)chunk[4 * i] << 24 | (uint32_t)chunk[4 * i + 1] << 16 | (uint32_t)chunk[4 * i + 2] << 8 | chunk[4 * i + 3];
+        }
+        for (int i = 16; i < 80; ++i)
+        {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i)
+        {
+            uint32_t f, k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            const uint32_t next = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = next;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    for (int i = 0; i < 20; ++i)
+    {
+        digest[i] = (uint8_t)(h[i / 4] >> (24 - 8 * (i % 4)));
+    }
+}
+
+static std::string base64(const uint8_t *data, size_t length)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < length; i += 3)
+    {
+        const uint32_t n = (uint32_t)data[i] << 16 | (i + 1 < length ? (uint32_t)data[i + 1] << 8 : 0) |
+                           (i + 2 < length ? data[i + 2] : 0);
+        out += alphabet[n >> 18];
+        out += alphabet[(n >> 12) & 63];
+        out += i + 1 < length ? alphabet[(n >> 6) & 63] : '=';
+        out += i + 2 < length ? alphabet[n & 63] : '=';
+    }
+    return out;
+}
+
+// === HANDSHAKE ===
+static std::string trim(const char *begin, const char *end)
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t'))
+    {
+        ++begin;
+    }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t'))
+    {
+        --end;
+    }
+    return std::string(begin, end);
+}
+
+long parseHttpRequest(const uint8_t *data, size_t length, HttpRequest &request)
+{
+    const char *text = (const char *)data;
+    const char *head_end = (const char *)memmem(text, length, "\r\n\r\n", 4);
+    if (!head_end)
+    {
+        return length >= HTTP_HEAD_MAX_BYTES ? -1 : 0;
+    }
+
+    // Request line: METHOD SP target SP version
+    const char *line_end = (const char *)memmem(text, head_end + 2 - text, "\r\n", 2);
+    const char *space = (const char *)memchr(text, ' ', line_end - text);
+    const char *target_end = space ? (const char *)memchr(space + 1, ' ', line_end - space - 1) : nullptr;
+    if (!space || !target_end)
+    {
+        return -1;
+    }
+    request.method.assign(text, space);
+    const std::string target(space + 1, target_end);
+    const size_t query = target.find('?');
+    request.path = target.substr(0, query);
+    request.query = query == std::string::npos ? "" : target.substr(query + 1);
+
+    for (const char *line = line_end + 2; line < head_end;)
+    {
+        const char *next = (const char *)memmem(line, head_end + 2 - line, "\r\n", 2);
+        const char *colon = (const char *)memchr(line, ':', next - line);
+        if (colon)
+        {
+            const std::string name = trim(line, colon);
+            const std::string value = trim(colon + 1, next);
+            if (strcasecmp(name.c_str(), "Sec-WebSocket-Key") == 0)
+            {
+                request.websocket_key = value;
+            }
+            else if (strcasecmp(name.c_str(), "Upgrade") == 0)
+            {
+                request.upgrade = strcasecmp(value.c_str(), "websocket") == 0;
+            }
+        }
+        line = next + 2;
+    }
+    return head_end + 4 - text;
+}
+
+std::string handshakeResponse(const std::string &key)
+{
+    const std::string accept_input = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    uint8_t digest[20];
+    sha1((const uint8_t *)accept_input.data(), accept_input.size(), digest);
+    return "HTTP/1.1 101 Switching Protocols\r\n"
+           "Upgrade: websocket\r\n"
+           "Connection: Upgrade\r\n"
+           "Sec-WebSocket-Accept: " +
+           base64(digest, sizeof(digest)) + "\r\n\r\n";
+}
+
+// === FRAMES ===
+int parseFrameHeader(const uint8_t *data, size_t length, WsFrame &frame)
+{
+    if (length < 2)
+    {
+        return 0;
+    }
+    frame.fin = data[0] & 0x80;
+    frame.opcode = data[0] & 0x0F;
+    frame.masked = data[1] & 0x80;
+    if (data[0] & 0x70)
+    {
+        return -1; // No extensions were negotiated
+    }
+
+    size_t at = 2;
+    uint64_t payload = data[1] & 0x7F;
+    if (payload == 126)
+    {
+        if (length < 4)
+        {
+            return 0;
+        }
+        payload = (uint64_t)data[2] << 8 | data[3];
+        at = 4;
+    }
+    else if (payload == 127)
+    {
+        if (length < 10)
+        {
+            return 0;
+        }
+        payload = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            payload = payload << 8 | data[2 + i];
+        }
+        at = 10;
+    }
+    if (frame.masked)
+    {
+        if (length < at + 4)
+        {
+            return 0;
+        }
+        memcpy(frame.mask, data + at, 4);
+        at += 4;
+    }
+    // Control frames are short and never fragmented
+    if ((frame.opcode & 0x08) && (payload > 125 || !frame.fin))
+    {
+        return -1;
+    }
+    frame.header_bytes = at;
+    frame.payload_bytes = payload;
+    return 1;
+}
+
+void unmaskPayload(uint8_t *payload, size_t bytes, const uint8_t mask[4], size_t offset)
+{
+    // Rotate the key to this piece's phase, then XOR eight bytes at a time
+    uint8_t key[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        key[i] = mask[(offset + i) & 3];
+    }
+    uint64_t key_word;
+    memcpy(&key_word, key, sizeof(key_word));
+
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, payload + i, sizeof(word));
+        word ^= key_word;
+        memcpy(payload + i, &word, sizeof(word));
+    }
+    for (; i < bytes; ++i)
+    {
+        payload[i] ^= key[i & 7];
+    }
+}
+
+size_t writeFrameHeader(uint8_t *out, uint8_t opcode, uint64_t payload_bytes)
+{
+    out[0] = 0x80 | opcode;
+    if (payload_bytes < 126)
+    {
+        out[1] = (uint8_t)payload_bytes;
+        return 2;
+    }
+    if (payload_bytes <= 0xFFFF)
+    {
+        out[1] = 126;
+        out[2] = (uint8_t)(payload_bytes >> 8);
+        out[3] = (uint8_t)payload_bytes;
+        return 4;
+    }
+    out[1] = 127;
+    for (int i = 0; i < 8; ++i)
+    {
+        out[2 + i] = (uint8_t)(payload_bytes >> (56 - 8 * i));
+    }
+    return 10;
+}
@@ -0,0 +1,64 @@
+// src/wire_packet.cpp
+
+#include <string.h>
+
+#include "wire_packet.h"
+
+static_assert(offsetof(AudioPacketHeader, crc32) + 4 == WIRE_HEADER_V1_BYTES, "Version 1 header prefix changed");
+
+const char *packetCheckName(uint8_t check)
+{
+    switch (check)
+    {
+    case PACKET_OK:
+        return "ok";
+    case PACKET_TRUNCATED:
+        return "truncated";
+    case PACKET_BAD_MAGIC:
+        return "bad_magic";
+    case PACKET_BAD_VERSION:
+        return "bad_version";
+    case PACKET_BAD_CRC:
+        return "bad_crc";
+    default:
+        return "unknown";
+    }
+}
+
+PacketCheck checkPacket(const uint8_t *data, size_t available, AudioPacketHeader &header, size_t &packet_bytes)
+{
+    if (available < WIRE_HEADER_V1_BYTES)
+    {
+        return PACKET_TRUNCATED;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(&header, data, WIRE_HEADER_V1_BYTES);
+    if (header.magic != AUDIO_PACKET_MAGIC)
+    {
+        return PACKET_BAD_MAGIC;
+    }
+    if (header.version < 1 || header.header_size < WIRE_HEADER_V1_BYTES)
+    {
+        return PACKET_BAD_VERSION;
+    }
+    packet_bytes = (size_t)header.header_size + header.payload_bytes;
+    if (packet_bytes > available)
+    {
+        return PACKET_TRUNCATED;
+    }
+    uint32_t crc = crc32Update(0, data, offsetof(AudioPacketHeader, crc32));
+    crc = crc32Update(crc, data + header.header_size, header.payload_bytes);
+    if (crc != header.crc32)
+    {
+        return PACKET_BAD_CRC;
+    }
+    // Later fields only as far as this sender's header goes
+    const size_t known = header.header_size < sizeof(header) ? header.header_size : sizeof(header);
+    memcpy(&header, data, known);
+    return PACKET_OK;
+}
+
+void wirePacketInit()
+{
+    crc32Update(0, nullptr, 0);
+}
@@ -0,0 +1,989 @@
+// src/worker.cpp
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <charconv>
+
+#include "worker.h"
+#include "gateway_clock.h"
+#include "logging.h"
+
+#define RTP_HEADER_BYTES 12 // udp_transport.h on the node
+#define BAD_PACKET_LOG_EVERY 1000
+
+Worker::Worker(unsigned worker_id, GatewayShared &gateway)
+    : id(worker_id), shared(gateway), config(gateway.config), stats(*gateway.stats[worker_id])
+{
+}
+
+Worker::~Worker()
+{
+    for (int fd : {listener.fd, udp.fd, wake.fd, timer.fd, epoll_fd})
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+}
+
+// === Setup ===
+static int openSocket(int type, const GatewayConfig &config, uint16_t port)
+{
+    const int fd = socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    const int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, config.bind_address.c_str(), &address.sin_addr) != 1 ||
+        bind(fd, (const sockaddr *)&address, sizeof(address)) != 0 ||
+        (type == SOCK_STREAM && listen(fd, GATEWAY_LISTEN_BACKLOG) != 0))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool Worker::watch(PollSource *source, uint32_t events)
+{
+    epoll_event event = {};
+    event.events = events;
+    event.data.ptr = source;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, source->fd, &event) == 0;
+}
+
+bool Worker::begin()
+{
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    timer.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epoll_fd < 0 || wake.fd < 0 || timer.fd < 0)
+    {
+        LOG_ERROR("Worker %u: epoll/eventfd/timerfd setup failed: %m", id);
+        return false;
+    }
+    itimerspec tick = {};
+    tick.it_interval.tv_sec = 1;
+    tick.it_value.tv_sec = 1;
+    timerfd_settime(timer.fd, 0, &tick, nullptr);
+
+    listener.fd = openSocket(SOCK_STREAM, config, config.port);
+    if (listener.fd < 0)
+    {
+        LOG_ERROR("Worker %u: cannot listen on %s:%u: %m", id, config.bind_address.c_str(), config.port);
+        return false;
+    }
+    if (config.udp_port)
+    {
+        udp.fd = openSocket(SOCK_DGRAM, config, config.udp_port);
+        if (udp.fd < 0)
+        {
+            LOG_ERROR("Worker %u: cannot bind UDP %s:%u: %m", id, config.bind_address.c_str(), config.udp_port);
+            return false;
+        }
+        udp_buffers.resize((size_t)GATEWAY_UDP_BATCH * GATEWAY_UDP_DATAGRAM_MAX);
+    }
+    if (!watch(&listener, EPOLLIN) || !watch(&wake, EPOLLIN) || !watch(&timer, EPOLLIN) ||
+        (udp.fd >= 0 && !watch(&udp, EPOLLIN)))
+    {
+        LOG_ERROR("Worker %u: epoll_ctl failed: %m", id);
+        return false;
+    }
+    return writer.begin(config.data_dir, id, config.segment_bytes);
+}
+
+void Worker::start()
+{
+    thread = std::thread([this]() { run(); });
+    cpu_set_t allowed;
+    if (config.pin_threads && sched_getaffinity(0, sizeof(allowed), &allowed) == 0 && CPU_COUNT(&allowed) > 0)
+    {
+        // The id-th CPU this process may use, wrapping if there are more workers
+        unsigned skip = id % (unsigned)CPU_COUNT(&allowed);
+        int cpu = 0;
+        while (!CPU_ISSET(cpu, &allowed) || skip-- > 0)
+        {
+            ++cpu;
+        }
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus) != 0)
+        {
+            LOG_WARN("Worker %u: could not pin to CPU %d", id, cpu);
+        }
+    }
+    char name[16];
+    snprintf(name, sizeof(name), "ingest-%u", id);
+    pthread_setname_np(thread.native_handle(), name);
+}
+
+void Worker::stop()
+{
+    stopping.store(true, std::memory_order_relaxed);
+    const uint64_t one = 1;
+    (void)!write(wake.fd, &one, sizeof(one));
+}
+
+void Worker::join()
+{
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+// === Event Loop ===
+void Worker::run()
+{
+    epoll_event events[GATEWAY_MAX_EVENTS];
+    last_sync_ms = monotonicMs();
+    while (!stopping.load(std::memory_order_relaxed))
+    {
+        const int ready = epoll_wait(epoll_fd, events, GATEWAY_MAX_EVENTS, -1);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            LOG_ERROR("Worker %u: epoll_wait failed: %m", id);
+            break;
+        }
+        for (int i = 0; i < ready; ++i)
+        {
+            PollSource *source = (PollSource *)events[i].data.ptr;
+            switch (source->kind)
+            {
+            case SOURCE_LISTENER:
+                acceptConnections();
+                break;
+            case SOURCE_UDP:
+                receiveDatagrams();
+                break;
+            case SOURCE_WAKE:
+            {
+                uint64_t count;
+                (void)!read(wake.fd, &count, sizeof(count));
+                serviceSubscribers();
+                break;
+            }
+            case SOURCE_TIMER:
+            {
+                uint64_t expirations;
+                (void)!read(timer.fd, &expirations, sizeof(expirations));
+                onTick();
+                break;
+            }
+            case SOURCE_CONNECTION:
+            {
+                Connection *conn = static_cast<Connection *>(source);
+                if (!conn->closed && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                {
+                    onReadable(conn);
+                }
+                if (!conn->closed && (events[i].events & EPOLLOUT))
+                {
+                    flushOutput(conn);
+                }
+                break;
+            }
+            }
+        }
+        graveyard.clear();
+    }
+
+    std::vector<Connection *> open;
+    for (auto &entry : connections)
+    {
+        open.push_back(entry.second.get());
+    }
+    for (Connection *conn : open)
+    {
+        closeConnection(conn, nullptr);
+    }
+    graveyard.clear();
+    writer.close();
+    onTick(); // Final counters for the exit summary
+}
+
+// === Connections ===
+void Worker::acceptConnections()
+{
+    while (true)
+    {
+        sockaddr_in peer = {};
+        socklen_t peer_length = sizeof(peer);
+        const int fd = accept4(listener.fd, (sockaddr *)&peer, &peer_length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                LOG_WARN("Worker %u: accept failed: %m", id);
+            }
+            return;
+        }
+        const int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        std::unique_ptr<Connection> conn(new Connection());
+        conn->kind = SOURCE_CONNECTION;
+        conn->fd = fd;
+        conn->ip = peer.sin_addr.s_addr;
+        conn->port = ntohs(peer.sin_port);
+        char ip_text[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &peer.sin_addr, ip_text, sizeof(ip_text));
+        snprintf(conn->name, sizeof(conn->name), "%s:%u", ip_text, conn->port);
+        conn->last_rx_ms = monotonicMs();
+        if (!conn->rx.begin(config.connection_buffer) || !watch(conn.get(), EPOLLIN))
+        {
+            LOG_WARN("Worker %u: dropping connection from %s, no buffer", id, conn->name);
+            close(fd);
+            continue;
+        }
+        connections[fd] = std::move(conn);
+    }
+}
+
+void Worker::closeConnection(Connection *conn, const char *why)
+{
+    if (conn->closed)
+    {
+        return;
+    }
+    conn->closed = true;
+    if (conn->role == ROLE_NODE)
+    {
+        stats.nodes.add(-1);
+        if (why)
+        {
+            LOG_INFO("Node %s disconnected (%s)", conn->name, why);
+        }
+    }
+    else if (conn->role == ROLE_SUBSCRIBER)
+    {
+        stats.subscribers.add(-1);
+        stats.subscriber_dropped.add(conn->queue->dropped());
+        shared.fanout.remove(conn->queue.get());
+        subscribers.erase(std::find(subscribers.begin(), subscribers.end(), conn));
+        if (why)
+        {
+            LOG_INFO("Subscriber %s disconnected (%s)", conn->name, why);
+        }
+    }
+    close(conn->fd); // Also leaves the epoll set
+    auto entry = connections.find(conn->fd);
+    if (entry != connections.end())
+    {
+        graveyard.push_back(std::move(entry->second));
+        connections.erase(entry);
+    }
+}
+
+void Worker::onReadable(Connection *conn)
+{
+    while (!conn->closed)
+    {
+        const size_t room = conn->rx.writable();
+        if (room == 0)
+        {
+            // A whole ring without one complete frame: processFrames() refuses those first
+            closeConnection(conn, "receive buffer full");
+            return;
+        }
+        const ssize_t got = recv(conn->fd, conn->rx.writePtr(), room, 0);
+        if (got == 0)
+        {
+            closeConnection(conn, "closed by peer");
+            return;
+        }
+        if (got < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                closeConnection(conn, strerror(errno));
+            }
+            return;
+        }
+        conn->rx.commit((size_t)got);
+        conn->last_rx_ms = monotonicMs();
+        if (!processInput(conn, unixTimeUs()))
+        {
+            return;
+        }
+        if ((size_t)got < room)
+        {
+            return; // Drained; level-triggered epoll brings us back for the rest
+        }
+    }
+}
+
+bool Worker::processInput(Connection *conn, int64_t arrival_us)
+{
+    if (conn->role == ROLE_HANDSHAKE && !processHandshake(conn))
+    {
+        return false;
+    }
+    if (conn->role == ROLE_NODE || conn->role == ROLE_SUBSCRIBER)
+    {
+        return processFrames(conn, arrival_us);
+    }
+    return !conn->closed;
+}
+
+bool Worker::processHandshake(Connection *conn)
+{
+    HttpRequest request;
+    const long used = parseHttpRequest(conn->rx.readPtr(), conn->rx.readable(), request);
+    if (used == 0)
+    {
+        return true;
+    }
+    if (used < 0)
+    {
+        stats.protocol_errors.add(1);
+        closeConnection(conn, "malformed HTTP request");
+        return false;
+    }
+    conn->rx.consume((size_t)used);
+
+    if (!request.upgrade || request.websocket_key.empty())
+    {
+        conn->role = ROLE_HTTP;
+        if (request.method == "GET" && request.path == "/metrics")
+        {
+            queueHttp(conn, 200, "OK", renderMetrics(shared), "text/plain; version=0.0.4");
+        }
+        else
+        {
+            queueHttp(conn, 404, "Not Found", "not found\n", "text/plain");
+        }
+        return false;
+    }
+
+    conn->tx += handshakeResponse(request.websocket_key);
+    if (request.path == "/subscribe")
+    {
+        uint32_t node = 0;
+        const size_t at = request.query.find("node=");
+        if (at != std::string::npos)
+        {
+            const std::string value = request.query.substr(at + 5, request.query.find('&', at) - at - 5);
+            in_addr address;
+            if (inet_pton(AF_INET, value.c_str(), &address) == 1)
+            {
+                node = address.s_addr;
+            }
+        }
+        conn->role = ROLE_SUBSCRIBER;
+        conn->queue = std::make_shared<SubscriberQueue>(config.subscriber_queue, node, wake.fd);
+        shared.fanout.add(conn->queue);
+        subscribers.push_back(conn);
+        stats.subscribers.add(1);
+        LOG_INFO("Subscriber %s connected (%s)", conn->name, node ? request.query.c_str() + at : "all nodes");
+    }
+    else
+    {
+        conn->role = ROLE_NODE;
+        stats.nodes.add(1);
+        LOG_INFO("Node %s connected on worker %u", conn->name, id);
+    }
+    flushOutput(conn);
+    return !conn->closed;
+}
+
+// === WebSocket Frames ===
+bool Worker::processFrames(Connection *conn, int64_t arrival_us)
+{
+    size_t used = 0;
+    bool ok = true;
+    while (ok)
+    {
+        uint8_t *data = conn->rx.readPtr() + used;
+        const size_t available = conn->rx.readable() - used;
+        WsFrame frame;
+        const int parsed = parseFrameHeader(data, available, frame);
+        if (parsed == 0)
+        {
+            break;
+        }
+        if (parsed < 0 || !frame.masked)
+        {
+            stats.protocol_errors.add(1);
+            closeConnection(conn, "WebSocket protocol error");
+            ok = false;
+            break;
+        }
+        const uint64_t frame_bytes = frame.header_bytes + frame.payload_bytes;
+        if (frame_bytes > conn->rx.capacity())
+        {
+            stats.protocol_errors.add(1);
+            closeConnection(conn, "frame larger than the receive buffer");
+            ok = false;
+            break;
+        }
+        if (available < frame_bytes)
+        {
+            break;
+        }
+        uint8_t *payload = data + frame.header_bytes;
+        unmaskPayload(payload, (size_t)frame.payload_bytes, frame.mask);
+        ok = handleFrame(conn, frame, payload, arrival_us);
+        used += (size_t)frame_bytes;
+    }
+    // Recorded packets point into the ring: write them out before it moves on
+    writer.flush();
+    if (!conn->closed)
+    {
+        conn->rx.consume(used);
+    }
+    return ok && !conn->closed;
+}
+
+bool Worker::handleFrame(Connection *conn, const WsFrame &frame, uint8_t *payload, int64_t arrival_us)
+{
+    const size_t bytes = (size_t)frame.payload_bytes;
+    switch (frame.opcode)
+    {
+    case WS_OPCODE_TEXT:
+    case WS_OPCODE_BINARY:
+        if (conn->in_fragment)
+        {
+            break; // New data frame inside a fragmented message
+        }
+        if (!frame.fin)
+        {
+            conn->in_fragment = true;
+            conn->fragment_opcode = frame.opcode;
+            conn->fragments.assign(payload, payload + bytes);
+            return true;
+        }
+        if (conn->role == ROLE_NODE)
+        {
+            if (frame.opcode == WS_OPCODE_BINARY)
+            {
+                handleNodeMessage(conn, payload, bytes, arrival_us);
+            }
+            else
+            {
+                handleText(conn, (const char *)payload, bytes, arrival_us);
+            }
+        }
+        return true; // Subscribers have nothing to say
+    case WS_OPCODE_CONTINUATION:
+        if (!conn->in_fragment || conn->fragments.size() + bytes > conn->rx.capacity())
+        {
+            break;
+        }
+        conn->fragments.insert(conn->fragments.end(), payload, payload + bytes);
+        if (frame.fin)
+        {
+            conn->in_fragment = false;
+            if (conn->role == ROLE_NODE && conn->fragment_opcode == WS_OPCODE_BINARY)
+            {
+                handleNodeMessage(conn, conn->fragments.data(), conn->fragments.size(), arrival_us);
+                writer.flush(); // Before the reassembly buffer is reused
+            }
+            else if (conn->role == ROLE_NODE)
+            {
+                handleText(conn, (const char *)conn->fragments.data(), conn->fragments.size(), arrival_us);
+            }
+            conn->fragments.clear();
+        }
+        return true;
+    case WS_OPCODE_PING:
+        queueFrame(conn, WS_OPCODE_PONG, payload, bytes);
+        flushOutput(conn);
+        return !conn->closed;
+    case WS_OPCODE_PONG:
+        return true;
+    case WS_OPCODE_CLOSE:
+        queueFrame(conn, WS_OPCODE_CLOSE, payload, bytes < 2 ? bytes : 2); // Echo the status code
+        conn->close_after_tx = true;
+        flushOutput(conn);
+        return false;
+    default:
+        break;
+    }
+    stats.protocol_errors.add(1);
+    closeConnection(conn, "WebSocket protocol error");
+    return false;
+}
+
+// === Packets ===
+void Worker::rejectPacket(uint8_t check, const char *from, uint64_t &count)
+{
+    stats.rejected[check].add(1);
+    if (count++ % BAD_PACKET_LOG_EVERY == 0)
+    {
+        LOG_WARN("Rejected packet from %s: %s (%llu so far)", from, packetCheckName(check), (unsigned long long)count);
+    }
+}
+
+void Worker::acceptPacket(const uint8_t *packet, size_t bytes, const AudioPacketHeader &header, uint32_t ip,
+                          uint16_t port, uint8_t transport, int64_t arrival_us)
+{
+    stats.packets[transport].add(1);
+    stats.packet_bytes.add(bytes);
+    // Spooled and pre-roll packets are late on purpose, not because of the link
+    if (header.wall_clock_us != 0 && !(header.flags & (PACKET_FLAG_SPOOLED | PACKET_FLAG_PREROLL)) &&
+        arrival_us > header.wall_clock_us)
+    {
+        stats.latency_us_sum.add((uint64_t)(arrival_us - header.wall_clock_us));
+        stats.latency_count.add(1);
+    }
+    writer.add(packet, bytes, header, ip, port, transport, arrival_us);
+}
+
+// A binary message: back-to-back packets. Everything up to the first bad one
+// is kept, as in server.py's iter_packets().
+void Worker::handleNodeMessage(Connection *conn, const uint8_t *data, size_t bytes, int64_t arrival_us)
+{
+    size_t offset = 0;
+    while (offset < bytes)
+    {
+        AudioPacketHeader header;
+        size_t packet_bytes = 0;
+        const PacketCheck check = checkPacket(data + offset, bytes - offset, header, packet_bytes);
+        if (check != PACKET_OK)
+        {
+            rejectPacket(check, conn->name, conn->rejected);
+            break;
+        }
+        acceptPacket(data + offset, packet_bytes, header, conn->ip, conn->port, INGEST_TRANSPORT_WS, arrival_us);
+        offset += packet_bytes;
+    }
+    shared.fanout.publish(conn->ip, data, offset);
+}
+
+// Finds "key": in a flat JSON object and returns where its value starts
+static const char *jsonValue(const char *text, size_t length, const char *key)
+{
+    char quoted[32];
+    const int quoted_length = snprintf(quoted, sizeof(quoted), "\"%s\"", key);
+    const char *end = text + length;
+    const char *at = (const char *)memmem(text, length, quoted, quoted_length);
+    if (!at)
+    {
+        return nullptr;
+    }
+    at += quoted_length;
+    while (at < end && (*at == ' ' || *at == ':'))
+    {
+        ++at;
+    }
+    return at < end ? at : nullptr;
+}
+
+static long long jsonInteger(const char *text, size_t length, const char *key)
+{
+    const char *value = jsonValue(text, length, key);
+    long long result = 0;
+    if (value)
+    {
+        std::from_chars(value, text + length, result); // The frame is not NUL-terminated, so bounded
+    }
+    return result;
+}
+
+void Worker::handleText(Connection *conn, const char *text, size_t length, int64_t arrival_us)
+{
+    const char *type = jsonValue(text, length, "type");
+    if (!type)
+    {
+        return;
+    }
+    const size_t type_room = text + length - type;
+    if (type_room >= 11 && memcmp(type, "\"time_ping\"", 11) == 0)
+    {
+        // Same reply as server.py's time_pong(): the node's t0 back, with our receive and send times
+        char pong[160];
+        const int pong_length = snprintf(pong, sizeof(pong),
+                                         "{\"type\":\"time_pong\",\"seq\":%lld,\"t0\":%lld,\"t1\":%lld,\"t2\":%lld}",
+                                         jsonInteger(text, length, "seq"), jsonInteger(text, length, "t0"),
+                                         (long long)arrival_us, (long long)unixTimeUs());
+        queueFrame(conn, WS_OPCODE_TEXT, pong, (size_t)pong_length);
+        flushOutput(conn);
+    }
+    else if (type_room >= 12 && memcmp(type, "\"flow_state\"", 12) == 0)
+    {
+        LOG_INFO("Flow state from %s: %.*s", conn->name, (int)length, text);
+    }
+}
+
+// === Output ===
+void Worker::queueFrame(Connection *conn, uint8_t opcode, const void *payload, size_t bytes)
+{
+    uint8_t header[WS_SERVER_HEADER_MAX];
+    const size_t header_bytes = writeFrameHeader(header, opcode, bytes);
+    conn->tx.append((const char *)header, header_bytes);
+    conn->tx.append((const char *)payload, bytes);
+}
+
+void Worker::queueHttp(Connection *conn, int status, const char *reason, const std::string &body, const char *type)
+{
+    char head[256];
+    snprintf(head, sizeof(head),
+             "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", status,
+             reason, type, body.size());
+    conn->tx += head;
+    conn->tx += body;
+    conn->close_after_tx = true;
+    flushOutput(conn);
+}
+
+void Worker::setWriting(Connection *conn, bool writing)
+{
+    if (conn->writing == writing)
+    {
+        return;
+    }
+    epoll_event event = {};
+    event.events = writing ? (uint32_t)(EPOLLIN | EPOLLOUT) : (uint32_t)EPOLLIN;
+    event.data.ptr = conn;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+    conn->writing = writing;
+}
+
+// True once conn->tx is fully sent
+bool Worker::flushTx(Connection *conn)
+{
+    while (conn->tx_sent < conn->tx.size())
+    {
+        const ssize_t sent = send(conn->fd, conn->tx.data() + conn->tx_sent, conn->tx.size() - conn->tx_sent,
+                                  MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                closeConnection(conn, strerror(errno));
+            }
+            else if (conn->tx.size() - conn->tx_sent > CONNECTION_TX_MAX)
+            {
+                closeConnection(conn, "not reading its replies");
+            }
+            return false;
+        }
+        conn->tx_sent += (size_t)sent;
+    }
+    conn->tx.clear();
+    conn->tx_sent = 0;
+    return true;
+}
+
+// True once the subscriber's queue is empty and everything taken from it is sent
+bool Worker::flushSubscriber(Connection *conn)
+{
+    while (true)
+    {
+        if (conn->inflight_count == 0)
+        {
+            while (conn->inflight_count < SUBSCRIBER_WRITE_BATCH && conn->queue->pop(conn->inflight[conn->inflight_count]))
+            {
+                const size_t i = conn->inflight_count++;
+                conn->inflight_header_bytes[i] =
+                    (uint8_t)writeFrameHeader(conn->inflight_headers[i], WS_OPCODE_BINARY, conn->inflight[i]->size());
+            }
+            conn->inflight_sent = 0;
+            if (conn->inflight_count == 0)
+            {
+                return true;
+            }
+        }
+
+        // The batch as iovecs, minus what an earlier partial write already sent
+        iovec iov[2 * SUBSCRIBER_WRITE_BATCH];
+        int iov_count = 0;
+        size_t skip = conn->inflight_sent;
+        for (size_t i = 0; i < conn->inflight_count; ++i)
+        {
+            const iovec parts[2] = {{conn->inflight_headers[i], conn->inflight_header_bytes[i]},
+                                    {(void *)conn->inflight[i]->data(), conn->inflight[i]->size()}};
+            for (const iovec &part : parts)
+            {
+                if (skip >= part.iov_len)
+                {
+                    skip -= part.iov_len;
+                    continue;
+                }
+                iov[iov_count++] = {(uint8_t *)part.iov_base + skip, part.iov_len - skip};
+                skip = 0;
+            }
+        }
+        msghdr message = {};
+        message.msg_iov = iov;
+        message.msg_iovlen = iov_count;
+        const ssize_t sent = sendmsg(conn->fd, &message, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                closeConnection(conn, strerror(errno));
+            }
+            return false;
+        }
+        conn->inflight_sent += (size_t)sent;
+        size_t total = 0;
+        for (size_t i = 0; i < conn->inflight_count; ++i)
+        {
+            total += conn->inflight_header_bytes[i] + conn->inflight[i]->size();
+        }
+        if (conn->inflight_sent < total)
+        {
+            return false; // Socket full mid-batch
+        }
+        for (size_t i = 0; i < conn->inflight_count; ++i)
+        {
+            conn->inflight[i].reset();
+        }
+        conn->inflight_count = 0;
+        // Control frames queued meanwhile go out between batches, never inside a frame
+        if (!conn->tx.empty() && !flushTx(conn))
+        {
+            return false;
+        }
+    }
+}
+
+void Worker::flushOutput(Connection *conn)
+{
+    bool done = conn->inflight_count > 0 ? flushSubscriber(conn) : true;
+    if (done && !conn->closed)
+    {
+        done = flushTx(conn);
+    }
+    if (done && !conn->closed && conn->role == ROLE_SUBSCRIBER)
+    {
+        done = flushSubscriber(conn);
+    }
+    if (conn->closed)
+    {
+        return;
+    }
+    if (done && conn->close_after_tx)
+    {
+        closeConnection(conn, nullptr);
+        return;
+    }
+    setWriting(conn, !done);
+}
+
+void Worker::serviceSubscribers()
+{
+    // Copy: flushing can close a subscriber, which edits the list
+    const std::vector<Connection *> pending(subscribers);
+    for (Connection *conn : pending)
+    {
+        if (!conn->closed && !conn->writing)
+        {
+            flushOutput(conn);
+        }
+    }
+}
+
+// === UDP / RTP ===
+void Worker::trackUdpSequence(uint32_t ip, uint16_t port, uint32_t sequence)
+{
+    UdpPeer &peer = udp_peers[ip];
+    peer.report.received++;
+    if (!peer.started || peer.port != port)
+    {
+        peer.started = true; // First datagram, or the node came back from a new socket
+        peer.port = port;
+        peer.next_sequence = sequence + 1;
+        return;
+    }
+    const int32_t delta = (int32_t)(sequence - peer.next_sequence);
+    if (delta == 0)
+    {
+        peer.next_sequence = sequence + 1;
+    }
+    else if (delta > 0 && delta < GATEWAY_UDP_RESYNC_PACKETS)
+    {
+        peer.report.lost += (uint64_t)delta;
+        stats.udp_lost.add((uint64_t)delta);
+        peer.next_sequence = sequence + 1;
+    }
+    else if (delta < 0 && delta > -GATEWAY_UDP_RESYNC_PACKETS)
+    {
+        // Counted as lost when the gap opened; it only came late
+        peer.report.reordered++;
+        stats.udp_reordered.add(1);
+        if (peer.report.lost > 0)
+        {
+            peer.report.lost--;
+            stats.udp_lost.add((uint64_t)-1);
+        }
+    }
+    else
+    {
+        peer.next_sequence = sequence + 1; // Node rebooted
+    }
+}
+
+void Worker::receiveDatagrams()
+{
+    for (int i = 0; i < GATEWAY_UDP_BATCH; ++i)
+    {
+        udp_iov[i] = {udp_buffers.data() + (size_t)i * GATEWAY_UDP_DATAGRAM_MAX, GATEWAY_UDP_DATAGRAM_MAX};
+    }
+    while (true)
+    {
+        for (int i = 0; i < GATEWAY_UDP_BATCH; ++i)
+        {
+            udp_messages[i].msg_hdr = {};
+            udp_messages[i].msg_hdr.msg_name = &udp_sources[i];
+            udp_messages[i].msg_hdr.msg_namelen = sizeof(udp_sources[i]);
+            udp_messages[i].msg_hdr.msg_iov = &udp_iov[i];
+            udp_messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        const int received = recvmmsg(udp.fd, udp_messages, GATEWAY_UDP_BATCH, MSG_DONTWAIT, nullptr);
+        if (received <= 0)
+        {
+            return;
+        }
+        const int64_t arrival_us = unixTimeUs();
+        for (int i = 0; i < received; ++i)
+        {
+            const uint8_t *data = (const uint8_t *)udp_iov[i].iov_base;
+            size_t length = udp_messages[i].msg_len;
+            const uint32_t ip = udp_sources[i].sin_addr.s_addr;
+            const uint16_t port = ntohs(udp_sources[i].sin_port);
+            uint8_t transport = INGEST_TRANSPORT_UDP;
+
+            // RTP version 2 has the top bits 10; the wire magic's first byte (0x43) does not
+            if (length >= RTP_HEADER_BYTES && (data[0] >> 6) == 2)
+            {
+                const size_t rtp_bytes = RTP_HEADER_BYTES + 4 * (data[0] & 0x0F); // Plus any CSRCs
+                if (length < rtp_bytes)
+                {
+                    continue;
+                }
+                data += rtp_bytes;
+                length -= rtp_bytes;
+                transport = INGEST_TRANSPORT_RTP;
+            }
+
+            AudioPacketHeader header;
+            size_t packet_bytes = 0;
+            char from[24];
+            const PacketCheck check = checkPacket(data, length, header, packet_bytes);
+            if (check != PACKET_OK)
+            {
+                char ip_text[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &udp_sources[i].sin_addr, ip_text, sizeof(ip_text));
+                snprintf(from, sizeof(from), "udp:%s", ip_text);
+                rejectPacket(check, from, udp_rejected);
+                continue;
+            }
+            trackUdpSequence(ip, port, header.sequence);
+            acceptPacket(data, packet_bytes, header, ip, port, transport, arrival_us);
+            shared.fanout.publish(ip, data, packet_bytes);
+        }
+        // Recorded packets point into the batch buffers
+        writer.flush();
+        if (received < GATEWAY_UDP_BATCH)
+        {
+            return;
+        }
+    }
+}
+
+// === Housekeeping ===
+void Worker::onTick()
+{
+    const uint64_t now = monotonicMs();
+    if (config.sync_ms && now - last_sync_ms >= config.sync_ms)
+    {
+        writer.sync();
+        last_sync_ms = now;
+    }
+    const SegmentStats &segments = writer.stats();
+    stats.segment_records.set(segments.records);
+    stats.segment_bytes.set(segments.bytes);
+    stats.segment_files.set(segments.segments);
+    stats.segment_dropped.set(segments.dropped);
+    stats.segment_errors.set(segments.write_errors);
+
+    for (const auto &entry : udp_peers)
+    {
+        shared.udp_peers.publish(entry.first, entry.second.report);
+    }
+
+    // Flushing or closing can erase from `connections`, so both wait until the walk is over
+    std::vector<Connection *> idle;
+    std::vector<Connection *> reported;
+    for (auto &entry : connections)
+    {
+        Connection *conn = entry.second.get();
+        if (conn->role != ROLE_SUBSCRIBER && config.idle_timeout_s &&
+            now - conn->last_rx_ms >= (uint64_t)config.idle_timeout_s * 1000)
+        {
+            idle.push_back(conn);
+            continue;
+        }
+        // Loss on the datagram path, reported over the node's WebSocket
+        UdpPeerReport report;
+        if (conn->role == ROLE_NODE && shared.udp_peers.lookup(conn->ip, report) &&
+            report.received != conn->udp_reported.received)
+        {
+            char message[160];
+            const int length = snprintf(message, sizeof(message),
+                                        "{\"type\":\"udp_stats\",\"received\":%llu,\"lost\":%llu,\"reordered\":%llu,\"late\":0}",
+                                        (unsigned long long)report.received, (unsigned long long)report.lost,
+                                        (unsigned long long)report.reordered);
+            queueFrame(conn, WS_OPCODE_TEXT, message, (size_t)length);
+            conn->udp_reported = report;
+            if (!conn->writing)
+            {
+                reported.push_back(conn);
+            }
+        }
+    }
+    for (Connection *conn : reported)
+    {
+        if (!conn->closed)
+        {
+            flushOutput(conn);
+        }
+    }
+    for (Connection *conn : idle)
+    {
+        closeConnection(conn, "idle timeout");
+    }
+}